@@ -0,0 +1,181 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <set>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/IncludeScanner.h"
+#include "thekogans/make/core/ProjectGraph.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        bool list;
+        std::string config;
+        std::string type;
+        std::string target;
+        util::ui32 concurrency;
+        std::string base;
+        std::string changes;
+        std::string project_root;
+        std::set<std::string> paths;
+
+        Options () :
+            help (false),
+            list (false),
+            config (CONFIG_DEBUG),
+            type (TYPE_STATIC),
+            target (TARGET_ALL),
+            concurrency (1),
+            base (make::core::_DEVELOPMENT_ROOT) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 'l':
+                    list = true;
+                    break;
+                case 'c':
+                    config = value;
+                    break;
+                case 't':
+                    type = value;
+                    break;
+                case 'g':
+                    target = value;
+                    break;
+                case 'j':
+                    concurrency = util::stringToui32 (value.c_str ());
+                    break;
+                case 'r':
+                    base = value;
+                    break;
+                case 'f':
+                    changes = value;
+                    break;
+            }
+        }
+
+        virtual void DoPath (const std::string &path) {
+            if (project_root.empty ()) {
+                project_root = path;
+            }
+            else {
+                AddPath (path);
+            }
+        }
+
+        void AddPath (const std::string &path) {
+            std::string trimmed = util::TrimSpaces (path.c_str ());
+            if (!trimmed.empty ()) {
+                paths.insert (
+                    trimmed[0] == PATH_SEPARATOR_CHAR ?
+                        trimmed : make::core::MakePath (base, trimmed));
+            }
+        }
+    };
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "ctgjrf");
+    if (options.help || options.project_root.empty ()) {
+        std::cout << "usage: " << argv[0] << " [-h] [-l] [-c:Debug|Release] [-t:Static|Shared] "
+            "[-g:target] [-j:concurrency] [-r:base] [-f:changes_file|-] project_root [path...]" << std::endl <<
+            "  Relative paths (git diff --name-only) are resolved against base "
+            "($(DEVELOPMENT_ROOT) by default)." << std::endl;
+        return options.help ? 0 : 1;
+    }
+    THEKOGANS_UTIL_TRY {
+        if (!options.changes.empty ()) {
+            std::ifstream file;
+            if (options.changes != "-") {
+                file.open (options.changes.c_str ());
+                if (!file.is_open ()) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to open: %s.",
+                        options.changes.c_str ());
+                }
+            }
+            std::istream &stream = options.changes != "-" ? file : std::cin;
+            std::string line;
+            while (std::getline (stream, line)) {
+                options.AddPath (line);
+            }
+        }
+        if (options.list) {
+            make::core::ProjectGraph graph (
+                options.project_root,
+                options.config,
+                options.target == TARGET_TESTS || options.target == TARGET_TESTS_SELF ?
+                    TYPE_STATIC : options.type);
+            std::set<std::string> affectedProjects;
+            std::set<std::string> unownedPaths;
+            // List the same slice BuildAffectedProjects builds.
+            if (options.target == TARGET_TESTS || options.target == TARGET_TESTS_SELF) {
+                make::core::IncludeScanner includeScanner;
+                graph.GetImpactedProjects (
+                    options.paths, includeScanner, affectedProjects, &unownedPaths);
+                includeScanner.Save ();
+            }
+            else {
+                graph.GetAffectedProjects (options.paths, affectedProjects, &unownedPaths);
+            }
+            for (std::set<std::string>::const_iterator
+                    it = affectedProjects.begin (),
+                    end = affectedProjects.end (); it != end; ++it) {
+                std::cout << *it << std::endl;
+            }
+            for (std::set<std::string>::const_iterator
+                    it = unownedPaths.begin (),
+                    end = unownedPaths.end (); it != end; ++it) {
+                std::cerr << "Not in graph: " << *it << std::endl;
+            }
+        }
+        else {
+            make::core::BuildAffectedProjects (
+                options.project_root,
+                options.config,
+                options.type,
+                MODE_DEVELOPMENT,
+                false,
+                false,
+                options.target,
+                options.concurrency,
+                options.paths);
+        }
+        return 0;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,176 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/Path.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Benchmark.h"
+#include "thekogans/make/core/Baseline.h"
+
+using namespace thekogans;
+
+namespace {
+    enum {
+        EXIT_OK,
+        EXIT_REGRESSION,
+        EXIT_ERROR
+    };
+
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        std::string directory;
+        std::string save;
+        std::string compare;
+        util::f64 threshold;
+        util::f64 noise;
+        std::string results;
+
+        Options () :
+            help (false),
+            directory ("baselines"),
+            threshold (make::core::Baseline::DEFAULT_THRESHOLD / 100.0),
+            noise (make::core::Baseline::DEFAULT_NOISE) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 'd':
+                    directory = value;
+                    break;
+                case 's':
+                    save = value;
+                    break;
+                case 'c':
+                    compare = value;
+                    break;
+                case 't':
+                    threshold = util::stringTof64 (value.c_str ()) / 100.0;
+                    break;
+                case 'm':
+                    noise = util::stringTof64 (value.c_str ());
+                    break;
+            }
+        }
+
+        virtual void DoPath (const std::string &path) {
+            results = path;
+        }
+    };
+
+    std::string ReadFile (const std::string &path) {
+        std::fstream file (path.c_str (), std::fstream::in);
+        if (!file.is_open ()) {
+            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                "Unable to open: %s.",
+                path.c_str ());
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf ();
+        return contents.str ();
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "dsctm");
+    if (options.help || options.results.empty () ||
+            options.save.empty () == options.compare.empty ()) {
+        std::cout << "usage: " << argv[0] << " [-h] [-d:directory] "
+            "-s:name | -c:name [-t:threshold_percent] [-m:noise_mads] results.json" << std::endl;
+        return options.help ? EXIT_OK : EXIT_ERROR;
+    }
+    THEKOGANS_UTIL_TRY {
+        std::string suite;
+        make::core::Benchmark::Parameters parameters;
+        make::core::Benchmark::Results results;
+        make::core::Benchmark::FromJSON (ReadFile (options.results), suite, parameters, results);
+        if (!options.save.empty ()) {
+            make::core::Baseline baseline (
+                make::core::Baseline::GetPath (options.directory, options.save));
+            baseline.name = options.save;
+            baseline.suite = suite;
+            baseline.parameters = parameters;
+            baseline.results = results;
+            baseline.Save ();
+            std::cout << "Saved baseline " << options.save << " (" <<
+                results.size () << " results) to " << baseline.path << std::endl;
+            return EXIT_OK;
+        }
+        std::string path = make::core::Baseline::GetPath (options.directory, options.compare);
+        if (!util::Path (path).Exists ()) {
+            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                "Baseline not found: %s.",
+                path.c_str ());
+        }
+        make::core::Baseline baseline (path);
+        if (baseline.suite != suite) {
+            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                "Baseline %s is for suite '%s', results are for suite '%s'.",
+                options.compare.c_str (),
+                baseline.suite.c_str (),
+                suite.c_str ());
+        }
+        if (baseline.parameters != parameters) {
+            std::cout << "Warning: suite parameters differ from baseline " <<
+                options.compare << "." << std::endl;
+        }
+        make::core::Baseline::Comparisons comparisons;
+        util::ui32 regressions =
+            baseline.Compare (results, options.threshold, options.noise, comparisons);
+        for (make::core::Baseline::Comparisons::const_iterator
+                it = comparisons.begin (),
+                end = comparisons.end (); it != end; ++it) {
+            if (it->missing) {
+                std::cout << util::FormatString (
+                    "%-60s %14.3f %14s %9s %-9s %s",
+                    it->name.c_str (),
+                    it->baselineMedian,
+                    "-",
+                    "-",
+                    it->unit.c_str (),
+                    "MISSING") << std::endl;
+                continue;
+            }
+            std::cout << util::FormatString (
+                "%-60s %14.3f %14.3f %+8.2f%% %-9s %s",
+                it->name.c_str (),
+                it->baselineMedian,
+                it->currentMedian,
+                it->change * 100.0,
+                it->unit.c_str (),
+                it->regression ? "REGRESSION" : "") << std::endl;
+        }
+        std::cout << regressions << " regression(s) past " <<
+            options.threshold * 100.0 << "% (missing results included)." << std::endl;
+        return regressions > 0 ? EXIT_REGRESSION : EXIT_OK;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return EXIT_ERROR;
+    }
+}
@@ -0,0 +1,155 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <fstream>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Benchmark.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        make::core::Benchmark::GraphParameters graphParameters;
+        std::string config;
+        util::ui32 runs;
+        bool keep;
+        std::string output;
+
+        Options () :
+            help (false),
+            config (CONFIG_DEBUG),
+            runs (5),
+            keep (false) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 'O':
+                    graphParameters.organization = value;
+                    break;
+                case 'n':
+                    graphParameters.projectCount = util::stringToui32 (value.c_str ());
+                    break;
+                case 'd':
+                    graphParameters.depth = util::stringToui32 (value.c_str ());
+                    break;
+                case 'f':
+                    graphParameters.fanOut = util::stringToui32 (value.c_str ());
+                    break;
+                case 'D':
+                    graphParameters.diamondDensity = util::stringTof32 (value.c_str ());
+                    break;
+                case 'C':
+                    graphParameters.conditionalDensity = util::stringTof32 (value.c_str ());
+                    break;
+                case 'R':
+                    graphParameters.regexDensity = util::stringTof32 (value.c_str ());
+                    break;
+                case 's':
+                    graphParameters.sourceCount = util::stringToui32 (value.c_str ());
+                    break;
+                case 'g':
+                    graphParameters.goalSize = util::stringToui32 (value.c_str ());
+                    break;
+                case 'S':
+                    graphParameters.seed = util::stringToui32 (value.c_str ());
+                    break;
+                case 'c':
+                    config = value;
+                    break;
+                case 'r':
+                    runs = util::stringToui32 (value.c_str ());
+                    break;
+                case 'k':
+                    keep = true;
+                    break;
+                case 'o':
+                    output = value;
+                    break;
+            }
+        }
+    };
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "OndfDCRsgScro");
+    if (options.help) {
+        std::cout << "usage: " << argv[0] << " [-h] [-O:organization] [-n:projects] "
+            "[-d:depth] [-f:fan_out] [-D:diamond_density] [-C:conditional_density] "
+            "[-R:regex_density] [-s:sources] [-g:goal_size] [-S:seed] "
+            "[-c:config] [-r:runs] [-k] [-o:output.json]" << std::endl;
+        return 0;
+    }
+    THEKOGANS_UTIL_TRY {
+        std::string project_root =
+            make::core::Benchmark::GenerateGraph (options.graphParameters);
+        make::core::Benchmark::Results results;
+        try {
+            make::core::Benchmark::RunGraph (project_root, options.config, options.runs, results);
+        }
+        catch (...) {
+            // Don't leave a half benchmarked graph behind.
+            if (!options.keep) {
+                make::core::Benchmark::DeleteGraph (options.graphParameters);
+            }
+            throw;
+        }
+        if (!options.keep) {
+            make::core::Benchmark::DeleteGraph (options.graphParameters);
+        }
+        make::core::Benchmark::Parameters parameters;
+        options.graphParameters.GetParameters (parameters);
+        parameters["config"] = options.config;
+        parameters["runs"] = util::ui32Tostring (options.runs);
+        std::string json = make::core::Benchmark::ToJSON ("graph", parameters, results);
+        if (options.output.empty ()) {
+            std::cout << json;
+            std::cout.flush ();
+        }
+        else {
+            std::fstream file (
+                options.output.c_str (),
+                std::fstream::out | std::fstream::trunc);
+            if (file.is_open ()) {
+                file << json;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "Unable to open: %s.",
+                    options.output.c_str ());
+            }
+        }
+        return 0;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return 1;
+    }
+}
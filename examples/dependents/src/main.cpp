@@ -0,0 +1,120 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <string>
+#include <list>
+#include <set>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/DependentsIndex.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        bool all;
+        std::string root;
+        util::ui32 workerCount;
+        std::list<std::string> projects;
+
+        Options () :
+            help (false),
+            all (false),
+            root (make::core::_DEVELOPMENT_ROOT),
+            workerCount (0) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 'a':
+                    all = true;
+                    break;
+                case 'r':
+                    root = value;
+                    break;
+                case 'j':
+                    workerCount = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+
+        virtual void DoPath (const std::string &path) {
+            projects.push_back (path);
+        }
+    };
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "rj");
+    if (options.help) {
+        std::cout << "usage: " << argv[0] << " [-h] [-a] [-r:root] [-j:workers] "
+            "[organization_project...]" << std::endl <<
+            "  -a lists transitive dependents." << std::endl;
+        return 0;
+    }
+    THEKOGANS_UTIL_TRY {
+        make::core::DependentsIndex index (options.root);
+        util::ui32 parsed = index.Refresh (options.workerCount);
+        index.Save ();
+        std::cout << "Indexed " << index.entries.size () << " configs (" <<
+            parsed << " reparsed)." << std::endl;
+        if (!index.IsComplete ()) {
+            // The dependents listed below might be missing any of these.
+            std::cout << "Unresolved dependencies (evaluate to be sure):" << std::endl;
+            const std::set<std::string> &unresolved = index.GetUnresolved ();
+            for (std::set<std::string>::const_iterator
+                    it = unresolved.begin (),
+                    end = unresolved.end (); it != end; ++it) {
+                std::cout << "  " << *it << std::endl;
+            }
+        }
+        for (std::list<std::string>::const_iterator
+                it = options.projects.begin (),
+                end = options.projects.end (); it != end; ++it) {
+            std::set<std::string> dependents;
+            if (options.all) {
+                index.GetAllDependents (*it, dependents);
+            }
+            else {
+                dependents = index.GetDependents (*it);
+            }
+            std::cout << *it << ":" << std::endl;
+            for (std::set<std::string>::const_iterator
+                    jt = dependents.begin (),
+                    end = dependents.end (); jt != end; ++jt) {
+                std::cout << "  " << *jt << std::endl;
+            }
+        }
+        return 0;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return 1;
+    }
+}
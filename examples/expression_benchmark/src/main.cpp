@@ -0,0 +1,225 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <new>
+#include <iostream>
+#include <fstream>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/thekogans_make.h"
+#include "thekogans/make/core/Function.h"
+#include "thekogans/make/core/Value.h"
+#include "thekogans/make/core/Benchmark.h"
+
+using namespace thekogans;
+
+// Count every allocation so that the benchmarks can report allocs/op.
+void *operator new (std::size_t size) {
+    make::core::Benchmark::CountAllocation ();
+    void *ptr = malloc (size > 0 ? size : 1);
+    if (ptr == 0) {
+        throw std::bad_alloc ();
+    }
+    return ptr;
+}
+
+void operator delete (void *ptr) noexcept {
+    free (ptr);
+}
+
+namespace {
+    // The built-in corpus exercises have_feature the same way real
+    // thekogans_make.xml files do. make_core does not provide it (the
+    // thekogans_make driver does), so register a version of it here.
+    // Without it Function::Exec would return an empty Value and the
+    // function entries would time a no-op.
+    struct have_feature : public make::core::Function {
+        THEKOGANS_MAKE_CORE_DECLARE_FUNCTION (have_feature)
+
+        virtual make::core::Value Exec (
+                const make::core::thekogans_make &config,
+                const Parameters &parameters) const {
+            std::string feature;
+            for (Parameters::const_iterator
+                    it = parameters.begin (),
+                    end = parameters.end (); it != end; ++it) {
+                if (it->first == "f") {
+                    feature = it->second;
+                }
+                else {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unknown have_feature parameter: %s",
+                        it->first.c_str ());
+                }
+            }
+            if (feature.empty ()) {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION ("%s",
+                    "have_feature requires a -f:feature parameter.");
+            }
+            return make::core::Value (config.HasFeature (feature));
+        }
+    };
+
+    THEKOGANS_MAKE_CORE_IMPLEMENT_FUNCTION (have_feature)
+
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        std::string config;
+        util::ui32 runs;
+        util::ui64 iterations;
+        std::list<std::string> corpora;
+        bool builtin;
+        std::string output;
+
+        Options () :
+            help (false),
+            config (CONFIG_DEBUG),
+            runs (5),
+            iterations (10000),
+            builtin (true) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 'c':
+                    config = value;
+                    break;
+                case 'r':
+                    runs = util::stringToui32 (value.c_str ());
+                    break;
+                case 'i':
+                    iterations = util::stringToui64 (value.c_str ());
+                    break;
+                case 'x':
+                    corpora.push_back (value);
+                    break;
+                case 'b':
+                    builtin = false;
+                    break;
+                case 'o':
+                    output = value;
+                    break;
+            }
+        }
+    };
+
+    // Corpus files contain one expression per line:
+    // condition|format|function name text
+    // Empty lines and lines starting with '#' are ignored.
+    void LoadCorpus (
+            const std::string &path,
+            make::core::Benchmark::Corpus &corpus) {
+        std::fstream file (path.c_str (), std::fstream::in);
+        if (file.is_open ()) {
+            std::string line;
+            while (std::getline (file, line)) {
+                line = util::TrimSpaces (line.c_str ());
+                if (!line.empty () && line[0] != '#') {
+                    corpus.push_back (make::core::Benchmark::Expression::Parse (line));
+                }
+            }
+        }
+        else {
+            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                "Unable to open: %s.",
+                path.c_str ());
+        }
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "crixo");
+    if (options.help) {
+        std::cout << "usage: " << argv[0] << " [-h] [-c:config] [-r:runs] "
+            "[-i:iterations] [-x:corpus] [-b] [-o:output.json]" << std::endl;
+        return 0;
+    }
+    THEKOGANS_UTIL_TRY {
+        make::core::Benchmark::Corpus corpus;
+        if (options.builtin) {
+            make::core::Benchmark::GetExpressionCorpus (corpus);
+        }
+        for (std::list<std::string>::const_iterator
+                it = options.corpora.begin (),
+                end = options.corpora.end (); it != end; ++it) {
+            LoadCorpus (*it, corpus);
+        }
+        // A single project gives the corpus a realistic symbol table.
+        make::core::Benchmark::GraphParameters graphParameters;
+        graphParameters.organization = "thekogans_make_core_expression_benchmark";
+        graphParameters.projectCount = 1;
+        std::string project_root =
+            make::core::Benchmark::GenerateGraph (graphParameters);
+        make::core::Benchmark::Results results;
+        try {
+            make::core::Benchmark::RunExpressions (
+                make::core::thekogans_make::GetConfig (
+                    project_root,
+                    THEKOGANS_MAKE_XML,
+                    MAKE,
+                    options.config,
+                    TYPE_SHARED),
+                corpus,
+                options.runs,
+                options.iterations,
+                results);
+        }
+        catch (...) {
+            make::core::Benchmark::DeleteGraph (graphParameters);
+            throw;
+        }
+        make::core::Benchmark::DeleteGraph (graphParameters);
+        make::core::Benchmark::Parameters parameters;
+        parameters["config"] = options.config;
+        parameters["runs"] = util::ui32Tostring (options.runs);
+        parameters["iterations"] = util::ui64Tostring (options.iterations);
+        std::string json = make::core::Benchmark::ToJSON ("expression", parameters, results);
+        if (options.output.empty ()) {
+            std::cout << json;
+            std::cout.flush ();
+        }
+        else {
+            std::fstream file (
+                options.output.c_str (),
+                std::fstream::out | std::fstream::trunc);
+            if (file.is_open ()) {
+                file << json;
+            }
+            else {
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "Unable to open: %s.",
+                    options.output.c_str ());
+            }
+        }
+        return 0;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,112 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <string>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/BuildGraph.h"
+#include "thekogans/make/core/Executor.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        bool list;
+        std::string config;
+        std::string type;
+        util::ui32 concurrency;
+        std::string project_root;
+
+        Options () :
+            help (false),
+            list (false),
+            config (CONFIG_DEBUG),
+            type (TYPE_STATIC),
+            concurrency (0) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 'l':
+                    list = true;
+                    break;
+                case 'c':
+                    config = value;
+                    break;
+                case 't':
+                    type = value;
+                    break;
+                case 'j':
+                    concurrency = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+
+        virtual void DoPath (const std::string &path) {
+            project_root = path;
+        }
+    };
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "ctj");
+    if (options.help || options.project_root.empty ()) {
+        std::cout << "usage: " << argv[0] << " [-h] [-l] [-c:Debug|Release] [-t:Static|Shared] "
+            "[-j:concurrency] project_root" << std::endl <<
+            "  -l lists the actions instead of running them." << std::endl;
+        return options.help ? 0 : 1;
+    }
+    THEKOGANS_UTIL_TRY {
+        if (options.list) {
+            make::core::BuildGraph graph (
+                options.project_root,
+                "make",
+                options.config,
+                options.type);
+            make::core::Executor executor (graph);
+            const std::vector<make::core::Executor::Action> &actions = executor.GetActions ();
+            for (std::size_t i = 0, count = actions.size (); i < count; ++i) {
+                std::cout << i << ": " << actions[i].GetCommandLine () << std::endl;
+            }
+        }
+        else {
+            util::ui32 ran = make::core::BuildProjectNative (
+                options.project_root,
+                options.config,
+                options.type,
+                options.concurrency);
+            std::cout << ran << " action(s) ran." << std::endl;
+        }
+        return 0;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return 1;
+    }
+}
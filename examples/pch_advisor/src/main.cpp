@@ -0,0 +1,149 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/BuildGraph.h"
+#include "thekogans/make/core/IncludeScanner.h"
+#include "thekogans/make/core/PrecompiledHeaderAdvisor.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        std::string config;
+        std::string type;
+        std::string traces;
+        util::ui32 percentage;
+        util::ui32 count;
+        std::string project_root;
+
+        Options () :
+            help (false),
+            config (CONFIG_DEBUG),
+            type (TYPE_STATIC),
+            percentage (make::core::PrecompiledHeaderAdvisor::DEFAULT_MIN_INCLUSION_PERCENTAGE),
+            count (make::core::PrecompiledHeaderAdvisor::DEFAULT_MAX_HEADERS) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 'c':
+                    config = value;
+                    break;
+                case 't':
+                    type = value;
+                    break;
+                case 'r':
+                    traces = value;
+                    break;
+                case 'p':
+                    percentage = util::stringToui32 (value.c_str ());
+                    break;
+                case 'n':
+                    count = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+
+        virtual void DoPath (const std::string &path) {
+            project_root = path;
+        }
+    };
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "ctrpn");
+    if (options.help || options.project_root.empty ()) {
+        std::cout << "usage: " << argv[0] << " [-h] [-c:Debug|Release] [-t:Static|Shared] "
+            "[-r:time_traces] [-p:min_inclusion_percentage] [-n:max_headers] project_root" << std::endl <<
+            "  -r directory with clang -ftime-trace files (default: $(build_root)/native)." << std::endl;
+        return options.help ? 0 : 1;
+    }
+    THEKOGANS_UTIL_TRY {
+        make::core::BuildGraph graph (
+            options.project_root,
+            "make",
+            options.config,
+            options.type);
+        const make::core::BuildGraph::Project &project = graph.GetRoot ();
+        make::core::PrecompiledHeaderAdvisor::ParseCosts costs;
+        make::core::PrecompiledHeaderAdvisor::LoadTimeTraces (
+            !options.traces.empty () ? options.traces : make::core::MakePath (project.build_root, "native"),
+            costs);
+        std::cout << (costs.empty () ? "No time traces found, costs are in bytes." :
+            "Costs are in microseconds.") << std::endl;
+        std::vector<std::string> includeDirectories (
+            project.include_directories.begin (),
+            project.include_directories.end ());
+        make::core::IncludeScanner includeScanner;
+        for (std::vector<make::core::BuildGraph::Language>::const_iterator
+                it = project.languages.begin (),
+                end = project.languages.end (); it != end; ++it) {
+            if (it->sources.empty ()) {
+                continue;
+            }
+            std::vector<make::core::PrecompiledHeaderAdvisor::Candidate> candidates;
+            std::size_t sourceCount = make::core::PrecompiledHeaderAdvisor::GetCandidates (
+                it->sources,
+                includeDirectories,
+                includeScanner,
+                costs,
+                candidates);
+            std::cout << it->name << " (" << sourceCount << " source(s)):" << std::endl;
+            for (std::size_t i = 0, count = candidates.size (); i < count; ++i) {
+                std::cout << "  " << candidates[i].header << ": included by " <<
+                    candidates[i].count << ", cost " << candidates[i].cost <<
+                    ", score " << candidates[i].score << std::endl;
+            }
+            std::vector<std::string> headers;
+            make::core::PrecompiledHeaderAdvisor::GetRecommended (
+                candidates,
+                sourceCount,
+                project.project_root,
+                includeDirectories,
+                includeScanner,
+                headers,
+                options.percentage,
+                options.count);
+            std::cout << "recommended:" << std::endl;
+            for (std::size_t i = 0, count = headers.size (); i < count; ++i) {
+                std::cout << "  " << headers[i] << std::endl;
+            }
+        }
+        includeScanner.Save ();
+        return 0;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return 1;
+    }
+}
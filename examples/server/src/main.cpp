@@ -0,0 +1,108 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <csignal>
+#include <iostream>
+#include <string>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Server.h"
+
+using namespace thekogans;
+
+namespace {
+    enum {
+        EXIT_OK,
+        EXIT_FAILED,
+        EXIT_ERROR
+    };
+
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        bool serve;
+        std::string path;
+        std::string request;
+
+        Options () :
+            help (false),
+            serve (false),
+            path (make::core::Server::GetDefaultPath ()) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 's':
+                    serve = true;
+                    break;
+                case 'p':
+                    path = value;
+                    break;
+            }
+        }
+
+        virtual void DoPath (const std::string &path) {
+            if (!request.empty ()) {
+                request += " ";
+            }
+            request += path;
+        }
+    };
+
+    make::core::Server *server = 0;
+
+    void StopHandler (int /*signal*/) {
+        if (server != 0) {
+            server->Stop ();
+        }
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "p");
+    if (options.help || options.serve == !options.request.empty ()) {
+        std::cout << "usage: " << argv[0] << " [-h] [-p:socket_path] -s | request" << std::endl <<
+            "  build project_root [config] [type] [target] [concurrency]" << std::endl <<
+            "  generate project_root [generator] [config] [type] [force]" << std::endl <<
+            "  query project_root what [config] [type]" << std::endl;
+        return options.help ? EXIT_OK : EXIT_ERROR;
+    }
+    THEKOGANS_UTIL_TRY {
+        if (options.serve) {
+            make::core::Server server_ (options.path);
+            server = &server_;
+            signal (SIGINT, StopHandler);
+            signal (SIGTERM, StopHandler);
+            server_.Run ();
+            server = 0;
+            return EXIT_OK;
+        }
+        return make::core::Server::SendRequest (
+            options.path, options.request, std::cout) ? EXIT_OK : EXIT_FAILED;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return EXIT_ERROR;
+    }
+}
@@ -0,0 +1,179 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/ProjectGraph.h"
+#include "thekogans/make/core/IncludeScanner.h"
+#include "thekogans/make/core/TestRunner.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        bool list;
+        std::string config;
+        util::ui32 concurrency;
+        std::string junit;
+        std::string base;
+        std::string changes;
+        std::string project_root;
+        std::set<std::string> paths;
+
+        Options () :
+            help (false),
+            list (false),
+            config (CONFIG_DEBUG),
+            concurrency (0),
+            base (make::core::_DEVELOPMENT_ROOT) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 'l':
+                    list = true;
+                    break;
+                case 'c':
+                    config = value;
+                    break;
+                case 'j':
+                    concurrency = util::stringToui32 (value.c_str ());
+                    break;
+                case 'r':
+                    junit = value;
+                    break;
+                case 'b':
+                    base = value;
+                    break;
+                case 'f':
+                    changes = value;
+                    break;
+            }
+        }
+
+        virtual void DoPath (const std::string &path) {
+            if (project_root.empty ()) {
+                project_root = path;
+            }
+            else {
+                AddPath (path);
+            }
+        }
+
+        void AddPath (const std::string &path) {
+            std::string trimmed = util::TrimSpaces (path.c_str ());
+            if (!trimmed.empty ()) {
+                paths.insert (
+                    trimmed[0] == PATH_SEPARATOR_CHAR ?
+                        trimmed : make::core::MakePath (base, trimmed));
+            }
+        }
+    };
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "cjrbf");
+    if (options.help || options.project_root.empty ()) {
+        std::cout << "usage: " << argv[0] << " [-h] [-l] [-c:Debug|Release] "
+            "[-j:concurrency] [-r:junit_report] [-b:base] [-f:changes_file|-] "
+            "project_root [path...]" << std::endl <<
+            "  -l lists the tests (longest first) instead of running them." << std::endl <<
+            "  If changed paths are given, only the tests they impact run. Relative" << std::endl <<
+            "  paths (git diff --name-only) are resolved against base "
+            "($(DEVELOPMENT_ROOT) by default)." << std::endl <<
+            "  Build the tests target first." << std::endl;
+        return options.help ? 0 : 1;
+    }
+    THEKOGANS_UTIL_TRY {
+        if (!options.changes.empty ()) {
+            std::ifstream file;
+            if (options.changes != "-") {
+                file.open (options.changes.c_str ());
+                if (!file.is_open ()) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to open: %s.",
+                        options.changes.c_str ());
+                }
+            }
+            std::istream &stream = options.changes != "-" ? file : std::cin;
+            std::string line;
+            while (std::getline (stream, line)) {
+                options.AddPath (line);
+            }
+        }
+        std::set<std::string> impactedProjects;
+        if (!options.paths.empty () || !options.changes.empty ()) {
+            make::core::ProjectGraph graph (options.project_root, options.config, TYPE_STATIC);
+            make::core::IncludeScanner includeScanner;
+            graph.GetImpactedProjects (options.paths, includeScanner, impactedProjects);
+            includeScanner.Save ();
+            if (impactedProjects.empty ()) {
+                std::cout << "No tests are impacted by the changes." << std::endl;
+                return 0;
+            }
+        }
+        make::core::TestRunner testRunner (
+            options.project_root,
+            options.config,
+            TYPE_STATIC,
+            impactedProjects);
+        const std::vector<make::core::TestRunner::Test> &tests = testRunner.GetTests ();
+        if (options.list) {
+            std::vector<const make::core::TestRunner::Test *> sorted;
+            for (std::size_t i = 0, count = tests.size (); i < count; ++i) {
+                sorted.push_back (&tests[i]);
+            }
+            std::stable_sort (sorted.begin (), sorted.end (),
+                [] (const make::core::TestRunner::Test *test1,
+                        const make::core::TestRunner::Test *test2) {
+                    return test1->estimate > test2->estimate;
+                });
+            for (std::size_t i = 0, count = sorted.size (); i < count; ++i) {
+                std::cout << sorted[i]->path << " (" <<
+                    util::f64Tostring (sorted[i]->estimate, "%.2f") << "s)" << std::endl;
+            }
+            return 0;
+        }
+        util::ui32 failed = testRunner.Run (options.concurrency);
+        std::string junit = !options.junit.empty () ? options.junit : testRunner.GetDefaultJUnitPath ();
+        testRunner.WriteJUnit (junit);
+        std::cout << tests.size () - failed << " of " << tests.size () << " test(s) passed, " <<
+            "results in " << junit << std::endl;
+        return failed == 0 ? 0 : 1;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return 1;
+    }
+}
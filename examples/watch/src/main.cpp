@@ -0,0 +1,116 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <csignal>
+#include <iostream>
+#include <string>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/CommandLineOptions.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Watch.h"
+
+using namespace thekogans;
+
+namespace {
+    struct Options : public util::CommandLineOptions {
+        bool help;
+        std::string config;
+        std::string type;
+        std::string target;
+        util::ui32 concurrency;
+        util::ui32 debounce;
+        std::string project_root;
+
+        Options () :
+            help (false),
+            config (CONFIG_DEBUG),
+            type (TYPE_STATIC),
+            target (TARGET_ALL),
+            concurrency (1),
+            debounce (make::core::Watch::DEFAULT_DEBOUNCE) {}
+
+        virtual void DoOption (
+                char option,
+                const std::string &value) {
+            switch (option) {
+                case 'h':
+                    help = true;
+                    break;
+                case 'c':
+                    config = value;
+                    break;
+                case 't':
+                    type = value;
+                    break;
+                case 'g':
+                    target = value;
+                    break;
+                case 'j':
+                    concurrency = util::stringToui32 (value.c_str ());
+                    break;
+                case 'd':
+                    debounce = util::stringToui32 (value.c_str ());
+                    break;
+            }
+        }
+
+        virtual void DoPath (const std::string &path) {
+            project_root = path;
+        }
+    };
+
+    make::core::Watch *watch = 0;
+
+    void StopHandler (int /*signal*/) {
+        if (watch != 0) {
+            watch->Stop ();
+        }
+    }
+}
+
+int main (
+        int argc,
+        const char *argv[]) {
+    Options options;
+    options.Parse (argc, argv, "ctgjd");
+    if (options.help || options.project_root.empty ()) {
+        std::cout << "usage: " << argv[0] << " [-h] [-c:Debug|Release] [-t:Static|Shared] "
+            "[-g:target] [-j:concurrency] [-d:debounce_ms] project_root" << std::endl;
+        return options.help ? 0 : 1;
+    }
+    THEKOGANS_UTIL_TRY {
+        make::core::Watch watch_ (
+            options.project_root,
+            options.config,
+            options.type,
+            options.target,
+            options.concurrency,
+            options.debounce);
+        watch = &watch_;
+        signal (SIGINT, StopHandler);
+        signal (SIGTERM, StopHandler);
+        watch_.Run ();
+        watch = 0;
+        return 0;
+    }
+    THEKOGANS_UTIL_CATCH (util::Exception) {
+        std::cerr << exception.Report () << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,187 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Baseline_h)
+#define __thekogans_make_core_Baseline_h
+
+#include <string>
+#include <vector>
+#include <list>
+#include "pugixml/pugixml.hpp"
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/Benchmark.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct Baseline Baseline.h thekogans/make/core/Baseline.h
+            ///
+            /// \brief
+            /// Baseline is a named set of Benchmark results stored locally (one
+            /// xml file per baseline). New runs are compared against it using the
+            /// median and the median absolute deviation (MAD) of the samples, so
+            /// that a noisy run does not get mistaken for a regression.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Baseline {
+                /// \brief
+                /// Path to the baseline xml file.
+                std::string path;
+                /// \brief
+                /// Baseline name.
+                std::string name;
+                /// \brief
+                /// Benchmark suite the results came from.
+                std::string suite;
+                /// \brief
+                /// Suite parameters.
+                Benchmark::Parameters parameters;
+                /// \brief
+                /// Baseline results.
+                Benchmark::Results results;
+
+                enum {
+                    /// \brief
+                    /// Default max baseline file size.
+                    DEFAULT_MAX_BASELINE_FILE_SIZE = 16 * 1024 * 1024
+                };
+
+                /// \brief
+                /// ctor. If the file exists, load it.
+                /// \param[in] path_ Path to the baseline xml file.
+                /// \param[in] maxBaselineFileSize Protect against
+                /// reading unreasonably large files.
+                Baseline (
+                    const std::string &path_,
+                    util::ui64 maxBaselineFileSize = DEFAULT_MAX_BASELINE_FILE_SIZE);
+
+                /// \brief
+                /// Return the path of the named baseline in the given directory.
+                /// \param[in] directory Directory where baselines are stored.
+                /// \param[in] name Baseline name.
+                /// \return directory/name.xml
+                static std::string GetPath (
+                    const std::string &directory,
+                    const std::string &name);
+
+                /// \brief
+                /// Save the baseline to the file (creating the directory if needed).
+                void Save () const;
+
+                /// \struct Baseline::Comparison Baseline.h thekogans/make/core/Baseline.h
+                ///
+                /// \brief
+                /// The result of comparing one measurement against the baseline.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Comparison {
+                    /// \brief
+                    /// Measurement name.
+                    std::string name;
+                    /// \brief
+                    /// Sample unit.
+                    std::string unit;
+                    /// \brief
+                    /// Baseline median.
+                    util::f64 baselineMedian;
+                    /// \brief
+                    /// Baseline median absolute deviation.
+                    util::f64 baselineMAD;
+                    /// \brief
+                    /// Current median.
+                    util::f64 currentMedian;
+                    /// \brief
+                    /// Current median absolute deviation.
+                    util::f64 currentMAD;
+                    /// \brief
+                    /// (currentMedian - baselineMedian) / baselineMedian.
+                    util::f64 change;
+                    /// \brief
+                    /// true = the change is past the threshold and outside the noise.
+                    bool regression;
+                    /// \brief
+                    /// true = the measurement is in the baseline but not in the
+                    /// current results (deleted or renamed). Only baselineMedian
+                    /// and baselineMAD are valid.
+                    bool missing;
+
+                    /// \brief
+                    /// ctor.
+                    Comparison () :
+                        baselineMedian (0.0),
+                        baselineMAD (0.0),
+                        currentMedian (0.0),
+                        currentMAD (0.0),
+                        change (0.0),
+                        regression (false),
+                        missing (false) {}
+                };
+                /// \brief
+                /// Convenient typedef for std::list<Comparison>.
+                typedef std::list<Comparison> Comparisons;
+
+                enum {
+                    /// \brief
+                    /// Default regression threshold (in percent).
+                    DEFAULT_THRESHOLD = 5,
+                    /// \brief
+                    /// Default number of MADs a change must exceed to not be noise.
+                    DEFAULT_NOISE = 3
+                };
+
+                /// \brief
+                /// Compare the given results against the baseline. New results
+                /// (not in the baseline) are ignored. Baseline results missing
+                /// from current are reported (Comparison::missing) and count as
+                /// regressions, so that a deleted or renamed benchmark doesn't
+                /// read as no regression. Lower values are
+                /// better, so a measurement regresses when its median grew by
+                /// more than threshold and by more than noise times the larger
+                /// of the two (normalized) MADs.
+                /// \param[in] current Results to compare against the baseline.
+                /// \param[in] threshold Relative change (0.05 = 5%) considered a regression.
+                /// \param[in] noise Number of MADs a change must exceed to not be noise.
+                /// \param[out] comparisons Where to put the per measurement comparisons.
+                /// \return Number of regressions (missing results included).
+                util::ui32 Compare (
+                    const Benchmark::Results &current,
+                    util::f64 threshold,
+                    util::f64 noise,
+                    Comparisons &comparisons) const;
+
+                /// \brief
+                /// Return the median of the given samples.
+                /// \param[in] samples Samples to return the median of.
+                /// \return Median of samples (0.0 if empty).
+                static util::f64 GetMedian (std::vector<util::f64> samples);
+                /// \brief
+                /// Return the median absolute deviation of the given samples.
+                /// \param[in] samples Samples to return the MAD of.
+                /// \return MAD of samples (0.0 if empty).
+                static util::f64 GetMAD (const std::vector<util::f64> &samples);
+
+            private:
+                /// \brief
+                /// Parse the baseline tag.
+                /// \param[in] node Root node.
+                void ParseBaseline (pugi::xml_node &node);
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Baseline_h)
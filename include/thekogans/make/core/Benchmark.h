@@ -0,0 +1,274 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Benchmark_h)
+#define __thekogans_make_core_Benchmark_h
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            struct thekogans_make;
+
+            /// \struct Benchmark Benchmark.h thekogans/make/core/Benchmark.h
+            ///
+            /// \brief
+            /// Benchmark measures the make_core config pipeline on synthetic
+            /// project graphs and reports the results as JSON so that make_core
+            /// performance can be tracked across releases.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Benchmark {
+                /// \struct Benchmark::Result Benchmark.h thekogans/make/core/Benchmark.h
+                ///
+                /// \brief
+                /// A single measurement. Lower values are better.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Result {
+                    /// \brief
+                    /// Measurement name (GetConfig.cold, Expand...).
+                    std::string name;
+                    /// \brief
+                    /// Sample unit (us, ns/op, allocs/op...).
+                    std::string unit;
+                    /// \brief
+                    /// Number of operations timed per sample.
+                    util::ui64 iterations;
+                    /// \brief
+                    /// One sample per run.
+                    std::vector<util::f64> samples;
+
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] name_ Measurement name.
+                    /// \param[in] unit_ Sample unit.
+                    /// \param[in] iterations_ Number of operations timed per sample.
+                    Result (
+                        const std::string &name_ = std::string (),
+                        const std::string &unit_ = std::string (),
+                        util::ui64 iterations_ = 1) :
+                        name (name_),
+                        unit (unit_),
+                        iterations (iterations_) {}
+                };
+                /// \brief
+                /// Convenient typedef for std::list<Result>.
+                typedef std::list<Result> Results;
+                /// \brief
+                /// Convenient typedef for std::map<std::string, std::string>.
+                typedef std::map<std::string, std::string> Parameters;
+
+                /// \struct Benchmark::GraphParameters Benchmark.h thekogans/make/core/Benchmark.h
+                ///
+                /// \brief
+                /// Describes the shape of a synthetic project graph.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL GraphParameters {
+                    /// \brief
+                    /// Organization under $(DEVELOPMENT_ROOT) to generate the projects in.
+                    /// A single directory name (no path separators, . or ..).
+                    std::string organization;
+                    /// \brief
+                    /// Number of projects (including the root program).
+                    util::ui32 projectCount;
+                    /// \brief
+                    /// Number of library layers below the root program.
+                    util::ui32 depth;
+                    /// \brief
+                    /// Number of dependencies each project has on the layer below.
+                    util::ui32 fanOut;
+                    /// \brief
+                    /// [0.0, 1.0] Probability that a dependency is drawn from a
+                    /// small shared subset of the layer below (creating diamonds).
+                    util::f32 diamondDensity;
+                    /// \brief
+                    /// [0.0, 1.0] Probability that a dependency, feature or
+                    /// preprocessor definition is wrapped in an <if>/<choose>.
+                    util::f32 conditionalDensity;
+                    /// \brief
+                    /// [0.0, 1.0] Probability that a project lists it's sources
+                    /// with a <regex> instead of file by file.
+                    util::f32 regexDensity;
+                    /// \brief
+                    /// Number of source (and header) files per project.
+                    util::ui32 sourceCount;
+                    /// \brief
+                    /// Size (in bytes) of the placeholder library goals
+                    /// created for the CopyDependencies benchmark.
+                    util::ui32 goalSize;
+                    /// \brief
+                    /// Random number generator seed.
+                    util::ui32 seed;
+
+                    /// \brief
+                    /// ctor. Set reasonable defaults.
+                    GraphParameters ();
+
+                    /// \brief
+                    /// Return the parameters as name/value pairs.
+                    /// \param[out] parameters Parameters as name/value pairs.
+                    void GetParameters (Parameters &parameters) const;
+                };
+
+                /// \brief
+                /// Generate a synthetic project graph under
+                /// $(DEVELOPMENT_ROOT)/graphParameters.organization. Throws
+                /// EINVAL if the organization is not a plain directory name, a
+                /// count is 0 or a density is outside [0.0, 1.0]. The organization
+                /// directory is marked as generated. If it already exists without
+                /// the mark (a real checkout), GenerateGraph throws instead of
+                /// overwriting it.
+                /// \param[in] graphParameters Graph shape.
+                /// \return Root (program) project_root.
+                static std::string GenerateGraph (const GraphParameters &graphParameters);
+                /// \brief
+                /// Delete a synthetic project graph created by GenerateGraph.
+                /// Throws rather than delete an organization directory
+                /// GenerateGraph did not create.
+                /// \param[in] graphParameters Graph shape.
+                static void DeleteGraph (const GraphParameters &graphParameters);
+
+                /// \brief
+                /// Run the config pipeline benchmarks (GetConfig cold and warm,
+                /// CheckDependencies, closure queries, Expand/Eval throughput
+                /// and CopyDependencies) against the project graph rooted at
+                /// project_root.
+                /// \param[in] project_root Root project returned by GenerateGraph.
+                /// \param[in] config Debug | Release.
+                /// \param[in] runs Number of samples to take for each benchmark.
+                /// \param[out] results Where to put the results.
+                static void RunGraph (
+                    const std::string &project_root,
+                    const std::string &config,
+                    util::ui32 runs,
+                    Results &results);
+
+                /// \struct Benchmark::Expression Benchmark.h thekogans/make/core/Benchmark.h
+                ///
+                /// \brief
+                /// An expression engine corpus entry.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Expression {
+                    /// \enum
+                    /// Expression type.
+                    enum Type {
+                        /// \brief
+                        /// Condition (as found in <if condition = "..."/>). Measures
+                        /// Tokenizer and Parser.
+                        TYPE_Condition,
+                        /// \brief
+                        /// Format string passed to thekogans_make::Expand.
+                        TYPE_Format,
+                        /// \brief
+                        /// Function call (the part following '$') passed
+                        /// to Function::ParseAndExec.
+                        TYPE_Function
+                    } type;
+                    /// \brief
+                    /// Name (used to name the results).
+                    std::string name;
+                    /// \brief
+                    /// Expression text.
+                    std::string text;
+
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] type_ Expression type.
+                    /// \param[in] name_ Name (used to name the results).
+                    /// \param[in] text_ Expression text.
+                    Expression (
+                        Type type_ = TYPE_Condition,
+                        const std::string &name_ = std::string (),
+                        const std::string &text_ = std::string ()) :
+                        type (type_),
+                        name (name_),
+                        text (text_) {}
+
+                    /// \brief
+                    /// Parse an expression from a corpus line of the form:
+                    /// condition|format|function name text
+                    /// \param[in] line Corpus line to parse.
+                    /// \return Parsed expression.
+                    static Expression Parse (const std::string &line);
+                };
+                /// \brief
+                /// Convenient typedef for std::list<Expression>.
+                typedef std::list<Expression> Corpus;
+
+                /// \brief
+                /// Return the built-in corpus of real-world conditions,
+                /// format strings and function calls.
+                /// NOTE: The function entries call have_feature, which
+                /// make_core does not implement. Drivers must register it
+                /// (see THEKOGANS_MAKE_CORE_IMPLEMENT_FUNCTION) or those
+                /// entries will evaluate to an empty Value.
+                /// \param[out] corpus Where to put the built-in corpus.
+                static void GetExpressionCorpus (Corpus &corpus);
+                /// \brief
+                /// Run the expression engine microbenchmarks (Tokenizer, Parser
+                /// Value comparisons, Expand and Function::ParseAndExec) over the
+                /// given corpus. Every expression is measured in ns/op and, if
+                /// the host counts allocations (see CountAllocation), allocs/op.
+                /// \param[in] config Config to evaluate the corpus against.
+                /// \param[in] corpus Expressions to measure.
+                /// \param[in] runs Number of samples to take for each expression.
+                /// \param[in] iterations Number of operations per sample.
+                /// \param[out] results Where to put the results.
+                static void RunExpressions (
+                    const thekogans_make &config,
+                    const Corpus &corpus,
+                    util::ui32 runs,
+                    util::ui64 iterations,
+                    Results &results);
+
+                /// \brief
+                /// make_core does not replace the global operator new. Hosts
+                /// that want allocs/op reported should replace it and call
+                /// CountAllocation for every allocation.
+                static void CountAllocation ();
+
+                /// \brief
+                /// Format the given results as JSON.
+                /// \param[in] suite Benchmark suite name.
+                /// \param[in] parameters Suite parameters.
+                /// \param[in] results Results to format.
+                /// \return JSON formatted results.
+                static std::string ToJSON (
+                    const std::string &suite,
+                    const Parameters &parameters,
+                    const Results &results);
+                /// \brief
+                /// Parse results formatted by ToJSON.
+                /// \param[in] json JSON formatted results.
+                /// \param[out] suite Benchmark suite name.
+                /// \param[out] parameters Suite parameters.
+                /// \param[out] results Parsed results.
+                static void FromJSON (
+                    const std::string &json,
+                    std::string &suite,
+                    Parameters &parameters,
+                    Results &results);
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Benchmark_h)
@@ -0,0 +1,296 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_BuildGraph_h)
+#define __thekogans_make_core_BuildGraph_h
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <list>
+#include <set>
+#include <map>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/GUID.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/thekogans_make.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct BuildGraph BuildGraph.h thekogans/make/core/BuildGraph.h
+            ///
+            /// \brief
+            /// BuildGraph is a flattened, pre-resolved view of a project and all
+            /// its project dependencies (and plugin hosts) for a given generator,
+            /// config and type. Every include directory, link library, shared
+            /// library, preprocessor definition and file path is computed once
+            /// (full paths, dependency closures included) so that generators that
+            /// consume it (see Generator::UsesBuildGraph) don't have to walk
+            /// thekogans_make objects and recompute them per project. A BuildGraph
+            /// is not modified after construction and can be read from any number
+            /// of threads. Sources in FileLists with unity = "yes" are replaced
+            /// by the unity translation units that batch them. Building the
+            /// graph writes nothing. Consumers that compile it (Executor::Run,
+            /// generators that use it) call WriteUnityBatches to write the
+            /// batches to $(build_root)/unity first.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL BuildGraph {
+                /// \brief
+                /// Convenient typedef for std::unique_ptr<BuildGraph>.
+                typedef std::unique_ptr<BuildGraph> Ptr;
+
+                /// \struct BuildGraph::CustomBuild BuildGraph.h thekogans/make/core/BuildGraph.h
+                ///
+                /// \brief
+                /// A custom build step.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL CustomBuild {
+                    /// \brief
+                    /// Full paths of the files the recipe produces.
+                    std::vector<std::string> outputs;
+                    /// \brief
+                    /// Full paths of the files the recipe depends on.
+                    std::vector<std::string> dependencies;
+                    /// \brief
+                    /// Message to display while running the recipe.
+                    std::string message;
+                    /// \brief
+                    /// Recipe (expanded).
+                    std::string recipe;
+                };
+
+                /// \struct BuildGraph::File BuildGraph.h thekogans/make/core/BuildGraph.h
+                ///
+                /// \brief
+                /// A file in one of the project's file lists.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL File {
+                    /// \brief
+                    /// Full path.
+                    std::string path;
+                    /// \brief
+                    /// Path relative to the file list prefix (as it appears in
+                    /// thekogans_make.xml). Unity translation units are relative
+                    /// to the build root.
+                    std::string name;
+                    /// \brief
+                    /// File list prefix (relative to the project root). Two lists
+                    /// can have files with the same name, prefix + name can't
+                    /// collide. Empty for unity translation units (name has it).
+                    std::string prefix;
+                    /// \brief
+                    /// true = has a custom build step.
+                    bool hasCustomBuild;
+                    /// \brief
+                    /// Custom build step (valid if hasCustomBuild).
+                    CustomBuild customBuild;
+                    /// \brief
+                    /// Per file precompiled header settings.
+                    thekogans_make::PrecompiledHeader precompiled_header;
+                    /// \brief
+                    /// If not empty, this is a generated unity translation unit
+                    /// (see Unity.h) and these are the sources it includes.
+                    std::vector<std::string> unity_files;
+
+                    /// \brief
+                    /// ctor.
+                    File () :
+                        hasCustomBuild (false) {}
+                };
+
+                /// \struct BuildGraph::Language BuildGraph.h thekogans/make/core/BuildGraph.h
+                ///
+                /// \brief
+                /// Compiler inputs of one language (masm, nasm, c, cpp,
+                /// objective_c, objective_cpp, rc).
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Language {
+                    /// \brief
+                    /// Language name (thekogans_make.xml tag prefix).
+                    std::string name;
+                    /// \brief
+                    /// Compiler flags.
+                    std::list<std::string> flags;
+                    /// \brief
+                    /// Common preprocessor definitions followed by the language's own.
+                    std::list<std::string> preprocessor_definitions;
+                    /// \brief
+                    /// Headers.
+                    std::vector<File> headers;
+                    /// \brief
+                    /// Sources.
+                    std::vector<File> sources;
+                    /// \brief
+                    /// Tests.
+                    std::vector<File> tests;
+                };
+
+                /// \brief
+                /// Convenient typedef for std::pair<std::string, std::string>.
+                /// Full source path, destination path (relative to the install prefix).
+                typedef std::pair<std::string, std::string> InstallPath;
+
+                /// \struct BuildGraph::Project BuildGraph.h thekogans/make/core/BuildGraph.h
+                ///
+                /// \brief
+                /// A project (one node in the graph).
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Project {
+                    /// \brief
+                    /// Project root directory (where thekogans_make.xml resides).
+                    std::string project_root;
+                    /// \brief
+                    /// Debug | Release.
+                    std::string config;
+                    /// \brief
+                    /// Static | Shared.
+                    std::string type;
+                    /// \brief
+                    /// Project organization.
+                    std::string organization;
+                    /// \brief
+                    /// Project name.
+                    std::string project;
+                    /// \brief
+                    /// library | program | plugin.
+                    std::string project_type;
+                    /// \brief
+                    /// Project version.
+                    std::string version;
+                    /// \brief
+                    /// Hierarchical | Flat.
+                    std::string naming_convention;
+                    /// \brief
+                    /// Project guid.
+                    util::GUID guid;
+                    /// \brief
+                    /// Full path of the build directory.
+                    std::string build_root;
+                    /// \brief
+                    /// Full path of the goal (empty if the project has no goal).
+                    std::string goal;
+                    /// \brief
+                    /// Full path of the library dependents link against
+                    /// (empty if the project has no goal).
+                    std::string link_library;
+                    /// \brief
+                    /// Features (including those of the dependencies).
+                    std::set<std::string> features;
+                    /// \brief
+                    /// Include directories (including those of the dependencies).
+                    std::set<std::string> include_directories;
+                    /// \brief
+                    /// Link libraries (including those of the dependencies).
+                    std::list<std::string> link_libraries;
+                    /// \brief
+                    /// Shared libraries (including those of the dependencies).
+                    std::set<std::string> shared_libraries;
+                    /// \brief
+                    /// Linker flags.
+                    std::list<std::string> linker_flags;
+                    /// \brief
+                    /// Librarian flags.
+                    std::list<std::string> librarian_flags;
+                    /// \brief
+                    /// Project wide precompiled header settings.
+                    thekogans_make::PrecompiledHeader precompiled_header;
+                    /// \brief
+                    /// Compiler inputs. Only languages with headers,
+                    /// sources or tests are present.
+                    std::vector<Language> languages;
+                    /// \brief
+                    /// Resources.
+                    std::vector<File> resources;
+                    /// \brief
+                    /// Files (and custom build outputs) to install.
+                    std::vector<InstallPath> install;
+                    /// \brief
+                    /// Windows subsystem.
+                    std::string subsystem;
+                    /// \brief
+                    /// Windows .def file.
+                    std::string def_file;
+                    /// \brief
+                    /// Indices (in BuildGraph::projects) of project dependencies.
+                    std::vector<util::ui32> dependencies;
+                    /// \brief
+                    /// Indices (in BuildGraph::projects) of plugin hosts.
+                    std::vector<util::ui32> plugin_hosts;
+                };
+
+                /// \brief
+                /// Generator name.
+                std::string generator;
+                /// \brief
+                /// All projects, dependencies before dependents.
+                /// The root project is last.
+                std::vector<Project> projects;
+                /// \brief
+                /// Project root to index (in projects) map.
+                /// NOTE: A project root can appear more than once if its
+                /// dependents use it with different configs or types.
+                /// This map points to the last one added.
+                std::map<std::string, util::ui32> index;
+
+                /// \brief
+                /// ctor. Build the graph.
+                /// \param[in] project_root Root project.
+                /// \param[in] generator_ Generator name.
+                /// \param[in] config Debug | Release.
+                /// \param[in] type Static | Shared.
+                BuildGraph (
+                    const std::string &project_root,
+                    const std::string &generator_,
+                    const std::string &config,
+                    const std::string &type);
+
+                /// \brief
+                /// Return the root project.
+                /// \return The root project.
+                inline const Project &GetRoot () const {
+                    return projects.back ();
+                }
+                /// \brief
+                /// Return the project with the given root.
+                /// \param[in] project_root Project root.
+                /// \return The project with the given root (0 if not in the graph).
+                const Project *GetProject (const std::string &project_root) const;
+
+                /// \brief
+                /// Write the unity translation units of every project (only
+                /// the ones whose contents changed, see Unity::WriteBatch).
+                /// \return Number of batches written.
+                util::ui32 WriteUnityBatches () const;
+
+            private:
+                /// \brief
+                /// Add the given config (and its dependencies) to the graph.
+                /// \param[in] config Config to add.
+                /// \param[in, out] added Config key to index map of added projects.
+                /// \return config's index.
+                util::ui32 AddProject (
+                    const thekogans_make &config,
+                    std::map<std::string, util::ui32> &added);
+
+                /// \brief
+                /// BuildGraph is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (BuildGraph)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_BuildGraph_h)
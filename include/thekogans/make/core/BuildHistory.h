@@ -0,0 +1,203 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_BuildHistory_h)
+#define __thekogans_make_core_BuildHistory_h
+
+#include <string>
+#include <map>
+#include "pugixml/pugixml.hpp"
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Singleton.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            #define BUILD_HISTORY_XML "BuildHistory.xml"
+
+            /// \struct BuildHistory BuildHistory.h thekogans/make/core/BuildHistory.h
+            ///
+            /// \brief
+            /// BuildHistory is a small database ($(TOOLCHAIN_ROOT)/BuildHistory.xml)
+            /// of per project, per variant (config, type and target) build times and
+            /// peak memory use. BuildProject uses it to estimate how long each project
+            /// will take so that it can schedule the critical path first, and how much
+            /// memory it will need so that it can stay within the host's ResourceBudget.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL BuildHistory :
+                    public util::Singleton<BuildHistory, util::SpinLock> {
+                /// \struct BuildHistory::Entry BuildHistory.h thekogans/make/core/BuildHistory.h
+                ///
+                /// \brief
+                /// Build times of a single project variant.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Entry {
+                    /// \brief
+                    /// Exponentially weighted moving average of the build time (in seconds).
+                    util::f64 duration;
+                    /// \brief
+                    /// Last build time (in seconds).
+                    util::f64 last;
+                    /// \brief
+                    /// Number of recorded builds.
+                    util::ui32 count;
+                    /// \brief
+                    /// Decaying max of the max resident set size (in KB) of
+                    /// any single process (0 = never measured). This is per
+                    /// child, not the sum over a parallel make's job tree.
+                    util::ui64 maxRSS;
+
+                    /// \brief
+                    /// ctor.
+                    Entry () :
+                        duration (0.0),
+                        last (0.0),
+                        count (0),
+                        maxRSS (0) {}
+                };
+
+                enum {
+                    /// \brief
+                    /// Default max build history file size.
+                    DEFAULT_MAX_BUILD_HISTORY_FILE_SIZE = 4 * 1024 * 1024
+                };
+
+            private:
+                /// \brief
+                /// Path to the build history xml file.
+                std::string path;
+                /// \brief
+                /// Convenient typedef for std::pair<std::string, std::string>
+                /// (project_root, variant).
+                typedef std::pair<std::string, std::string> Key;
+                /// \brief
+                /// Convenient typedef for std::map<Key, Entry>.
+                typedef std::map<Key, Entry> Entries;
+                /// \brief
+                /// Recorded build times.
+                Entries entries;
+                /// \brief
+                /// true = entries need to be saved.
+                bool modified;
+                /// \brief
+                /// Synchronization lock.
+                mutable util::SpinLock spinLock;
+
+            public:
+                /// \brief
+                /// ctor. Load $(TOOLCHAIN_ROOT)/BuildHistory.xml if it exists.
+                BuildHistory ();
+
+                /// \brief
+                /// Return the variant name for the given config, type and target.
+                /// \param[in] config Debug | Release.
+                /// \param[in] type Static | Shared.
+                /// \param[in] target Build target.
+                /// \return Variant name.
+                static std::string GetVariant (
+                    const std::string &config,
+                    const std::string &type,
+                    const std::string &target);
+
+                /// \brief
+                /// Return the recorded build times of the given project variant.
+                /// \param[in] project_root Project root.
+                /// \param[in] variant Variant returned by GetVariant.
+                /// \param[out] entry Recorded build times.
+                /// \return true = found, false = never built.
+                bool Get (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    Entry &entry) const;
+                /// \brief
+                /// Return the estimated build time of the given project variant.
+                /// \param[in] project_root Project root.
+                /// \param[in] variant Variant returned by GetVariant.
+                /// \param[in] defaultDuration Duration to return if the
+                /// variant was never built.
+                /// \return Estimated build time (in seconds).
+                util::f64 GetDuration (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    util::f64 defaultDuration) const;
+                /// \brief
+                /// Return the average estimated build time of all recorded
+                /// variants. Used as the estimate for variants never built.
+                /// \param[in] defaultDuration Duration to return if history is empty.
+                /// \return Average estimated build time (in seconds).
+                util::f64 GetAverageDuration (util::f64 defaultDuration) const;
+                /// \brief
+                /// Return the estimated peak memory use of the given project variant.
+                /// \param[in] project_root Project root.
+                /// \param[in] variant Variant returned by GetVariant.
+                /// \param[in] defaultMaxRSS Max RSS (in KB) to return if
+                /// the variant was never measured.
+                /// \return Estimated max RSS (in KB).
+                util::ui64 GetMaxRSS (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    util::ui64 defaultMaxRSS) const;
+
+                /// \brief
+                /// Record a build time.
+                /// \param[in] project_root Project root.
+                /// \param[in] variant Variant returned by GetVariant.
+                /// \param[in] duration Build time (in seconds).
+                void Add (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    util::f64 duration);
+                /// \brief
+                /// Record a peak memory use. A bigger one replaces the
+                /// recorded one right away, smaller ones wear it down
+                /// slowly, so that a single small build doesn't get a
+                /// big link scheduled alongside others.
+                /// \param[in] project_root Project root.
+                /// \param[in] variant Variant returned by GetVariant.
+                /// \param[in] maxRSS Max resident set size (in KB).
+                void AddMaxRSS (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    util::ui64 maxRSS);
+
+                /// \brief
+                /// Save the history to the file (if modified).
+                void Save ();
+
+            private:
+                /// \brief
+                /// Load the history from the file.
+                /// \param[in] maxBuildHistoryFileSize Protect against
+                /// reading unreasonably large files.
+                void Load (util::ui64 maxBuildHistoryFileSize);
+                /// \brief
+                /// Parse the build_history tag.
+                /// \param[in] node Root node.
+                void ParseBuildHistory (pugi::xml_node &node);
+
+                /// \brief
+                /// BuildHistory is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (BuildHistory)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_BuildHistory_h)
@@ -0,0 +1,148 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_BuildProgress_h)
+#define __thekogans_make_core_BuildProgress_h
+
+#include <functional>
+#include <string>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Singleton.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/Scheduler.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct BuildProgress BuildProgress.h thekogans/make/core/BuildProgress.h
+            ///
+            /// \brief
+            /// BuildProgress receives the progress (and ETA, estimated from
+            /// BuildHistory) of BuildProject runs and forwards it to an optional
+            /// callback and/or a status line written to std::cout. Installer sets
+            /// the phase so that the status line says what is being installed.
+            /// Set THEKOGANS_MAKE_CORE_STATUS_LINE=yes to turn on the status line
+            /// without code changes.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL BuildProgress :
+                    public util::Singleton<BuildProgress, util::SpinLock> {
+                /// \brief
+                /// Progress callback. Receives the current phase and progress.
+                typedef std::function<void (
+                    const std::string & /*phase*/,
+                    const Scheduler::Progress & /*progress*/)> Callback;
+
+            private:
+                /// \brief
+                /// Optional progress callback.
+                Callback callback;
+                /// \brief
+                /// true = write a status line to std::cout.
+                bool statusLine;
+                /// \brief
+                /// What is being built.
+                std::string phase;
+                /// \brief
+                /// Last status line progress written (to avoid
+                /// repeating it on every tick).
+                util::ui32 lastCompletedJobs;
+                /// \brief
+                /// Last status line running jobs written.
+                util::ui32 lastRunningJobs;
+                /// \brief
+                /// Synchronization lock.
+                mutable util::SpinLock spinLock;
+
+            public:
+                /// \brief
+                /// ctor.
+                BuildProgress ();
+
+                /// \brief
+                /// Set the progress callback.
+                /// \param[in] callback_ Progress callback (empty to remove).
+                void SetCallback (const Callback &callback_);
+                /// \brief
+                /// Turn the status line on or off.
+                /// \param[in] statusLine_ true = write a status line to std::cout.
+                void SetStatusLine (bool statusLine_);
+                /// \brief
+                /// Return true if there is anyone to report progress to.
+                /// \return true if there is anyone to report progress to.
+                bool IsEnabled () const;
+
+                /// \brief
+                /// Return the current phase.
+                /// \return Current phase.
+                std::string GetPhase () const;
+
+                /// \struct BuildProgress::Phase BuildProgress.h thekogans/make/core/BuildProgress.h
+                ///
+                /// \brief
+                /// Set the phase for the duration of a scope, restoring the
+                /// previous one on exit (Installer phases nest).
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Phase {
+                    /// \brief
+                    /// Phase to restore.
+                    std::string previous;
+
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] phase New phase.
+                    explicit Phase (const std::string &phase);
+                    /// \brief
+                    /// dtor. Restore the previous phase.
+                    ~Phase ();
+
+                    /// \brief
+                    /// Phase is neither copy constructable, nor assignable.
+                    THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (Phase)
+                };
+
+                /// \brief
+                /// Report progress. Called by BuildProject.
+                /// \param[in] progress Current progress.
+                void Report (const Scheduler::Progress &progress);
+
+                /// \brief
+                /// Format a status line.
+                /// \param[in] phase What is being built.
+                /// \param[in] progress Current progress.
+                /// \return [completed/total running, percent] elapsed, ETA - phase
+                static std::string FormatStatusLine (
+                    const std::string &phase,
+                    const Scheduler::Progress &progress);
+
+            private:
+                /// \brief
+                /// Set the current phase.
+                /// \param[in] phase_ New phase.
+                /// \return Previous phase.
+                std::string SetPhase (const std::string &phase_);
+
+                /// \brief
+                /// BuildProgress is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (BuildProgress)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_BuildProgress_h)
@@ -0,0 +1,254 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Console_h)
+#define __thekogans_make_core_Console_h
+
+#include <memory>
+#include <string>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Singleton.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct Console Console.h thekogans/make/core/Console.h
+            ///
+            /// \brief
+            /// Console is where make_core's informational messages (Copying...,
+            /// Installing..., Updating...) go. Messages are pushed on to a lock free
+            /// ring buffer and written (in batches, with one flush per batch) by a
+            /// background thread, so callers never wait on the terminal. Progress
+            /// (SetProgress) is rendered as a single line, at most every
+            /// PROGRESS_INTERVAL milliseconds, no matter how often it changes.
+            /// Messages below the current level are dropped before they are
+            /// formatted. Set THEKOGANS_MAKE_CORE_CONSOLE_LEVEL=Warning (quiet mode)
+            /// or Debug to change the level without code changes. Errors go to
+            /// std::cerr, everything else to std::cout.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Console :
+                    public util::Singleton<Console, util::SpinLock> {
+                /// \brief
+                /// Message levels.
+                enum Level {
+                    /// \brief
+                    /// Something failed.
+                    Error,
+                    /// \brief
+                    /// Something looks wrong.
+                    Warning,
+                    /// \brief
+                    /// What is being done (default).
+                    Info,
+                    /// \brief
+                    /// Everything else.
+                    Debug
+                };
+
+                /// \brief
+                /// "Error"
+                static const char * const LEVEL_ERROR;
+                /// \brief
+                /// "Warning"
+                static const char * const LEVEL_WARNING;
+                /// \brief
+                /// "Info"
+                static const char * const LEVEL_INFO;
+                /// \brief
+                /// "Debug"
+                static const char * const LEVEL_DEBUG;
+
+                /// \brief
+                /// Return the string representation of the given level.
+                /// \param[in] level Level to convert.
+                /// \return String representation of level.
+                static std::string LevelTostring (Level level);
+                /// \brief
+                /// Return the level of the given string representation.
+                /// \param[in] level String representation of a level.
+                /// \return Level (Info if level is not recognized).
+                static Level stringToLevel (const std::string &level);
+
+                enum {
+                    /// \brief
+                    /// Number of messages the ring buffer holds (a power of 2).
+                    /// Writers wait (yield) when it's full.
+                    RING_BUFFER_SIZE = 1024,
+                    /// \brief
+                    /// Min time (in milliseconds) between progress renderings.
+                    PROGRESS_INTERVAL = 100
+                };
+
+            private:
+                /// \struct Console::Cell Console.h thekogans/make/core/Console.h
+                ///
+                /// \brief
+                /// Ring buffer slot.
+                struct Cell {
+                    /// \brief
+                    /// Slot sequence number (see Write and Dequeue).
+                    std::atomic<std::size_t> sequence;
+                    /// \brief
+                    /// Message level.
+                    Level level;
+                    /// \brief
+                    /// Message.
+                    std::string message;
+                };
+                /// \brief
+                /// Ring buffer.
+                std::unique_ptr<Cell[]> cells;
+                /// \brief
+                /// Next slot to write.
+                std::atomic<std::size_t> enqueuePosition;
+                /// \brief
+                /// Next slot to read (writer thread only).
+                std::size_t dequeuePosition;
+                /// \brief
+                /// Number of messages written to the console.
+                std::atomic<std::size_t> written;
+                /// \brief
+                /// Current level.
+                std::atomic<util::ui32> level;
+                /// \brief
+                /// Latest progress line.
+                std::string progress;
+                /// \brief
+                /// true = progress changed since it was last rendered.
+                bool progressChanged;
+                /// \brief
+                /// Synchronize access to progress and progressChanged.
+                std::mutex progressMutex;
+                /// \brief
+                /// Used to wait on the two conditions below.
+                std::mutex mutex;
+                /// \brief
+                /// Signaled when there are messages to write.
+                std::condition_variable available;
+                /// \brief
+                /// Signaled when a batch of messages was written.
+                std::condition_variable drained;
+                /// \brief
+                /// Writes the messages.
+                std::thread writer;
+
+            public:
+                /// \brief
+                /// ctor. Start the writer thread.
+                Console ();
+
+                /// \brief
+                /// Set the level. Messages below it are dropped.
+                /// \param[in] level_ New level (Warning = quiet mode).
+                void SetLevel (Level level_);
+                /// \brief
+                /// Return the current level.
+                /// \return Current level.
+                Level GetLevel () const;
+                /// \brief
+                /// Return true if messages of the given level are written.
+                /// \param[in] level_ Level to check.
+                /// \return true = messages of level_ are written.
+                inline bool IsEnabled (Level level_) const {
+                    return (util::ui32)level_ <= level.load (std::memory_order_relaxed);
+                }
+
+                /// \brief
+                /// Queue a message. Write does not check the level (child
+                /// process output and explicitly requested status lines
+                /// are always written). Use the macros below for messages
+                /// that should be dropped below the current level, they
+                /// also skip formatting them.
+                /// \param[in] level_ Message level.
+                /// \param[in] message Message (including the trailing newline).
+                void Write (
+                    Level level_,
+                    const std::string &message);
+                /// \brief
+                /// Set the progress line (rendered at most every
+                /// PROGRESS_INTERVAL milliseconds). Dropped in quiet mode.
+                /// \param[in] progress_ Progress line (empty = clear it).
+                void SetProgress (const std::string &progress_);
+                /// \brief
+                /// Wait for all messages queued so far to be written, and the
+                /// progress line to be cleared. Call it before writing to
+                /// std::cout/std::cerr directly (or letting a child do it)
+                /// so that output stays in order.
+                void Flush ();
+
+            private:
+                /// \brief
+                /// Pop the oldest message (writer thread only).
+                /// \param[out] level_ Message level.
+                /// \param[out] message Message.
+                /// \return false = ring buffer is empty.
+                bool Dequeue (
+                    Level &level_,
+                    std::string &message);
+                /// \brief
+                /// Writer thread.
+                void Run ();
+
+                /// \brief
+                /// Console is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (Console)
+            };
+
+            /// \def THEKOGANS_MAKE_CORE_CONSOLE(level, message)
+            /// Queue a message of the given level. message is a stream expression
+            /// ("Copying " << from << std::endl) and is only evaluated if the
+            /// level is enabled.
+            #define THEKOGANS_MAKE_CORE_CONSOLE(level, message)\
+                if (!thekogans::make::core::Console::Instance ().IsEnabled (\
+                        thekogans::make::core::Console::level)) {\
+                }\
+                else {\
+                    std::ostringstream consoleStream;\
+                    consoleStream << message;\
+                    thekogans::make::core::Console::Instance ().Write (\
+                        thekogans::make::core::Console::level, consoleStream.str ());\
+                }
+            /// \def THEKOGANS_MAKE_CORE_CONSOLE_ERROR(message)
+            /// Queue an error message.
+            #define THEKOGANS_MAKE_CORE_CONSOLE_ERROR(message)\
+                THEKOGANS_MAKE_CORE_CONSOLE (Error, message)
+            /// \def THEKOGANS_MAKE_CORE_CONSOLE_WARNING(message)
+            /// Queue a warning message.
+            #define THEKOGANS_MAKE_CORE_CONSOLE_WARNING(message)\
+                THEKOGANS_MAKE_CORE_CONSOLE (Warning, message)
+            /// \def THEKOGANS_MAKE_CORE_CONSOLE_INFO(message)
+            /// Queue an informational message.
+            #define THEKOGANS_MAKE_CORE_CONSOLE_INFO(message)\
+                THEKOGANS_MAKE_CORE_CONSOLE (Info, message)
+            /// \def THEKOGANS_MAKE_CORE_CONSOLE_DEBUG(message)
+            /// Queue a debug message.
+            #define THEKOGANS_MAKE_CORE_CONSOLE_DEBUG(message)\
+                THEKOGANS_MAKE_CORE_CONSOLE (Debug, message)
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Console_h)
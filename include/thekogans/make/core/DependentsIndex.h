@@ -0,0 +1,197 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_DependentsIndex_h)
+#define __thekogans_make_core_DependentsIndex_h
+
+#include <string>
+#include <set>
+#include <map>
+#include "pugixml/pugixml.hpp"
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/Utils.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            #define DEPENDENTS_INDEX_XML "DependentsIndex.xml"
+
+            /// \struct DependentsIndex DependentsIndex.h thekogans/make/core/DependentsIndex.h
+            ///
+            /// \brief
+            /// DependentsIndex is a persisted ($(TOOLCHAIN_ROOT)/DependentsIndex.xml)
+            /// project -> dependents index of every thekogans_make.xml under a root
+            /// (DEVELOPMENT_ROOT by default). Refresh only reparses configs whose
+            /// modification time changed, and does so in parallel. Configs are read
+            /// as plain xml, not evaluated. Dependencies inside conditionals are
+            /// all recorded (the index errs on the side of too many dependents).
+            /// Dependencies whose organization or name need expanding ($(...))
+            /// can't be recorded. Projects with such dependencies are reported
+            /// by GetUnresolved, and any of them might be missing from the
+            /// dependents the index returns. Callers that need a complete answer
+            /// must evaluate those projects' configs (or fall back to a full
+            /// evaluation) when IsComplete returns false.
+            /// Projects are named organization_project.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL DependentsIndex {
+                /// \struct DependentsIndex::Entry DependentsIndex.h thekogans/make/core/DependentsIndex.h
+                ///
+                /// \brief
+                /// What we know about a single config file.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Entry {
+                    /// \brief
+                    /// Config file modification time.
+                    util::i64 lastModified;
+                    /// \brief
+                    /// organization_project (empty if the config could not be parsed).
+                    std::string project;
+                    /// \brief
+                    /// organization_project of every dependency and plugin host.
+                    std::set<std::string> dependencies;
+                    /// \brief
+                    /// true = some dependencies need expanding and are missing
+                    /// from dependencies.
+                    bool unresolved;
+
+                    /// \brief
+                    /// ctor.
+                    Entry () :
+                        lastModified (0),
+                        unresolved (false) {}
+                };
+
+                enum {
+                    /// \brief
+                    /// Default max index file size.
+                    DEFAULT_MAX_DEPENDENTS_INDEX_FILE_SIZE = 16 * 1024 * 1024
+                };
+
+                /// \brief
+                /// Path to the index xml file.
+                std::string path;
+                /// \brief
+                /// Directory scanned for thekogans_make.xml files.
+                std::string root;
+                /// \brief
+                /// Convenient typedef for std::map<std::string, Entry>.
+                typedef std::map<std::string, Entry> Entries;
+                /// \brief
+                /// Config file path to entry map.
+                Entries entries;
+                /// \brief
+                /// Convenient typedef for std::map<std::string, std::set<std::string>>.
+                typedef std::map<std::string, std::set<std::string>> ProjectMap;
+                /// \brief
+                /// Project to direct dependents map (derived from entries).
+                ProjectMap dependents;
+                /// \brief
+                /// Project to config files map (derived from entries).
+                ProjectMap configFiles;
+                /// \brief
+                /// Projects with unresolved dependencies (derived from entries).
+                std::set<std::string> unresolved;
+                /// \brief
+                /// true = entries need to be saved.
+                bool modified;
+
+                /// \brief
+                /// ctor. Load the index (if it exists). Call Refresh to bring it up to date.
+                /// \param[in] root_ Directory to scan for thekogans_make.xml files.
+                /// \param[in] path_ Path to the index xml file.
+                DependentsIndex (
+                    const std::string &root_ = _DEVELOPMENT_ROOT,
+                    const std::string &path_ = GetDefaultPath ());
+
+                /// \brief
+                /// Return the default index path ($(TOOLCHAIN_ROOT)/DependentsIndex.xml).
+                /// \return Default index path.
+                static std::string GetDefaultPath ();
+                /// \brief
+                /// Return the index name of the given project.
+                /// \param[in] organization Project organization.
+                /// \param[in] project Project name.
+                /// \return organization_project.
+                static std::string GetProjectName (
+                    const std::string &organization,
+                    const std::string &project);
+
+                /// \brief
+                /// Scan root and reparse new and modified configs.
+                /// \param[in] workerCount Number of parser threads
+                /// (0 = std::thread::hardware_concurrency).
+                /// \return Number of configs (re)parsed.
+                util::ui32 Refresh (util::ui32 workerCount = 0);
+
+                /// \brief
+                /// Return the projects that directly depend on the given project.
+                /// \param[in] project organization_project.
+                /// \return Direct dependents.
+                const std::set<std::string> &GetDependents (const std::string &project) const;
+                /// \brief
+                /// Return every project that (transitively) depends on the given project.
+                /// \param[in] project organization_project.
+                /// \param[out] allDependents Transitive dependents (not including project).
+                void GetAllDependents (
+                    const std::string &project,
+                    std::set<std::string> &allDependents) const;
+
+                /// \brief
+                /// Return the projects whose dependencies could not all be
+                /// recorded (their organization or name need expanding).
+                /// Any of them might be a dependent the index does not list.
+                /// \return Projects with unresolved dependencies.
+                inline const std::set<std::string> &GetUnresolved () const {
+                    return unresolved;
+                }
+                /// \brief
+                /// Return true if every project's dependencies were recorded,
+                /// i.e. GetDependents and GetAllDependents never list too few.
+                /// \return true = the index is complete.
+                inline bool IsComplete () const {
+                    return unresolved.empty ();
+                }
+
+                /// \brief
+                /// Save the index to the file (if modified).
+                void Save ();
+
+            private:
+                /// \brief
+                /// Load the index from the file.
+                /// \param[in] maxDependentsIndexFileSize Protect against
+                /// reading unreasonably large files.
+                void Load (util::ui64 maxDependentsIndexFileSize);
+                /// \brief
+                /// Parse the dependents_index tag.
+                /// \param[in] node Root node.
+                void ParseDependentsIndex (pugi::xml_node &node);
+                /// \brief
+                /// Rebuild dependents, configFiles and unresolved from entries.
+                void Index ();
+
+                /// \brief
+                /// DependentsIndex is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (DependentsIndex)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_DependentsIndex_h)
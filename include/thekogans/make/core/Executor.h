@@ -0,0 +1,323 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Executor_h)
+#define __thekogans_make_core_Executor_h
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <mutex>
+#include "pugixml/pugixml.hpp"
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/BuildGraph.h"
+#include "thekogans/make/core/IncludeScanner.h"
+#include "thekogans/make/core/ResourceBudget.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            #define ACTION_LOG_XML "ActionLog.xml"
+
+            /// \struct Executor Executor.h thekogans/make/core/Executor.h
+            ///
+            /// \brief
+            /// Executor is an alternative to generating Makefiles and running gnu
+            /// make for every project. It turns a BuildGraph into a DAG of custom
+            /// build, compile, archive and link actions and runs them directly on
+            /// a pool of work stealing threads. An action is skipped if all its
+            /// outputs exist, are newer than all its inputs (including the headers
+            /// listed in the compiler generated depfiles) and were produced by the
+            /// same command line (recorded in $(TOOLCHAIN_ROOT)/ActionLog.xml).
+            /// Compiles also check the headers found by IncludeScanner, so a
+            /// missing or stale depfile doesn't hide a changed header.
+            /// NOTE: Executor drives gcc/clang style compilers (CC, CXX and AR
+            /// environment variables, cc, c++ and ar by default). Projects with
+            /// masm, nasm or rc sources have to be built with gnu make.
+            /// Compiles and links draw from separate ResourceBudget pools, and
+            /// each takes its project's recorded max RSS (see BuildHistory) out
+            /// of the host's memory budget. Actions that don't fit wait until a
+            /// running one completes while the workers move on to ones that do.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Executor {
+                /// \struct Executor::Toolset Executor.h thekogans/make/core/Executor.h
+                ///
+                /// \brief
+                /// Programs used to build.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Toolset {
+                    /// \brief
+                    /// C (and Objective-C) compiler.
+                    std::string cc;
+                    /// \brief
+                    /// C++ (and Objective-C++) compiler (also used to link).
+                    std::string cxx;
+                    /// \brief
+                    /// Librarian.
+                    std::string ar;
+
+                    /// \brief
+                    /// Return the toolset named by CC, CXX and AR (cc, c++ and ar by default).
+                    /// \return Toolset from the environment.
+                    static Toolset FromEnvironment ();
+                };
+
+                /// \struct Executor::Action Executor.h thekogans/make/core/Executor.h
+                ///
+                /// \brief
+                /// A node in the action DAG.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Action {
+                    /// \brief
+                    /// Action type.
+                    enum Type {
+                        /// \brief
+                        /// Custom build recipe.
+                        CustomBuild,
+                        /// \brief
+                        /// Compile a source file.
+                        Compile,
+                        /// \brief
+                        /// Create a static library.
+                        Archive,
+                        /// \brief
+                        /// Link a program, shared library or plugin.
+                        Link
+                    } type;
+                    /// \brief
+                    /// Message to display when the action runs.
+                    std::string description;
+                    /// \brief
+                    /// Program to execute.
+                    std::string program;
+                    /// \brief
+                    /// Program arguments.
+                    std::list<std::string> arguments;
+                    /// \brief
+                    /// Files the action reads.
+                    std::vector<std::string> inputs;
+                    /// \brief
+                    /// Files the action writes.
+                    std::vector<std::string> outputs;
+                    /// \brief
+                    /// Compiler generated dependency file (Compile only).
+                    std::string depfile;
+                    /// \brief
+                    /// Files the program writes (temporary) that Execute renames
+                    /// into place (final) once the program succeeds. Used by
+                    /// actions whose outputs are shared between builds.
+                    std::map<std::string, std::string> temporaries;
+                    /// \brief
+                    /// Action log identity. If empty, the hash of the command line is used.
+                    std::string hash;
+                    /// \brief
+                    /// Index (in BuildGraph::projects) of the project the action belongs to.
+                    util::ui32 project;
+                    /// \brief
+                    /// Actions that must complete before this one starts.
+                    std::vector<util::ui32> dependencies;
+                    /// \brief
+                    /// Actions that depend on this one.
+                    std::vector<util::ui32> dependents;
+                    /// \brief
+                    /// Estimated memory (in KB).
+                    util::ui64 memory;
+
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] type_ Action type.
+                    /// \param[in] project_ Index (in BuildGraph::projects) of the project.
+                    Action (
+                        Type type_,
+                        util::ui32 project_) :
+                        type (type_),
+                        project (project_),
+                        memory (0) {}
+
+                    /// \brief
+                    /// Return the ResourceBudget pool the action takes a token from.
+                    /// \return ResourceBudget::Link for links, ResourceBudget::Compile
+                    /// for everything else.
+                    inline ResourceBudget::Pool GetPool () const {
+                        return type == Link ? ResourceBudget::Link : ResourceBudget::Compile;
+                    }
+
+                    /// \brief
+                    /// Return the command line.
+                    /// \return Command line.
+                    std::string GetCommandLine () const;
+                    /// \brief
+                    /// Return the action's identity in the action log.
+                    /// \return hash if set, otherwise the hash of GetCommandLine.
+                    std::string GetHash () const;
+                };
+
+            private:
+                /// \brief
+                /// Graph to build.
+                const BuildGraph &graph;
+                /// \brief
+                /// Programs used to build.
+                Toolset toolset;
+                /// \brief
+                /// Action DAG.
+                std::vector<Action> actions;
+                /// \brief
+                /// Per project include directories (in search order).
+                std::vector<std::vector<std::string>> includeDirectories;
+                /// \brief
+                /// Header dependency scanner.
+                IncludeScanner includeScanner;
+                /// \brief
+                /// PrecompiledHeaderCache key to the action that creates it.
+                /// Projects that precompile the same header the same way
+                /// share the action (and the precompiled header).
+                std::map<std::string, util::ui32> precompiledHeaders;
+                /// \brief
+                /// Action log path.
+                std::string path;
+                /// \brief
+                /// Convenient typedef for std::map<std::string, std::string>.
+                /// Output path to command line hash map.
+                typedef std::map<std::string, std::string> ActionLog;
+                /// \brief
+                /// Loaded action log (updated as actions complete).
+                ActionLog actionLog;
+                /// \brief
+                /// true = actionLog was modified and needs to be saved.
+                bool modified;
+                /// \brief
+                /// Synchronize access to actionLog.
+                std::mutex mutex;
+
+            public:
+                enum {
+                    /// \brief
+                    /// Default max action log file size.
+                    DEFAULT_MAX_ACTION_LOG_FILE_SIZE = 64 * 1024 * 1024
+                };
+
+                /// \brief
+                /// ctor. Create the action DAG.
+                /// \param[in] graph_ Graph to build.
+                /// \param[in] toolset_ Programs used to build.
+                /// \param[in] path_ Action log path.
+                Executor (
+                    const BuildGraph &graph_,
+                    const Toolset &toolset_ = Toolset::FromEnvironment (),
+                    const std::string &path_ = GetDefaultPath ());
+
+                /// \brief
+                /// Return $(TOOLCHAIN_ROOT)/ActionLog.xml.
+                /// \return $(TOOLCHAIN_ROOT)/ActionLog.xml.
+                static std::string GetDefaultPath ();
+
+                /// \brief
+                /// Return the action DAG.
+                /// \return The action DAG.
+                inline const std::vector<Action> &GetActions () const {
+                    return actions;
+                }
+
+                /// \brief
+                /// Run all out of date actions. If an action fails, no new
+                /// actions are started, the running ones are waited on, the
+                /// action log is saved and the exception is rethrown.
+                /// \param[in] workerCount Number of worker threads
+                /// (0 = std::thread::hardware_concurrency).
+                /// The ResourceBudget is ResourceBudget::FromEnvironment (workerCount).
+                /// \return Number of actions that ran.
+                util::ui32 Run (util::ui32 workerCount = 0);
+
+            private:
+                /// \brief
+                /// Return true if the given action's outputs are up to date.
+                /// \param[in] action Action to check.
+                /// \return true = action can be skipped.
+                bool IsUpToDate (const Action &action);
+                /// \brief
+                /// Run the given action (if it's out of date).
+                /// \param[in] action Action to run.
+                /// \return true = Action ran, false = Action was up to date.
+                bool Execute (const Action &action);
+                /// \brief
+                /// Add the given project's actions to the DAG.
+                /// \param[in] project Project to add.
+                /// \param[in] completionActions Actions (per project) after
+                /// which a project's dependents can link.
+                void AddProject (
+                    const BuildGraph::Project &project,
+                    std::vector<std::vector<util::ui32>> &completionActions);
+                /// \brief
+                /// Return the header to precompile for the given project's
+                /// language. If the project asked for an automatic precompiled
+                /// header, it's generated (see PrecompiledHeaderAdvisor.h) from
+                /// the sources and the time traces of the previous build.
+                /// \param[in] project Project whose header to return.
+                /// \param[in] language Language whose sources will use it.
+                /// \return Header path (empty = no precompiled header).
+                std::string GetPrecompiledHeader (
+                    const BuildGraph::Project &project,
+                    const BuildGraph::Language &language);
+                /// \brief
+                /// Add (or find) the action that precompiles the given header.
+                /// \param[in] project Project whose header to precompile.
+                /// \param[in] language c or cpp.
+                /// \param[in] header Header to precompile (see GetPrecompiledHeader).
+                /// \param[in] compiler Compiler used to precompile the header.
+                /// \param[in] dependencies Actions the precompile depends on.
+                /// \param[out] stubHeader Header to -include in compiles.
+                /// \return Action index.
+                util::ui32 AddPrecompiledHeader (
+                    const BuildGraph::Project &project,
+                    const BuildGraph::Language &language,
+                    const std::string &header,
+                    const std::string &compiler,
+                    const std::vector<util::ui32> &dependencies,
+                    std::string &stubHeader);
+                /// \brief
+                /// Add an action to the DAG.
+                /// \param[in] action Action to add.
+                /// \param[in] dependencies Actions it depends on.
+                /// \return Action index.
+                util::ui32 AddAction (
+                    const Action &action,
+                    const std::vector<util::ui32> &dependencies);
+
+                /// \brief
+                /// Load the action log.
+                /// \param[in] maxActionLogFileSize Max action log file size.
+                void Load (util::ui64 maxActionLogFileSize = DEFAULT_MAX_ACTION_LOG_FILE_SIZE);
+                /// \brief
+                /// Parse the action log.
+                /// \param[in] node Root node.
+                void ParseActionLog (pugi::xml_node &node);
+                /// \brief
+                /// Save the action log (if modified).
+                void Save ();
+
+                /// \brief
+                /// Executor is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (Executor)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Executor_h)
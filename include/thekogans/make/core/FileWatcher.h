@@ -0,0 +1,110 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_FileWatcher_h)
+#define __thekogans_make_core_FileWatcher_h
+
+#include <string>
+#include <set>
+#include <map>
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct FileWatcher FileWatcher.h thekogans/make/core/FileWatcher.h
+            ///
+            /// \brief
+            /// FileWatcher is a thin wrapper around inotify (Linux only). It
+            /// watches directories (not files) because most editors save by
+            /// writing a temporary file and renaming it over the original,
+            /// which would silently drop a watch placed on the file itself.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL FileWatcher {
+            private:
+                /// \brief
+                /// inotify instance.
+                int handle;
+                /// \brief
+                /// Convenient typedef for std::map<int, std::string>.
+                typedef std::map<int, std::string> Directories;
+                /// \brief
+                /// Watch descriptor to directory map.
+                Directories directories;
+                /// \brief
+                /// Watched directories.
+                std::set<std::string> watchedDirectories;
+
+            public:
+                /// \brief
+                /// ctor. Create the inotify instance.
+                FileWatcher ();
+                /// \brief
+                /// dtor. Close the inotify instance.
+                ~FileWatcher ();
+
+                /// \brief
+                /// Return the inotify handle (to poll on).
+                /// \return inotify handle.
+                inline int GetHandle () const {
+                    return handle;
+                }
+
+                /// \brief
+                /// Return true if the given directory is being watched.
+                /// \param[in] directory Directory to check.
+                /// \return true = directory is being watched.
+                inline bool IsWatched (const std::string &directory) const {
+                    return watchedDirectories.find (directory) != watchedDirectories.end ();
+                }
+
+                /// \brief
+                /// Start watching the given directory (does nothing if
+                /// already watched). Files created, modified, deleted
+                /// and renamed in it will be reported by Read.
+                /// \param[in] directory Directory to watch.
+                void AddDirectory (const std::string &directory);
+                /// \brief
+                /// Stop watching all directories.
+                void Clear ();
+
+                /// \brief
+                /// Wait for changes.
+                /// \param[in] timeout Max time to wait (in milliseconds).
+                /// -1 = wait forever.
+                /// \return true = changes are pending, false = timed out.
+                bool Wait (util::i32 timeout) const;
+                /// \brief
+                /// Read all pending changes (does not block).
+                /// \param[out] paths Full paths of changed files.
+                /// \return false = the kernel event queue overflowed and some
+                /// changes were lost. The caller should assume that everything
+                /// changed.
+                bool Read (std::set<std::string> &paths);
+
+                /// \brief
+                /// FileWatcher is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (FileWatcher)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_FileWatcher_h)
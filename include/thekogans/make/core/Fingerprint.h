@@ -0,0 +1,128 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Fingerprint_h)
+#define __thekogans_make_core_Fingerprint_h
+
+#include <string>
+#include <map>
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            #define FINGERPRINT_FILE "thekogans_make.fingerprint"
+
+            /// \struct Fingerprint Fingerprint.h thekogans/make/core/Fingerprint.h
+            ///
+            /// \brief
+            /// Fingerprint is a hash of everything that goes into a generated
+            /// build system: the evaluated config (its thekogans_make.xml, resolved
+            /// version, features, files, include directories, link libraries,
+            /// flags and preprocessor definitions), the fingerprints of its project
+            /// dependencies and plugin hosts, the generator (name and version), the
+            /// toolchain constants and the make_core version. CreateBuildSystem
+            /// stores the fingerprints of the build systems it generates in their
+            /// build roots ($(build_root)/thekogans_make.fingerprint) and skips
+            /// generation when none of them changed and the generator's output
+            /// (Generator::GetOutputFile) is still there. Whoever deletes a
+            /// generated build system must Delete its fingerprint too. Generators
+            /// can use the same calls to decide which dependencies need regenerating.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Fingerprint {
+                /// \brief
+                /// Convenient typedef for std::map<std::string, std::string>.
+                /// Maps fingerprint file paths to fingerprints.
+                typedef std::map<std::string, std::string> Map;
+
+                /// \brief
+                /// Return the path of the given build system's fingerprint file.
+                /// \param[in] project_root Project root directory (where thekogans_make.xml resides).
+                /// \param[in] generator Generator name.
+                /// \param[in] config Debug or Release.
+                /// \param[in] type Static or Shared.
+                /// \return $(build_root)/thekogans_make.fingerprint.
+                static std::string GetPath (
+                    const std::string &project_root,
+                    const std::string &generator,
+                    const std::string &config,
+                    const std::string &type);
+
+                /// \brief
+                /// Compute the fingerprint of the given build system.
+                /// \param[in] project_root Project root directory (where thekogans_make.xml resides).
+                /// \param[in] generator Generator name.
+                /// \param[in] generatorVersion Generator version (Generator::GetVersion).
+                /// \param[in] config Debug or Release.
+                /// \param[in] type Static or Shared.
+                /// \param[in] dependencies true = Also return the fingerprints
+                /// of all project dependencies (and plugin hosts).
+                /// \param[out] fingerprints Computed fingerprints.
+                /// \return The fingerprint of the given build system.
+                static std::string Compute (
+                    const std::string &project_root,
+                    const std::string &generator,
+                    const std::string &generatorVersion,
+                    const std::string &config,
+                    const std::string &type,
+                    bool dependencies,
+                    Map &fingerprints);
+
+                /// \brief
+                /// Return the fingerprint stored in the given file.
+                /// \param[in] path Fingerprint file path.
+                /// \return Stored fingerprint (empty if none).
+                static std::string Load (const std::string &path);
+                /// \brief
+                /// Return true if the given fingerprint matches the stored one
+                /// and the generator's output exists.
+                /// \param[in] path Fingerprint file path.
+                /// \param[in] fingerprint Fingerprint returned by Compute.
+                /// \param[in] outputFile Generator output file (Generator::GetOutputFile),
+                /// relative to the fingerprint's build root (empty = don't check).
+                /// \return true = nothing changed since the fingerprint was saved.
+                static bool IsUpToDate (
+                    const std::string &path,
+                    const std::string &fingerprint,
+                    const std::string &outputFile = std::string ());
+                /// \brief
+                /// Return true if all the given fingerprints match the stored
+                /// ones and all the generator's outputs exist.
+                /// \param[in] fingerprints Fingerprints returned by Compute.
+                /// \param[in] outputFile Generator output file (Generator::GetOutputFile),
+                /// relative to each fingerprint's build root (empty = don't check).
+                /// \return true = nothing changed since the fingerprints were saved.
+                static bool IsUpToDate (
+                    const Map &fingerprints,
+                    const std::string &outputFile = std::string ());
+                /// \brief
+                /// Store the given fingerprints. Fingerprints whose build root
+                /// does not exist (not generated) are skipped.
+                /// \param[in] fingerprints Fingerprints returned by Compute.
+                static void Save (const Map &fingerprints);
+                /// \brief
+                /// Delete the given fingerprint file (if it exists).
+                /// \param[in] path Fingerprint file path.
+                static void Delete (const std::string &path);
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Fingerprint_h)
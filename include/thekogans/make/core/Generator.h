@@ -31,6 +31,8 @@ namespace thekogans {
     namespace make {
         namespace core {
 
+            struct BuildGraph;
+
             /// \struct Generator Generator.h thekogans/make/Generator.h
             ///
             /// \brief
@@ -100,6 +102,45 @@ namespace thekogans {
                 /// Return the class name of the generator.
                 /// \return Class name of the generator.
                 virtual const char *GetName () const = 0;
+                /// \brief
+                /// Return the version of the generator's output. It's part of the
+                /// build system fingerprint (see Fingerprint.h). Bump it whenever
+                /// a change to the generator changes the build systems it produces
+                /// so that existing ones are regenerated.
+                /// \return Version of the generator's output.
+                virtual std::string GetVersion () const {
+                    return std::string ();
+                }
+                /// \brief
+                /// Return the primary file Generate writes (relative to the build
+                /// root, ex: Makefile). CreateBuildSystem regenerates a build system
+                /// whose fingerprint matches (see Fingerprint.h) but whose primary
+                /// output is missing.
+                /// \return Primary output file (empty = not known, don't check).
+                virtual std::string GetOutputFile () const {
+                    return std::string ();
+                }
+                /// \brief
+                /// Return true if Generate (..., false, ...) can run concurrently
+                /// on separate instances for different projects. CreateBuildSystem
+                /// will then generate a project's dependencies in parallel, each
+                /// with generateDependencies == false, after parsing every config
+                /// in the graph itself. thekogans_make::GetConfig is safe to call
+                /// from Generate. Thread-safe generators should not write to
+                /// std::cout/std::cerr from Generate as the order of that output
+                /// is not deterministic. Errors are reported in sequential order.
+                /// \return true = Generate is thread-safe.
+                virtual bool IsThreadSafe () const {
+                    return false;
+                }
+                /// \brief
+                /// Return true if the generator wants CreateBuildSystem to call
+                /// GenerateFromGraph instead of walking the thekogans_make
+                /// objects itself.
+                /// \return true = Call GenerateFromGraph.
+                virtual bool UsesBuildGraph () const {
+                    return false;
+                }
 
                 /// \brief
                 /// Generate a build system.
@@ -115,6 +156,17 @@ namespace thekogans {
                     const std::string &type,
                     bool generateDependencies,
                     bool force) = 0;
+                /// \brief
+                /// Generate a build system from a pre-resolved BuildGraph. The
+                /// default implementation calls Generate with the root project.
+                /// \param[in] graph The root project and all its dependencies.
+                /// \param[in] generateDependencies true = Generate Dependencies.
+                /// \param[in] force true = Don't bother checking the timestamps and force generation.
+                /// \return true = Generated the build system, false = The build system was up to date.
+                virtual bool GenerateFromGraph (
+                    const BuildGraph &graph,
+                    bool generateDependencies,
+                    bool force);
 
                 /// \brief
                 /// Delete a build system.
@@ -0,0 +1,174 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_IncludeScanner_h)
+#define __thekogans_make_core_IncludeScanner_h
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <mutex>
+#include "pugixml/pugixml.hpp"
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            #define INCLUDE_CACHE_XML "IncludeCache.xml"
+
+            /// \struct IncludeScanner IncludeScanner.h thekogans/make/core/IncludeScanner.h
+            ///
+            /// \brief
+            /// IncludeScanner finds the #include (and #import) directives of source
+            /// and header files and resolves them against a list of include
+            /// directories. Files are scanned with memchr (no preprocessing: #if'ed
+            /// out includes are reported too, which errs on the side of rebuilding).
+            /// The directives and a hash of every scanned file are cached
+            /// ($(TOOLCHAIN_ROOT)/IncludeCache.xml) keyed by the file's last modified
+            /// date, so a warm scan costs one stat per file. Headers that can't be
+            /// resolved (system headers) are ignored. IncludeScanner is thread safe.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL IncludeScanner {
+                /// \struct IncludeScanner::Entry IncludeScanner.h thekogans/make/core/IncludeScanner.h
+                ///
+                /// \brief
+                /// Cached scan of a single file.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Entry {
+                    /// \brief
+                    /// File last modified date when it was scanned.
+                    util::i64 lastModified;
+                    /// \brief
+                    /// SHA2-256 of the file contents.
+                    std::string hash;
+                    /// \brief
+                    /// Include directives. The first character is '"' or '<'.
+                    std::vector<std::string> includes;
+
+                    /// \brief
+                    /// ctor.
+                    Entry () :
+                        lastModified (0) {}
+                };
+
+                enum {
+                    /// \brief
+                    /// Default max include cache file size.
+                    DEFAULT_MAX_INCLUDE_CACHE_FILE_SIZE = 64 * 1024 * 1024
+                };
+
+            private:
+                /// \brief
+                /// Include cache path.
+                std::string path;
+                /// \brief
+                /// Convenient typedef for std::map<std::string, Entry>.
+                typedef std::map<std::string, Entry> Entries;
+                /// \brief
+                /// Cached scans.
+                Entries entries;
+                /// \brief
+                /// Files whose entries were validated during this session.
+                std::set<std::string> validated;
+                /// \brief
+                /// Files known to exist (or not) during this session.
+                std::map<std::string, bool> existing;
+                /// \brief
+                /// true = entries were modified and need to be saved.
+                bool modified;
+                /// \brief
+                /// Synchronize access to the above.
+                mutable std::mutex mutex;
+
+            public:
+                /// \brief
+                /// ctor. Load the include cache.
+                /// \param[in] path_ Include cache path.
+                explicit IncludeScanner (const std::string &path_ = GetDefaultPath ());
+
+                /// \brief
+                /// Return $(TOOLCHAIN_ROOT)/IncludeCache.xml.
+                /// \return $(TOOLCHAIN_ROOT)/IncludeCache.xml.
+                static std::string GetDefaultPath ();
+
+                /// \brief
+                /// Find the include directives in the given buffer.
+                /// \param[in] begin Start of buffer.
+                /// \param[in] end End of buffer.
+                /// \param[out] includes Include directives ('"' or '<' followed by the name).
+                static void ScanBuffer (
+                    const char *begin,
+                    const char *end,
+                    std::vector<std::string> &includes);
+
+                /// \brief
+                /// Return the (cached) scan of the given file.
+                /// \param[in] file File to scan.
+                /// \param[out] entry File scan.
+                /// \return false = file does not exist.
+                bool Scan (
+                    const std::string &file,
+                    Entry &entry);
+                /// \brief
+                /// Return the hash of the given file's contents.
+                /// \param[in] file File to hash.
+                /// \return SHA2-256 of the file's contents (empty if it doesn't exist).
+                std::string GetHash (const std::string &file);
+                /// \brief
+                /// Return all headers the given file includes (directly or not).
+                /// \param[in] file File whose headers to return.
+                /// \param[in] includeDirectories Directories to search (in order).
+                /// \param[out] dependencies Resolved headers.
+                /// \param[out] unresolved If not 0, include directives (as written,
+                /// "name" or <name>) that could not be resolved.
+                void GetDependencies (
+                    const std::string &file,
+                    const std::vector<std::string> &includeDirectories,
+                    std::set<std::string> &dependencies,
+                    std::set<std::string> *unresolved = 0);
+
+                /// \brief
+                /// Save the include cache (if modified).
+                void Save ();
+
+            private:
+                /// \brief
+                /// Return true if the given file exists (cached for the session).
+                /// \param[in] file File to check.
+                /// \return true = file exists.
+                bool Exists (const std::string &file);
+                /// \brief
+                /// Load the include cache.
+                /// \param[in] maxIncludeCacheFileSize Max include cache file size.
+                void Load (util::ui64 maxIncludeCacheFileSize = DEFAULT_MAX_INCLUDE_CACHE_FILE_SIZE);
+                /// \brief
+                /// Parse the include cache.
+                /// \param[in] node Root node.
+                void ParseIncludeCache (pugi::xml_node &node);
+
+                /// \brief
+                /// IncludeScanner is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (IncludeScanner)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_IncludeScanner_h)
@@ -0,0 +1,166 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_PrecompiledHeaderAdvisor_h)
+#define __thekogans_make_core_PrecompiledHeaderAdvisor_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/BuildGraph.h"
+#include "thekogans/make/core/IncludeScanner.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct PrecompiledHeaderAdvisor PrecompiledHeaderAdvisor.h thekogans/make/core/PrecompiledHeaderAdvisor.h
+            ///
+            /// \brief
+            /// PrecompiledHeaderAdvisor ranks the headers a project's sources include
+            /// by how many sources include them (directly or not) times how much
+            /// they cost to parse. Parse costs come from clang -ftime-trace files
+            /// (the "Source" events, averaged across all traces found) when there
+            /// are any, and from the size of the header and everything it includes
+            /// when there aren't. Headers under the project root are never
+            /// recommended (they change too often to be worth precompiling).
+            /// The recommendation is used to generate the precompiled header of
+            /// projects that ask for one with <precompiled_header auto = "yes"/>.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL PrecompiledHeaderAdvisor {
+                /// \struct PrecompiledHeaderAdvisor::Candidate PrecompiledHeaderAdvisor.h
+                /// thekogans/make/core/PrecompiledHeaderAdvisor.h
+                ///
+                /// \brief
+                /// A header worth considering.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Candidate {
+                    /// \brief
+                    /// Full path of a resolved header or, for a header that
+                    /// could not be resolved (system headers), the include
+                    /// directive as written (<name> or "name").
+                    std::string header;
+                    /// \brief
+                    /// Number of sources that include it.
+                    util::ui32 count;
+                    /// \brief
+                    /// Parse cost (microseconds if measured, bytes if not).
+                    util::f64 cost;
+                    /// \brief
+                    /// count * cost.
+                    util::f64 score;
+
+                    /// \brief
+                    /// ctor.
+                    Candidate () :
+                        count (0),
+                        cost (0.0),
+                        score (0.0) {}
+
+                    /// \brief
+                    /// Return true if the candidate was resolved to a file.
+                    /// \return true = header is a full path.
+                    inline bool IsResolved () const {
+                        return !header.empty () && header[0] != '<' && header[0] != '"';
+                    }
+                };
+
+                /// \brief
+                /// Convenient typedef for std::map<std::string, util::f64>.
+                /// Header path to average parse time (microseconds).
+                typedef std::map<std::string, util::f64> ParseCosts;
+
+                enum {
+                    /// \brief
+                    /// Default min percentage of sources that must include a
+                    /// header for it to be recommended.
+                    DEFAULT_MIN_INCLUSION_PERCENTAGE = 50,
+                    /// \brief
+                    /// Default max number of recommended headers.
+                    DEFAULT_MAX_HEADERS = 32,
+                    /// \brief
+                    /// Assumed size (in bytes) of an unresolved header and
+                    /// everything it includes when there are no time traces.
+                    UNMEASURED_HEADER_SIZE = 128 * 1024
+                };
+
+                /// \brief
+                /// Aggregate the clang -ftime-trace (*.json) files found in
+                /// the given directory (and its subdirectories).
+                /// \param[in] directory Directory to search.
+                /// \param[out] costs Average parse time of every header traced.
+                static void LoadTimeTraces (
+                    const std::string &directory,
+                    ParseCosts &costs);
+
+                /// \brief
+                /// Rank the headers included by the given sources.
+                /// \param[in] sources Sources to analyze.
+                /// \param[in] includeDirectories Directories to search (in order).
+                /// \param[in] includeScanner Used to find the included headers.
+                /// \param[in] costs Measured parse costs (can be empty).
+                /// \param[out] candidates Headers, highest score first.
+                /// \return Number of sources analyzed (unity batches count
+                /// as the number of sources they batch).
+                static std::size_t GetCandidates (
+                    const std::vector<BuildGraph::File> &sources,
+                    const std::vector<std::string> &includeDirectories,
+                    IncludeScanner &includeScanner,
+                    const ParseCosts &costs,
+                    std::vector<Candidate> &candidates);
+
+                /// \brief
+                /// Pick the headers to precompile from the ranked candidates.
+                /// Headers under project_root, headers included by fewer than
+                /// minInclusionPercentage % of the sources and resolved headers
+                /// already included by a better candidate are skipped.
+                /// \param[in] candidates Ranked candidates (see GetCandidates).
+                /// \param[in] sourceCount Number of sources analyzed.
+                /// \param[in] project_root Project root.
+                /// \param[in] includeDirectories Directories to search (in order).
+                /// \param[in] includeScanner Used to find the included headers.
+                /// \param[out] headers Recommended headers (best first).
+                /// \param[in] minInclusionPercentage Min percentage of sources
+                /// that must include a header.
+                /// \param[in] maxHeaders Max number of headers to recommend.
+                static void GetRecommended (
+                    const std::vector<Candidate> &candidates,
+                    std::size_t sourceCount,
+                    const std::string &project_root,
+                    const std::vector<std::string> &includeDirectories,
+                    IncludeScanner &includeScanner,
+                    std::vector<std::string> &headers,
+                    util::ui32 minInclusionPercentage = DEFAULT_MIN_INCLUSION_PERCENTAGE,
+                    util::ui32 maxHeaders = DEFAULT_MAX_HEADERS);
+
+                /// \brief
+                /// Write a header that includes the given headers. The file
+                /// is only rewritten if its contents change.
+                /// \param[in] path Header path.
+                /// \param[in] headers Headers to include (see GetRecommended).
+                /// \return true = the file was (re)written.
+                static bool WriteHeader (
+                    const std::string &path,
+                    const std::vector<std::string> &headers);
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_PrecompiledHeaderAdvisor_h)
@@ -0,0 +1,95 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_PrecompiledHeaderCache_h)
+#define __thekogans_make_core_PrecompiledHeaderCache_h
+
+#include <string>
+#include <list>
+#include <vector>
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/IncludeScanner.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            #define PRECOMPILED_HEADER_CACHE_DIR "pch"
+
+            /// \struct PrecompiledHeaderCache PrecompiledHeaderCache.h thekogans/make/core/PrecompiledHeaderCache.h
+            ///
+            /// \brief
+            /// PrecompiledHeaderCache lets projects that precompile the same header
+            /// the same way share one precompiled header. A precompiled header lives
+            /// in $(TOOLCHAIN_ROOT)/pch/<key>/, where key is a hash of the header's
+            /// contents (and those of every header it includes), the compiler and
+            /// the compiler arguments that affect code generation (include
+            /// directories are left out, as the included headers' contents already
+            /// account for them). The cached directory holds a stub header that
+            /// includes the real one, and the stub's precompiled form next to it,
+            /// so compiles use it with -include <stub> (gcc/clang pick up
+            /// <stub>.gch and fall back to the stub if it's unusable).
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL PrecompiledHeaderCache {
+                /// \brief
+                /// Return $(TOOLCHAIN_ROOT)/pch.
+                /// \return $(TOOLCHAIN_ROOT)/pch.
+                static std::string GetDirectory ();
+                /// \brief
+                /// Return the cache key of the given header.
+                /// \param[in] header Full path of the header to precompile.
+                /// \param[in] compiler Compiler used to precompile it.
+                /// \param[in] arguments Compiler arguments (-I arguments are ignored).
+                /// \param[in] includeDirectories Used to find the headers header includes.
+                /// \param[in] includeScanner Used to find and hash the headers header includes.
+                /// \return Cache key.
+                static std::string GetKey (
+                    const std::string &header,
+                    const std::string &compiler,
+                    const std::list<std::string> &arguments,
+                    const std::vector<std::string> &includeDirectories,
+                    IncludeScanner &includeScanner);
+                /// \brief
+                /// Return the path of the stub header for the given key.
+                /// \param[in] key Cache key.
+                /// \param[in] header Full path of the header to precompile.
+                /// \return $(TOOLCHAIN_ROOT)/pch/<key>/<header name>.
+                static std::string GetStubHeader (
+                    const std::string &key,
+                    const std::string &header);
+                /// \brief
+                /// Return the path of the precompiled header for the given key.
+                /// \param[in] key Cache key.
+                /// \param[in] header Full path of the header to precompile.
+                /// \return $(TOOLCHAIN_ROOT)/pch/<key>/<header name>.gch.
+                static std::string GetPrecompiledHeader (
+                    const std::string &key,
+                    const std::string &header);
+                /// \brief
+                /// Create the stub header (if it doesn't exist).
+                /// \param[in] key Cache key.
+                /// \param[in] header Full path of the header to precompile.
+                static void CreateStubHeader (
+                    const std::string &key,
+                    const std::string &header);
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_PrecompiledHeaderCache_h)
@@ -0,0 +1,246 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Process_h)
+#define __thekogans_make_core_Process_h
+
+#include <string>
+#include <list>
+#include <map>
+#include <ostream>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Singleton.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct ResourceUsage Process.h thekogans/make/core/Process.h
+            ///
+            /// \brief
+            /// Resources consumed by one or more child processes (and all
+            /// their descendants).
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL ResourceUsage {
+                /// \brief
+                /// Number of processes accounted for.
+                util::ui32 processCount;
+                /// \brief
+                /// Wall clock time (in seconds).
+                util::f64 wallTime;
+                /// \brief
+                /// User CPU time (in seconds).
+                util::f64 userTime;
+                /// \brief
+                /// System CPU time (in seconds).
+                util::f64 systemTime;
+                /// \brief
+                /// Max resident set size (in KB) of any single process.
+                util::ui64 maxRSS;
+                /// \brief
+                /// File system input blocks.
+                util::ui64 inputBlocks;
+                /// \brief
+                /// File system output blocks.
+                util::ui64 outputBlocks;
+
+                /// \brief
+                /// ctor.
+                ResourceUsage () :
+                    processCount (0),
+                    wallTime (0.0),
+                    userTime (0.0),
+                    systemTime (0.0),
+                    maxRSS (0),
+                    inputBlocks (0),
+                    outputBlocks (0) {}
+
+                /// \brief
+                /// Accumulate the given usage. Times and blocks
+                /// are summed, maxRSS is the max of the two.
+                /// \param[in] usage Usage to accumulate.
+                /// \return *this.
+                ResourceUsage &operator += (const ResourceUsage &usage);
+            };
+
+            /// \struct Process Process.h thekogans/make/core/Process.h
+            ///
+            /// \brief
+            /// Process is a drop in replacement for util::ChildProcess for the
+            /// processes make_core spawns. On POSIX it spawns the child itself
+            /// (fork/exec) and reaps it with wait4 to capture it's resource
+            /// usage. On Windows it falls back to util::ChildProcess and only
+            /// the wall clock time is captured.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Process {
+            private:
+                /// \brief
+                /// Program to execute.
+                std::string path;
+                /// \brief
+                /// Program arguments.
+                std::list<std::string> arguments;
+                /// \brief
+                /// Child exit code (-1 if it did not exit normally).
+                int returnCode;
+                /// \brief
+                /// Child resource usage.
+                ResourceUsage usage;
+                /// \brief
+                /// If not empty, the child's stdout and stderr go here.
+                std::string outputPath;
+                /// \brief
+                /// If not empty, the child's output is streamed line by line
+                /// with this prefix.
+                std::string outputPrefix;
+                /// \brief
+                /// If not empty, a copy of the streamed output goes here.
+                std::string logPath;
+
+            public:
+                /// \brief
+                /// ctor.
+                /// \param[in] path_ Program to execute.
+                explicit Process (const std::string &path_) :
+                    path (path_),
+                    returnCode (-1) {}
+
+                /// \brief
+                /// Add an argument to the command line.
+                /// \param[in] argument Argument to add.
+                void AddArgument (const std::string &argument) {
+                    arguments.push_back (argument);
+                }
+
+                /// \brief
+                /// Redirect the child's stdout and stderr to the given file
+                /// (truncated). On Windows the child always inherits the
+                /// parent's output.
+                /// \param[in] outputPath_ File to write the child's output to.
+                void SetOutputPath (const std::string &outputPath_) {
+                    outputPath = outputPath_;
+                }
+
+                /// \brief
+                /// Capture the child's stdout and stderr through pipes and
+                /// stream them through Console (stdout at the Info level, stderr
+                /// at the Error level, see Console.h) as complete lines,
+                /// each starting with the given prefix. Lines from concurrently
+                /// running children never interleave, and unlike make's
+                /// --output-sync, nothing is held back until the child exits.
+                /// On Windows the child always inherits the parent's output.
+                /// \param[in] outputPrefix_ Line prefix ("[project:variant] ").
+                /// \param[in] logPath_ If not empty, the unprefixed output is
+                /// also written (truncated) to this file.
+                void SetOutputPrefix (
+                        const std::string &outputPrefix_,
+                        const std::string &logPath_ = std::string ()) {
+                    outputPrefix = outputPrefix_;
+                    logPath = logPath_;
+                }
+
+                /// \brief
+                /// Execute the child and wait for it to finish.
+                /// \return true = the child ran to completion and returned 0.
+                bool Exec ();
+
+                /// \brief
+                /// Return the child exit code.
+                /// \return Child exit code.
+                int GetReturnCode () const {
+                    return returnCode;
+                }
+                /// \brief
+                /// Return the child resource usage.
+                /// \return Child resource usage.
+                const ResourceUsage &GetResourceUsage () const {
+                    return usage;
+                }
+
+                /// \brief
+                /// Return the command line (for error reporting).
+                /// \return Command line.
+                std::string BuildCommandLine () const;
+
+                /// \brief
+                /// Process is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (Process)
+            };
+
+            /// \struct ProcessAccounting Process.h thekogans/make/core/Process.h
+            ///
+            /// \brief
+            /// ProcessAccounting aggregates child process resource usage per
+            /// project and target so that BuildProject can report which
+            /// projects dominate build cost and memory.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL ProcessAccounting :
+                    public util::Singleton<ProcessAccounting, util::SpinLock> {
+                /// \brief
+                /// Convenient typedef for std::pair<std::string, std::string>
+                /// (project, target).
+                typedef std::pair<std::string, std::string> Key;
+                /// \brief
+                /// Convenient typedef for std::map<Key, ResourceUsage>.
+                typedef std::map<Key, ResourceUsage> Map;
+
+            private:
+                /// \brief
+                /// Aggregated usage.
+                Map map;
+                /// \brief
+                /// Synchronization lock.
+                mutable util::SpinLock spinLock;
+
+            public:
+                /// \brief
+                /// Accumulate the given usage under project/target.
+                /// \param[in] project Project the process worked on.
+                /// \param[in] target Target the process built.
+                /// \param[in] usage Process resource usage.
+                void Add (
+                    const std::string &project,
+                    const std::string &target,
+                    const ResourceUsage &usage);
+
+                /// \brief
+                /// Return the aggregated usage.
+                /// \param[out] map_ Where to put the aggregated usage.
+                void Get (Map &map_) const;
+                /// \brief
+                /// Return the usage of all processes.
+                /// \return The usage of all processes.
+                ResourceUsage GetTotal () const;
+
+                /// \brief
+                /// Forget all accounted usage.
+                void Reset ();
+
+                /// \brief
+                /// Write a per project/target table (most expensive
+                /// first) followed by the totals.
+                /// \param[in] stream Where to write the table.
+                void Report (std::ostream &stream) const;
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Process_h)
@@ -0,0 +1,173 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_ProjectGraph_h)
+#define __thekogans_make_core_ProjectGraph_h
+
+#include <memory>
+#include <string>
+#include <set>
+#include <map>
+#include <vector>
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/thekogans_make.h"
+#include "thekogans/make/core/IncludeScanner.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct ProjectGraph ProjectGraph.h thekogans/make/core/ProjectGraph.h
+            ///
+            /// \brief
+            /// ProjectGraph is a snapshot of a project and all its project dependencies
+            /// (and plugin hosts) as seen by BuildProject. It maps files to the projects
+            /// that own them and projects to the projects that depend on them. Used to
+            /// compute the slice of the graph that needs to be rebuilt (or retested)
+            /// after a set of files changed.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL ProjectGraph {
+                /// \brief
+                /// Convenient typedef for std::unique_ptr<ProjectGraph>.
+                typedef std::unique_ptr<ProjectGraph> Ptr;
+
+                /// \brief
+                /// Root project.
+                std::string project_root;
+                /// \brief
+                /// Debug | Release.
+                std::string config;
+                /// \brief
+                /// Static | Shared.
+                std::string type;
+                /// \brief
+                /// Roots of all projects in the graph.
+                std::set<std::string> projects;
+                /// \brief
+                /// Convenient typedef for std::map<std::string, std::set<std::string>>.
+                typedef std::map<std::string, std::set<std::string>> Dependents;
+                /// \brief
+                /// Project root to direct dependents map.
+                Dependents dependents;
+                /// \brief
+                /// Convenient typedef for std::map<std::string, std::string>.
+                typedef std::map<std::string, std::string> Owners;
+                /// \brief
+                /// File (listed in a FileList or thekogans_make.xml) to owning project root map.
+                Owners files;
+                /// \brief
+                /// Directory (project root, FileList prefix or include
+                /// directory) to owning project root map.
+                Owners directories;
+                /// \brief
+                /// Convenient typedef for std::map<std::string, std::set<std::string>>.
+                typedef std::map<std::string, std::set<std::string>> Files;
+                /// \brief
+                /// Project root to test files (*_tests file lists) map.
+                Files testFiles;
+                /// \brief
+                /// Convenient typedef for std::map<std::string, std::vector<std::string>>.
+                typedef std::map<std::string, std::vector<std::string>> IncludeDirectories;
+                /// \brief
+                /// Project root to include directories map.
+                IncludeDirectories includeDirectories;
+
+                /// \brief
+                /// ctor. Load the graph.
+                /// \param[in] project_root_ Root project.
+                /// \param[in] config_ Debug | Release.
+                /// \param[in] type_ Static | Shared.
+                ProjectGraph (
+                    const std::string &project_root_,
+                    const std::string &config_,
+                    const std::string &type_);
+
+                /// \brief
+                /// Return the root of the project that owns the given path. Files
+                /// listed in a config are matched exactly. Everything else belongs
+                /// to the project with the longest matching directory.
+                /// \param[in] path Absolute path.
+                /// \return Owning project root (empty if not in the graph).
+                std::string GetOwner (const std::string &path) const;
+                /// \brief
+                /// Return the given projects and every project that (transitively)
+                /// depends on them.
+                /// \param[in] roots Project roots.
+                /// \param[out] closure Reverse dependency closure of roots.
+                void GetDependents (
+                    const std::set<std::string> &roots,
+                    std::set<std::string> &closure) const;
+                /// \brief
+                /// Map the given paths to their owners and return the reverse
+                /// dependency closure of the owners.
+                /// \param[in] paths Changed paths (absolute).
+                /// \param[out] affectedProjects Projects that need to be rebuilt.
+                /// \param[out] unownedPaths If not null, receives paths not in the graph.
+                void GetAffectedProjects (
+                    const std::set<std::string> &paths,
+                    std::set<std::string> &affectedProjects,
+                    std::set<std::string> *unownedPaths = 0) const;
+                /// \brief
+                /// Like GetAffectedProjects, but for deciding which projects need
+                /// to be retested. A project whose changes are confined to its
+                /// tests (test files and the headers only they include, found
+                /// with includeScanner) is retested, but its dependents are not.
+                /// \param[in] paths Changed paths (absolute).
+                /// \param[in] includeScanner Used to find the headers the
+                /// project's files include.
+                /// \param[out] impactedProjects Projects that need to be retested.
+                /// \param[out] unownedPaths If not null, receives paths not in the graph.
+                void GetImpactedProjects (
+                    const std::set<std::string> &paths,
+                    IncludeScanner &includeScanner,
+                    std::set<std::string> &impactedProjects,
+                    std::set<std::string> *unownedPaths = 0) const;
+
+            private:
+                /// \brief
+                /// Return true if the given project's changes only affect its tests.
+                /// \param[in] owner Project root.
+                /// \param[in] paths Changed paths owned by owner.
+                /// \param[in] includeScanner Used to find the included headers.
+                /// \return true = only owner's tests are affected.
+                bool IsTestOnlyChange (
+                    const std::string &owner,
+                    const std::set<std::string> &paths,
+                    IncludeScanner &includeScanner) const;
+                /// \brief
+                /// Add the given project and its dependencies to the graph.
+                /// \param[in] config_ Project config.
+                void AddProject (const thekogans_make &config_);
+                /// \brief
+                /// Map the given directory to the given project (if it's inside it).
+                /// \param[in] directory Directory to map.
+                /// \param[in] owner Owning project root.
+                void AddDirectory (
+                    const std::string &directory,
+                    const std::string &owner);
+
+                /// \brief
+                /// ProjectGraph is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (ProjectGraph)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_ProjectGraph_h)
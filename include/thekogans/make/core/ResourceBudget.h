@@ -0,0 +1,149 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_ResourceBudget_h)
+#define __thekogans_make_core_ResourceBudget_h
+
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct ResourceBudget ResourceBudget.h thekogans/make/core/ResourceBudget.h
+            ///
+            /// \brief
+            /// ResourceBudget keeps separate pools of compile and link tokens and a
+            /// memory budget. Scheduler and Executor acquire a token (and a job's
+            /// estimated memory, its recorded max RSS, see BuildHistory::GetMaxRSS)
+            /// before starting a job and release them when it completes. Jobs that
+            /// don't fit are passed over for the ones that do, so that a few big
+            /// links don't run the host out of memory while compiles keep the CPUs
+            /// busy. A job that needs more than the whole budget runs by itself.
+            /// NOTE: Max RSS is measured per child process (the biggest single
+            /// process in the job's tree), not summed over the tree. A gnu make
+            /// job holds one token but runs -j<n> recipes, where n is the host's
+            /// CPU count divided by the number of makes that can run at once
+            /// (see BuildProject), so it can use up to n times its estimate.
+            /// The budgets are per host, set with the following environment variables:
+            ///
+            /// THEKOGANS_MAKE_CORE_COMPILE_JOBS - max concurrent compile jobs
+            /// (default: worker count).
+            /// THEKOGANS_MAKE_CORE_LINK_JOBS - max concurrent link jobs
+            /// (default: a quarter of the worker count, at least 1).
+            /// THEKOGANS_MAKE_CORE_MEMORY_BUDGET - memory (in MB) all running jobs
+            /// can use (default: DEFAULT_MEMORY_PERCENTAGE of physical memory,
+            /// 0 = unlimited).
+            ///
+            /// NOTE: ResourceBudget is not thread safe. Callers serialize access to it.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL ResourceBudget {
+                /// \brief
+                /// Token pools.
+                enum Pool {
+                    /// \brief
+                    /// Compiles (and everything else that's not a link).
+                    Compile,
+                    /// \brief
+                    /// Links.
+                    Link
+                };
+
+                enum {
+                    /// \brief
+                    /// Default memory budget (percentage of physical memory).
+                    DEFAULT_MEMORY_PERCENTAGE = 80,
+                    /// \brief
+                    /// Estimated memory (in KB) of a compile job never measured.
+                    DEFAULT_COMPILE_MEMORY = 256 * 1024,
+                    /// \brief
+                    /// Estimated memory (in KB) of a link job never measured.
+                    DEFAULT_LINK_MEMORY = 1024 * 1024
+                };
+
+                /// \brief
+                /// Max concurrent compile jobs.
+                util::ui32 compileTokens;
+                /// \brief
+                /// Max concurrent link jobs.
+                util::ui32 linkTokens;
+                /// \brief
+                /// Memory (in KB) all running jobs can use (0 = unlimited).
+                util::ui64 memory;
+
+            private:
+                /// \brief
+                /// Running compile jobs.
+                util::ui32 compileJobs;
+                /// \brief
+                /// Running link jobs.
+                util::ui32 linkJobs;
+                /// \brief
+                /// Estimated memory (in KB) used by running jobs.
+                util::ui64 memoryInUse;
+
+            public:
+                /// \brief
+                /// ctor.
+                /// \param[in] compileTokens_ Max concurrent compile jobs.
+                /// \param[in] linkTokens_ Max concurrent link jobs.
+                /// \param[in] memory_ Memory (in KB) all running jobs can use (0 = unlimited).
+                ResourceBudget (
+                    util::ui32 compileTokens_,
+                    util::ui32 linkTokens_,
+                    util::ui64 memory_ = 0);
+
+                /// \brief
+                /// Return the budget configured for this host (see above).
+                /// \param[in] workerCount Number of workers the budget is for.
+                /// \return Host budget.
+                static ResourceBudget FromEnvironment (util::ui32 workerCount);
+                /// \brief
+                /// Return the physical memory (in KB) of this host.
+                /// \return Physical memory (in KB, 0 = unknown).
+                static util::ui64 GetPhysicalMemory ();
+
+                /// \brief
+                /// Acquire a token from the given pool and the given amount of memory.
+                /// \param[in] pool Pool to acquire a token from.
+                /// \param[in] memory_ Estimated job memory (in KB).
+                /// \return true = acquired, false = the job doesn't fit (yet).
+                bool Acquire (
+                    Pool pool,
+                    util::ui64 memory_);
+                /// \brief
+                /// Release what a previous successful Acquire acquired.
+                /// \param[in] pool Pool passed to Acquire.
+                /// \param[in] memory_ Memory passed to Acquire.
+                void Release (
+                    Pool pool,
+                    util::ui64 memory_);
+
+                /// \brief
+                /// Return true if no job is holding resources.
+                /// \return true = no job is holding resources.
+                inline bool IsIdle () const {
+                    return compileJobs == 0 && linkJobs == 0;
+                }
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_ResourceBudget_h)
@@ -0,0 +1,254 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Scheduler_h)
+#define __thekogans_make_core_Scheduler_h
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <list>
+#include <set>
+#include <ostream>
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/ResourceBudget.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct Scheduler Scheduler.h thekogans/make/core/Scheduler.h
+            ///
+            /// \brief
+            /// Scheduler runs a DAG of jobs (one per project in BuildProject) on a
+            /// number of worker threads. Ready jobs are started longest remaining
+            /// path first (using each job's estimated duration), so that a few slow
+            /// libraries deep in the graph do not end up holding up the whole build.
+            /// Given a ResourceBudget, a ready job only starts if its pool has a free
+            /// token and its estimated memory fits. Otherwise the next ready job that
+            /// does fit is started instead.
+            /// After the run, the critical path (and the dependency edges whose
+            /// removal would shorten it the most) can be reported.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Scheduler {
+                /// \brief
+                /// Convenient typedef for std::function<void ()>.
+                typedef std::function<void ()> Action;
+
+                /// \struct Scheduler::Job Scheduler.h thekogans/make/core/Scheduler.h
+                ///
+                /// \brief
+                /// A node in the DAG.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Job {
+                    /// \brief
+                    /// Job name (for reporting).
+                    std::string name;
+                    /// \brief
+                    /// Estimated duration (in seconds).
+                    util::f64 estimate;
+                    /// \brief
+                    /// Runs on a worker thread.
+                    Action action;
+                    /// \brief
+                    /// ResourceBudget pool the job takes a token from.
+                    ResourceBudget::Pool pool;
+                    /// \brief
+                    /// Estimated memory (in KB).
+                    util::ui64 memory;
+                    /// \brief
+                    /// Run on the thread that called Run, after action completes.
+                    std::list<Action> postActions;
+                    /// \brief
+                    /// Jobs that must complete before this one starts.
+                    std::set<util::ui32> dependencies;
+                    /// \brief
+                    /// Jobs that depend on this one.
+                    std::set<util::ui32> dependents;
+                    /// \brief
+                    /// Longest path (in seconds) from the start of this
+                    /// job to the end of the schedule.
+                    util::f64 remaining;
+                    /// \brief
+                    /// true = action and postActions completed.
+                    bool completed;
+                    /// \brief
+                    /// Actual duration of action (in seconds).
+                    util::f64 duration;
+
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] name_ Job name.
+                    /// \param[in] estimate_ Estimated duration (in seconds).
+                    /// \param[in] action_ Runs on a worker thread.
+                    /// \param[in] pool_ ResourceBudget pool the job takes a token from.
+                    /// \param[in] memory_ Estimated memory (in KB).
+                    Job (
+                        const std::string &name_,
+                        util::f64 estimate_,
+                        const Action &action_,
+                        ResourceBudget::Pool pool_ = ResourceBudget::Compile,
+                        util::ui64 memory_ = 0) :
+                        name (name_),
+                        estimate (estimate_),
+                        action (action_),
+                        pool (pool_),
+                        memory (memory_),
+                        remaining (0.0),
+                        completed (false),
+                        duration (0.0) {}
+
+                    /// \brief
+                    /// Return the actual duration if completed, the estimate otherwise.
+                    /// \return Job duration (in seconds).
+                    util::f64 GetDuration () const {
+                        return completed ? duration : estimate;
+                    }
+                };
+                /// \brief
+                /// DAG nodes.
+                std::vector<Job> jobs;
+
+                /// \struct Scheduler::Progress Scheduler.h thekogans/make/core/Scheduler.h
+                ///
+                /// \brief
+                /// A snapshot of a Run in progress. All times are in seconds.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Progress {
+                    /// \brief
+                    /// Number of completed jobs.
+                    util::ui32 completedJobs;
+                    /// \brief
+                    /// Number of running jobs.
+                    util::ui32 runningJobs;
+                    /// \brief
+                    /// Total number of jobs.
+                    util::ui32 totalJobs;
+                    /// \brief
+                    /// Time since Run started.
+                    util::f64 elapsed;
+                    /// \brief
+                    /// Estimated work completed (sum of job durations).
+                    util::f64 completedWork;
+                    /// \brief
+                    /// Estimated total work (sum of job durations).
+                    util::f64 totalWork;
+                    /// \brief
+                    /// Estimated time remaining. The larger of the remaining
+                    /// critical path and the remaining work spread over the
+                    /// workers.
+                    util::f64 eta;
+
+                    /// \brief
+                    /// ctor.
+                    Progress () :
+                        completedJobs (0),
+                        runningJobs (0),
+                        totalJobs (0),
+                        elapsed (0.0),
+                        completedWork (0.0),
+                        totalWork (0.0),
+                        eta (0.0) {}
+
+                    /// \brief
+                    /// Return the estimated fraction [0.0, 1.0] of the work completed.
+                    /// \return Estimated fraction of the work completed.
+                    util::f64 GetFraction () const {
+                        return totalWork > 0.0 ? completedWork / totalWork :
+                            totalJobs > 0 ? (util::f64)completedJobs / (util::f64)totalJobs : 1.0;
+                    }
+                };
+                /// \brief
+                /// Called on the thread that called Run when jobs start and
+                /// complete, and every PROGRESS_INTERVAL seconds in between.
+                typedef std::function<void (const Progress &)> ProgressCallback;
+
+                enum {
+                    /// \brief
+                    /// How often (in seconds) to report progress while jobs are running.
+                    PROGRESS_INTERVAL = 1
+                };
+
+                /// \brief
+                /// Add a job to the DAG.
+                /// \param[in] name Job name (for reporting).
+                /// \param[in] estimate Estimated duration (in seconds).
+                /// \param[in] action Runs on a worker thread.
+                /// \param[in] pool ResourceBudget pool the job takes a token from.
+                /// \param[in] memory Estimated memory (in KB).
+                /// \return Job index.
+                util::ui32 AddJob (
+                    const std::string &name,
+                    util::f64 estimate,
+                    const Action &action,
+                    ResourceBudget::Pool pool = ResourceBudget::Compile,
+                    util::ui64 memory = 0);
+                /// \brief
+                /// Add an action to run on the thread that called
+                /// Run after the given job's action completes.
+                /// \param[in] job Job index.
+                /// \param[in] postAction Action to run.
+                void AddPostAction (
+                    util::ui32 job,
+                    const Action &postAction);
+                /// \brief
+                /// Make job depend on dependency.
+                /// \param[in] job Job index.
+                /// \param[in] dependency Job index of the dependency.
+                void AddDependency (
+                    util::ui32 job,
+                    util::ui32 dependency);
+
+                /// \brief
+                /// Run all jobs. If a job throws, no new jobs are started,
+                /// the running ones are waited on, and the exception is
+                /// rethrown.
+                /// \param[in] workerCount Max number of concurrently running
+                /// jobs. 1 (without a progressCallback) = run every job on the
+                /// calling thread.
+                /// \param[in] progressCallback Optional progress callback.
+                /// \param[in] budget Optional resource budget (ignored when
+                /// running every job on the calling thread).
+                void Run (
+                    util::ui32 workerCount,
+                    const ProgressCallback &progressCallback = ProgressCallback (),
+                    const ResourceBudget *budget = 0);
+
+                /// \brief
+                /// Compute every job's remaining (longest path to the end).
+                /// \return Critical path length (in seconds).
+                util::f64 ComputeRemaining ();
+                /// \brief
+                /// Return the critical path (using actual durations for
+                /// completed jobs and estimates for the rest).
+                /// \param[out] path Job indices (first to last).
+                /// \return Critical path length (in seconds).
+                util::f64 GetCriticalPath (std::vector<util::ui32> &path) const;
+                /// \brief
+                /// Write the critical path followed by the dependency edges
+                /// on it whose removal would shorten it the most.
+                /// \param[in] stream Where to write the report.
+                /// \param[in] maxEdges Max number of edges to report.
+                void ReportCriticalPath (
+                    std::ostream &stream,
+                    util::ui32 maxEdges = 5) const;
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Scheduler_h)
@@ -0,0 +1,157 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Server_h)
+#define __thekogans_make_core_Server_h
+
+#include <string>
+#include <set>
+#include <ostream>
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/FileWatcher.h"
+#include "thekogans/make/core/thekogans_make.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            #define THEKOGANS_MAKE_SOCKET "thekogans_make.socket"
+
+            /// \struct Server Server.h thekogans/make/core/Server.h
+            ///
+            /// \brief
+            /// Server (Linux only) keeps the parsed project graph (thekogans_make
+            /// config cache) resident between requests. Requests arrive on a Unix
+            /// domain socket, one line per connection:
+            ///
+            /// build <project_root> [config] [type] [target] [concurrency]
+            /// generate <project_root> [generator] [config] [type] [force]
+            /// query <project_root> <what> [config] [type]
+            ///
+            /// where what is one of version, features, dependencies,
+            /// include_directories, link_libraries or shared_libraries.
+            /// While a request is processed the server's stdout and stderr
+            /// (and those of the child processes it spawns) are redirected to
+            /// the connection. The last line of the response is either "ok" or
+            /// "error" (preceded by the error report). Requests are processed
+            /// one at a time, the config cache is not thread safe.
+            ///
+            /// The directory of every config loaded on behalf of a request is
+            /// watched for changes. When a thekogans_make.xml changes, its
+            /// project, and every project that depends on it, is flushed from
+            /// the cache and will be reparsed by the next request that needs it.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Server {
+                static const char * const REQUEST_BUILD;
+                static const char * const REQUEST_GENERATE;
+                static const char * const REQUEST_QUERY;
+                static const char * const QUERY_VERSION;
+                static const char * const QUERY_FEATURES;
+                static const char * const QUERY_DEPENDENCIES;
+                static const char * const QUERY_INCLUDE_DIRECTORIES;
+                static const char * const QUERY_LINK_LIBRARIES;
+                static const char * const QUERY_SHARED_LIBRARIES;
+                static const char * const RESPONSE_OK;
+                static const char * const RESPONSE_ERROR;
+
+                enum {
+                    /// \brief
+                    /// Max request line length.
+                    MAX_REQUEST_SIZE = 64 * 1024,
+                    /// \brief
+                    /// Max time (in seconds) to wait for a client to send its request.
+                    REQUEST_TIMEOUT = 5
+                };
+
+            private:
+                /// \brief
+                /// Unix domain socket path.
+                std::string path;
+                /// \brief
+                /// Listening socket.
+                int listener;
+                /// \brief
+                /// Self pipe used by Stop to wake up Run.
+                int stopPipe[2];
+                /// \brief
+                /// Watches the directories of all loaded configs.
+                FileWatcher watcher;
+
+            public:
+                /// \brief
+                /// ctor. Create the socket and start listening on it.
+                /// \param[in] path_ Unix domain socket path.
+                explicit Server (const std::string &path_ = GetDefaultPath ());
+                /// \brief
+                /// dtor. Close and remove the socket.
+                ~Server ();
+
+                /// \brief
+                /// Return the default socket path ($(TOOLCHAIN_ROOT)/thekogans_make.socket).
+                /// \return Default socket path.
+                static std::string GetDefaultPath ();
+
+                /// \brief
+                /// Process requests until Stop is called.
+                void Run ();
+                /// \brief
+                /// Ask Run to return. Async signal safe.
+                void Stop ();
+
+                /// \brief
+                /// Client side helper. Send a request to a running server and
+                /// copy its response to the given stream.
+                /// \param[in] path Unix domain socket path.
+                /// \param[in] request Request line.
+                /// \param[out] response Where to write the response.
+                /// \return true = the server responded with "ok".
+                static bool SendRequest (
+                    const std::string &path,
+                    const std::string &request,
+                    std::ostream &response);
+
+            private:
+                /// \brief
+                /// Accept a connection and process its request.
+                void ProcessConnection ();
+                /// \brief
+                /// Process a request. Called with stdout and stderr
+                /// redirected to the connection.
+                /// \param[in] request Request line.
+                void ProcessRequest (const std::string &request);
+                /// \brief
+                /// Watch the directories of the given config and all its dependencies.
+                /// \param[in] config Config to watch.
+                /// \param[in, out] visitedProjects Used to visit every project once.
+                void WatchConfig (
+                    const thekogans_make &config,
+                    std::set<std::string> &visitedProjects);
+                /// \brief
+                /// Flush the configs whose thekogans_make.xml changed.
+                void ProcessChanges ();
+
+                /// \brief
+                /// Server is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (Server)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Server_h)
@@ -0,0 +1,184 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Stats_h)
+#define __thekogans_make_core_Stats_h
+
+#include <atomic>
+#include <string>
+#include <map>
+#include <ostream>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Singleton.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct Stats Stats.h thekogans/make/core/Stats.h
+            ///
+            /// \brief
+            /// Stats keeps cheap, always-on counters describing the work
+            /// make_core did during this run (configs parsed, expressions
+            /// evaluated, functions called, files stat-ed and copied, child
+            /// processes spawned...). Query them with Get/GetFunctionCalls, or
+            /// set the THEKOGANS_MAKE_CORE_STATS environment variable to have
+            /// them dumped at exit (to stdout if it's value is 'yes', or to the
+            /// file it names otherwise).
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Stats :
+                    public util::Singleton<Stats, util::SpinLock> {
+                /// \brief
+                /// Counter ids.
+                enum Counter {
+                    /// \brief
+                    /// Configs parsed by thekogans_make::GetConfig.
+                    CONFIGS_PARSED,
+                    /// \brief
+                    /// thekogans_make::GetConfig calls satisfied from the cache.
+                    CONFIG_CACHE_HITS,
+                    /// \brief
+                    /// thekogans_make::Eval calls.
+                    EVAL_CALLS,
+                    /// \brief
+                    /// thekogans_make::Expand calls.
+                    EXPAND_CALLS,
+                    /// \brief
+                    /// Function::Exec calls that resolved to a registered Function.
+                    FUNCTION_CALLS,
+                    /// \brief
+                    /// Function::Exec calls that resolved to a symbol lookup.
+                    SYMBOL_LOOKUPS,
+                    /// \brief
+                    /// thekogans_make::LookupSymbol calls that fell through to getenv.
+                    ENVIRONMENT_LOOKUPS,
+                    /// \brief
+                    /// Of the above, the ones getenv could not resolve either.
+                    ENVIRONMENT_MISSES,
+                    /// \brief
+                    /// File system stat calls (Exists, Directory::Entry).
+                    FILE_STATS,
+                    /// \brief
+                    /// Directories enumerated.
+                    DIRECTORY_SCANS,
+                    /// \brief
+                    /// Files copied by CopyFile.
+                    FILES_COPIED,
+                    /// \brief
+                    /// Bytes copied by CopyFile.
+                    BYTES_COPIED,
+                    /// \brief
+                    /// Manifest files written.
+                    MANIFEST_SAVES,
+                    /// \brief
+                    /// Child processes spawned.
+                    CHILD_PROCESSES,
+                    /// \brief
+                    /// Build systems generated by CreateBuildSystem.
+                    BUILD_SYSTEMS_GENERATED,
+                    /// \brief
+                    /// Build systems CreateBuildSystem skipped because their fingerprints matched.
+                    BUILD_SYSTEMS_SKIPPED,
+                    /// \brief
+                    /// Number of counters.
+                    COUNTER_COUNT
+                };
+
+            private:
+                /// \brief
+                /// Counters.
+                std::atomic<util::ui64> counters[COUNTER_COUNT];
+                /// \brief
+                /// Per function name Function::Exec call counts.
+                std::map<std::string, util::ui64> functionCalls;
+                /// \brief
+                /// Synchronization lock for functionCalls.
+                mutable util::SpinLock spinLock;
+
+            public:
+                /// \brief
+                /// ctor.
+                Stats ();
+
+                /// \brief
+                /// Return the given counter's name.
+                /// \param[in] counter Counter whose name to return.
+                /// \return counter's name.
+                static const char *GetCounterName (Counter counter);
+
+                /// \brief
+                /// Add value to the given counter.
+                /// \param[in] counter Counter to increment.
+                /// \param[in] value Value to add.
+                inline void Increment (
+                        Counter counter,
+                        util::ui64 value = 1) {
+                    counters[counter].fetch_add (value, std::memory_order_relaxed);
+                }
+                /// \brief
+                /// Return the given counter's value.
+                /// \param[in] counter Counter whose value to return.
+                /// \return counter's value.
+                inline util::ui64 Get (Counter counter) const {
+                    return counters[counter].load (std::memory_order_relaxed);
+                }
+
+                /// \brief
+                /// Record a Function::Exec call.
+                /// \param[in] name Function name.
+                void AddFunctionCall (const std::string &name);
+                /// \brief
+                /// Return the per function name call counts.
+                /// \param[out] functionCalls_ Per function name call counts.
+                void GetFunctionCalls (std::map<std::string, util::ui64> &functionCalls_) const;
+
+                /// \brief
+                /// Zero out all counters.
+                void Reset ();
+
+                /// \brief
+                /// Write a human readable report to the given stream.
+                /// \param[in] stream Stream to write the report to.
+                void Dump (std::ostream &stream) const;
+                /// \brief
+                /// Return the counters as a JSON object.
+                /// \return Counters as a JSON object.
+                std::string ToJSON () const;
+
+                /// \brief
+                /// Stats is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (Stats)
+            };
+
+            /// \def THEKOGANS_MAKE_CORE_STATS_INCREMENT(counter)
+            /// Increment the given Stats counter by one.
+            #define THEKOGANS_MAKE_CORE_STATS_INCREMENT(counter)\
+                thekogans::make::core::Stats::Instance ().Increment (\
+                    thekogans::make::core::Stats::counter)
+            /// \def THEKOGANS_MAKE_CORE_STATS_ADD(counter, value)
+            /// Add value to the given Stats counter.
+            #define THEKOGANS_MAKE_CORE_STATS_ADD(counter, value)\
+                thekogans::make::core::Stats::Instance ().Increment (\
+                    thekogans::make::core::Stats::counter, value)
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Stats_h)
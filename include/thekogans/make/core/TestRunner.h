@@ -0,0 +1,163 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_TestRunner_h)
+#define __thekogans_make_core_TestRunner_h
+
+#include <string>
+#include <vector>
+#include <set>
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/Utils.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            #define TEST_RESULTS_XML "TestResults.xml"
+
+            /// \struct TestRunner TestRunner.h thekogans/make/core/TestRunner.h
+            ///
+            /// \brief
+            /// TestRunner finds the test programs built from the *_tests file lists
+            /// of every project in a graph (the executables in each project's
+            /// $(build_root)/$(TESTS_DIR)) and runs them concurrently. Only regular
+            /// files that are programs count (on POSIX: an exec bit, an ELF or
+            /// Mach-O header and not a shared library; on Windows: .exe), so
+            /// helper scripts, shared objects and fixture data are left alone. Tests are
+            /// Scheduler jobs whose estimates come from BuildHistory, so the
+            /// longest tests start first and the pool drains evenly. Every test's
+            /// output is captured (next to it, in <test>.log) and the results can
+            /// be written as a JUnit report.
+            ///
+            /// NOTE: There is no per test timeout. A test that hangs blocks
+            /// its worker (and Run) forever.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL TestRunner {
+                /// \struct TestRunner::Test TestRunner.h thekogans/make/core/TestRunner.h
+                ///
+                /// \brief
+                /// A test program and the result of running it.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Test {
+                    /// \brief
+                    /// $(organization)_$(project) of the project the test belongs to.
+                    std::string project;
+                    /// \brief
+                    /// Project root.
+                    std::string project_root;
+                    /// \brief
+                    /// Test program path.
+                    std::string path;
+                    /// \brief
+                    /// Estimated duration (in seconds).
+                    util::f64 estimate;
+                    /// \brief
+                    /// true = the test ran.
+                    bool ran;
+                    /// \brief
+                    /// true = the test ran and returned 0.
+                    bool passed;
+                    /// \brief
+                    /// Test exit code (-1 if it did not exit normally).
+                    int returnCode;
+                    /// \brief
+                    /// Actual duration (in seconds).
+                    util::f64 duration;
+
+                    /// \brief
+                    /// ctor.
+                    Test () :
+                        estimate (0.0),
+                        ran (false),
+                        passed (false),
+                        returnCode (-1),
+                        duration (0.0) {}
+
+                    /// \brief
+                    /// Return the path of the captured test output.
+                    /// \return <path>.log.
+                    inline std::string GetOutputPath () const {
+                        return path + ".log";
+                    }
+                };
+
+            private:
+                /// \brief
+                /// Debug | Release.
+                std::string config;
+                /// \brief
+                /// Static | Shared.
+                std::string type;
+                /// \brief
+                /// Root project build root.
+                std::string build_root;
+                /// \brief
+                /// Discovered tests.
+                std::vector<Test> tests;
+
+            public:
+                /// \brief
+                /// ctor. Discover the tests of the given project and its dependencies.
+                /// \param[in] project_root Root project.
+                /// \param[in] config_ Debug | Release.
+                /// \param[in] type_ Static | Shared (tests are built Static).
+                /// \param[in] projects If not empty, only the tests of these
+                /// projects (roots) are run (see ProjectGraph::GetImpactedProjects).
+                TestRunner (
+                    const std::string &project_root,
+                    const std::string &config_,
+                    const std::string &type_ = TYPE_STATIC,
+                    const std::set<std::string> &projects = std::set<std::string> ());
+
+                /// \brief
+                /// Return the discovered tests.
+                /// \return The discovered tests.
+                inline const std::vector<Test> &GetTests () const {
+                    return tests;
+                }
+
+                /// \brief
+                /// Run all tests. A failing test does not stop the others.
+                /// \param[in] concurrency Max number of concurrently running
+                /// tests (0 = std::thread::hardware_concurrency).
+                /// \return Number of tests that failed.
+                util::ui32 Run (util::ui32 concurrency = 0);
+
+                /// \brief
+                /// Return $(build_root)/TestResults.xml of the root project.
+                /// \return Default JUnit report path.
+                inline std::string GetDefaultJUnitPath () const {
+                    return MakePath (build_root, TEST_RESULTS_XML);
+                }
+
+                /// \brief
+                /// Write the results of the last Run as a JUnit report
+                /// (a testsuite per project, a testcase per test).
+                /// \param[in] path Report path.
+                void WriteJUnit (const std::string &path) const;
+
+                /// \brief
+                /// TestRunner is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (TestRunner)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_TestRunner_h)
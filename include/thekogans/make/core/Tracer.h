@@ -0,0 +1,254 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Tracer_h)
+#define __thekogans_make_core_Tracer_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include "thekogans/util/Types.h"
+#include "thekogans/util/Singleton.h"
+#include "thekogans/util/SpinLock.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct Tracer Tracer.h thekogans/make/core/Tracer.h
+            ///
+            /// \brief
+            /// Tracer collects timed spans from the make_core pipeline (config
+            /// parsing, expression evaluation, project/toolchain discovery,
+            /// downloads, gnu make invocations, file copies) and writes them
+            /// out in Chrome trace-event JSON format. Load the resulting file
+            /// in chrome://tracing or https://ui.perfetto.dev.
+            /// Tracing is off by default. To turn it on, either set the
+            /// THEKOGANS_MAKE_CORE_TRACE environment variable to the path of
+            /// the trace file, or call Tracer::Instance ().Enable (path). When
+            /// disabled, a span costs a single flag test.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Tracer :
+                    public util::Singleton<Tracer, util::SpinLock> {
+                enum {
+                    /// \brief
+                    /// Default threshold (in microseconds) for spans created with
+                    /// THEKOGANS_MAKE_CORE_TRACE_THRESHOLD_SCOPE. Can be overridden
+                    /// with the THEKOGANS_MAKE_CORE_TRACE_THRESHOLD environment variable.
+                    DEFAULT_THRESHOLD = 100
+                };
+
+                /// \struct Tracer::Scope Tracer.h thekogans/make/core/Tracer.h
+                ///
+                /// \brief
+                /// Scope records a complete ('X') event spanning it's lifetime.
+                /// Use the THEKOGANS_MAKE_CORE_TRACE_SCOPE* macros instead of
+                /// creating it directly.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Scope {
+                private:
+                    /// \brief
+                    /// Event category.
+                    const char *category;
+                    /// \brief
+                    /// Event name.
+                    const char *name;
+                    /// \brief
+                    /// true == tracing was enabled when the scope was entered.
+                    bool active;
+                    /// \brief
+                    /// true == only record the event if it lasted longer than
+                    /// the tracer threshold.
+                    bool threshold;
+                    /// \brief
+                    /// Scope start time (microseconds since tracer epoch).
+                    util::ui64 start;
+                    /// \brief
+                    /// Extra event arguments (already JSON encoded).
+                    std::string args;
+
+                public:
+                    /// \brief
+                    /// ctor.
+                    /// \param[in] category_ Event category.
+                    /// \param[in] name_ Event name.
+                    /// \param[in] threshold_ true == drop the event if it
+                    /// finished faster than the tracer threshold.
+                    Scope (
+                            const char *category_,
+                            const char *name_,
+                            bool threshold_ = false) :
+                            category (category_),
+                            name (name_),
+                            active (Tracer::enabled),
+                            threshold (threshold_),
+                            start (active ? Tracer::Now () : 0) {}
+                    /// \brief
+                    /// dtor. Record the event.
+                    ~Scope () {
+                        if (active) {
+                            End ();
+                        }
+                    }
+
+                    /// \brief
+                    /// Return true if the scope is being recorded.
+                    /// \return true == the scope is being recorded.
+                    inline bool IsActive () const {
+                        return active;
+                    }
+
+                    /// \brief
+                    /// Add a key/value argument to the event.
+                    /// \param[in] key Argument name.
+                    /// \param[in] value Argument value.
+                    void AddArg (
+                        const char *key,
+                        const std::string &value);
+
+                private:
+                    /// \brief
+                    /// Hand the finished event to the tracer.
+                    void End ();
+
+                    /// \brief
+                    /// Scope is neither copy constructable, nor assignable.
+                    THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (Scope)
+                };
+
+            private:
+                /// \struct Tracer::Event Tracer.h thekogans/make/core/Tracer.h
+                ///
+                /// \brief
+                /// A recorded complete event.
+                struct Event {
+                    /// \brief
+                    /// Event category.
+                    const char *category;
+                    /// \brief
+                    /// Event name.
+                    const char *name;
+                    /// \brief
+                    /// Event start (microseconds since tracer epoch).
+                    util::ui64 start;
+                    /// \brief
+                    /// Event duration (microseconds).
+                    util::ui64 duration;
+                    /// \brief
+                    /// Small integer id of the thread that recorded the event.
+                    util::ui32 threadId;
+                    /// \brief
+                    /// Extra event arguments (already JSON encoded).
+                    std::string args;
+                };
+                /// \brief
+                /// Set to true when tracing is enabled. Checked by
+                /// Scope without taking the lock.
+                static volatile bool enabled;
+                /// \brief
+                /// Path to the trace file.
+                std::string path;
+                /// \brief
+                /// Minimum duration (microseconds) of threshold spans.
+                util::ui64 thresholdDuration;
+                /// \brief
+                /// Recorded events.
+                std::vector<Event> events;
+                /// \brief
+                /// Maps std::thread::id to small integers for the tid field.
+                std::map<std::thread::id, util::ui32> threadIds;
+                /// \brief
+                /// Synchronization lock.
+                util::SpinLock spinLock;
+
+            public:
+                /// \brief
+                /// ctor.
+                Tracer ();
+
+                /// \brief
+                /// Return true if tracing is enabled.
+                /// \return true == tracing is enabled.
+                static inline bool IsEnabled () {
+                    return enabled;
+                }
+                /// \brief
+                /// Return the number of microseconds elapsed since the tracer epoch.
+                /// \return Number of microseconds elapsed since the tracer epoch.
+                static util::ui64 Now ();
+
+                /// \brief
+                /// Start recording spans.
+                /// \param[in] path_ Path to the trace file.
+                /// \param[in] thresholdDuration_ Minimum duration (microseconds)
+                /// of threshold spans (Eval, Expand...).
+                void Enable (
+                    const std::string &path_,
+                    util::ui64 thresholdDuration_ = DEFAULT_THRESHOLD);
+                /// \brief
+                /// Stop recording spans. Recorded events are kept until Flush.
+                void Disable ();
+
+                /// \brief
+                /// Write all recorded events to the trace file.
+                /// NOTE: If tracing was enabled through the environment (or
+                /// Enable was called), Flush is called at exit.
+                void Flush ();
+
+            private:
+                /// \brief
+                /// Called by Scope::End to record a finished span.
+                /// \param[in] category Event category.
+                /// \param[in] name Event name.
+                /// \param[in] start Event start.
+                /// \param[in] threshold true == drop short events.
+                /// \param[in] args Extra event arguments.
+                void AddEvent (
+                    const char *category,
+                    const char *name,
+                    util::ui64 start,
+                    bool threshold,
+                    const std::string &args);
+
+                /// \brief
+                /// Tracer is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (Tracer)
+            };
+
+            /// \def THEKOGANS_MAKE_CORE_TRACE_SCOPE(category, name)
+            /// Record a span covering the rest of the enclosing scope.
+            #define THEKOGANS_MAKE_CORE_TRACE_SCOPE(category, name)\
+                thekogans::make::core::Tracer::Scope traceScope (category, name)
+            /// \def THEKOGANS_MAKE_CORE_TRACE_THRESHOLD_SCOPE(category, name)
+            /// Record a span covering the rest of the enclosing scope,
+            /// but only if it lasts longer than the tracer threshold.
+            #define THEKOGANS_MAKE_CORE_TRACE_THRESHOLD_SCOPE(category, name)\
+                thekogans::make::core::Tracer::Scope traceScope (category, name, true)
+            /// \def THEKOGANS_MAKE_CORE_TRACE_ARG(key, value)
+            /// Attach an argument to the span created by one of the above.
+            /// value is only evaluated if tracing is enabled.
+            #define THEKOGANS_MAKE_CORE_TRACE_ARG(key, value)\
+                if (!traceScope.IsActive ()) {\
+                }\
+                else traceScope.AddArg (key, value)
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Tracer_h)
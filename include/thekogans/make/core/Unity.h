@@ -0,0 +1,85 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Unity_h)
+#define __thekogans_make_core_Unity_h
+
+#include <string>
+#include <vector>
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct Unity Unity.h thekogans/make/core/Unity.h
+            ///
+            /// \brief
+            /// Unity batches the sources of a FileList with unity = "yes" into
+            /// unity (jumbo) translation units that #include them, so that shared
+            /// headers are parsed once per batch instead of once per file. Batch
+            /// boundaries are picked by hashing file names (content defined
+            /// chunking) rather than by position, so adding or removing a file
+            /// usually only changes the batch it lands in. Removing a file that
+            /// ends a batch merges it with the next one, and a batch cut at its
+            /// max size (2 * batchSize) can shift the cuts that follow it until
+            /// a name hash cut resyncs them. Every other batch (and its object
+            /// file) is left alone. Batch files are only rewritten when their
+            /// contents change.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Unity {
+                /// \struct Unity::Batch Unity.h thekogans/make/core/Unity.h
+                ///
+                /// \brief
+                /// A unity translation unit.
+                struct _LIB_THEKOGANS_MAKE_CORE_DECL Batch {
+                    /// \brief
+                    /// Unity translation unit path (relative to directory).
+                    std::string name;
+                    /// \brief
+                    /// Full paths of the sources it includes.
+                    std::vector<std::string> files;
+                };
+
+                /// \brief
+                /// Split the given sources into batches.
+                /// \param[in] files Full paths of the sources to batch.
+                /// \param[in] batchSize Average number of files per batch
+                /// (no batch has more than twice that).
+                /// \param[in] extension Unity translation unit extension (.c, .cpp...).
+                /// \param[out] batches Batches (in file order).
+                static void GetBatches (
+                    const std::vector<std::string> &files,
+                    util::ui32 batchSize,
+                    const std::string &extension,
+                    std::vector<Batch> &batches);
+                /// \brief
+                /// Write the given batch (if its contents changed).
+                /// \param[in] directory Where to write it.
+                /// \param[in] batch Batch to write.
+                /// \return true = The batch was written.
+                static bool WriteBatch (
+                    const std::string &directory,
+                    const Batch &batch);
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Unity_h)
@@ -73,6 +73,12 @@ namespace thekogans {
 
             #define MAKE "make"
             #define MAKEFILE "Makefile"
+            // Full output of the last make run (in $(build_root)) when
+            // BuildProject streams prefixed output.
+            #define BUILD_LOG "build.log"
+
+            #define UNITY_DIR "unity"
+            #define DEFAULT_UNITY_BATCH_SIZE 16
 
             #define PATH_SEPARATOR "/"
             #define PATH_SEPARATOR_CHAR '/'
@@ -203,6 +209,8 @@ namespace thekogans {
 
             _LIB_THEKOGANS_MAKE_CORE_DECL std::string _LIB_THEKOGANS_MAKE_CORE_API GetFileHash (
                 const std::string &path);
+            _LIB_THEKOGANS_MAKE_CORE_DECL std::string _LIB_THEKOGANS_MAKE_CORE_API EncodeJSONString (
+                const std::string &value);
             _LIB_THEKOGANS_MAKE_CORE_DECL bool _LIB_THEKOGANS_MAKE_CORE_API CopyFile (
                 const std::string &from,
                 const std::string &to);
@@ -248,7 +256,8 @@ namespace thekogans {
                 const std::string &config,
                 const std::string &type,
                 bool generateDependencies,
-                bool force);
+                bool force,
+                util::ui32 concurrency = 0);
             _LIB_THEKOGANS_MAKE_CORE_DECL void _LIB_THEKOGANS_MAKE_CORE_API DeleteBuildSystem (
                 const std::string &project_root,
                 const std::string &generator,
@@ -262,7 +271,27 @@ namespace thekogans {
                 const std::string &mode,
                 bool hide_commands,
                 bool parallel_build,
-                const std::string &target);
+                const std::string &target,
+                util::ui32 concurrency = 1,
+                const std::set<std::string> &projects = std::set<std::string> ());
+            _LIB_THEKOGANS_MAKE_CORE_DECL void _LIB_THEKOGANS_MAKE_CORE_API BuildAffectedProjects (
+                const std::string &project_root,
+                const std::string &config,
+                const std::string &type,
+                const std::string &mode,
+                bool hide_commands,
+                bool parallel_build,
+                const std::string &target,
+                util::ui32 concurrency,
+                const std::set<std::string> &changedPaths);
+            // Build project_root and its dependencies with the native
+            // Executor (see Executor.h) instead of gnu make. Returns the
+            // number of actions that ran.
+            _LIB_THEKOGANS_MAKE_CORE_DECL util::ui32 _LIB_THEKOGANS_MAKE_CORE_API BuildProjectNative (
+                const std::string &project_root,
+                const std::string &config,
+                const std::string &type,
+                util::ui32 concurrency = 0);
 
             inline bool IsEscapableCh (char ch) {
                 return
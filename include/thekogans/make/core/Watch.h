@@ -0,0 +1,134 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (__thekogans_make_core_Watch_h)
+#define __thekogans_make_core_Watch_h
+
+#include <string>
+#include <set>
+#include "thekogans/util/Types.h"
+#include "thekogans/make/core/Config.h"
+#include "thekogans/make/core/FileWatcher.h"
+#include "thekogans/make/core/ProjectGraph.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            /// \struct Watch Watch.h thekogans/make/core/Watch.h
+            ///
+            /// \brief
+            /// Watch (Linux only) implements watch mode. It watches every source,
+            /// header, test, resource and config file of a project and all its
+            /// project dependencies. Bursts of changes are debounced, each changed
+            /// file is mapped to the project that owns it, and only the owners and
+            /// the projects that depend on them are rebuilt (in dependency order,
+            /// using BuildProject). A changed thekogans_make.xml flushes the cached
+            /// configs and rescans the graph.
+
+            struct _LIB_THEKOGANS_MAKE_CORE_DECL Watch {
+                enum {
+                    /// \brief
+                    /// Default quiet period (in milliseconds) that ends a burst of changes.
+                    DEFAULT_DEBOUNCE = 250
+                };
+
+            private:
+                /// \brief
+                /// Root project.
+                std::string project_root;
+                /// \brief
+                /// Debug | Release.
+                std::string config;
+                /// \brief
+                /// Static | Shared.
+                std::string type;
+                /// \brief
+                /// Build target.
+                std::string target;
+                /// \brief
+                /// Max number of projects to build concurrently.
+                util::ui32 concurrency;
+                /// \brief
+                /// Quiet period (in milliseconds) that ends a burst of changes.
+                util::ui32 debounce;
+                /// \brief
+                /// Watches the directories of all files.
+                FileWatcher watcher;
+                /// \brief
+                /// Project graph (file owners and dependents).
+                ProjectGraph::Ptr graph;
+                /// \brief
+                /// Self pipe used by Stop to wake up Run.
+                int stopPipe[2];
+
+            public:
+                /// \brief
+                /// ctor.
+                /// \param[in] project_root_ Root project.
+                /// \param[in] config_ Debug | Release.
+                /// \param[in] type_ Static | Shared.
+                /// \param[in] target_ Build target.
+                /// \param[in] concurrency_ Max number of projects to build concurrently.
+                /// \param[in] debounce_ Quiet period (in milliseconds) that ends a burst of changes.
+                Watch (
+                    const std::string &project_root_,
+                    const std::string &config_,
+                    const std::string &type_,
+                    const std::string &target_ = TARGET_ALL,
+                    util::ui32 concurrency_ = 1,
+                    util::ui32 debounce_ = DEFAULT_DEBOUNCE);
+                /// \brief
+                /// dtor.
+                ~Watch ();
+
+                /// \brief
+                /// Build the root project, then rebuild changed projects
+                /// until Stop is called. Build errors are reported and
+                /// watching continues.
+                void Run ();
+                /// \brief
+                /// Ask Run to return. Async signal safe.
+                void Stop ();
+
+            private:
+                /// \brief
+                /// (Re)load the project graph and register watches for its files.
+                void Scan ();
+                /// \brief
+                /// Wait for changes (or Stop).
+                /// \param[in] timeout Max time to wait (in milliseconds). -1 = wait forever.
+                /// \param[out] stop true = Stop was called.
+                /// \return true = changes are pending.
+                bool Wait (
+                    util::i32 timeout,
+                    bool &stop);
+                /// \brief
+                /// Build the given projects.
+                /// \param[in] projects Project roots to build (empty = all).
+                void Build (const std::set<std::string> &projects);
+
+                /// \brief
+                /// Watch is neither copy constructable, nor assignable.
+                THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (Watch)
+            };
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
+
+#endif // !defined (__thekogans_make_core_Watch_h)
@@ -69,6 +69,9 @@ namespace thekogans {
                 static const char * const ATTR_CONFIG;
                 static const char * const ATTR_TYPE;
                 static const char * const ATTR_FLAGS;
+                static const char * const ATTR_UNITY;
+                static const char * const ATTR_UNITY_BATCH_SIZE;
+                static const char * const ATTR_AUTO;
 
                 static const char * const TAG_THEKOGANS_MAKE;
                 static const char * const TAG_CONSTANTS;
@@ -271,6 +274,10 @@ namespace thekogans {
                     } type;
                     std::string file;
                     std::string outputFile;
+                    // true = Generate file from the sources' most
+                    // frequently included, most expensive headers
+                    // (see PrecompiledHeaderAdvisor.h).
+                    bool automatic;
 
                     static const char * const TYPE_NONE;
                     static const char * const TYPE_USE;
@@ -280,7 +287,8 @@ namespace thekogans {
                     static Type stringToType (const std::string &type);
 
                     PrecompiledHeader () :
-                        type (None) {}
+                        type (None),
+                        automatic (false) {}
                 } precompiled_header;
                 struct _LIB_THEKOGANS_MAKE_CORE_DECL FileList {
                     typedef std::unique_ptr<FileList> Ptr;
@@ -290,6 +298,13 @@ namespace thekogans {
                     std::string prefix;
                     bool install;
                     std::string destinationPrefix;
+                    // Compile the sources as batched unity translation
+                    // units (see Unity.h). Files can opt out. Only
+                    // honored by BuildGraph consumers (the native
+                    // Executor and generators that use BuildGraph).
+                    // The make generator compiles every file on its own.
+                    bool unity;
+                    util::ui32 unityBatchSize;
                     struct _LIB_THEKOGANS_MAKE_CORE_DECL File {
                         typedef std::unique_ptr<File> Ptr;
 
@@ -317,13 +332,17 @@ namespace thekogans {
                         };
                         CustomBuild::Ptr customBuild;
                         PrecompiledHeader precompiled_header;
+                        // false = Never put this file in a unity batch.
+                        bool unity;
 
-                        File () {}
+                        File () :
+                            unity (true) {}
                         File (
                             const std::string &name_,
                             bool createCustomBuild = false) :
                             name (name_),
-                            customBuild (createCustomBuild ? new CustomBuild : 0) {}
+                            customBuild (createCustomBuild ? new CustomBuild : 0),
+                            unity (true) {}
 
                         THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (File)
                     };
@@ -331,7 +350,9 @@ namespace thekogans {
 
                     explicit FileList (const std::string &destinationPrefix_) :
                         install (false),
-                        destinationPrefix (destinationPrefix_) {}
+                        destinationPrefix (destinationPrefix_),
+                        unity (false),
+                        unityBatchSize (DEFAULT_UNITY_BATCH_SIZE) {}
 
                     THEKOGANS_MAKE_CORE_DISALLOW_COPY_AND_ASSIGN (FileList)
                 };
@@ -447,12 +468,25 @@ namespace thekogans {
                     const std::string &project_root,
                     const std::string &config_file);
 
+                // Thread safe. Configs are parsed (and cached) under a
+                // lock, so concurrent generators can ask for any config.
                 static const thekogans_make &GetConfig (
                     const std::string &project_root,
                     const std::string &config_file,
                     const std::string &generator,
                     const std::string &config,
                     const std::string &type);
+                // Drop all cached configs. Any references returned
+                // by GetConfig are invalid after this call.
+                static void FlushConfigs ();
+                // Drop all cached configs of project_root and of every
+                // project that (transitively) depends on it. The roots
+                // of all flushed projects are returned in flushedRoots.
+                // Any references returned by GetConfig for those projects
+                // are invalid after this call.
+                static void FlushConfig (
+                    const std::string &project_root,
+                    std::set<std::string> &flushedRoots);
 
                 void CheckDependencies () const;
                 void ListDependencies (util::ui32 indentationLevel) const;
@@ -463,6 +497,16 @@ namespace thekogans {
                 void GetIncludeDirectories (std::set<std::string> &include_directories_) const;
                 void GetLinkLibraries (std::list<std::string> &link_libraries_) const;
                 void GetSharedLibraries (std::set<std::string> &shared_libraries) const;
+                // Full paths of all header, source, test and resource
+                // files of this project (not its dependencies). If
+                // prefixes is not null, it receives the full paths
+                // of all the file list prefixes.
+                void GetFiles (
+                    std::set<std::string> &files,
+                    std::set<std::string> *prefixes = 0) const;
+                // Full paths of the files in the *_tests file lists
+                // of this project (a subset of GetFiles).
+                void GetTestFiles (std::set<std::string> &files) const;
 
                 inline bool HasGoal () const {
                     return
@@ -0,0 +1,299 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/File.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/Directory.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/XMLUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Baseline.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const TAG_BASELINE = "baseline";
+                const char * const ATTR_SCHEMA_VERSION = "schema_version";
+                const char * const ATTR_NAME = "name";
+                const char * const ATTR_SUITE = "suite";
+
+                const char * const TAG_PARAMETER = "parameter";
+                const char * const ATTR_VALUE = "value";
+
+                const char * const TAG_RESULT = "result";
+                const char * const ATTR_UNIT = "unit";
+                const char * const ATTR_ITERATIONS = "iterations";
+
+                const util::ui32 BASELINE_XML_SCHEMA_VERSION = 1;
+
+                // Scale factor making the MAD a consistent
+                // estimator of the standard deviation.
+                const util::f64 MAD_SCALE = 1.4826;
+            }
+
+            Baseline::Baseline (
+                    const std::string &path_,
+                    util::ui64 maxBaselineFileSize) :
+                    path (path_) {
+                if (util::Path (path).Exists ()) {
+                    util::ReadOnlyFile file (util::HostEndian, path);
+                    // Protect yourself.
+                    util::ui64 fileSize = file.GetSize ();
+                    if (fileSize > maxBaselineFileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "'%s' is bigger (" THEKOGANS_UTIL_UI64_FORMAT ") than expected. (" THEKOGANS_UTIL_UI64_FORMAT ")",
+                            path.c_str (),
+                            fileSize,
+                            maxBaselineFileSize);
+                    }
+                    util::Buffer buffer (util::HostEndian, (util::ui32)fileSize);
+                    if (buffer.AdvanceWriteOffset (
+                            file.Read (
+                                buffer.GetWritePtr (),
+                                (util::ui32)fileSize)) != (util::ui32)fileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to read " THEKOGANS_UTIL_UI64_FORMAT " bytes from '%s'.",
+                            fileSize,
+                            path.c_str ());
+                    }
+                    pugi::xml_document document;
+                    pugi::xml_parse_result result =
+                        document.load_buffer (
+                            buffer.GetReadPtr (),
+                            buffer.GetDataAvailableForReading ());
+                    if (!result) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to parse %s (%s)",
+                            path.c_str (),
+                            result.description ());
+                    }
+                    pugi::xml_node node = document.document_element ();
+                    if (std::string (node.name ()) == TAG_BASELINE) {
+                        ParseBaseline (node);
+                    }
+                }
+            }
+
+            std::string Baseline::GetPath (
+                    const std::string &directory,
+                    const std::string &name) {
+                return MakePath (directory, name + EXT_SEPARATOR + XML_EXT);
+            }
+
+            void Baseline::Save () const {
+                util::Directory::Create (util::Path (path).GetDirectory ());
+                std::fstream baselineFile (
+                    path.c_str (),
+                    std::fstream::out | std::fstream::trunc);
+                if (baselineFile.is_open ()) {
+                    util::Attributes attributes;
+                    attributes.push_back (
+                        util::Attribute (
+                            ATTR_SCHEMA_VERSION,
+                            util::ui32Tostring (BASELINE_XML_SCHEMA_VERSION)));
+                    attributes.push_back (
+                        util::Attribute (
+                            ATTR_NAME,
+                            util::EncodeXMLCharEntities (name)));
+                    attributes.push_back (
+                        util::Attribute (
+                            ATTR_SUITE,
+                            util::EncodeXMLCharEntities (suite)));
+                    baselineFile << util::OpenTag (0, TAG_BASELINE, attributes, false, true);
+                    for (Benchmark::Parameters::const_iterator
+                             it = parameters.begin (),
+                             end = parameters.end (); it != end; ++it) {
+                        util::Attributes attributes;
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_NAME,
+                                util::EncodeXMLCharEntities (it->first)));
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_VALUE,
+                                util::EncodeXMLCharEntities (it->second)));
+                        baselineFile << util::OpenTag (1, TAG_PARAMETER, attributes, true, true);
+                    }
+                    for (Benchmark::Results::const_iterator
+                             it = results.begin (),
+                             end = results.end (); it != end; ++it) {
+                        util::Attributes attributes;
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_NAME,
+                                util::EncodeXMLCharEntities (it->name)));
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_UNIT,
+                                util::EncodeXMLCharEntities (it->unit)));
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_ITERATIONS,
+                                util::ui64Tostring (it->iterations)));
+                        std::ostringstream samples;
+                        samples.precision (15);
+                        for (std::size_t i = 0, count = it->samples.size (); i < count; ++i) {
+                            if (i > 0) {
+                                samples << ' ';
+                            }
+                            samples << it->samples[i];
+                        }
+                        baselineFile <<
+                            util::OpenTag (1, TAG_RESULT, attributes, false, false) <<
+                            samples.str () <<
+                            util::CloseTag (0, TAG_RESULT);
+                    }
+                    baselineFile << util::CloseTag (0, TAG_BASELINE);
+                }
+                else {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to open: %s.",
+                        path.c_str ());
+                }
+            }
+
+            util::ui32 Baseline::Compare (
+                    const Benchmark::Results &current,
+                    util::f64 threshold,
+                    util::f64 noise,
+                    Comparisons &comparisons) const {
+                util::ui32 regressions = 0;
+                for (Benchmark::Results::const_iterator
+                        it = current.begin (),
+                        end = current.end (); it != end; ++it) {
+                    for (Benchmark::Results::const_iterator
+                            jt = results.begin (),
+                            end = results.end (); jt != end; ++jt) {
+                        if (jt->name == it->name) {
+                            if (!jt->samples.empty () && !it->samples.empty ()) {
+                                Comparison comparison;
+                                comparison.name = it->name;
+                                comparison.unit = it->unit;
+                                comparison.baselineMedian = GetMedian (jt->samples);
+                                comparison.baselineMAD = GetMAD (jt->samples);
+                                comparison.currentMedian = GetMedian (it->samples);
+                                comparison.currentMAD = GetMAD (it->samples);
+                                util::f64 delta = comparison.currentMedian - comparison.baselineMedian;
+                                comparison.change = comparison.baselineMedian > 0.0 ?
+                                    delta / comparison.baselineMedian : 0.0;
+                                comparison.regression =
+                                    delta > comparison.baselineMedian * threshold &&
+                                    delta > noise * MAD_SCALE *
+                                        std::max (comparison.baselineMAD, comparison.currentMAD);
+                                if (comparison.regression) {
+                                    ++regressions;
+                                }
+                                comparisons.push_back (comparison);
+                            }
+                            break;
+                        }
+                    }
+                }
+                for (Benchmark::Results::const_iterator
+                        it = results.begin (),
+                        end = results.end (); it != end; ++it) {
+                    if (it->samples.empty ()) {
+                        continue;
+                    }
+                    bool found = false;
+                    for (Benchmark::Results::const_iterator
+                            jt = current.begin (),
+                            end = current.end (); !found && jt != end; ++jt) {
+                        found = jt->name == it->name && !jt->samples.empty ();
+                    }
+                    if (!found) {
+                        Comparison comparison;
+                        comparison.name = it->name;
+                        comparison.unit = it->unit;
+                        comparison.baselineMedian = GetMedian (it->samples);
+                        comparison.baselineMAD = GetMAD (it->samples);
+                        comparison.missing = true;
+                        ++regressions;
+                        comparisons.push_back (comparison);
+                    }
+                }
+                return regressions;
+            }
+
+            util::f64 Baseline::GetMedian (std::vector<util::f64> samples) {
+                if (!samples.empty ()) {
+                    std::size_t middle = samples.size () / 2;
+                    std::nth_element (samples.begin (), samples.begin () + middle, samples.end ());
+                    util::f64 median = samples[middle];
+                    if ((samples.size () & 1) == 0) {
+                        median = (median +
+                            *std::max_element (samples.begin (), samples.begin () + middle)) / 2.0;
+                    }
+                    return median;
+                }
+                return 0.0;
+            }
+
+            util::f64 Baseline::GetMAD (const std::vector<util::f64> &samples) {
+                util::f64 median = GetMedian (samples);
+                std::vector<util::f64> deviations;
+                deviations.reserve (samples.size ());
+                for (std::size_t i = 0, count = samples.size (); i < count; ++i) {
+                    deviations.push_back (fabs (samples[i] - median));
+                }
+                return GetMedian (deviations);
+            }
+
+            void Baseline::ParseBaseline (pugi::xml_node &node) {
+                name = util::Decodestring (node.attribute (ATTR_NAME).value ());
+                suite = util::Decodestring (node.attribute (ATTR_SUITE).value ());
+                for (pugi::xml_node child = node.first_child ();
+                        !child.empty (); child = child.next_sibling ()) {
+                    if (child.type () == pugi::node_element) {
+                        std::string childName = child.name ();
+                        if (childName == TAG_PARAMETER) {
+                            std::string parameterName =
+                                util::Decodestring (child.attribute (ATTR_NAME).value ());
+                            if (!parameterName.empty ()) {
+                                parameters[parameterName] =
+                                    util::Decodestring (child.attribute (ATTR_VALUE).value ());
+                            }
+                        }
+                        else if (childName == TAG_RESULT) {
+                            Benchmark::Result result (
+                                util::Decodestring (child.attribute (ATTR_NAME).value ()),
+                                util::Decodestring (child.attribute (ATTR_UNIT).value ()),
+                                util::stringToui64 (child.attribute (ATTR_ITERATIONS).value ()));
+                            if (!result.name.empty ()) {
+                                std::istringstream samples (child.text ().get ());
+                                util::f64 sample;
+                                while (samples >> sample) {
+                                    result.samples.push_back (sample);
+                                }
+                                results.push_back (result);
+                            }
+                        }
+                    }
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,1036 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/Directory.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/make/core/thekogans_make.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Console.h"
+#include "thekogans/make/core/Version.h"
+#include "thekogans/make/core/Function.h"
+#include "thekogans/make/core/Parser.h"
+#include "thekogans/make/core/Benchmark.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                // Synthetic conditions are written in terms of symbols
+                // only (no functions), so that they evaluate the same
+                // whether or not the host registered any Functions.
+                const char * const CONDITIONS[] = {
+                    "$(TOOLCHAIN_OS) != 'NoSuchOS'",
+                    "$(TOOLCHAIN_OS) != 'NoSuchOS' && $(config) != 'NoSuchConfig'",
+                    "$(type) == 'Shared' || $(type) == 'Static'",
+                    "$(version) >= '1.0.0' && $(TOOLCHAIN_ARCH) != 'NoSuchArch'"
+                };
+                const std::size_t CONDITION_COUNT = sizeof (CONDITIONS) / sizeof (CONDITIONS[0]);
+
+                // Also rejects NaN.
+                inline bool IsProbability (util::f32 value) {
+                    return value >= 0.0f && value <= 1.0f;
+                }
+
+                struct Random {
+                    std::mt19937 engine;
+
+                    explicit Random (util::ui32 seed) :
+                        engine (seed) {}
+
+                    // std::uniform_*_distribution are not guaranteed to
+                    // produce the same sequence across standard libraries.
+                    util::ui32 Next (util::ui32 range) {
+                        return range > 0 ? (util::ui32)(engine () % range) : 0;
+                    }
+                    bool Chance (util::f32 probability) {
+                        return (util::f32)engine () / 4294967296.0f < probability;
+                    }
+                };
+
+                std::string GetProjectName (util::ui32 index) {
+                    return util::FormatString ("p%u", index);
+                }
+
+                // GenerateGraph drops this in the organization root. Neither
+                // GenerateGraph nor DeleteGraph will touch a directory without
+                // it, so a mistyped organization can't clobber a real checkout.
+                const char * const GRAPH_MARKER = ".thekogans_make_core_benchmark";
+
+                // The organization is a single directory under $(DEVELOPMENT_ROOT).
+                bool IsValidOrganization (const std::string &organization) {
+                    return !organization.empty () &&
+                        organization != "." && organization != ".." &&
+                        organization.find_first_of ("/\\") == std::string::npos;
+                }
+
+                std::string GetOrganizationRoot (const std::string &organization) {
+                    return MakePath (_DEVELOPMENT_ROOT, organization);
+                }
+
+                // Return true if the organization root does not exist. Throw
+                // if it exists but was not created by GenerateGraph.
+                bool CheckOrganizationRoot (const std::string &organizationRoot) {
+                    if (!util::Path (ToSystemPath (organizationRoot)).Exists ()) {
+                        return true;
+                    }
+                    if (!util::Path (ToSystemPath (MakePath (organizationRoot, GRAPH_MARKER))).Exists ()) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "%s exists and was not created by Benchmark::GenerateGraph (no %s).",
+                            organizationRoot.c_str (),
+                            GRAPH_MARKER);
+                    }
+                    return false;
+                }
+
+                void WriteFile (
+                        const std::string &path,
+                        const std::string &contents) {
+                    util::Directory::Create (util::Path (ToSystemPath (path)).GetDirectory ());
+                    std::fstream file (
+                        ToSystemPath (path).c_str (),
+                        std::fstream::out | std::fstream::trunc);
+                    if (file.is_open ()) {
+                        file << contents;
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to open: %s.",
+                            path.c_str ());
+                    }
+                }
+
+                std::string GetCondition (Random &random) {
+                    return util::EncodeXMLCharEntities (CONDITIONS[random.Next (CONDITION_COUNT)]);
+                }
+
+                std::string GetConfigFile (
+                        const Benchmark::GraphParameters &graphParameters,
+                        util::ui32 index,
+                        const std::vector<util::ui32> &dependencies,
+                        bool regex,
+                        Random &random) {
+                    std::string name = GetProjectName (index);
+                    std::ostringstream stream;
+                    stream <<
+                        "<thekogans_make organization = \"" << graphParameters.organization << "\"\n"
+                        "                project = \"" << name << "\"\n"
+                        "                project_type = \"" <<
+                            (index == 0 ? PROJECT_TYPE_PROGRAM : PROJECT_TYPE_LIBRARY) << "\"\n"
+                        "                major_version = \"1\"\n"
+                        "                minor_version = \"0\"\n"
+                        "                patch_version = \"0\"\n"
+                        "                schema_version = \"" << THEKOGANS_MAKE_XML_SCHEMA_VERSION << "\">\n";
+                    stream <<
+                        "  <features>\n"
+                        "    <feature>BENCHMARK_" << name << "</feature>\n";
+                    if (random.Chance (graphParameters.conditionalDensity)) {
+                        stream <<
+                            "    <if condition = \"" << GetCondition (random) << "\">\n"
+                            "      <feature>BENCHMARK_" << name << "_EXTRA</feature>\n"
+                            "    </if>\n";
+                    }
+                    stream << "  </features>\n";
+                    if (!dependencies.empty ()) {
+                        stream << "  <dependencies>\n";
+                        for (std::size_t i = 0, count = dependencies.size (); i < count; ++i) {
+                            std::string dependency =
+                                "<dependency organization = \"" + graphParameters.organization +
+                                "\"\n                name = \"" + GetProjectName (dependencies[i]) + "\"/>\n";
+                            if (random.Chance (graphParameters.conditionalDensity)) {
+                                stream <<
+                                    "    <if condition = \"" << GetCondition (random) << "\">\n"
+                                    "      " << dependency <<
+                                    "    </if>\n";
+                            }
+                            else {
+                                stream << "    " << dependency;
+                            }
+                        }
+                        stream << "  </dependencies>\n";
+                    }
+                    stream <<
+                        "  <cpp_preprocessor_definitions>\n"
+                        "    <cpp_preprocessor_definition>BENCHMARK_$(organization)_$(project)_VERSION=$(version)</cpp_preprocessor_definition>\n";
+                    if (random.Chance (graphParameters.conditionalDensity)) {
+                        stream <<
+                            "    <choose>\n"
+                            "      <when condition = \"$(config) == '" CONFIG_DEBUG "'\">\n"
+                            "        <cpp_preprocessor_definition>BENCHMARK_" << name << "_DEBUG</cpp_preprocessor_definition>\n"
+                            "      </when>\n"
+                            "      <otherwise>\n"
+                            "        <cpp_preprocessor_definition>BENCHMARK_" << name << "_RELEASE</cpp_preprocessor_definition>\n"
+                            "      </otherwise>\n"
+                            "    </choose>\n";
+                    }
+                    stream << "  </cpp_preprocessor_definitions>\n";
+                    if (index != 0) {
+                        stream <<
+                            "  <cpp_headers prefix = \"" << INCLUDE_DIR << "\"\n"
+                            "               install = \"yes\">\n";
+                        for (util::ui32 i = 0; i < graphParameters.sourceCount; ++i) {
+                            stream << "    <cpp_header>$(organization)/$(project_directory)/h" << i << ".h</cpp_header>\n";
+                        }
+                        stream << "  </cpp_headers>\n";
+                    }
+                    stream << "  <cpp_sources prefix = \"" << SRC_DIR << "\">\n";
+                    if (regex) {
+                        stream << "    <regex>.*\\.cpp</regex>\n";
+                    }
+                    else {
+                        for (util::ui32 i = 0; i < graphParameters.sourceCount; ++i) {
+                            stream << "    <cpp_source>s" << i << ".cpp</cpp_source>\n";
+                        }
+                    }
+                    stream <<
+                        "  </cpp_sources>\n"
+                        "</thekogans_make>\n";
+                    return stream.str ();
+                }
+
+                // Benchmarked calls (CheckDependencies, CopyFile...) print
+                // progress. Keep it out of the measurements (and the
+                // benchmark output) by raising the Console level.
+                struct ConsoleSilencer {
+                    Console::Level level;
+
+                    ConsoleSilencer () :
+                            level (Console::Instance ().GetLevel ()) {
+                        Console::Instance ().Flush ();
+                        Console::Instance ().SetLevel (Console::Error);
+                    }
+                    ~ConsoleSilencer () {
+                        Console::Instance ().Flush ();
+                        Console::Instance ().SetLevel (level);
+                    }
+                };
+
+                typedef std::chrono::steady_clock Clock;
+
+                util::f64 GetElapsed (
+                        const Clock::time_point &start,
+                        const Clock::time_point &end,
+                        util::ui64 iterations,
+                        const std::string &unit) {
+                    util::f64 nanoseconds =
+                        (util::f64)std::chrono::duration_cast<std::chrono::nanoseconds> (
+                            end - start).count ();
+                    return (unit == "us" ? nanoseconds / 1000.0 : nanoseconds) /
+                        (util::f64)(iterations > 0 ? iterations : 1);
+                }
+
+                Benchmark::Result &AddResult (
+                        Benchmark::Results &results,
+                        const std::string &name,
+                        const std::string &unit,
+                        util::ui64 iterations) {
+                    for (Benchmark::Results::iterator
+                            it = results.begin (),
+                            end = results.end (); it != end; ++it) {
+                        if (it->name == name) {
+                            return *it;
+                        }
+                    }
+                    results.push_back (Benchmark::Result (name, unit, iterations));
+                    return results.back ();
+                }
+
+                void CollectConfigs (
+                        const thekogans_make &config,
+                        std::set<std::string> &visited,
+                        std::list<const thekogans_make *> &configs) {
+                    if (visited.insert (config.project_root).second) {
+                        configs.push_back (&config);
+                        for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
+                                it = config.dependencies.begin (),
+                                end = config.dependencies.end (); it != end; ++it) {
+                            if ((*it)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                                CollectConfigs (
+                                    thekogans_make::GetConfig (
+                                        (*it)->GetProjectRoot (),
+                                        (*it)->GetConfigFile (),
+                                        (*it)->GetGenerator (),
+                                        (*it)->GetConfig (),
+                                        (*it)->GetType ()),
+                                    visited,
+                                    configs);
+                            }
+                        }
+                    }
+                }
+
+                const util::ui64 WARM_ITERATIONS = 1000;
+                const util::ui64 EXPRESSION_ITERATIONS = 10000;
+
+                // Conditions and format strings lifted from real
+                // thekogans_make.xml files. have_feature is provided
+                // by the driver, not make_core.
+                const struct {
+                    Benchmark::Expression::Type type;
+                    const char *name;
+                    const char *text;
+                } EXPRESSION_CORPUS[] = {
+                    {Benchmark::Expression::TYPE_Condition, "os",
+                        "$(TOOLCHAIN_OS) == 'Windows'"},
+                    {Benchmark::Expression::TYPE_Condition, "os_and_feature",
+                        "$(TOOLCHAIN_OS) == 'Windows' && $(have_feature -f:THEKOGANS_MAKE_CORE_HAVE_CURL)"},
+                    {Benchmark::Expression::TYPE_Condition, "nested",
+                        "($(TOOLCHAIN_OS) == 'Linux' || $(TOOLCHAIN_OS) == 'OSX') && "
+                        "($(config) == 'Debug' || $(type) == 'Static')"},
+                    {Benchmark::Expression::TYPE_Condition, "not",
+                        "!($(TOOLCHAIN_OS) == 'Windows') && $(TOOLCHAIN_ARCH) != 'arm64'"},
+                    {Benchmark::Expression::TYPE_Condition, "compare_string",
+                        "$(naming_convention) == 'Hierarchical'"},
+                    {Benchmark::Expression::TYPE_Condition, "compare_int",
+                        "$(major_version) >= 1 || $(schema_version) == 2"},
+                    {Benchmark::Expression::TYPE_Condition, "compare_version",
+                        "$(version) >= '0.12.0' && $(version) < '1.0.0'"},
+                    {Benchmark::Expression::TYPE_Format, "plain",
+                        "include"},
+                    {Benchmark::Expression::TYPE_Format, "project_directory",
+                        "$(organization)/$(project_directory)/Config.h"},
+                    {Benchmark::Expression::TYPE_Format, "define",
+                        "_LIB_$(organization)_$(project)_VERSION=\"$(version)\""},
+                    {Benchmark::Expression::TYPE_Format, "quoted",
+                        "'$(DEVELOPMENT_ROOT)/$(organization)' \"$(build_directory)\""},
+                    {Benchmark::Expression::TYPE_Function, "symbol",
+                        "(TOOLCHAIN_TRIPLET)"},
+                    {Benchmark::Expression::TYPE_Function, "indexed_symbol",
+                        "(TOOLCHAIN_OS[0])"},
+                    {Benchmark::Expression::TYPE_Function, "function",
+                        "(have_feature -f:THEKOGANS_MAKE_CORE_HAVE_CURL)"},
+                    {Benchmark::Expression::TYPE_Function, "nested_function",
+                        "(have_feature -f:$(organization)_$(project)_FEATURE)"}
+                };
+                const std::size_t EXPRESSION_CORPUS_COUNT =
+                    sizeof (EXPRESSION_CORPUS) / sizeof (EXPRESSION_CORPUS[0]);
+
+                const char * const EXPRESSION_TYPE_NAMES[] = {
+                    "condition",
+                    "format",
+                    "function"
+                };
+
+                std::atomic<util::ui64> allocationCount (0);
+                std::atomic<bool> countingAllocations (false);
+
+                // Measure iterations calls of op. Records ns/op, and
+                // allocs/op if the host counts allocations.
+                template<typename Op>
+                void Measure (
+                        const std::string &name,
+                        util::ui64 iterations,
+                        Op op,
+                        Benchmark::Results &results) {
+                    util::ui64 allocations = allocationCount.load (std::memory_order_relaxed);
+                    Clock::time_point start = Clock::now ();
+                    for (util::ui64 i = 0; i < iterations; ++i) {
+                        op ();
+                    }
+                    Clock::time_point end = Clock::now ();
+                    allocations = allocationCount.load (std::memory_order_relaxed) - allocations;
+                    AddResult (results, name, "ns/op", iterations).samples.push_back (
+                        GetElapsed (start, end, iterations, "ns/op"));
+                    if (countingAllocations) {
+                        AddResult (results, name + ".allocs", "allocs/op", iterations).samples.push_back (
+                            (util::f64)allocations / (util::f64)(iterations > 0 ? iterations : 1));
+                    }
+                }
+
+                // Just enough JSON to read back what ToJSON writes.
+                struct JSONValue {
+                    enum Type {
+                        TYPE_null,
+                        TYPE_bool,
+                        TYPE_number,
+                        TYPE_string,
+                        TYPE_array,
+                        TYPE_object
+                    } type;
+                    std::string string;
+                    util::f64 number;
+                    std::vector<JSONValue> array;
+                    std::vector<std::pair<std::string, JSONValue>> object;
+
+                    JSONValue () :
+                        type (TYPE_null),
+                        number (0.0) {}
+
+                    const JSONValue *Find (const std::string &name) const {
+                        for (std::size_t i = 0, count = object.size (); i < count; ++i) {
+                            if (object[i].first == name) {
+                                return &object[i].second;
+                            }
+                        }
+                        return 0;
+                    }
+                };
+
+                struct JSONParser {
+                    const char *json;
+                    const char *current;
+
+                    explicit JSONParser (const char *json_) :
+                        json (json_),
+                        current (json_) {}
+
+                    void Parse (JSONValue &value) {
+                        ParseValue (value);
+                        SkipSpaces ();
+                        if (*current != '\0') {
+                            Error ("Trailing characters");
+                        }
+                    }
+
+                private:
+                    void Error (const char *message) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "%s in JSON (near %u)",
+                            message,
+                            (util::ui32)(current - json));
+                    }
+
+                    void SkipSpaces () {
+                        while (*current != '\0' && isspace (*current)) {
+                            ++current;
+                        }
+                    }
+
+                    bool GetToken (char token) {
+                        SkipSpaces ();
+                        if (*current == token) {
+                            ++current;
+                            return true;
+                        }
+                        return false;
+                    }
+
+                    void Expect (char token) {
+                        if (!GetToken (token)) {
+                            Error (util::FormatString ("Expecting '%c'", token).c_str ());
+                        }
+                    }
+
+                    void ParseValue (JSONValue &value) {
+                        SkipSpaces ();
+                        switch (*current) {
+                            case '{': {
+                                ++current;
+                                value.type = JSONValue::TYPE_object;
+                                if (!GetToken ('}')) {
+                                    do {
+                                        std::string name;
+                                        SkipSpaces ();
+                                        ParseString (name);
+                                        Expect (':');
+                                        value.object.push_back (std::make_pair (name, JSONValue ()));
+                                        ParseValue (value.object.back ().second);
+                                    } while (GetToken (','));
+                                    Expect ('}');
+                                }
+                                break;
+                            }
+                            case '[': {
+                                ++current;
+                                value.type = JSONValue::TYPE_array;
+                                if (!GetToken (']')) {
+                                    do {
+                                        value.array.push_back (JSONValue ());
+                                        ParseValue (value.array.back ());
+                                    } while (GetToken (','));
+                                    Expect (']');
+                                }
+                                break;
+                            }
+                            case '"': {
+                                value.type = JSONValue::TYPE_string;
+                                ParseString (value.string);
+                                break;
+                            }
+                            case 't': {
+                                ParseKeyword ("true");
+                                value.type = JSONValue::TYPE_bool;
+                                value.number = 1.0;
+                                break;
+                            }
+                            case 'f': {
+                                ParseKeyword ("false");
+                                value.type = JSONValue::TYPE_bool;
+                                break;
+                            }
+                            case 'n': {
+                                ParseKeyword ("null");
+                                break;
+                            }
+                            default: {
+                                char *end = 0;
+                                value.number = strtod (current, &end);
+                                if (end == current) {
+                                    Error ("Invalid value");
+                                }
+                                value.type = JSONValue::TYPE_number;
+                                current = end;
+                                break;
+                            }
+                        }
+                    }
+
+                    void ParseKeyword (const char *keyword) {
+                        std::size_t length = strlen (keyword);
+                        if (strncmp (current, keyword, length) != 0) {
+                            Error ("Invalid value");
+                        }
+                        current += length;
+                    }
+
+                    void ParseString (std::string &string) {
+                        if (*current++ != '"') {
+                            Error ("Expecting string");
+                        }
+                        while (*current != '"') {
+                            char ch = *current++;
+                            if (ch == '\0') {
+                                Error ("Unterminated string");
+                            }
+                            else if (ch == '\\') {
+                                ch = *current++;
+                                switch (ch) {
+                                    case '"':
+                                    case '\\':
+                                    case '/':
+                                        string += ch;
+                                        break;
+                                    case 'b':
+                                        string += '\b';
+                                        break;
+                                    case 'f':
+                                        string += '\f';
+                                        break;
+                                    case 'n':
+                                        string += '\n';
+                                        break;
+                                    case 'r':
+                                        string += '\r';
+                                        break;
+                                    case 't':
+                                        string += '\t';
+                                        break;
+                                    case 'u': {
+                                        // EncodeJSONString only escapes control
+                                        // characters, so there are no surrogates.
+                                        util::ui32 codePoint = 0;
+                                        for (util::ui32 i = 0; i < 4; ++i) {
+                                            ch = *current++;
+                                            codePoint <<= 4;
+                                            if (ch >= '0' && ch <= '9') {
+                                                codePoint |= ch - '0';
+                                            }
+                                            else if (ch >= 'a' && ch <= 'f') {
+                                                codePoint |= ch - 'a' + 10;
+                                            }
+                                            else if (ch >= 'A' && ch <= 'F') {
+                                                codePoint |= ch - 'A' + 10;
+                                            }
+                                            else {
+                                                Error ("Invalid \\u escape");
+                                            }
+                                        }
+                                        if (codePoint < 0x80) {
+                                            string += (char)codePoint;
+                                        }
+                                        else if (codePoint < 0x800) {
+                                            string += (char)(0xc0 | (codePoint >> 6));
+                                            string += (char)(0x80 | (codePoint & 0x3f));
+                                        }
+                                        else {
+                                            string += (char)(0xe0 | (codePoint >> 12));
+                                            string += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+                                            string += (char)(0x80 | (codePoint & 0x3f));
+                                        }
+                                        break;
+                                    }
+                                    default:
+                                        Error ("Invalid escape sequence");
+                                }
+                            }
+                            else {
+                                string += ch;
+                            }
+                        }
+                        ++current;
+                    }
+                };
+
+                std::string GetJSONString (
+                        const JSONValue &object,
+                        const char *name) {
+                    const JSONValue *value = object.Find (name);
+                    return value != 0 && value->type == JSONValue::TYPE_string ?
+                        value->string : std::string ();
+                }
+            }
+
+            Benchmark::GraphParameters::GraphParameters () :
+                organization ("thekogans_make_core_benchmark"),
+                projectCount (100),
+                depth (5),
+                fanOut (3),
+                diamondDensity (0.3f),
+                conditionalDensity (0.25f),
+                regexDensity (0.5f),
+                sourceCount (10),
+                goalSize (64 * 1024),
+                seed (1) {}
+
+            void Benchmark::GraphParameters::GetParameters (Parameters &parameters) const {
+                parameters["organization"] = organization;
+                parameters["projects"] = util::ui32Tostring (projectCount);
+                parameters["depth"] = util::ui32Tostring (depth);
+                parameters["fan_out"] = util::ui32Tostring (fanOut);
+                parameters["diamond_density"] = util::f32Tostring (diamondDensity);
+                parameters["conditional_density"] = util::f32Tostring (conditionalDensity);
+                parameters["regex_density"] = util::f32Tostring (regexDensity);
+                parameters["sources"] = util::ui32Tostring (sourceCount);
+                parameters["goal_size"] = util::ui32Tostring (goalSize);
+                parameters["seed"] = util::ui32Tostring (seed);
+            }
+
+            std::string Benchmark::GenerateGraph (const GraphParameters &graphParameters) {
+                if (!IsValidOrganization (graphParameters.organization) ||
+                        graphParameters.projectCount == 0 ||
+                        graphParameters.depth == 0 ||
+                        !IsProbability (graphParameters.diamondDensity) ||
+                        !IsProbability (graphParameters.conditionalDensity) ||
+                        !IsProbability (graphParameters.regexDensity)) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                }
+                Random random (graphParameters.seed);
+                // Layer 0 is the root program. Spread the rest of
+                // the projects evenly over layers 1..depth.
+                util::ui32 layerCount =
+                    std::min (graphParameters.depth, graphParameters.projectCount - 1) + 1;
+                std::vector<std::vector<util::ui32>> layers (layerCount);
+                layers[0].push_back (0);
+                for (util::ui32 i = 1; i < graphParameters.projectCount; ++i) {
+                    layers[1 + (util::ui64)(i - 1) * (layerCount - 1) /
+                        (graphParameters.projectCount - 1)].push_back (i);
+                }
+                std::vector<std::set<util::ui32>> dependencies (graphParameters.projectCount);
+                for (util::ui32 layer = 0; layer + 1 < layerCount; ++layer) {
+                    const std::vector<util::ui32> &parents = layers[layer];
+                    const std::vector<util::ui32> &children = layers[layer + 1];
+                    // Make sure every project is reachable from the root.
+                    for (std::size_t i = 0, count = children.size (); i < count; ++i) {
+                        dependencies[parents[random.Next ((util::ui32)parents.size ())]].insert (children[i]);
+                    }
+                    // Diamonds are created by drawing from a small
+                    // subset of the layer shared by all parents.
+                    util::ui32 sharedCount = std::max<util::ui32> (1,
+                        (util::ui32)children.size () / std::max<util::ui32> (1, graphParameters.fanOut));
+                    util::ui32 fanOut = std::min<util::ui32> (
+                        graphParameters.fanOut, (util::ui32)children.size ());
+                    for (std::size_t i = 0, count = parents.size (); i < count; ++i) {
+                        std::set<util::ui32> &parentDependencies = dependencies[parents[i]];
+                        // The shared subset can be smaller than fanOut. Once
+                        // it's had sharedCount draws, draw from the whole layer.
+                        util::ui32 sharedDraws = 0;
+                        while (parentDependencies.size () < fanOut) {
+                            if (sharedDraws < sharedCount &&
+                                    random.Chance (graphParameters.diamondDensity)) {
+                                parentDependencies.insert (children[random.Next (sharedCount)]);
+                                ++sharedDraws;
+                            }
+                            else {
+                                parentDependencies.insert (
+                                    children[random.Next ((util::ui32)children.size ())]);
+                            }
+                        }
+                    }
+                }
+                std::string organizationRoot = GetOrganizationRoot (graphParameters.organization);
+                CheckOrganizationRoot (organizationRoot);
+                WriteFile (MakePath (organizationRoot, GRAPH_MARKER), std::string ());
+                for (util::ui32 i = 0; i < graphParameters.projectCount; ++i) {
+                    std::string project_root = MakePath (organizationRoot, GetProjectName (i));
+                    bool regex = random.Chance (graphParameters.regexDensity);
+                    WriteFile (
+                        MakePath (project_root, THEKOGANS_MAKE_XML),
+                        GetConfigFile (
+                            graphParameters,
+                            i,
+                            std::vector<util::ui32> (dependencies[i].begin (), dependencies[i].end ()),
+                            regex,
+                            random));
+                    for (util::ui32 j = 0; j < graphParameters.sourceCount; ++j) {
+                        std::string header = util::FormatString ("h%u.h", j);
+                        std::list<std::string> components;
+                        components.push_back (project_root);
+                        components.push_back (INCLUDE_DIR);
+                        components.push_back (graphParameters.organization);
+                        components.push_back (GetProjectName (i));
+                        components.push_back (header);
+                        WriteFile (MakePath (components, false), "#pragma once\n");
+                        WriteFile (
+                            MakePath (MakePath (project_root, SRC_DIR), util::FormatString ("s%u.cpp", j)),
+                            "#include \"" + graphParameters.organization + "/" +
+                                GetProjectName (i) + "/" + header + "\"\n");
+                    }
+                }
+                std::string project_root = MakePath (organizationRoot, GetProjectName (0));
+                // Create placeholder library goals for CopyDependencies.
+                {
+                    const std::string config = CONFIG_DEBUG;
+                    std::set<std::string> visited;
+                    std::list<const thekogans_make *> configs;
+                    CollectConfigs (
+                        thekogans_make::GetConfig (
+                            project_root, THEKOGANS_MAKE_XML, MAKE, config, TYPE_SHARED),
+                        visited,
+                        configs);
+                    std::string goal (graphParameters.goalSize, '\0');
+                    for (std::list<const thekogans_make *>::const_iterator
+                            it = configs.begin (),
+                            end = configs.end (); it != end; ++it) {
+                        if ((*it)->project_type == PROJECT_TYPE_LIBRARY) {
+                            WriteFile ((*it)->GetProjectGoal (), goal);
+                        }
+                    }
+                    thekogans_make::FlushConfigs ();
+                }
+                return project_root;
+            }
+
+            void Benchmark::DeleteGraph (const GraphParameters &graphParameters) {
+                if (!IsValidOrganization (graphParameters.organization)) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                }
+                thekogans_make::FlushConfigs ();
+                std::string organizationRoot = GetOrganizationRoot (graphParameters.organization);
+                if (!CheckOrganizationRoot (organizationRoot)) {
+                    util::Path (ToSystemPath (organizationRoot)).Delete ();
+                }
+            }
+
+            void Benchmark::RunGraph (
+                    const std::string &project_root,
+                    const std::string &config_,
+                    util::ui32 runs,
+                    Results &results) {
+                ConsoleSilencer consoleSilencer;
+                std::string destination =
+                    MakePath (MakePath (project_root, BUILD_DIR), "benchmark_copy_dependencies");
+                for (util::ui32 run = 0; run < runs; ++run) {
+                    // GetConfig cold: parse the whole graph from scratch.
+                    thekogans_make::FlushConfigs ();
+                    Clock::time_point start = Clock::now ();
+                    const thekogans_make *root = &thekogans_make::GetConfig (
+                        project_root, THEKOGANS_MAKE_XML, MAKE, config_, TYPE_SHARED);
+                    std::set<std::string> visited;
+                    std::list<const thekogans_make *> configs;
+                    CollectConfigs (*root, visited, configs);
+                    Clock::time_point end = Clock::now ();
+                    AddResult (results, "GetConfig.cold", "us", 1).samples.push_back (
+                        GetElapsed (start, end, 1, "us"));
+                    AddResult (results, "GetConfig.cold.per_config", "us", configs.size ()).samples.push_back (
+                        GetElapsed (start, end, configs.size (), "us"));
+                    // GetConfig warm: every lookup is a cache hit.
+                    start = Clock::now ();
+                    for (util::ui64 i = 0; i < WARM_ITERATIONS; ++i) {
+                        thekogans_make::GetConfig (
+                            project_root, THEKOGANS_MAKE_XML, MAKE, config_, TYPE_SHARED);
+                    }
+                    end = Clock::now ();
+                    AddResult (results, "GetConfig.warm", "ns/op", WARM_ITERATIONS).samples.push_back (
+                        GetElapsed (start, end, WARM_ITERATIONS, "ns/op"));
+                    start = Clock::now ();
+                    root->CheckDependencies ();
+                    end = Clock::now ();
+                    AddResult (results, "CheckDependencies", "us", 1).samples.push_back (
+                        GetElapsed (start, end, 1, "us"));
+                    {
+                        std::set<std::string> features;
+                        start = Clock::now ();
+                        root->GetFeatures (features);
+                        end = Clock::now ();
+                        AddResult (results, "GetFeatures", "us", 1).samples.push_back (
+                            GetElapsed (start, end, 1, "us"));
+                    }
+                    {
+                        std::set<std::string> include_directories;
+                        start = Clock::now ();
+                        root->GetIncludeDirectories (include_directories);
+                        end = Clock::now ();
+                        AddResult (results, "GetIncludeDirectories", "us", 1).samples.push_back (
+                            GetElapsed (start, end, 1, "us"));
+                    }
+                    {
+                        std::list<std::string> link_libraries;
+                        start = Clock::now ();
+                        root->GetLinkLibraries (link_libraries);
+                        end = Clock::now ();
+                        AddResult (results, "GetLinkLibraries", "us", 1).samples.push_back (
+                            GetElapsed (start, end, 1, "us"));
+                    }
+                    {
+                        std::set<std::string> shared_libraries;
+                        start = Clock::now ();
+                        root->GetSharedLibraries (shared_libraries);
+                        end = Clock::now ();
+                        AddResult (results, "GetSharedLibraries", "us", 1).samples.push_back (
+                            GetElapsed (start, end, 1, "us"));
+                    }
+                    {
+                        std::list<std::string> preprocessorDefinitions;
+                        start = Clock::now ();
+                        root->GetCommonPreprocessorDefinitions (preprocessorDefinitions);
+                        end = Clock::now ();
+                        AddResult (results, "GetCommonPreprocessorDefinitions", "us", 1).samples.push_back (
+                            GetElapsed (start, end, 1, "us"));
+                    }
+                    start = Clock::now ();
+                    for (util::ui64 i = 0; i < EXPRESSION_ITERATIONS; ++i) {
+                        root->Expand ("$(organization)_$(project)-$(TOOLCHAIN_TRIPLET)-$(config)-$(type).$(version)");
+                    }
+                    end = Clock::now ();
+                    AddResult (results, "Expand", "ns/op", EXPRESSION_ITERATIONS).samples.push_back (
+                        GetElapsed (start, end, EXPRESSION_ITERATIONS, "ns/op"));
+                    start = Clock::now ();
+                    for (util::ui64 i = 0; i < EXPRESSION_ITERATIONS; ++i) {
+                        root->Eval (CONDITIONS[i % CONDITION_COUNT]);
+                    }
+                    end = Clock::now ();
+                    AddResult (results, "Eval", "ns/op", EXPRESSION_ITERATIONS).samples.push_back (
+                        GetElapsed (start, end, EXPRESSION_ITERATIONS, "ns/op"));
+                    // CopyDependencies cold (everything is copied)
+                    // and warm (everything is up to date).
+                    {
+                        util::Path path (ToSystemPath (destination));
+                        if (path.Exists ()) {
+                            path.Delete ();
+                        }
+                    }
+                    util::Directory::Create (ToSystemPath (destination));
+                    start = Clock::now ();
+                    CopyDependencies (project_root, config_, TYPE_SHARED, destination);
+                    end = Clock::now ();
+                    AddResult (results, "CopyDependencies.cold", "us", 1).samples.push_back (
+                        GetElapsed (start, end, 1, "us"));
+                    start = Clock::now ();
+                    CopyDependencies (project_root, config_, TYPE_SHARED, destination);
+                    end = Clock::now ();
+                    AddResult (results, "CopyDependencies.warm", "us", 1).samples.push_back (
+                        GetElapsed (start, end, 1, "us"));
+                }
+            }
+
+            Benchmark::Expression Benchmark::Expression::Parse (const std::string &line) {
+                std::string::size_type typeEnd = line.find (' ');
+                std::string::size_type nameEnd = typeEnd != std::string::npos ?
+                    line.find (' ', typeEnd + 1) : std::string::npos;
+                if (nameEnd != std::string::npos) {
+                    std::string type = line.substr (0, typeEnd);
+                    for (std::size_t i = 0; i < TYPE_Function + 1; ++i) {
+                        if (type == EXPRESSION_TYPE_NAMES[i]) {
+                            return Expression (
+                                (Type)i,
+                                line.substr (typeEnd + 1, nameEnd - typeEnd - 1),
+                                line.substr (nameEnd + 1));
+                        }
+                    }
+                }
+                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                    "Invalid corpus line: %s", line.c_str ());
+            }
+
+            void Benchmark::GetExpressionCorpus (Corpus &corpus) {
+                for (std::size_t i = 0; i < EXPRESSION_CORPUS_COUNT; ++i) {
+                    corpus.push_back (
+                        Expression (
+                            EXPRESSION_CORPUS[i].type,
+                            EXPRESSION_CORPUS[i].name,
+                            EXPRESSION_CORPUS[i].text));
+                }
+            }
+
+            void Benchmark::RunExpressions (
+                    const thekogans_make &config,
+                    const Corpus &corpus,
+                    util::ui32 runs,
+                    util::ui64 iterations,
+                    Results &results) {
+                for (util::ui32 run = 0; run < runs; ++run) {
+                    for (Corpus::const_iterator
+                            it = corpus.begin (),
+                            end = corpus.end (); it != end; ++it) {
+                        const char *text = it->text.c_str ();
+                        std::string name = std::string (EXPRESSION_TYPE_NAMES[it->type]) + "." + it->name;
+                        switch (it->type) {
+                            case Expression::TYPE_Condition: {
+                                Measure (name + ".Tokenizer", iterations,
+                                    [&config, text] () {
+                                        Tokenizer tokenizer (text, config);
+                                        while (tokenizer.GetToken ().type != Tokenizer::Token::END) {
+                                        }
+                                    },
+                                    results);
+                                Measure (name + ".Parser", iterations,
+                                    [&config, text] () {
+                                        Tokenizer tokenizer (text, config);
+                                        Parser parser (tokenizer);
+                                        parser.Parse ();
+                                    },
+                                    results);
+                                break;
+                            }
+                            case Expression::TYPE_Format: {
+                                Measure (name + ".Expand", iterations,
+                                    [&config, text] () {
+                                        config.Expand (text);
+                                    },
+                                    results);
+                                break;
+                            }
+                            case Expression::TYPE_Function: {
+                                std::size_t length = it->text.size ();
+                                Measure (name + ".ParseAndExec", iterations,
+                                    [&config, text, length] () {
+                                        util::TenantReadBuffer buffer (util::HostEndian, text, length);
+                                        Function::ParseAndExec (config, buffer);
+                                    },
+                                    results);
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            void Benchmark::CountAllocation () {
+                allocationCount.fetch_add (1, std::memory_order_relaxed);
+                if (!countingAllocations.load (std::memory_order_relaxed)) {
+                    countingAllocations = true;
+                }
+            }
+
+            std::string Benchmark::ToJSON (
+                    const std::string &suite,
+                    const Parameters &parameters,
+                    const Results &results) {
+                std::ostringstream stream;
+                stream.precision (15);
+                stream <<
+                    "{\n"
+                    "  \"suite\": " << EncodeJSONString (suite) << ",\n"
+                    "  \"version\": " << EncodeJSONString (GetVersion ().ToString ()) << ",\n"
+                    "  \"parameters\": {";
+                for (Parameters::const_iterator
+                        it = parameters.begin (),
+                        end = parameters.end (); it != end; ++it) {
+                    if (it != parameters.begin ()) {
+                        stream << ", ";
+                    }
+                    stream << EncodeJSONString (it->first) << ": " << EncodeJSONString (it->second);
+                }
+                stream <<
+                    "},\n"
+                    "  \"results\": [";
+                for (Results::const_iterator
+                        it = results.begin (),
+                        end = results.end (); it != end; ++it) {
+                    stream << (it == results.begin () ? "\n" : ",\n") <<
+                        "    {\"name\": " << EncodeJSONString (it->name) <<
+                        ", \"unit\": " << EncodeJSONString (it->unit) <<
+                        ", \"iterations\": " << it->iterations <<
+                        ", \"samples\": [";
+                    for (std::size_t i = 0, count = it->samples.size (); i < count; ++i) {
+                        if (i > 0) {
+                            stream << ", ";
+                        }
+                        stream << it->samples[i];
+                    }
+                    stream << "]}";
+                }
+                stream <<
+                    "\n  ]\n"
+                    "}\n";
+                return stream.str ();
+            }
+
+            void Benchmark::FromJSON (
+                    const std::string &json,
+                    std::string &suite,
+                    Parameters &parameters,
+                    Results &results) {
+                JSONValue root;
+                JSONParser (json.c_str ()).Parse (root);
+                if (root.type != JSONValue::TYPE_object) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "%s", "Expecting a JSON object.");
+                }
+                suite = GetJSONString (root, "suite");
+                const JSONValue *parametersValue = root.Find ("parameters");
+                if (parametersValue != 0 && parametersValue->type == JSONValue::TYPE_object) {
+                    for (std::size_t i = 0, count = parametersValue->object.size (); i < count; ++i) {
+                        if (parametersValue->object[i].second.type == JSONValue::TYPE_string) {
+                            parameters[parametersValue->object[i].first] =
+                                parametersValue->object[i].second.string;
+                        }
+                    }
+                }
+                const JSONValue *resultsValue = root.Find ("results");
+                if (resultsValue != 0 && resultsValue->type == JSONValue::TYPE_array) {
+                    for (std::size_t i = 0, count = resultsValue->array.size (); i < count; ++i) {
+                        const JSONValue &resultValue = resultsValue->array[i];
+                        std::string name = GetJSONString (resultValue, "name");
+                        if (resultValue.type != JSONValue::TYPE_object || name.empty ()) {
+                            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                                "Invalid result: %u.", (util::ui32)i);
+                        }
+                        const JSONValue *iterations = resultValue.Find ("iterations");
+                        Result &result = AddResult (
+                            results,
+                            name,
+                            GetJSONString (resultValue, "unit"),
+                            iterations != 0 && iterations->type == JSONValue::TYPE_number ?
+                                (util::ui64)iterations->number : 1);
+                        const JSONValue *samples = resultValue.Find ("samples");
+                        if (samples != 0 && samples->type == JSONValue::TYPE_array) {
+                            for (std::size_t j = 0, count = samples->array.size (); j < count; ++j) {
+                                if (samples->array[j].type == JSONValue::TYPE_number) {
+                                    result.samples.push_back (samples->array[j].number);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
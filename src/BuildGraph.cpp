@@ -0,0 +1,319 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Unity.h"
+#include "thekogans/make/core/BuildGraph.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                void AddFiles (
+                        const thekogans_make &config,
+                        const std::list<thekogans_make::FileList::Ptr> &fileLists,
+                        std::vector<BuildGraph::File> &files,
+                        std::vector<BuildGraph::InstallPath> &install,
+                        const char *unityExtension = 0) {
+                    std::string buildPrefix = MakePath (
+                        config.project_root,
+                        GetBuildDirectory (config.generator, config.config, config.type));
+                    for (std::list<thekogans_make::FileList::Ptr>::const_iterator
+                            it = fileLists.begin (),
+                            end = fileLists.end (); it != end; ++it) {
+                        std::string prefix = MakePath (config.project_root, (*it)->prefix);
+                        std::string outputPrefix = MakePath (buildPrefix, (*it)->prefix);
+                        bool unity = unityExtension != 0 && (*it)->unity;
+                        std::vector<std::string> unityFiles;
+                        std::map<std::string, std::string> unityNames;
+                        for (std::list<thekogans_make::FileList::File::Ptr>::const_iterator
+                                jt = (*it)->files.begin (),
+                                end = (*it)->files.end (); jt != end; ++jt) {
+                            // Files with their own precompiled header
+                            // settings can't share a translation unit.
+                            if (unity && (*jt)->unity && (*jt)->customBuild.get () == 0 &&
+                                    (*jt)->precompiled_header.type == thekogans_make::PrecompiledHeader::None) {
+                                unityFiles.push_back (MakePath (prefix, (*jt)->name));
+                                unityNames[unityFiles.back ()] = (*jt)->name;
+                                if ((*it)->install) {
+                                    install.push_back (
+                                        BuildGraph::InstallPath (
+                                            unityFiles.back (),
+                                            MakePath ((*it)->destinationPrefix, (*jt)->name)));
+                                }
+                                continue;
+                            }
+                            BuildGraph::File file;
+                            file.path = MakePath (prefix, (*jt)->name);
+                            file.name = (*jt)->name;
+                            file.prefix = (*it)->prefix;
+                            file.precompiled_header = (*jt)->precompiled_header;
+                            if ((*jt)->customBuild.get () != 0) {
+                                file.hasCustomBuild = true;
+                                const thekogans_make::FileList::File::CustomBuild &customBuild =
+                                    *(*jt)->customBuild;
+                                for (std::vector<std::string>::const_iterator
+                                        kt = customBuild.outputs.begin (),
+                                        end = customBuild.outputs.end (); kt != end; ++kt) {
+                                    file.customBuild.outputs.push_back (MakePath (outputPrefix, *kt));
+                                    if ((*it)->install) {
+                                        install.push_back (
+                                            BuildGraph::InstallPath (
+                                                MakePath (outputPrefix, *kt),
+                                                MakePath ((*it)->destinationPrefix, *kt)));
+                                    }
+                                }
+                                for (std::vector<std::string>::const_iterator
+                                        kt = customBuild.dependencies.begin (),
+                                        end = customBuild.dependencies.end (); kt != end; ++kt) {
+                                    file.customBuild.dependencies.push_back (
+                                        MakePath (config.project_root, *kt));
+                                }
+                                file.customBuild.message = customBuild.message;
+                                file.customBuild.recipe = customBuild.recipe;
+                            }
+                            else if ((*it)->install) {
+                                install.push_back (
+                                    BuildGraph::InstallPath (
+                                        file.path,
+                                        MakePath ((*it)->destinationPrefix, (*jt)->name)));
+                            }
+                            files.push_back (file);
+                        }
+                        if (!unityFiles.empty ()) {
+                            std::vector<Unity::Batch> batches;
+                            Unity::GetBatches (unityFiles, (*it)->unityBatchSize, unityExtension, batches);
+                            std::string unityPrefix = MakePath (UNITY_DIR, (*it)->prefix);
+                            for (std::vector<Unity::Batch>::const_iterator
+                                    jt = batches.begin (),
+                                    end = batches.end (); jt != end; ++jt) {
+                                BuildGraph::File file;
+                                if (jt->files.size () == 1) {
+                                    file.path = jt->files[0];
+                                    file.name = unityNames[file.path];
+                                    file.prefix = (*it)->prefix;
+                                }
+                                else {
+                                    file.path = MakePath (MakePath (buildPrefix, unityPrefix), jt->name);
+                                    file.name = MakePath (unityPrefix, jt->name);
+                                    file.unity_files = jt->files;
+                                }
+                                files.push_back (file);
+                            }
+                        }
+                    }
+                }
+
+                // Languages that can be batched and their
+                // unity translation unit extensions.
+                const char *GetUnityExtension (const std::string &language) {
+                    return
+                        language == "c" ? ".c" :
+                        language == "cpp" ? ".cpp" :
+                        language == "objective_c" ? ".m" :
+                        language == "objective_cpp" ? ".mm" : 0;
+                }
+
+                void AddLanguage (
+                        const thekogans_make &config,
+                        const char *name,
+                        const std::list<std::string> &flags,
+                        const std::list<std::string> &commonPreprocessorDefinitions,
+                        const std::list<std::string> &preprocessorDefinitions,
+                        const std::list<thekogans_make::FileList::Ptr> *headers,
+                        const std::list<thekogans_make::FileList::Ptr> &sources,
+                        const std::list<thekogans_make::FileList::Ptr> *tests,
+                        BuildGraph::Project &project) {
+                    if ((headers != 0 && !headers->empty ()) ||
+                            !sources.empty () ||
+                            (tests != 0 && !tests->empty ())) {
+                        BuildGraph::Language language;
+                        language.name = name;
+                        language.flags = flags;
+                        language.preprocessor_definitions = commonPreprocessorDefinitions;
+                        language.preprocessor_definitions.insert (
+                            language.preprocessor_definitions.end (),
+                            preprocessorDefinitions.begin (),
+                            preprocessorDefinitions.end ());
+                        if (headers != 0) {
+                            AddFiles (config, *headers, language.headers, project.install);
+                        }
+                        AddFiles (config, sources, language.sources, project.install,
+                            GetUnityExtension (language.name));
+                        if (tests != 0) {
+                            AddFiles (config, *tests, language.tests, project.install);
+                        }
+                        project.languages.push_back (language);
+                    }
+                }
+            }
+
+            BuildGraph::BuildGraph (
+                    const std::string &project_root,
+                    const std::string &generator_,
+                    const std::string &config,
+                    const std::string &type) :
+                    generator (generator_) {
+                std::map<std::string, util::ui32> added;
+                AddProject (
+                    thekogans_make::GetConfig (
+                        project_root,
+                        THEKOGANS_MAKE_XML,
+                        generator,
+                        config,
+                        type),
+                    added);
+            }
+
+            const BuildGraph::Project *BuildGraph::GetProject (
+                    const std::string &project_root) const {
+                std::map<std::string, util::ui32>::const_iterator it = index.find (project_root);
+                return it != index.end () ? &projects[it->second] : 0;
+            }
+
+            util::ui32 BuildGraph::WriteUnityBatches () const {
+                util::ui32 written = 0;
+                for (std::vector<Project>::const_iterator
+                        it = projects.begin (),
+                        end = projects.end (); it != end; ++it) {
+                    for (std::vector<Language>::const_iterator
+                            jt = it->languages.begin (),
+                            end = it->languages.end (); jt != end; ++jt) {
+                        for (std::vector<File>::const_iterator
+                                kt = jt->sources.begin (),
+                                end = jt->sources.end (); kt != end; ++kt) {
+                            if (!kt->unity_files.empty ()) {
+                                Unity::Batch batch;
+                                batch.name = kt->path;
+                                batch.files = kt->unity_files;
+                                if (Unity::WriteBatch (std::string (), batch)) {
+                                    ++written;
+                                }
+                            }
+                        }
+                    }
+                }
+                return written;
+            }
+
+            util::ui32 BuildGraph::AddProject (
+                    const thekogans_make &config,
+                    std::map<std::string, util::ui32> &added) {
+                std::string configKey = GetConfigKey (
+                    config.project_root,
+                    config.config_file,
+                    config.generator,
+                    config.config,
+                    config.type);
+                std::map<std::string, util::ui32>::const_iterator it = added.find (configKey);
+                if (it != added.end ()) {
+                    return it->second;
+                }
+                std::vector<util::ui32> dependencies;
+                std::vector<util::ui32> plugin_hosts;
+                const std::list<thekogans_make::Dependency::Ptr> *dependencyLists[] = {
+                    &config.dependencies,
+                    &config.plugin_hosts
+                };
+                std::vector<util::ui32> *indices[] = {
+                    &dependencies,
+                    &plugin_hosts
+                };
+                for (std::size_t i = 0; i < 2; ++i) {
+                    for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
+                            jt = dependencyLists[i]->begin (),
+                            end = dependencyLists[i]->end (); jt != end; ++jt) {
+                        if ((*jt)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                            indices[i]->push_back (
+                                AddProject (
+                                    thekogans_make::GetConfig (
+                                        (*jt)->GetProjectRoot (),
+                                        (*jt)->GetConfigFile (),
+                                        generator,
+                                        (*jt)->GetConfig (),
+                                        (*jt)->GetType ()),
+                                    added));
+                        }
+                    }
+                }
+                Project project;
+                project.project_root = config.project_root;
+                project.config = config.config;
+                project.type = config.type;
+                project.organization = config.organization;
+                project.project = config.project;
+                project.project_type = config.project_type;
+                project.version = config.GetVersion ();
+                project.naming_convention = config.naming_convention;
+                project.guid = config.guid;
+                project.build_root = GetBuildRoot (
+                    config.project_root,
+                    config.generator,
+                    config.config,
+                    config.type);
+                if (config.HasGoal ()) {
+                    project.goal = config.GetProjectGoal ();
+                    project.link_library = config.GetProjectLinkLibrary ();
+                }
+                config.GetFeatures (project.features);
+                config.GetIncludeDirectories (project.include_directories);
+                config.GetLinkLibraries (project.link_libraries);
+                config.GetSharedLibraries (project.shared_libraries);
+                project.linker_flags = config.linker_flags;
+                project.librarian_flags = config.librarian_flags;
+                project.precompiled_header = config.precompiled_header;
+                std::list<std::string> preprocessor_definitions;
+                config.GetCommonPreprocessorDefinitions (preprocessor_definitions);
+                AddLanguage (config, "masm", config.masm_flags,
+                    preprocessor_definitions, config.masm_preprocessor_definitions,
+                    &config.masm_headers, config.masm_sources, &config.masm_tests, project);
+                AddLanguage (config, "nasm", config.nasm_flags,
+                    preprocessor_definitions, config.nasm_preprocessor_definitions,
+                    &config.nasm_headers, config.nasm_sources, &config.nasm_tests, project);
+                AddLanguage (config, "c", config.c_flags,
+                    preprocessor_definitions, config.c_preprocessor_definitions,
+                    &config.c_headers, config.c_sources, &config.c_tests, project);
+                AddLanguage (config, "cpp", config.cpp_flags,
+                    preprocessor_definitions, config.cpp_preprocessor_definitions,
+                    &config.cpp_headers, config.cpp_sources, &config.cpp_tests, project);
+                AddLanguage (config, "objective_c", config.objective_c_flags,
+                    preprocessor_definitions, config.objective_c_preprocessor_definitions,
+                    &config.objective_c_headers, config.objective_c_sources,
+                    &config.objective_c_tests, project);
+                AddLanguage (config, "objective_cpp", config.objective_cpp_flags,
+                    preprocessor_definitions, config.objective_cpp_preprocessor_definitions,
+                    &config.objective_cpp_headers, config.objective_cpp_sources,
+                    &config.objective_cpp_tests, project);
+                AddLanguage (config, "rc", config.rc_flags,
+                    preprocessor_definitions, config.rc_preprocessor_definitions,
+                    0, config.rc_sources, 0, project);
+                AddFiles (config, config.resources, project.resources, project.install);
+                project.subsystem = config.subsystem;
+                project.def_file = config.def_file;
+                project.dependencies = dependencies;
+                project.plugin_hosts = plugin_hosts;
+                util::ui32 projectIndex = (util::ui32)projects.size ();
+                projects.push_back (project);
+                index[project.project_root] = projectIndex;
+                added[configKey] = projectIndex;
+                return projectIndex;
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,269 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <fstream>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/File.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/XMLUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/BuildHistory.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const TAG_BUILD_HISTORY = "build_history";
+                const char * const ATTR_SCHEMA_VERSION = "schema_version";
+
+                const char * const TAG_ENTRY = "entry";
+                const char * const ATTR_PROJECT_ROOT = "project_root";
+                const char * const ATTR_VARIANT = "variant";
+                const char * const ATTR_DURATION = "duration";
+                const char * const ATTR_LAST = "last";
+                const char * const ATTR_COUNT = "count";
+                const char * const ATTR_MAX_RSS = "max_rss";
+
+                const util::ui32 BUILD_HISTORY_XML_SCHEMA_VERSION = 1;
+
+                // Weight of the latest build time in the moving average.
+                // Recent builds matter more, but a single outlier should
+                // not throw the schedule off.
+                const util::f64 DURATION_WEIGHT = 0.3;
+                // Fraction of the recorded max RSS a smaller one takes off.
+                const util::f64 MAX_RSS_DECAY = 0.1;
+            }
+
+            BuildHistory::BuildHistory () :
+                    path (ToSystemPath (MakePath (_TOOLCHAIN_ROOT, BUILD_HISTORY_XML))),
+                    modified (false) {
+                // A corrupt history only costs us the estimates.
+                THEKOGANS_UTIL_TRY {
+                    Load (DEFAULT_MAX_BUILD_HISTORY_FILE_SIZE);
+                }
+                THEKOGANS_UTIL_CATCH (util::Exception) {
+                    THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                    entries.clear ();
+                }
+            }
+
+            std::string BuildHistory::GetVariant (
+                    const std::string &config,
+                    const std::string &type,
+                    const std::string &target) {
+                return config + DECORATIONS_SEPARATOR + type + DECORATIONS_SEPARATOR + target;
+            }
+
+            bool BuildHistory::Get (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    Entry &entry) const {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                Entries::const_iterator it = entries.find (Key (project_root, variant));
+                if (it != entries.end ()) {
+                    entry = it->second;
+                    return true;
+                }
+                return false;
+            }
+
+            util::f64 BuildHistory::GetDuration (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    util::f64 defaultDuration) const {
+                Entry entry;
+                return Get (project_root, variant, entry) && entry.count > 0 ?
+                    entry.duration : defaultDuration;
+            }
+
+            util::f64 BuildHistory::GetAverageDuration (util::f64 defaultDuration) const {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                util::f64 total = 0.0;
+                util::ui32 count = 0;
+                for (Entries::const_iterator
+                        it = entries.begin (),
+                        end = entries.end (); it != end; ++it) {
+                    // Entries only holding a max RSS have no duration.
+                    if (it->second.count > 0) {
+                        total += it->second.duration;
+                        ++count;
+                    }
+                }
+                return count > 0 ? total / (util::f64)count : defaultDuration;
+            }
+
+            util::ui64 BuildHistory::GetMaxRSS (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    util::ui64 defaultMaxRSS) const {
+                Entry entry;
+                return Get (project_root, variant, entry) && entry.maxRSS > 0 ?
+                    entry.maxRSS : defaultMaxRSS;
+            }
+
+            void BuildHistory::Add (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    util::f64 duration) {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                Entry &entry = entries[Key (project_root, variant)];
+                entry.duration = entry.count == 0 ? duration :
+                    DURATION_WEIGHT * duration + (1.0 - DURATION_WEIGHT) * entry.duration;
+                entry.last = duration;
+                ++entry.count;
+                modified = true;
+            }
+
+            void BuildHistory::AddMaxRSS (
+                    const std::string &project_root,
+                    const std::string &variant,
+                    util::ui64 maxRSS) {
+                if (maxRSS > 0) {
+                    util::LockGuard<util::SpinLock> guard (spinLock);
+                    Entry &entry = entries[Key (project_root, variant)];
+                    entry.maxRSS = maxRSS >= entry.maxRSS ? maxRSS :
+                        entry.maxRSS - (util::ui64)((util::f64)(entry.maxRSS - maxRSS) * MAX_RSS_DECAY);
+                    modified = true;
+                }
+            }
+
+            void BuildHistory::Save () {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                if (modified) {
+                    std::fstream buildHistoryFile (
+                        path.c_str (),
+                        std::fstream::out | std::fstream::trunc);
+                    if (buildHistoryFile.is_open ()) {
+                        util::Attributes attributes;
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_SCHEMA_VERSION,
+                                util::ui32Tostring (BUILD_HISTORY_XML_SCHEMA_VERSION)));
+                        buildHistoryFile << util::OpenTag (0, TAG_BUILD_HISTORY, attributes, false, true);
+                        for (Entries::const_iterator
+                                 it = entries.begin (),
+                                 end = entries.end (); it != end; ++it) {
+                            util::Attributes attributes;
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_PROJECT_ROOT,
+                                    util::EncodeXMLCharEntities (it->first.first)));
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_VARIANT,
+                                    util::EncodeXMLCharEntities (it->first.second)));
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_DURATION,
+                                    util::f64Tostring (it->second.duration)));
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_LAST,
+                                    util::f64Tostring (it->second.last)));
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_COUNT,
+                                    util::ui32Tostring (it->second.count)));
+                            if (it->second.maxRSS > 0) {
+                                attributes.push_back (
+                                    util::Attribute (
+                                        ATTR_MAX_RSS,
+                                        util::ui64Tostring (it->second.maxRSS)));
+                            }
+                            buildHistoryFile << util::OpenTag (1, TAG_ENTRY, attributes, true, true);
+                        }
+                        buildHistoryFile << util::CloseTag (0, TAG_BUILD_HISTORY);
+                        modified = false;
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to open: %s.",
+                            path.c_str ());
+                    }
+                }
+            }
+
+            void BuildHistory::Load (util::ui64 maxBuildHistoryFileSize) {
+                if (util::Path (path).Exists ()) {
+                    util::ReadOnlyFile file (util::HostEndian, path);
+                    // Protect yourself.
+                    util::ui64 fileSize = file.GetSize ();
+                    if (fileSize > maxBuildHistoryFileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "'%s' is bigger (" THEKOGANS_UTIL_UI64_FORMAT ") than expected. (" THEKOGANS_UTIL_UI64_FORMAT ")",
+                            path.c_str (),
+                            fileSize,
+                            maxBuildHistoryFileSize);
+                    }
+                    util::Buffer buffer (util::HostEndian, (util::ui32)fileSize);
+                    if (buffer.AdvanceWriteOffset (
+                            file.Read (
+                                buffer.GetWritePtr (),
+                                (util::ui32)fileSize)) != (util::ui32)fileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to read " THEKOGANS_UTIL_UI64_FORMAT " bytes from '%s'.",
+                            fileSize,
+                            path.c_str ());
+                    }
+                    pugi::xml_document document;
+                    pugi::xml_parse_result result =
+                        document.load_buffer (
+                            buffer.GetReadPtr (),
+                            buffer.GetDataAvailableForReading ());
+                    if (!result) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to parse %s (%s)",
+                            path.c_str (),
+                            result.description ());
+                    }
+                    pugi::xml_node node = document.document_element ();
+                    if (std::string (node.name ()) == TAG_BUILD_HISTORY) {
+                        ParseBuildHistory (node);
+                    }
+                }
+            }
+
+            void BuildHistory::ParseBuildHistory (pugi::xml_node &node) {
+                for (pugi::xml_node child = node.first_child ();
+                        !child.empty (); child = child.next_sibling ()) {
+                    if (child.type () == pugi::node_element) {
+                        std::string childName = child.name ();
+                        if (childName == TAG_ENTRY) {
+                            std::string project_root =
+                                util::Decodestring (child.attribute (ATTR_PROJECT_ROOT).value ());
+                            std::string variant =
+                                util::Decodestring (child.attribute (ATTR_VARIANT).value ());
+                            if (!project_root.empty () && !variant.empty ()) {
+                                Entry &entry = entries[Key (project_root, variant)];
+                                entry.duration = util::stringTof64 (child.attribute (ATTR_DURATION).value ());
+                                entry.last = util::stringTof64 (child.attribute (ATTR_LAST).value ());
+                                entry.count = util::stringToui32 (child.attribute (ATTR_COUNT).value ());
+                                entry.maxRSS = util::stringToui64 (child.attribute (ATTR_MAX_RSS).value ());
+                            }
+                        }
+                    }
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,136 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Console.h"
+#include "thekogans/make/core/BuildProgress.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const THEKOGANS_MAKE_CORE_STATUS_LINE = "THEKOGANS_MAKE_CORE_STATUS_LINE";
+
+                std::string FormatDuration (util::f64 seconds) {
+                    util::ui32 totalSeconds = (util::ui32)(seconds + 0.5);
+                    return totalSeconds >= 3600 ?
+                        util::FormatString ("%u:%02u:%02u",
+                            totalSeconds / 3600, totalSeconds / 60 % 60, totalSeconds % 60) :
+                        util::FormatString ("%u:%02u", totalSeconds / 60, totalSeconds % 60);
+                }
+            }
+
+            BuildProgress::BuildProgress () :
+                statusLine (
+                    util::GetEnvironmentVariable (THEKOGANS_MAKE_CORE_STATUS_LINE) == VALUE_YES),
+                lastCompletedJobs (util::NIDX32),
+                lastRunningJobs (util::NIDX32) {}
+
+            void BuildProgress::SetCallback (const Callback &callback_) {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                callback = callback_;
+            }
+
+            void BuildProgress::SetStatusLine (bool statusLine_) {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                statusLine = statusLine_;
+            }
+
+            bool BuildProgress::IsEnabled () const {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                return statusLine || callback;
+            }
+
+            std::string BuildProgress::GetPhase () const {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                return phase;
+            }
+
+            BuildProgress::Phase::Phase (const std::string &phase) :
+                previous (BuildProgress::Instance ().SetPhase (phase)) {}
+
+            BuildProgress::Phase::~Phase () {
+                BuildProgress::Instance ().SetPhase (previous);
+            }
+
+            void BuildProgress::Report (const Scheduler::Progress &progress) {
+                Callback callback_;
+                std::string phase_;
+                bool printStatusLine = false;
+                {
+                    util::LockGuard<util::SpinLock> guard (spinLock);
+                    callback_ = callback;
+                    phase_ = phase;
+                    if (statusLine &&
+                            (progress.completedJobs != lastCompletedJobs ||
+                                progress.runningJobs != lastRunningJobs)) {
+                        lastCompletedJobs = progress.completedJobs;
+                        lastRunningJobs = progress.runningJobs;
+                        printStatusLine = true;
+                    }
+                }
+                if (printStatusLine) {
+                    // Asked for explicitly, so not subject to the Console level.
+                    Console::Instance ().Write (
+                        Console::Info, FormatStatusLine (phase_, progress) + "\n");
+                }
+                if (callback_) {
+                    // A misbehaving callback should not bring the build down.
+                    THEKOGANS_UTIL_TRY {
+                        callback_ (phase_, progress);
+                    }
+                    THEKOGANS_UTIL_CATCH (util::Exception) {
+                        THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                    }
+                }
+            }
+
+            std::string BuildProgress::FormatStatusLine (
+                    const std::string &phase,
+                    const Scheduler::Progress &progress) {
+                std::string statusLine = util::FormatString (
+                    "[%u/%u, %u running, %3u%%] elapsed %s, ETA %s",
+                    progress.completedJobs,
+                    progress.totalJobs,
+                    progress.runningJobs,
+                    (util::ui32)(progress.GetFraction () * 100.0 + 0.5),
+                    FormatDuration (progress.elapsed).c_str (),
+                    FormatDuration (progress.eta).c_str ());
+                if (!phase.empty ()) {
+                    statusLine += " - " + phase;
+                }
+                return statusLine;
+            }
+
+            std::string BuildProgress::SetPhase (const std::string &phase_) {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                std::string previous = phase;
+                phase = phase_;
+                // New phase, new status line.
+                lastCompletedJobs = util::NIDX32;
+                lastRunningJobs = util::NIDX32;
+                return previous;
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
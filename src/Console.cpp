@@ -0,0 +1,241 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/make/core/Console.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const THEKOGANS_MAKE_CORE_CONSOLE_LEVEL =
+                    "THEKOGANS_MAKE_CORE_CONSOLE_LEVEL";
+
+                void FlushAtExit () {
+                    Console::Instance ().Flush ();
+                }
+            }
+
+            const char * const Console::LEVEL_ERROR = "Error";
+            const char * const Console::LEVEL_WARNING = "Warning";
+            const char * const Console::LEVEL_INFO = "Info";
+            const char * const Console::LEVEL_DEBUG = "Debug";
+
+            std::string Console::LevelTostring (Level level) {
+                return level == Error ? LEVEL_ERROR :
+                    level == Warning ? LEVEL_WARNING :
+                    level == Info ? LEVEL_INFO : LEVEL_DEBUG;
+            }
+
+            Console::Level Console::stringToLevel (const std::string &level) {
+                return level == LEVEL_ERROR ? Error :
+                    level == LEVEL_WARNING ? Warning :
+                    level == LEVEL_DEBUG ? Debug : Info;
+            }
+
+            Console::Console () :
+                    cells (new Cell[RING_BUFFER_SIZE]),
+                    enqueuePosition (0),
+                    dequeuePosition (0),
+                    written (0),
+                    level (Info),
+                    progressChanged (false) {
+                for (std::size_t i = 0; i < RING_BUFFER_SIZE; ++i) {
+                    cells[i].sequence.store (i, std::memory_order_relaxed);
+                }
+                std::string level_ =
+                    util::GetEnvironmentVariable (THEKOGANS_MAKE_CORE_CONSOLE_LEVEL);
+                if (!level_.empty ()) {
+                    level = stringToLevel (level_);
+                }
+                // The writer is detached and never joined. Anything still
+                // queued at exit is written by FlushAtExit.
+                writer = std::thread (&Console::Run, this);
+                writer.detach ();
+                atexit (FlushAtExit);
+            }
+
+            void Console::SetLevel (Level level_) {
+                level.store (level_, std::memory_order_relaxed);
+            }
+
+            Console::Level Console::GetLevel () const {
+                return (Level)level.load (std::memory_order_relaxed);
+            }
+
+            void Console::Write (
+                    Level level_,
+                    const std::string &message) {
+                // Bounded multi producer queue (Dmitry Vyukov). A slot is free
+                // to write when its sequence == position, and ready to read
+                // when its sequence == position + 1.
+                std::size_t position = enqueuePosition.load (std::memory_order_relaxed);
+                Cell *cell;
+                for (;;) {
+                    cell = &cells[position & (RING_BUFFER_SIZE - 1)];
+                    std::intptr_t difference =
+                        (std::intptr_t)cell->sequence.load (std::memory_order_acquire) -
+                        (std::intptr_t)position;
+                    if (difference == 0) {
+                        if (enqueuePosition.compare_exchange_weak (
+                                position, position + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    }
+                    else if (difference < 0) {
+                        // Full. Let the writer catch up.
+                        available.notify_one ();
+                        std::this_thread::yield ();
+                        position = enqueuePosition.load (std::memory_order_relaxed);
+                    }
+                    else {
+                        position = enqueuePosition.load (std::memory_order_relaxed);
+                    }
+                }
+                cell->level = level_;
+                cell->message = message;
+                cell->sequence.store (position + 1, std::memory_order_release);
+                available.notify_one ();
+            }
+
+            void Console::SetProgress (const std::string &progress_) {
+                if (IsEnabled (Info)) {
+                    std::lock_guard<std::mutex> guard (progressMutex);
+                    if (progress != progress_) {
+                        progress = progress_;
+                        progressChanged = true;
+                    }
+                }
+            }
+
+            void Console::Flush () {
+                // An empty message clears the progress line
+                // (without it being redrawn right after).
+                Write (Info, std::string ());
+                std::size_t target = enqueuePosition.load (std::memory_order_acquire);
+                std::unique_lock<std::mutex> lock (mutex);
+                available.notify_one ();
+                drained.wait (lock,
+                    [this, target] {
+                        return written.load (std::memory_order_acquire) >= target;
+                    });
+            }
+
+            bool Console::Dequeue (
+                    Level &level_,
+                    std::string &message) {
+                Cell &cell = cells[dequeuePosition & (RING_BUFFER_SIZE - 1)];
+                if (cell.sequence.load (std::memory_order_acquire) != dequeuePosition + 1) {
+                    return false;
+                }
+                level_ = cell.level;
+                message.swap (cell.message);
+                cell.message.clear ();
+                cell.sequence.store (
+                    dequeuePosition + RING_BUFFER_SIZE, std::memory_order_release);
+                ++dequeuePosition;
+                return true;
+            }
+
+            void Console::Run () {
+                typedef std::chrono::steady_clock Clock;
+                Clock::time_point lastProgress;
+                // Length of the progress line currently on screen.
+                std::size_t visibleProgress = 0;
+                Level level_;
+                std::string message;
+                for (;;) {
+                    std::size_t count = 0;
+                    bool wroteOut = false;
+                    bool wroteErr = false;
+                    while (Dequeue (level_, message)) {
+                        bool clearedProgress = visibleProgress > 0;
+                        if (clearedProgress) {
+                            std::cout << '\r' << std::string (visibleProgress, ' ') << '\r';
+                            visibleProgress = 0;
+                        }
+                        if (message.empty ()) {
+                            // Flush. Keep the progress line off the screen
+                            // until it changes.
+                            std::lock_guard<std::mutex> guard (progressMutex);
+                            progressChanged = false;
+                        }
+                        else if (clearedProgress) {
+                            // Redraw it after the batch.
+                            std::lock_guard<std::mutex> guard (progressMutex);
+                            progressChanged = true;
+                        }
+                        if (level_ == Error) {
+                            std::cout.flush ();
+                            std::cerr << message;
+                            wroteErr = true;
+                        }
+                        else {
+                            std::cout << message;
+                            wroteOut = true;
+                        }
+                        ++count;
+                    }
+                    if (wroteOut) {
+                        std::cout.flush ();
+                    }
+                    if (wroteErr) {
+                        std::cerr.flush ();
+                    }
+                    if (count > 0) {
+                        written.fetch_add (count, std::memory_order_release);
+                        std::lock_guard<std::mutex> guard (mutex);
+                        drained.notify_all ();
+                    }
+                    Clock::time_point now = Clock::now ();
+                    if (now - lastProgress >= std::chrono::milliseconds (PROGRESS_INTERVAL)) {
+                        std::string progress_;
+                        bool changed;
+                        {
+                            std::lock_guard<std::mutex> guard (progressMutex);
+                            progress_ = progress;
+                            changed = progressChanged;
+                            progressChanged = false;
+                        }
+                        if (changed) {
+                            std::cout << '\r' << progress_;
+                            if (progress_.size () < visibleProgress) {
+                                // Erase what's left of the longer, previous line.
+                                std::cout <<
+                                    std::string (visibleProgress - progress_.size (), ' ') <<
+                                    '\r' << progress_;
+                            }
+                            std::cout.flush ();
+                            visibleProgress = progress_.size ();
+                            lastProgress = now;
+                        }
+                    }
+                    if (count == 0) {
+                        std::unique_lock<std::mutex> lock (mutex);
+                        available.wait_for (lock, std::chrono::milliseconds (10));
+                    }
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,423 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <fstream>
+#include <list>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/File.h"
+#include "thekogans/util/Directory.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/XMLUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/make/core/thekogans_make.h"
+#include "thekogans/make/core/DependentsIndex.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const TAG_DEPENDENTS_INDEX = "dependents_index";
+                const char * const ATTR_SCHEMA_VERSION = "schema_version";
+                const char * const ATTR_ROOT = "root";
+
+                const char * const TAG_CONFIG = "config";
+                const char * const ATTR_PATH = "path";
+                const char * const ATTR_LAST_MODIFIED = "last_modified";
+                const char * const ATTR_PROJECT = "project";
+                const char * const ATTR_UNRESOLVED = "unresolved";
+
+                const char * const TAG_DEPENDENCY = "dependency";
+                const char * const ATTR_NAME = "name";
+
+                // Version 1 indexes dropped unresolved dependencies
+                // without a trace and are rebuilt from scratch.
+                const util::ui32 DEPENDENTS_INDEX_XML_SCHEMA_VERSION = 2;
+
+                typedef std::map<std::string, util::i64> Configs;
+
+                void FindConfigs (
+                        const std::string &directory,
+                        Configs &configs) {
+                    util::Directory directory_ (directory);
+                    util::Directory::Entry entry;
+                    for (bool gotEntry = directory_.GetFirstEntry (entry);
+                            gotEntry; gotEntry = directory_.GetNextEntry (entry)) {
+                        if (entry.type == util::Directory::Entry::Folder) {
+                            // Skip ., .., hidden (.git) and build directories.
+                            if (!entry.name.empty () && entry.name[0] != '.' && entry.name != BUILD_DIR) {
+                                THEKOGANS_UTIL_TRY {
+                                    FindConfigs (MakePath (directory, entry.name), configs);
+                                }
+                                THEKOGANS_UTIL_CATCH (util::Exception) {
+                                    THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                                }
+                            }
+                        }
+                        else if (entry.type == util::Directory::Entry::File &&
+                                entry.name == THEKOGANS_MAKE_XML) {
+                            configs[MakePath (directory, entry.name)] = entry.lastModifiedDate;
+                        }
+                    }
+                }
+
+                inline bool NeedsExpanding (const std::string &value) {
+                    return value.find ("$(") != std::string::npos;
+                }
+
+                void CollectDependencies (
+                        const pugi::xml_node &node,
+                        std::set<std::string> &dependencies,
+                        bool &unresolved) {
+                    for (pugi::xml_node child = node.first_child ();
+                            !child.empty (); child = child.next_sibling ()) {
+                        if (child.type () == pugi::node_element) {
+                            std::string childName = child.name ();
+                            // Custom build dependencies are <dependency>path</dependency>,
+                            // project dependencies always have a name attribute.
+                            std::string name = child.attribute (thekogans_make::ATTR_NAME).value ();
+                            if ((childName == thekogans_make::TAG_DEPENDENCY ||
+                                    childName == thekogans_make::TAG_PROJECT) && !name.empty ()) {
+                                std::string organization =
+                                    child.attribute (thekogans_make::ATTR_ORGANIZATION).value ();
+                                if (organization.empty () && childName == thekogans_make::TAG_PROJECT) {
+                                    organization = _TOOLCHAIN_DEFAULT_ORGANIZATION;
+                                }
+                                if (NeedsExpanding (organization) || NeedsExpanding (name)) {
+                                    unresolved = true;
+                                }
+                                else if (!organization.empty ()) {
+                                    dependencies.insert (
+                                        DependentsIndex::GetProjectName (organization, name));
+                                }
+                            }
+                            else {
+                                CollectDependencies (child, dependencies, unresolved);
+                            }
+                        }
+                    }
+                }
+
+                void ParseConfig (
+                        const std::string &path,
+                        DependentsIndex::Entry &entry) {
+                    pugi::xml_document document;
+                    pugi::xml_parse_result result = document.load_file (ToSystemPath (path).c_str ());
+                    if (!result) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to parse %s (%s)",
+                            path.c_str (),
+                            result.description ());
+                    }
+                    pugi::xml_node node = document.document_element ();
+                    if (std::string (node.name ()) == thekogans_make::TAG_THEKOGANS_MAKE) {
+                        std::string organization = node.attribute (thekogans_make::ATTR_ORGANIZATION).value ();
+                        std::string project = node.attribute (thekogans_make::ATTR_PROJECT).value ();
+                        if (!organization.empty () && !project.empty ()) {
+                            entry.project = DependentsIndex::GetProjectName (organization, project);
+                            CollectDependencies (node, entry.dependencies, entry.unresolved);
+                        }
+                    }
+                }
+            }
+
+            DependentsIndex::DependentsIndex (
+                    const std::string &root_,
+                    const std::string &path_) :
+                    path (path_),
+                    root (root_),
+                    modified (false) {
+                // A corrupt index only costs us a full rescan.
+                THEKOGANS_UTIL_TRY {
+                    Load (DEFAULT_MAX_DEPENDENTS_INDEX_FILE_SIZE);
+                }
+                THEKOGANS_UTIL_CATCH (util::Exception) {
+                    THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                    entries.clear ();
+                }
+                Index ();
+            }
+
+            std::string DependentsIndex::GetDefaultPath () {
+                return ToSystemPath (MakePath (_TOOLCHAIN_ROOT, DEPENDENTS_INDEX_XML));
+            }
+
+            std::string DependentsIndex::GetProjectName (
+                    const std::string &organization,
+                    const std::string &project) {
+                return organization + ORGANIZATION_PROJECT_SEPARATOR + project;
+            }
+
+            util::ui32 DependentsIndex::Refresh (util::ui32 workerCount) {
+                Configs configs;
+                if (util::Path (ToSystemPath (root)).Exists ()) {
+                    FindConfigs (root, configs);
+                }
+                // Forget configs that went away.
+                for (Entries::iterator it = entries.begin (); it != entries.end ();) {
+                    if (configs.find (it->first) == configs.end ()) {
+                        entries.erase (it++);
+                        modified = true;
+                    }
+                    else {
+                        ++it;
+                    }
+                }
+                std::vector<std::string> paths;
+                for (Configs::const_iterator
+                        it = configs.begin (),
+                        end = configs.end (); it != end; ++it) {
+                    Entries::const_iterator entry = entries.find (it->first);
+                    if (entry == entries.end () || entry->second.lastModified != it->second) {
+                        paths.push_back (it->first);
+                    }
+                }
+                if (!paths.empty ()) {
+                    std::vector<Entry> results (paths.size ());
+                    std::atomic<std::size_t> next (0);
+                    auto worker = [&paths, &results, &next] () {
+                        for (std::size_t i = next++; i < paths.size (); i = next++) {
+                            // A broken config is recorded without a project
+                            // and will be retried once it's modified.
+                            THEKOGANS_UTIL_TRY {
+                                ParseConfig (paths[i], results[i]);
+                            }
+                            THEKOGANS_UTIL_CATCH (util::Exception) {
+                                THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                            }
+                        }
+                    };
+                    if (workerCount == 0) {
+                        workerCount = std::max (1u, std::thread::hardware_concurrency ());
+                    }
+                    workerCount = std::min (workerCount, (util::ui32)paths.size ());
+                    std::list<std::thread> workers;
+                    for (util::ui32 i = 1; i < workerCount; ++i) {
+                        workers.push_back (std::thread (worker));
+                    }
+                    worker ();
+                    for (std::list<std::thread>::iterator
+                            it = workers.begin (),
+                            end = workers.end (); it != end; ++it) {
+                        it->join ();
+                    }
+                    for (std::size_t i = 0, count = paths.size (); i < count; ++i) {
+                        results[i].lastModified = configs[paths[i]];
+                        entries[paths[i]] = results[i];
+                    }
+                    modified = true;
+                }
+                if (modified) {
+                    Index ();
+                }
+                return (util::ui32)paths.size ();
+            }
+
+            const std::set<std::string> &DependentsIndex::GetDependents (
+                    const std::string &project) const {
+                static const std::set<std::string> empty;
+                ProjectMap::const_iterator it = dependents.find (project);
+                return it != dependents.end () ? it->second : empty;
+            }
+
+            void DependentsIndex::GetAllDependents (
+                    const std::string &project,
+                    std::set<std::string> &allDependents) const {
+                std::list<std::string> queue (1, project);
+                while (!queue.empty ()) {
+                    const std::set<std::string> &projectDependents = GetDependents (queue.front ());
+                    queue.pop_front ();
+                    for (std::set<std::string>::const_iterator
+                            it = projectDependents.begin (),
+                            end = projectDependents.end (); it != end; ++it) {
+                        if (*it != project && allDependents.insert (*it).second) {
+                            queue.push_back (*it);
+                        }
+                    }
+                }
+            }
+
+            void DependentsIndex::Save () {
+                if (modified) {
+                    util::Directory::Create (util::Path (path).GetDirectory ());
+                    std::fstream dependentsIndexFile (
+                        path.c_str (),
+                        std::fstream::out | std::fstream::trunc);
+                    if (dependentsIndexFile.is_open ()) {
+                        util::Attributes attributes;
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_SCHEMA_VERSION,
+                                util::ui32Tostring (DEPENDENTS_INDEX_XML_SCHEMA_VERSION)));
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_ROOT,
+                                util::EncodeXMLCharEntities (root)));
+                        dependentsIndexFile << util::OpenTag (0, TAG_DEPENDENTS_INDEX, attributes, false, true);
+                        for (Entries::const_iterator
+                                 it = entries.begin (),
+                                 end = entries.end (); it != end; ++it) {
+                            util::Attributes attributes;
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_PATH,
+                                    util::EncodeXMLCharEntities (it->first)));
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_LAST_MODIFIED,
+                                    util::i64Tostring (it->second.lastModified)));
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_PROJECT,
+                                    util::EncodeXMLCharEntities (it->second.project)));
+                            if (it->second.unresolved) {
+                                attributes.push_back (
+                                    util::Attribute (
+                                        ATTR_UNRESOLVED,
+                                        VALUE_YES));
+                            }
+                            dependentsIndexFile << util::OpenTag (1, TAG_CONFIG, attributes,
+                                it->second.dependencies.empty (), true);
+                            if (!it->second.dependencies.empty ()) {
+                                for (std::set<std::string>::const_iterator
+                                        jt = it->second.dependencies.begin (),
+                                        end = it->second.dependencies.end (); jt != end; ++jt) {
+                                    util::Attributes attributes;
+                                    attributes.push_back (
+                                        util::Attribute (
+                                            ATTR_NAME,
+                                            util::EncodeXMLCharEntities (*jt)));
+                                    dependentsIndexFile << util::OpenTag (2, TAG_DEPENDENCY, attributes, true, true);
+                                }
+                                dependentsIndexFile << util::CloseTag (1, TAG_CONFIG);
+                            }
+                        }
+                        dependentsIndexFile << util::CloseTag (0, TAG_DEPENDENTS_INDEX);
+                        modified = false;
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to open: %s.",
+                            path.c_str ());
+                    }
+                }
+            }
+
+            void DependentsIndex::Load (util::ui64 maxDependentsIndexFileSize) {
+                if (util::Path (path).Exists ()) {
+                    util::ReadOnlyFile file (util::HostEndian, path);
+                    // Protect yourself.
+                    util::ui64 fileSize = file.GetSize ();
+                    if (fileSize > maxDependentsIndexFileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "'%s' is bigger (" THEKOGANS_UTIL_UI64_FORMAT ") than expected. (" THEKOGANS_UTIL_UI64_FORMAT ")",
+                            path.c_str (),
+                            fileSize,
+                            maxDependentsIndexFileSize);
+                    }
+                    util::Buffer buffer (util::HostEndian, (util::ui32)fileSize);
+                    if (buffer.AdvanceWriteOffset (
+                            file.Read (
+                                buffer.GetWritePtr (),
+                                (util::ui32)fileSize)) != (util::ui32)fileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to read " THEKOGANS_UTIL_UI64_FORMAT " bytes from '%s'.",
+                            fileSize,
+                            path.c_str ());
+                    }
+                    pugi::xml_document document;
+                    pugi::xml_parse_result result =
+                        document.load_buffer (
+                            buffer.GetReadPtr (),
+                            buffer.GetDataAvailableForReading ());
+                    if (!result) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to parse %s (%s)",
+                            path.c_str (),
+                            result.description ());
+                    }
+                    pugi::xml_node node = document.document_element ();
+                    // An index of a different root (or schema) is of no use to us.
+                    if (std::string (node.name ()) == TAG_DEPENDENTS_INDEX &&
+                            util::stringToui32 (node.attribute (ATTR_SCHEMA_VERSION).value ()) ==
+                                DEPENDENTS_INDEX_XML_SCHEMA_VERSION &&
+                            util::Decodestring (node.attribute (ATTR_ROOT).value ()) == root) {
+                        ParseDependentsIndex (node);
+                    }
+                }
+            }
+
+            void DependentsIndex::ParseDependentsIndex (pugi::xml_node &node) {
+                for (pugi::xml_node child = node.first_child ();
+                        !child.empty (); child = child.next_sibling ()) {
+                    if (child.type () == pugi::node_element) {
+                        std::string childName = child.name ();
+                        if (childName == TAG_CONFIG) {
+                            std::string configPath =
+                                util::Decodestring (child.attribute (ATTR_PATH).value ());
+                            if (!configPath.empty ()) {
+                                Entry &entry = entries[configPath];
+                                entry.lastModified = (util::i64)util::stringToui64 (
+                                    child.attribute (ATTR_LAST_MODIFIED).value ());
+                                entry.project =
+                                    util::Decodestring (child.attribute (ATTR_PROJECT).value ());
+                                entry.unresolved =
+                                    std::string (child.attribute (ATTR_UNRESOLVED).value ()) == VALUE_YES;
+                                for (pugi::xml_node dependency = child.first_child ();
+                                        !dependency.empty (); dependency = dependency.next_sibling ()) {
+                                    if (dependency.type () == pugi::node_element &&
+                                            std::string (dependency.name ()) == TAG_DEPENDENCY) {
+                                        entry.dependencies.insert (
+                                            util::Decodestring (dependency.attribute (ATTR_NAME).value ()));
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            void DependentsIndex::Index () {
+                dependents.clear ();
+                configFiles.clear ();
+                unresolved.clear ();
+                for (Entries::const_iterator
+                        it = entries.begin (),
+                        end = entries.end (); it != end; ++it) {
+                    if (!it->second.project.empty ()) {
+                        configFiles[it->second.project].insert (it->first);
+                        if (it->second.unresolved) {
+                            unresolved.insert (it->second.project);
+                        }
+                        for (std::set<std::string>::const_iterator
+                                jt = it->second.dependencies.begin (),
+                                end = it->second.dependencies.end (); jt != end; ++jt) {
+                            dependents[*jt].insert (it->second.project);
+                        }
+                    }
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,1015 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if defined (TOOLCHAIN_OS_Windows)
+    #include <windows.h>
+#else // defined (TOOLCHAIN_OS_Windows)
+    #include <unistd.h>
+#endif // defined (TOOLCHAIN_OS_Windows)
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/File.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/Directory.h"
+#include "thekogans/util/SHA2.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/XMLUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Console.h"
+#include "thekogans/make/core/Process.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/BuildHistory.h"
+#include "thekogans/make/core/PrecompiledHeaderCache.h"
+#include "thekogans/make/core/PrecompiledHeaderAdvisor.h"
+#include "thekogans/make/core/Executor.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const TAG_ACTION_LOG = "action_log";
+                const char * const ATTR_SCHEMA_VERSION = "schema_version";
+
+                const char * const TAG_ENTRY = "entry";
+                const char * const ATTR_OUTPUT = "output";
+                const char * const ATTR_HASH = "hash";
+
+                const util::ui32 ACTION_LOG_XML_SCHEMA_VERSION = 1;
+
+                std::string GetEnvironmentVariable (
+                        const char *name,
+                        const char *defaultValue) {
+                    std::string value = util::GetEnvironmentVariable (name);
+                    return !value.empty () ? value : defaultValue;
+                }
+
+                std::string HashCommandLine (const std::string &commandLine) {
+                    util::Hash::Digest digest;
+                    util::SHA2 hasher;
+                    hasher.FromBuffer (
+                        commandLine.data (),
+                        commandLine.size (),
+                        util::SHA2::DIGEST_SIZE_256,
+                        digest);
+                    return util::Hash::DigestTostring (digest);
+                }
+
+                util::ui32 GetProcessId () {
+                #if defined (TOOLCHAIN_OS_Windows)
+                    return (util::ui32)GetCurrentProcessId ();
+                #else // defined (TOOLCHAIN_OS_Windows)
+                    return (util::ui32)getpid ();
+                #endif // defined (TOOLCHAIN_OS_Windows)
+                }
+
+                // Move a finished output into place. On POSIX the
+                // rename is atomic, so concurrent builds sharing the
+                // output never see a partially written file.
+                void RenameFile (
+                        const std::string &from,
+                        const std::string &to) {
+                    std::string systemFrom = ToSystemPath (from);
+                    std::string systemTo = ToSystemPath (to);
+                #if defined (TOOLCHAIN_OS_Windows)
+                    // rename will not replace an existing file on Windows.
+                    if (util::Path (systemTo).Exists ()) {
+                        util::Path (systemTo).Delete ();
+                    }
+                #endif // defined (TOOLCHAIN_OS_Windows)
+                    if (std::rename (systemFrom.c_str (), systemTo.c_str ()) != 0) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to rename '%s' to '%s'.",
+                            systemFrom.c_str (),
+                            systemTo.c_str ());
+                    }
+                }
+
+                bool GetLastModifiedDate (
+                        const std::string &path,
+                        util::i64 &lastModifiedDate) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                    std::string systemPath = ToSystemPath (path);
+                    if (util::Path (systemPath).Exists ()) {
+                        lastModifiedDate = util::Directory::Entry (systemPath).lastModifiedDate;
+                        return true;
+                    }
+                    return false;
+                }
+
+                // Parse a make style depfile (target: dependency ...).
+                // Escaped spaces and line continuations are honored.
+                void ParseDepfile (
+                        const std::string &path,
+                        std::vector<std::string> &dependencies) {
+                    std::ifstream file (ToSystemPath (path).c_str ());
+                    if (file.is_open ()) {
+                        std::string contents (
+                            (std::istreambuf_iterator<char> (file)),
+                            std::istreambuf_iterator<char> ());
+                        std::string::size_type start = contents.find (": ");
+                        if (start == std::string::npos) {
+                            start = contents.find (":\n");
+                        }
+                        if (start != std::string::npos) {
+                            std::string dependency;
+                            for (std::size_t i = start + 1, count = contents.size (); i < count; ++i) {
+                                char ch = contents[i];
+                                if (ch == '\\' && i + 1 < count) {
+                                    char next = contents[i + 1];
+                                    if (next == ' ') {
+                                        dependency += ' ';
+                                        ++i;
+                                        continue;
+                                    }
+                                    if (next == '\n' || next == '\r') {
+                                        ++i;
+                                        ch = ' ';
+                                    }
+                                }
+                                if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+                                    if (!dependency.empty ()) {
+                                        dependencies.push_back (dependency);
+                                        dependency.clear ();
+                                    }
+                                }
+                                else {
+                                    dependency += ch;
+                                }
+                            }
+                            if (!dependency.empty ()) {
+                                dependencies.push_back (dependency);
+                            }
+                        }
+                    }
+                }
+
+                // Files in different lists can share a name, so the object
+                // is named after prefix + name. .. components are renamed
+                // to keep the object under objectRoot.
+                std::string GetObjectPath (
+                        const std::string &objectRoot,
+                        const BuildGraph::File &file) {
+                    std::string name = MakePath (file.prefix, file.name);
+                    std::string objectName;
+                    for (std::string::size_type start = 0; start < name.size ();) {
+                        std::string::size_type end = name.find_first_of ("/\\", start);
+                        if (end == std::string::npos) {
+                            end = name.size ();
+                        }
+                        std::string component = name.substr (start, end - start);
+                        if (component == "..") {
+                            component = "__";
+                        }
+                        if (!component.empty () && component != ".") {
+                            objectName = MakePath (objectName, component);
+                        }
+                        start = end + 1;
+                    }
+                    return MakePath (objectRoot, objectName + ".o");
+                }
+
+                void AddCompilerArguments (
+                        const BuildGraph::Project &project,
+                        const BuildGraph::Language &language,
+                        Executor::Action &action) {
+                    action.arguments.push_back (project.config == CONFIG_DEBUG ? "-g" : "-O2");
+                    if (project.type == TYPE_SHARED) {
+                        action.arguments.push_back ("-fPIC");
+                    }
+                    for (std::list<std::string>::const_iterator
+                            it = language.flags.begin (),
+                            end = language.flags.end (); it != end; ++it) {
+                        action.arguments.push_back (*it);
+                    }
+                    for (std::set<std::string>::const_iterator
+                            it = project.include_directories.begin (),
+                            end = project.include_directories.end (); it != end; ++it) {
+                        action.arguments.push_back ("-I" + *it);
+                    }
+                    for (std::list<std::string>::const_iterator
+                            it = language.preprocessor_definitions.begin (),
+                            end = language.preprocessor_definitions.end (); it != end; ++it) {
+                        action.arguments.push_back ("-D" + *it);
+                    }
+                }
+
+                // Compiles and links of a project are measured
+                // (and estimated) separately. Other actions are
+                // cheap enough not to count.
+                bool GetMemoryVariant (
+                        const BuildGraph::Project &project,
+                        const Executor::Action &action,
+                        std::string &variant) {
+                    if (action.type == Executor::Action::Compile ||
+                            action.type == Executor::Action::Link) {
+                        variant = BuildHistory::GetVariant (
+                            project.config,
+                            project.type,
+                            action.type == Executor::Action::Link ? "link" : "compile");
+                        return true;
+                    }
+                    return false;
+                }
+
+                // Work stealing queues. Every worker pushes the actions
+                // it makes ready on to its own queue and pops from the
+                // back (depth first, hot caches). Idle workers steal
+                // from the front of the others' queues.
+                struct WorkQueues {
+                    struct Queue {
+                        std::mutex mutex;
+                        std::deque<util::ui32> actions;
+                    };
+                    std::vector<std::unique_ptr<Queue>> queues;
+                    std::mutex mutex;
+                    std::condition_variable available;
+                    util::i32 ready;
+                    // Actions that don't fit the budget wait in
+                    // deferred until a running one releases its share.
+                    ResourceBudget budget;
+                    std::vector<util::ui32> deferred;
+                    std::mutex budgetMutex;
+
+                    explicit WorkQueues (util::ui32 workerCount) :
+                            ready (0),
+                            budget (ResourceBudget::FromEnvironment (workerCount)) {
+                        for (util::ui32 i = 0; i < workerCount; ++i) {
+                            queues.push_back (std::unique_ptr<Queue> (new Queue));
+                        }
+                    }
+
+                    void Push (
+                            util::ui32 worker,
+                            util::ui32 action) {
+                        {
+                            std::lock_guard<std::mutex> guard (queues[worker]->mutex);
+                            queues[worker]->actions.push_back (action);
+                        }
+                        std::lock_guard<std::mutex> guard (mutex);
+                        ++ready;
+                        available.notify_one ();
+                    }
+
+                    bool Pop (
+                            util::ui32 worker,
+                            util::ui32 &action) {
+                        {
+                            std::lock_guard<std::mutex> guard (queues[worker]->mutex);
+                            if (!queues[worker]->actions.empty ()) {
+                                action = queues[worker]->actions.back ();
+                                queues[worker]->actions.pop_back ();
+                                Take ();
+                                return true;
+                            }
+                        }
+                        for (std::size_t i = 1, count = queues.size (); i < count; ++i) {
+                            Queue &victim = *queues[(worker + i) % count];
+                            std::lock_guard<std::mutex> guard (victim.mutex);
+                            if (!victim.actions.empty ()) {
+                                action = victim.actions.front ();
+                                victim.actions.pop_front ();
+                                Take ();
+                                return true;
+                            }
+                        }
+                        return false;
+                    }
+
+                    void Take () {
+                        std::lock_guard<std::mutex> guard (mutex);
+                        --ready;
+                    }
+
+                    bool Acquire (
+                            util::ui32 action,
+                            const Executor::Action &action_) {
+                        std::lock_guard<std::mutex> guard (budgetMutex);
+                        if (budget.Acquire (action_.GetPool (), action_.memory)) {
+                            return true;
+                        }
+                        deferred.push_back (action);
+                        return false;
+                    }
+
+                    void Release (
+                            util::ui32 worker,
+                            const Executor::Action &action_) {
+                        std::vector<util::ui32> retry;
+                        {
+                            std::lock_guard<std::mutex> guard (budgetMutex);
+                            budget.Release (action_.GetPool (), action_.memory);
+                            retry.swap (deferred);
+                        }
+                        for (std::vector<util::ui32>::const_iterator
+                                it = retry.begin (),
+                                end = retry.end (); it != end; ++it) {
+                            Push (worker, *it);
+                        }
+                    }
+                };
+            }
+
+            Executor::Toolset Executor::Toolset::FromEnvironment () {
+                Toolset toolset;
+                toolset.cc = GetEnvironmentVariable ("CC", "cc");
+                toolset.cxx = GetEnvironmentVariable ("CXX", "c++");
+                toolset.ar = GetEnvironmentVariable ("AR", "ar");
+                return toolset;
+            }
+
+            std::string Executor::Action::GetCommandLine () const {
+                std::string commandLine = program;
+                for (std::list<std::string>::const_iterator
+                        it = arguments.begin (),
+                        end = arguments.end (); it != end; ++it) {
+                    commandLine += " " + *it;
+                }
+                return commandLine;
+            }
+
+            std::string Executor::Action::GetHash () const {
+                return !hash.empty () ? hash : HashCommandLine (GetCommandLine ());
+            }
+
+            Executor::Executor (
+                    const BuildGraph &graph_,
+                    const Toolset &toolset_,
+                    const std::string &path_) :
+                    graph (graph_),
+                    toolset (toolset_),
+                    includeDirectories (graph.projects.size ()),
+                    path (ToSystemPath (path_)),
+                    modified (false) {
+                std::vector<std::vector<util::ui32>> completionActions (graph.projects.size ());
+                for (std::size_t i = 0, count = graph.projects.size (); i < count; ++i) {
+                    includeDirectories[i].assign (
+                        graph.projects[i].include_directories.begin (),
+                        graph.projects[i].include_directories.end ());
+                }
+                for (std::vector<BuildGraph::Project>::const_iterator
+                        it = graph.projects.begin (),
+                        end = graph.projects.end (); it != end; ++it) {
+                    AddProject (*it, completionActions);
+                }
+                // A corrupt log only costs us a rebuild.
+                THEKOGANS_UTIL_TRY {
+                    Load ();
+                }
+                THEKOGANS_UTIL_CATCH (util::Exception) {
+                    THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                    actionLog.clear ();
+                }
+            }
+
+            std::string Executor::GetDefaultPath () {
+                return MakePath (_TOOLCHAIN_ROOT, ACTION_LOG_XML);
+            }
+
+            util::ui32 Executor::Run (util::ui32 workerCount) {
+                // Listing actions (GetActions) leaves the tree alone.
+                // Running them needs the batches on disk.
+                graph.WriteUnityBatches ();
+                if (workerCount == 0) {
+                    workerCount = std::max (1u, std::thread::hardware_concurrency ());
+                }
+                WorkQueues workQueues (workerCount);
+                std::unique_ptr<std::atomic<util::ui32>[]> outstanding (
+                    new std::atomic<util::ui32>[actions.size ()]);
+                for (std::size_t i = 0, count = actions.size (); i < count; ++i) {
+                    outstanding[i] = (util::ui32)actions[i].dependencies.size ();
+                    if (outstanding[i] == 0) {
+                        workQueues.Push ((util::ui32)(i % workerCount), (util::ui32)i);
+                    }
+                }
+                std::atomic<std::size_t> remaining (actions.size ());
+                std::atomic<util::ui32> ran (0);
+                std::atomic<bool> stop (false);
+                std::exception_ptr error;
+                auto worker = [this, &workQueues, &outstanding, &remaining, &ran, &stop, &error] (
+                        util::ui32 id) {
+                    while (1) {
+                        util::ui32 action;
+                        if (!stop && workQueues.Pop (id, action)) {
+                            if (!workQueues.Acquire (action, actions[action])) {
+                                continue;
+                            }
+                            try {
+                                if (Execute (actions[action])) {
+                                    ++ran;
+                                }
+                            }
+                            catch (...) {
+                                std::lock_guard<std::mutex> guard (workQueues.mutex);
+                                if (!error) {
+                                    error = std::current_exception ();
+                                }
+                                stop = true;
+                                workQueues.available.notify_all ();
+                                break;
+                            }
+                            workQueues.Release (id, actions[action]);
+                            for (std::vector<util::ui32>::const_iterator
+                                    it = actions[action].dependents.begin (),
+                                    end = actions[action].dependents.end (); it != end; ++it) {
+                                if (--outstanding[*it] == 0) {
+                                    workQueues.Push (id, *it);
+                                }
+                            }
+                            if (--remaining == 0) {
+                                std::lock_guard<std::mutex> guard (workQueues.mutex);
+                                workQueues.available.notify_all ();
+                            }
+                            continue;
+                        }
+                        std::unique_lock<std::mutex> lock (workQueues.mutex);
+                        workQueues.available.wait (lock,
+                            [&workQueues, &remaining, &stop] () {
+                                return stop || remaining == 0 || workQueues.ready > 0;
+                            });
+                        if (stop || remaining == 0) {
+                            break;
+                        }
+                    }
+                };
+                if (!actions.empty ()) {
+                    std::list<std::thread> workers;
+                    for (util::ui32 i = 1; i < workerCount; ++i) {
+                        workers.push_back (std::thread (worker, i));
+                    }
+                    worker (0);
+                    for (std::list<std::thread>::iterator
+                            it = workers.begin (),
+                            end = workers.end (); it != end; ++it) {
+                        it->join ();
+                    }
+                }
+                Save ();
+                // Stale memory estimates only cost us some concurrency.
+                THEKOGANS_UTIL_TRY {
+                    BuildHistory::Instance ().Save ();
+                }
+                THEKOGANS_UTIL_CATCH (util::Exception) {
+                    THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                }
+                // A stale include cache only costs us a rescan.
+                THEKOGANS_UTIL_TRY {
+                    includeScanner.Save ();
+                }
+                THEKOGANS_UTIL_CATCH (util::Exception) {
+                    THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                }
+                if (error) {
+                    std::rethrow_exception (error);
+                }
+                return ran;
+            }
+
+            bool Executor::IsUpToDate (const Action &action) {
+                util::i64 oldestOutput = 0;
+                std::string hash = action.GetHash ();
+                {
+                    std::lock_guard<std::mutex> guard (mutex);
+                    for (std::vector<std::string>::const_iterator
+                            it = action.outputs.begin (),
+                            end = action.outputs.end (); it != end; ++it) {
+                        ActionLog::const_iterator entry = actionLog.find (*it);
+                        if (entry == actionLog.end () || entry->second != hash) {
+                            return false;
+                        }
+                    }
+                }
+                for (std::vector<std::string>::const_iterator
+                        it = action.outputs.begin (),
+                        end = action.outputs.end (); it != end; ++it) {
+                    util::i64 lastModifiedDate;
+                    if (!GetLastModifiedDate (*it, lastModifiedDate)) {
+                        return false;
+                    }
+                    if (it == action.outputs.begin () || lastModifiedDate < oldestOutput) {
+                        oldestOutput = lastModifiedDate;
+                    }
+                }
+                std::vector<std::string> inputs = action.inputs;
+                if (!action.depfile.empty ()) {
+                    // No depfile means the compiler never
+                    // finished. Can't trust the outputs.
+                    if (!util::Path (ToSystemPath (action.depfile)).Exists ()) {
+                        return false;
+                    }
+                    ParseDepfile (action.depfile, inputs);
+                }
+                if (action.type == Action::Compile) {
+                    std::set<std::string> headers;
+                    includeScanner.GetDependencies (
+                        action.inputs[0],
+                        includeDirectories[action.project],
+                        headers);
+                    inputs.insert (inputs.end (), headers.begin (), headers.end ());
+                }
+                for (std::vector<std::string>::const_iterator
+                        it = inputs.begin (),
+                        end = inputs.end (); it != end; ++it) {
+                    util::i64 lastModifiedDate;
+                    // Inputs that don't exist are either system
+                    // libraries or will fail the action anyway.
+                    if (GetLastModifiedDate (*it, lastModifiedDate) &&
+                            lastModifiedDate > oldestOutput) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            bool Executor::Execute (const Action &action) {
+                if (IsUpToDate (action)) {
+                    return false;
+                }
+                for (std::vector<std::string>::const_iterator
+                        it = action.outputs.begin (),
+                        end = action.outputs.end (); it != end; ++it) {
+                    std::string output = ToSystemPath (*it);
+                    util::Directory::Create (util::Path (output).GetDirectory ());
+                    // ar appends to existing archives.
+                    if (action.type == Action::Archive && util::Path (output).Exists ()) {
+                        util::Path (output).Delete ();
+                    }
+                }
+                THEKOGANS_MAKE_CORE_CONSOLE_INFO (action.description << std::endl);
+                Process process (action.program);
+                for (std::list<std::string>::const_iterator
+                        it = action.arguments.begin (),
+                        end = action.arguments.end (); it != end; ++it) {
+                    process.AddArgument (*it);
+                }
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (CHILD_PROCESSES);
+                bool result = process.Exec ();
+                const BuildGraph::Project &project = graph.projects[action.project];
+                std::string variant;
+                if (GetMemoryVariant (project, action, variant)) {
+                    BuildHistory::Instance ().AddMaxRSS (
+                        project.project_root, variant, process.GetResourceUsage ().maxRSS);
+                }
+                if (!result) {
+                    for (std::map<std::string, std::string>::const_iterator
+                            it = action.temporaries.begin (),
+                            end = action.temporaries.end (); it != end; ++it) {
+                        std::string temporary = ToSystemPath (it->first);
+                        if (util::Path (temporary).Exists ()) {
+                            util::Path (temporary).Delete ();
+                        }
+                    }
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to execute '%s'.",
+                        process.BuildCommandLine ().c_str ());
+                }
+                for (std::map<std::string, std::string>::const_iterator
+                        it = action.temporaries.begin (),
+                        end = action.temporaries.end (); it != end; ++it) {
+                    RenameFile (it->first, it->second);
+                }
+                std::string hash = action.GetHash ();
+                std::lock_guard<std::mutex> guard (mutex);
+                for (std::vector<std::string>::const_iterator
+                        it = action.outputs.begin (),
+                        end = action.outputs.end (); it != end; ++it) {
+                    actionLog[*it] = hash;
+                }
+                modified = true;
+                return true;
+            }
+
+            void Executor::AddProject (
+                    const BuildGraph::Project &project,
+                    std::vector<std::vector<util::ui32>> &completionActions) {
+                util::ui32 projectIndex = (util::ui32)(&project - &graph.projects[0]);
+                // Dependents wait on this project's goal. If it has
+                // none, they wait on whatever this project waits on.
+                std::vector<util::ui32> dependencies;
+                for (std::size_t i = 0; i < 2; ++i) {
+                    const std::vector<util::ui32> &projects =
+                        i == 0 ? project.dependencies : project.plugin_hosts;
+                    for (std::vector<util::ui32>::const_iterator
+                            it = projects.begin (),
+                            end = projects.end (); it != end; ++it) {
+                        dependencies.insert (
+                            dependencies.end (),
+                            completionActions[*it].begin (),
+                            completionActions[*it].end ());
+                    }
+                }
+                std::string objectRoot = MakePath (project.build_root, "native");
+                // Custom build steps first. Compiles wait on all of
+                // them as they might generate headers.
+                std::vector<util::ui32> customBuilds;
+                std::vector<const std::vector<BuildGraph::File> *> fileLists;
+                for (std::vector<BuildGraph::Language>::const_iterator
+                        it = project.languages.begin (),
+                        end = project.languages.end (); it != end; ++it) {
+                    fileLists.push_back (&it->headers);
+                    fileLists.push_back (&it->sources);
+                }
+                fileLists.push_back (&project.resources);
+                for (std::size_t i = 0, count = fileLists.size (); i < count; ++i) {
+                    for (std::vector<BuildGraph::File>::const_iterator
+                            it = fileLists[i]->begin (),
+                            end = fileLists[i]->end (); it != end; ++it) {
+                        if (it->hasCustomBuild) {
+                            Action action (Action::CustomBuild, projectIndex);
+                            action.description = !it->customBuild.message.empty () ?
+                                it->customBuild.message : "Building " + it->name;
+                            action.program = "/bin/sh";
+                            action.arguments.push_back ("-c");
+                            action.arguments.push_back (it->customBuild.recipe);
+                            action.inputs.push_back (it->path);
+                            action.inputs.insert (
+                                action.inputs.end (),
+                                it->customBuild.dependencies.begin (),
+                                it->customBuild.dependencies.end ());
+                            action.outputs = it->customBuild.outputs;
+                            customBuilds.push_back (AddAction (action, dependencies));
+                        }
+                    }
+                }
+                std::vector<util::ui32> compileDependencies = dependencies;
+                compileDependencies.insert (
+                    compileDependencies.end (),
+                    customBuilds.begin (),
+                    customBuilds.end ());
+                std::vector<util::ui32> compiles;
+                std::vector<std::string> objects;
+                bool cpp = false;
+                for (std::vector<BuildGraph::Language>::const_iterator
+                        it = project.languages.begin (),
+                        end = project.languages.end (); it != end; ++it) {
+                    if (it->sources.empty ()) {
+                        continue;
+                    }
+                    std::string compiler;
+                    if (it->name == "c" || it->name == "objective_c") {
+                        compiler = toolset.cc;
+                    }
+                    else if (it->name == "cpp" || it->name == "objective_cpp") {
+                        compiler = toolset.cxx;
+                        cpp = true;
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "%s: %s sources are not supported by the native executor.",
+                            project.project_root.c_str (),
+                            it->name.c_str ());
+                    }
+                    // Projects that precompile the same header the same way
+                    // share it (see PrecompiledHeaderCache.h).
+                    std::vector<util::ui32> sourceDependencies = compileDependencies;
+                    std::string stubHeader;
+                    std::string header = GetPrecompiledHeader (project, *it);
+                    if (!header.empty ()) {
+                        sourceDependencies.push_back (
+                            AddPrecompiledHeader (
+                                project, *it, header, compiler, compileDependencies, stubHeader));
+                    }
+                    for (std::vector<BuildGraph::File>::const_iterator
+                            jt = it->sources.begin (),
+                            end = it->sources.end (); jt != end; ++jt) {
+                        // Custom build sources produce their outputs above.
+                        if (jt->hasCustomBuild) {
+                            continue;
+                        }
+                        std::string object = GetObjectPath (objectRoot, *jt);
+                        Action action (Action::Compile, projectIndex);
+                        action.description = "Compiling " + jt->path;
+                        action.program = compiler;
+                        AddCompilerArguments (project, *it, action);
+                        if (!stubHeader.empty ()) {
+                            action.arguments.push_back ("-include");
+                            action.arguments.push_back (stubHeader);
+                        }
+                        action.depfile = object + ".d";
+                        action.arguments.push_back ("-MD");
+                        action.arguments.push_back ("-MF");
+                        action.arguments.push_back (action.depfile);
+                        action.arguments.push_back ("-c");
+                        action.arguments.push_back (jt->path);
+                        action.arguments.push_back ("-o");
+                        action.arguments.push_back (object);
+                        action.inputs.push_back (jt->path);
+                        action.inputs.insert (
+                            action.inputs.end (),
+                            jt->unity_files.begin (),
+                            jt->unity_files.end ());
+                        action.outputs.push_back (object);
+                        compiles.push_back (AddAction (action, sourceDependencies));
+                        objects.push_back (object);
+                    }
+                }
+                if (!project.goal.empty () && !objects.empty ()) {
+                    std::vector<util::ui32> goalDependencies = dependencies;
+                    goalDependencies.insert (
+                        goalDependencies.end (),
+                        compiles.begin (),
+                        compiles.end ());
+                    if (project.project_type == PROJECT_TYPE_LIBRARY && project.type == TYPE_STATIC) {
+                        Action action (Action::Archive, projectIndex);
+                        action.description = "Archiving " + project.goal;
+                        action.program = toolset.ar;
+                        action.arguments.push_back ("rcs");
+                        action.arguments.push_back (project.goal);
+                        action.arguments.insert (action.arguments.end (), objects.begin (), objects.end ());
+                        action.inputs = objects;
+                        action.outputs.push_back (project.goal);
+                        completionActions[projectIndex].push_back (AddAction (action, goalDependencies));
+                    }
+                    else {
+                        Action action (Action::Link, projectIndex);
+                        action.description = "Linking " + project.goal;
+                        action.program = cpp ? toolset.cxx : toolset.cc;
+                        if (project.project_type != PROJECT_TYPE_PROGRAM) {
+                        #if defined (TOOLCHAIN_OS_OSX)
+                            action.arguments.push_back ("-dynamiclib");
+                        #else // defined (TOOLCHAIN_OS_OSX)
+                            action.arguments.push_back ("-shared");
+                        #endif // defined (TOOLCHAIN_OS_OSX)
+                        }
+                        action.arguments.push_back ("-o");
+                        action.arguments.push_back (project.goal);
+                        action.arguments.insert (action.arguments.end (), objects.begin (), objects.end ());
+                        action.arguments.insert (
+                            action.arguments.end (),
+                            project.link_libraries.begin (),
+                            project.link_libraries.end ());
+                        action.arguments.insert (
+                            action.arguments.end (),
+                            project.linker_flags.begin (),
+                            project.linker_flags.end ());
+                        action.inputs = objects;
+                        action.inputs.insert (
+                            action.inputs.end (),
+                            project.link_libraries.begin (),
+                            project.link_libraries.end ());
+                        action.outputs.push_back (project.goal);
+                        completionActions[projectIndex].push_back (AddAction (action, goalDependencies));
+                    }
+                }
+                else {
+                    completionActions[projectIndex] = dependencies;
+                    completionActions[projectIndex].insert (
+                        completionActions[projectIndex].end (),
+                        customBuilds.begin (),
+                        customBuilds.end ());
+                }
+            }
+
+            std::string Executor::GetPrecompiledHeader (
+                    const BuildGraph::Project &project,
+                    const BuildGraph::Language &language) {
+                // Objective-c(pp) sources can't use a c(pp) precompiled header.
+                if (project.precompiled_header.type == thekogans_make::PrecompiledHeader::None ||
+                        (language.name != "c" && language.name != "cpp")) {
+                    return std::string ();
+                }
+                if (project.precompiled_header.automatic) {
+                    util::ui32 projectIndex = (util::ui32)(&project - &graph.projects[0]);
+                    PrecompiledHeaderAdvisor::ParseCosts costs;
+                    PrecompiledHeaderAdvisor::LoadTimeTraces (
+                        MakePath (project.build_root, "native"), costs);
+                    std::vector<PrecompiledHeaderAdvisor::Candidate> candidates;
+                    std::size_t sourceCount = PrecompiledHeaderAdvisor::GetCandidates (
+                        language.sources,
+                        includeDirectories[projectIndex],
+                        includeScanner,
+                        costs,
+                        candidates);
+                    std::vector<std::string> headers;
+                    PrecompiledHeaderAdvisor::GetRecommended (
+                        candidates,
+                        sourceCount,
+                        project.project_root,
+                        includeDirectories[projectIndex],
+                        includeScanner,
+                        headers);
+                    if (headers.empty ()) {
+                        return std::string ();
+                    }
+                    std::string header = MakePath (
+                        project.build_root,
+                        "precompiled_header_" + language.name + ".h");
+                    PrecompiledHeaderAdvisor::WriteHeader (header, headers);
+                    return header;
+                }
+                if (project.precompiled_header.file.empty ()) {
+                    return std::string ();
+                }
+                return util::Path (project.precompiled_header.file).IsAbsolute () ?
+                    project.precompiled_header.file :
+                    MakePath (project.project_root, project.precompiled_header.file);
+            }
+
+            util::ui32 Executor::AddPrecompiledHeader (
+                    const BuildGraph::Project &project,
+                    const BuildGraph::Language &language,
+                    const std::string &header,
+                    const std::string &compiler,
+                    const std::vector<util::ui32> &dependencies,
+                    std::string &stubHeader) {
+                util::ui32 projectIndex = (util::ui32)(&project - &graph.projects[0]);
+                Action action (Action::Compile, projectIndex);
+                action.program = compiler;
+                AddCompilerArguments (project, language, action);
+                std::string key = PrecompiledHeaderCache::GetKey (
+                    header,
+                    compiler,
+                    action.arguments,
+                    includeDirectories[projectIndex],
+                    includeScanner);
+                stubHeader = PrecompiledHeaderCache::GetStubHeader (key, header);
+                std::map<std::string, util::ui32>::const_iterator it =
+                    precompiledHeaders.find (key);
+                if (it != precompiledHeaders.end ()) {
+                    return it->second;
+                }
+                PrecompiledHeaderCache::CreateStubHeader (key, header);
+                std::string precompiledHeader =
+                    PrecompiledHeaderCache::GetPrecompiledHeader (key, header);
+                action.description = "Precompiling " + header;
+                // The .gch is shared by every build (and every root)
+                // that arrives at the same key. Their command lines
+                // differ (-I), so log it under the key, and compile
+                // to a per process temporary so that concurrent builds
+                // never read (or write) a half written file.
+                action.hash = key;
+                action.depfile = precompiledHeader + ".d";
+                std::string suffix = "." + util::ui32Tostring (GetProcessId ()) + ".tmp";
+                std::string temporaryDepfile = action.depfile + suffix;
+                std::string temporaryPrecompiledHeader = precompiledHeader + suffix;
+                action.temporaries[temporaryDepfile] = action.depfile;
+                action.temporaries[temporaryPrecompiledHeader] = precompiledHeader;
+                action.arguments.push_back ("-MD");
+                action.arguments.push_back ("-MF");
+                action.arguments.push_back (temporaryDepfile);
+                action.arguments.push_back ("-MT");
+                action.arguments.push_back (precompiledHeader);
+                action.arguments.push_back ("-x");
+                action.arguments.push_back (language.name == "c" ? "c-header" : "c++-header");
+                action.arguments.push_back (stubHeader);
+                action.arguments.push_back ("-o");
+                action.arguments.push_back (temporaryPrecompiledHeader);
+                action.inputs.push_back (header);
+                action.outputs.push_back (precompiledHeader);
+                util::ui32 index = AddAction (action, dependencies);
+                precompiledHeaders.insert (
+                    std::map<std::string, util::ui32>::value_type (key, index));
+                return index;
+            }
+
+            util::ui32 Executor::AddAction (
+                    const Action &action,
+                    const std::vector<util::ui32> &dependencies) {
+                util::ui32 index = (util::ui32)actions.size ();
+                actions.push_back (action);
+                const BuildGraph::Project &project = graph.projects[action.project];
+                std::string variant;
+                if (GetMemoryVariant (project, action, variant)) {
+                    actions.back ().memory = BuildHistory::Instance ().GetMaxRSS (
+                        project.project_root,
+                        variant,
+                        action.type == Action::Link ?
+                            ResourceBudget::DEFAULT_LINK_MEMORY :
+                            ResourceBudget::DEFAULT_COMPILE_MEMORY);
+                }
+                std::vector<util::ui32> &dependencies_ = actions.back ().dependencies;
+                dependencies_ = dependencies;
+                std::sort (dependencies_.begin (), dependencies_.end ());
+                dependencies_.erase (
+                    std::unique (dependencies_.begin (), dependencies_.end ()),
+                    dependencies_.end ());
+                for (std::vector<util::ui32>::const_iterator
+                        it = dependencies_.begin (),
+                        end = dependencies_.end (); it != end; ++it) {
+                    actions[*it].dependents.push_back (index);
+                }
+                return index;
+            }
+
+            void Executor::Load (util::ui64 maxActionLogFileSize) {
+                if (util::Path (path).Exists ()) {
+                    util::ReadOnlyFile file (util::HostEndian, path);
+                    // Protect yourself.
+                    util::ui64 fileSize = file.GetSize ();
+                    if (fileSize > maxActionLogFileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "'%s' is bigger (" THEKOGANS_UTIL_UI64_FORMAT ") than expected. (" THEKOGANS_UTIL_UI64_FORMAT ")",
+                            path.c_str (),
+                            fileSize,
+                            maxActionLogFileSize);
+                    }
+                    util::Buffer buffer (util::HostEndian, (util::ui32)fileSize);
+                    if (buffer.AdvanceWriteOffset (
+                            file.Read (
+                                buffer.GetWritePtr (),
+                                (util::ui32)fileSize)) != (util::ui32)fileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to read " THEKOGANS_UTIL_UI64_FORMAT " bytes from '%s'.",
+                            fileSize,
+                            path.c_str ());
+                    }
+                    pugi::xml_document document;
+                    pugi::xml_parse_result result =
+                        document.load_buffer (
+                            buffer.GetReadPtr (),
+                            buffer.GetDataAvailableForReading ());
+                    if (!result) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to parse %s (%s)",
+                            path.c_str (),
+                            result.description ());
+                    }
+                    pugi::xml_node node = document.document_element ();
+                    if (std::string (node.name ()) == TAG_ACTION_LOG) {
+                        ParseActionLog (node);
+                    }
+                }
+            }
+
+            void Executor::ParseActionLog (pugi::xml_node &node) {
+                for (pugi::xml_node child = node.first_child ();
+                        !child.empty (); child = child.next_sibling ()) {
+                    if (child.type () == pugi::node_element) {
+                        std::string childName = child.name ();
+                        if (childName == TAG_ENTRY) {
+                            std::string output =
+                                util::Decodestring (child.attribute (ATTR_OUTPUT).value ());
+                            std::string hash = child.attribute (ATTR_HASH).value ();
+                            if (!output.empty () && !hash.empty ()) {
+                                actionLog[output] = hash;
+                            }
+                        }
+                    }
+                }
+            }
+
+            void Executor::Save () {
+                std::lock_guard<std::mutex> guard (mutex);
+                if (modified) {
+                    util::Directory::Create (util::Path (path).GetDirectory ());
+                    std::fstream actionLogFile (
+                        path.c_str (),
+                        std::fstream::out | std::fstream::trunc);
+                    if (actionLogFile.is_open ()) {
+                        util::Attributes attributes;
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_SCHEMA_VERSION,
+                                util::ui32Tostring (ACTION_LOG_XML_SCHEMA_VERSION)));
+                        actionLogFile << util::OpenTag (0, TAG_ACTION_LOG, attributes, false, true);
+                        for (ActionLog::const_iterator
+                                 it = actionLog.begin (),
+                                 end = actionLog.end (); it != end; ++it) {
+                            util::Attributes attributes;
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_OUTPUT,
+                                    util::EncodeXMLCharEntities (it->first)));
+                            attributes.push_back (util::Attribute (ATTR_HASH, it->second));
+                            actionLogFile << util::OpenTag (1, TAG_ENTRY, attributes, true, true);
+                        }
+                        actionLogFile << util::CloseTag (0, TAG_ACTION_LOG);
+                        modified = false;
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to open: %s.",
+                            path.c_str ());
+                    }
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
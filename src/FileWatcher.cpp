@@ -0,0 +1,130 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/FileWatcher.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const util::ui32 WATCH_MASK =
+                    IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                    IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+                const std::size_t EVENT_BUFFER_SIZE = 64 * 1024;
+            }
+
+            FileWatcher::FileWatcher () :
+                    handle (inotify_init1 (IN_NONBLOCK | IN_CLOEXEC)) {
+                if (handle < 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+            }
+
+            FileWatcher::~FileWatcher () {
+                close (handle);
+            }
+
+            void FileWatcher::AddDirectory (const std::string &directory) {
+                if (!IsWatched (directory)) {
+                    int watch = inotify_add_watch (handle, directory.c_str (), WATCH_MASK);
+                    if (watch < 0) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                    directories[watch] = directory;
+                    watchedDirectories.insert (directory);
+                }
+            }
+
+            void FileWatcher::Clear () {
+                for (Directories::const_iterator
+                        it = directories.begin (),
+                        end = directories.end (); it != end; ++it) {
+                    inotify_rm_watch (handle, it->first);
+                }
+                directories.clear ();
+                watchedDirectories.clear ();
+            }
+
+            bool FileWatcher::Wait (util::i32 timeout) const {
+                pollfd fd;
+                fd.fd = handle;
+                fd.events = POLLIN;
+                fd.revents = 0;
+                int result;
+                do {
+                    result = poll (&fd, 1, timeout);
+                } while (result < 0 && errno == EINTR);
+                if (result < 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+                return result > 0;
+            }
+
+            bool FileWatcher::Read (std::set<std::string> &paths) {
+                bool result = true;
+                // inotify_event needs to be properly aligned.
+                alignas (inotify_event) char buffer[EVENT_BUFFER_SIZE];
+                while (1) {
+                    ssize_t count = read (handle, buffer, EVENT_BUFFER_SIZE);
+                    if (count < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                            break;
+                        }
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                    for (char *ptr = buffer; ptr < buffer + count;) {
+                        const inotify_event *event = (const inotify_event *)ptr;
+                        if ((event->mask & IN_Q_OVERFLOW) != 0) {
+                            result = false;
+                        }
+                        else if ((event->mask & IN_IGNORED) != 0) {
+                            // The directory was deleted (or unmounted).
+                            Directories::iterator it = directories.find (event->wd);
+                            if (it != directories.end ()) {
+                                watchedDirectories.erase (it->second);
+                                directories.erase (it);
+                            }
+                        }
+                        else if (event->len > 0) {
+                            Directories::const_iterator it = directories.find (event->wd);
+                            if (it != directories.end ()) {
+                                paths.insert (MakePath (it->second, event->name));
+                            }
+                        }
+                        ptr += sizeof (inotify_event) + event->len;
+                    }
+                }
+                return result;
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,272 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <fstream>
+#include <sstream>
+#include <list>
+#include <set>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/SHA2.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Version.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/thekogans_make.h"
+#include "thekogans/make/core/Fingerprint.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                std::string Hash (const std::string &inputs) {
+                    util::Hash::Digest digest;
+                    util::SHA2 hasher;
+                    hasher.FromBuffer (inputs.data (), inputs.size (), util::SHA2::DIGEST_SIZE_256, digest);
+                    return util::Hash::DigestTostring (digest);
+                }
+
+                template<typename Container>
+                void Write (
+                        std::ostream &stream,
+                        const char *name,
+                        const Container &values) {
+                    stream << name << ":";
+                    for (typename Container::const_iterator
+                            it = values.begin (),
+                            end = values.end (); it != end; ++it) {
+                        stream << " " << *it;
+                    }
+                    stream << "\n";
+                }
+
+                std::string GetToolchainInputs (
+                        const std::string &generator,
+                        const std::string &generatorVersion) {
+                    std::ostringstream stream;
+                    stream <<
+                        "make_core: " << GetVersion ().ToString () << "\n" <<
+                        "generator: " << generator << " " << generatorVersion << "\n" <<
+                        "DEVELOPMENT_ROOT: " << _DEVELOPMENT_ROOT << "\n" <<
+                        "TOOLCHAIN_ROOT: " << _TOOLCHAIN_ROOT << "\n" <<
+                        "TOOLCHAIN_OS: " << _TOOLCHAIN_OS << "\n" <<
+                        "TOOLCHAIN_ARCH: " << _TOOLCHAIN_ARCH << "\n" <<
+                        "TOOLCHAIN_COMPILER: " << _TOOLCHAIN_COMPILER << "\n" <<
+                        "TOOLCHAIN_TRIPLET: " << _TOOLCHAIN_TRIPLET << "\n" <<
+                        "TOOLCHAIN_BRANCH: " << _TOOLCHAIN_BRANCH << "\n" <<
+                        "TOOLCHAIN_NAMING_CONVENTION: " << _TOOLCHAIN_NAMING_CONVENTION << "\n" <<
+                        "TOOLCHAIN_PROGRAM_SUFFIX: " << _TOOLCHAIN_PROGRAM_SUFFIX << "\n" <<
+                        "TOOLCHAIN_SHARED_LIBRARY_SUFFIX: " << _TOOLCHAIN_SHARED_LIBRARY_SUFFIX << "\n" <<
+                        "TOOLCHAIN_STATIC_LIBRARY_SUFFIX: " << _TOOLCHAIN_STATIC_LIBRARY_SUFFIX << "\n";
+                    return stream.str ();
+                }
+
+                std::string ComputeHelper (
+                        const thekogans_make &config,
+                        const std::string &toolchainInputs,
+                        bool dependencies,
+                        Fingerprint::Map &fingerprints,
+                        std::map<std::string, std::string> &computed) {
+                    std::string configKey = GetConfigKey (
+                        config.project_root,
+                        config.config_file,
+                        config.generator,
+                        config.config,
+                        config.type);
+                    std::map<std::string, std::string>::const_iterator it = computed.find (configKey);
+                    if (it != computed.end ()) {
+                        return it->second;
+                    }
+                    std::ostringstream stream;
+                    stream << toolchainInputs <<
+                        "project_root: " << config.project_root << "\n" <<
+                        "config_file: " << GetFileHash (MakePath (config.project_root, config.config_file)) << "\n" <<
+                        "variant: " << config.generator << " " << config.config << " " << config.type << "\n" <<
+                        "version: " << config.GetVersion () << "\n" <<
+                        "project_type: " << config.project_type << "\n" <<
+                        "naming_convention: " << config.naming_convention << "\n";
+                    Write (stream, "features", config.features);
+                    // Regular expression file lists are expanded at parse time.
+                    // A new file matching one is a change.
+                    std::set<std::string> files;
+                    config.GetFiles (files);
+                    Write (stream, "files", files);
+                    std::set<std::string> include_directories;
+                    config.GetIncludeDirectories (include_directories);
+                    Write (stream, "include_directories", include_directories);
+                    std::list<std::string> link_libraries;
+                    config.GetLinkLibraries (link_libraries);
+                    Write (stream, "link_libraries", link_libraries);
+                    std::set<std::string> shared_libraries;
+                    config.GetSharedLibraries (shared_libraries);
+                    Write (stream, "shared_libraries", shared_libraries);
+                    std::list<std::string> preprocessor_definitions;
+                    config.GetCommonPreprocessorDefinitions (preprocessor_definitions);
+                    Write (stream, "common_preprocessor_definitions", preprocessor_definitions);
+                    Write (stream, "linker_flags", config.linker_flags);
+                    Write (stream, "librarian_flags", config.librarian_flags);
+                    Write (stream, "c_flags", config.c_flags);
+                    Write (stream, "c_preprocessor_definitions", config.c_preprocessor_definitions);
+                    Write (stream, "cpp_flags", config.cpp_flags);
+                    Write (stream, "cpp_preprocessor_definitions", config.cpp_preprocessor_definitions);
+                    Write (stream, "objective_c_flags", config.objective_c_flags);
+                    Write (stream, "objective_cpp_flags", config.objective_cpp_flags);
+                    Write (stream, "masm_flags", config.masm_flags);
+                    Write (stream, "nasm_flags", config.nasm_flags);
+                    Write (stream, "rc_flags", config.rc_flags);
+                    const std::list<thekogans_make::Dependency::Ptr> *dependencyLists[] = {
+                        &config.dependencies,
+                        &config.plugin_hosts
+                    };
+                    for (std::size_t i = 0; i < 2; ++i) {
+                        for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
+                                jt = dependencyLists[i]->begin (),
+                                end = dependencyLists[i]->end (); jt != end; ++jt) {
+                            stream << "dependency: " << (*jt)->ToString () << "\n";
+                            if ((*jt)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                                stream << "fingerprint: " << ComputeHelper (
+                                    thekogans_make::GetConfig (
+                                        (*jt)->GetProjectRoot (),
+                                        (*jt)->GetConfigFile (),
+                                        (*jt)->GetGenerator (),
+                                        (*jt)->GetConfig (),
+                                        (*jt)->GetType ()),
+                                    toolchainInputs,
+                                    dependencies,
+                                    fingerprints,
+                                    computed) << "\n";
+                            }
+                        }
+                    }
+                    std::string fingerprint = Hash (stream.str ());
+                    computed[configKey] = fingerprint;
+                    if (dependencies) {
+                        fingerprints[
+                            Fingerprint::GetPath (
+                                config.project_root,
+                                config.generator,
+                                config.config,
+                                config.type)] = fingerprint;
+                    }
+                    return fingerprint;
+                }
+            }
+
+            std::string Fingerprint::GetPath (
+                    const std::string &project_root,
+                    const std::string &generator,
+                    const std::string &config,
+                    const std::string &type) {
+                return MakePath (GetBuildRoot (project_root, generator, config, type), FINGERPRINT_FILE);
+            }
+
+            std::string Fingerprint::Compute (
+                    const std::string &project_root,
+                    const std::string &generator,
+                    const std::string &generatorVersion,
+                    const std::string &config,
+                    const std::string &type,
+                    bool dependencies,
+                    Map &fingerprints) {
+                std::map<std::string, std::string> computed;
+                std::string fingerprint = ComputeHelper (
+                    thekogans_make::GetConfig (
+                        project_root,
+                        THEKOGANS_MAKE_XML,
+                        generator,
+                        config,
+                        type),
+                    GetToolchainInputs (generator, generatorVersion),
+                    dependencies,
+                    fingerprints,
+                    computed);
+                fingerprints[GetPath (project_root, generator, config, type)] = fingerprint;
+                return fingerprint;
+            }
+
+            std::string Fingerprint::Load (const std::string &path) {
+                std::string fingerprint;
+                std::ifstream file (ToSystemPath (path).c_str ());
+                if (file.is_open ()) {
+                    std::getline (file, fingerprint);
+                }
+                return util::TrimSpaces (fingerprint.c_str ());
+            }
+
+            bool Fingerprint::IsUpToDate (
+                    const std::string &path,
+                    const std::string &fingerprint,
+                    const std::string &outputFile) {
+                if (Load (path) != fingerprint) {
+                    return false;
+                }
+                // A matching fingerprint is no good if the build
+                // system it describes was deleted behind our back.
+                if (!outputFile.empty ()) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                    return util::Path (
+                        ToSystemPath (
+                            MakePath (util::Path (path).GetDirectory (), outputFile))).Exists ();
+                }
+                return true;
+            }
+
+            bool Fingerprint::IsUpToDate (
+                    const Map &fingerprints,
+                    const std::string &outputFile) {
+                for (Map::const_iterator
+                        it = fingerprints.begin (),
+                        end = fingerprints.end (); it != end; ++it) {
+                    if (!IsUpToDate (it->first, it->second, outputFile)) {
+                        return false;
+                    }
+                }
+                return !fingerprints.empty ();
+            }
+
+            void Fingerprint::Save (const Map &fingerprints) {
+                for (Map::const_iterator
+                        it = fingerprints.begin (),
+                        end = fingerprints.end (); it != end; ++it) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                    if (util::Path (ToSystemPath (util::Path (it->first).GetDirectory ())).Exists ()) {
+                        std::ofstream file (
+                            ToSystemPath (it->first).c_str (),
+                            std::ofstream::out | std::ofstream::trunc);
+                        if (file.is_open ()) {
+                            file << it->second << std::endl;
+                        }
+                        else {
+                            THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                                "Unable to open: %s.",
+                                it->first.c_str ());
+                        }
+                    }
+                }
+            }
+
+            void Fingerprint::Delete (const std::string &path) {
+                std::string systemPath = ToSystemPath (path);
+                if (util::Path (systemPath).Exists ()) {
+                    util::Path (systemPath).Delete ();
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -20,6 +20,7 @@
 #include "thekogans/util/Exception.h"
 #include "thekogans/make/core/thekogans_make.h"
 #include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Stats.h"
 #include "thekogans/make/core/Function.h"
 
 namespace thekogans {
@@ -298,10 +299,12 @@ namespace thekogans {
                 {
                     Map::iterator it = GetMap ().find (identifier.first);
                     if (it != GetMap ().end ()) {
+                        Stats::Instance ().AddFunctionCall (it->first);
                         UniquePtr function = it->second ();
                         result = function->Exec (config, parameters);
                     }
                     else if (parameters.empty ()) {
+                        THEKOGANS_MAKE_CORE_STATS_INCREMENT (SYMBOL_LOOKUPS);
                         result = config.LookupSymbol (identifier.first);
                         if (identifier.second != util::NIDX32) {
                             result = identifier.second < result.value.size () ?
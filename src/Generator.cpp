@@ -18,6 +18,7 @@
 #include <cassert>
 #include "thekogans/util/Exception.h"
 #include "thekogans/util/LoggerMgr.h"
+#include "thekogans/make/core/BuildGraph.h"
 #include "thekogans/make/core/Generator.h"
 
 namespace thekogans {
@@ -54,6 +55,14 @@ namespace thekogans {
                 }
             }
 
+            bool Generator::GenerateFromGraph (
+                    const BuildGraph &graph,
+                    bool generateDependencies,
+                    bool force) {
+                const BuildGraph::Project &root = graph.GetRoot ();
+                return Generate (root.project_root, root.config, root.type, generateDependencies, force);
+            }
+
             void Generator::GetGenerators (std::list<std::string> &generators) {
                 for (Map::const_iterator it = GetMap ().begin (),
                         end = GetMap ().end (); it != end; ++it) {
@@ -0,0 +1,425 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <fstream>
+#include <list>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/File.h"
+#include "thekogans/util/Buffer.h"
+#include "thekogans/util/Directory.h"
+#include "thekogans/util/SHA2.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/XMLUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/IncludeScanner.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const TAG_INCLUDE_CACHE = "include_cache";
+                const char * const ATTR_SCHEMA_VERSION = "schema_version";
+
+                const char * const TAG_ENTRY = "entry";
+                const char * const ATTR_PATH = "path";
+                const char * const ATTR_LAST_MODIFIED = "last_modified";
+                const char * const ATTR_HASH = "hash";
+
+                const char * const TAG_INCLUDE = "include";
+                const char * const ATTR_NAME = "name";
+
+                const util::ui32 INCLUDE_CACHE_XML_SCHEMA_VERSION = 1;
+
+                inline bool IsSpace (char ch) {
+                    return ch == ' ' || ch == '\t';
+                }
+
+                inline bool Match (
+                        const char *&ptr,
+                        const char *end,
+                        const char *keyword,
+                        std::size_t length) {
+                    if ((std::size_t)(end - ptr) > length &&
+                            memcmp (ptr, keyword, length) == 0 &&
+                            (IsSpace (ptr[length]) || ptr[length] == '"' || ptr[length] == '<')) {
+                        ptr += length;
+                        return true;
+                    }
+                    return false;
+                }
+
+                // Remove . and .. components so that the same
+                // header reached through different paths is
+                // only scanned once.
+                std::string Normalize (const std::string &path) {
+                    if (path.find (PATH_SEPARATOR_CHAR + std::string (".")) == std::string::npos) {
+                        return path;
+                    }
+                    std::list<std::string> components;
+                    std::string::size_type start = 0;
+                    while (start <= path.size ()) {
+                        std::string::size_type end = path.find (PATH_SEPARATOR_CHAR, start);
+                        if (end == std::string::npos) {
+                            end = path.size ();
+                        }
+                        std::string component = path.substr (start, end - start);
+                        if (component == "..") {
+                            if (!components.empty () && components.back () != "..") {
+                                components.pop_back ();
+                            }
+                            else {
+                                components.push_back (component);
+                            }
+                        }
+                        else if (!component.empty () && component != ".") {
+                            components.push_back (component);
+                        }
+                        start = end + 1;
+                    }
+                    return MakePath (components, path[0] == PATH_SEPARATOR_CHAR);
+                }
+
+                bool GetLastModifiedDate (
+                        const std::string &path,
+                        util::i64 &lastModifiedDate) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                    std::string systemPath = ToSystemPath (path);
+                    if (util::Path (systemPath).Exists ()) {
+                        lastModifiedDate = util::Directory::Entry (systemPath).lastModifiedDate;
+                        return true;
+                    }
+                    return false;
+                }
+            }
+
+            IncludeScanner::IncludeScanner (const std::string &path_) :
+                    path (ToSystemPath (path_)),
+                    modified (false) {
+                // A corrupt cache only costs us a rescan.
+                THEKOGANS_UTIL_TRY {
+                    Load ();
+                }
+                THEKOGANS_UTIL_CATCH (util::Exception) {
+                    THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                    entries.clear ();
+                }
+            }
+
+            std::string IncludeScanner::GetDefaultPath () {
+                return MakePath (_TOOLCHAIN_ROOT, INCLUDE_CACHE_XML);
+            }
+
+            void IncludeScanner::ScanBuffer (
+                    const char *begin,
+                    const char *end,
+                    std::vector<std::string> &includes) {
+                const char *ptr = begin;
+                while (ptr < end) {
+                    const char *hash = (const char *)memchr (ptr, '#', end - ptr);
+                    if (hash == 0) {
+                        break;
+                    }
+                    ptr = hash + 1;
+                    // Only white space is allowed between
+                    // the start of the line and the '#'.
+                    const char *lineStart = hash;
+                    while (lineStart > begin && IsSpace (lineStart[-1])) {
+                        --lineStart;
+                    }
+                    if (lineStart != begin && lineStart[-1] != '\n') {
+                        continue;
+                    }
+                    while (ptr < end && IsSpace (*ptr)) {
+                        ++ptr;
+                    }
+                    if (!Match (ptr, end, "include", 7) && !Match (ptr, end, "import", 6)) {
+                        continue;
+                    }
+                    while (ptr < end && IsSpace (*ptr)) {
+                        ++ptr;
+                    }
+                    if (ptr < end && (*ptr == '"' || *ptr == '<')) {
+                        char delimiter = *ptr == '"' ? '"' : '>';
+                        const char *lineEnd = (const char *)memchr (ptr, '\n', end - ptr);
+                        if (lineEnd == 0) {
+                            lineEnd = end;
+                        }
+                        const char *nameEnd = (const char *)memchr (ptr + 1, delimiter, lineEnd - ptr - 1);
+                        if (nameEnd != 0 && nameEnd > ptr + 1) {
+                            includes.push_back (std::string (ptr, nameEnd));
+                        }
+                        ptr = lineEnd;
+                    }
+                }
+            }
+
+            bool IncludeScanner::Scan (
+                    const std::string &file,
+                    Entry &entry) {
+                {
+                    std::lock_guard<std::mutex> guard (mutex);
+                    if (validated.find (file) != validated.end ()) {
+                        entry = entries[file];
+                        return true;
+                    }
+                }
+                util::i64 lastModified;
+                if (!GetLastModifiedDate (file, lastModified)) {
+                    std::lock_guard<std::mutex> guard (mutex);
+                    existing[file] = false;
+                    return false;
+                }
+                {
+                    std::lock_guard<std::mutex> guard (mutex);
+                    existing[file] = true;
+                    Entries::const_iterator it = entries.find (file);
+                    if (it != entries.end () && it->second.lastModified == lastModified) {
+                        validated.insert (file);
+                        entry = it->second;
+                        return true;
+                    }
+                }
+                // Read and scan outside the lock.
+                std::ifstream stream (ToSystemPath (file).c_str (), std::ios::in | std::ios::binary);
+                if (!stream.is_open ()) {
+                    return false;
+                }
+                std::string contents (
+                    (std::istreambuf_iterator<char> (stream)),
+                    std::istreambuf_iterator<char> ());
+                Entry scanned;
+                scanned.lastModified = lastModified;
+                {
+                    util::Hash::Digest digest;
+                    util::SHA2 hasher;
+                    hasher.FromBuffer (contents.data (), contents.size (), util::SHA2::DIGEST_SIZE_256, digest);
+                    scanned.hash = util::Hash::DigestTostring (digest);
+                }
+                ScanBuffer (contents.data (), contents.data () + contents.size (), scanned.includes);
+                std::lock_guard<std::mutex> guard (mutex);
+                entries[file] = scanned;
+                validated.insert (file);
+                modified = true;
+                entry = scanned;
+                return true;
+            }
+
+            std::string IncludeScanner::GetHash (const std::string &file) {
+                Entry entry;
+                return Scan (file, entry) ? entry.hash : std::string ();
+            }
+
+            void IncludeScanner::GetDependencies (
+                    const std::string &file,
+                    const std::vector<std::string> &includeDirectories,
+                    std::set<std::string> &dependencies,
+                    std::set<std::string> *unresolved) {
+                std::vector<std::string> pending (1, file);
+                std::set<std::string> visited;
+                visited.insert (file);
+                while (!pending.empty ()) {
+                    std::string current = pending.back ();
+                    pending.pop_back ();
+                    Entry entry;
+                    if (!Scan (current, entry)) {
+                        continue;
+                    }
+                    std::string directory = util::Path (current).GetDirectory ();
+                    for (std::vector<std::string>::const_iterator
+                            it = entry.includes.begin (),
+                            end = entry.includes.end (); it != end; ++it) {
+                        std::string name = it->substr (1);
+                        std::string resolved;
+                        if (name[0] == PATH_SEPARATOR_CHAR) {
+                            if (Exists (name)) {
+                                resolved = Normalize (name);
+                            }
+                        }
+                        // "" includes look in the including file's directory first.
+                        else if ((*it)[0] == '"') {
+                            std::string candidate = Normalize (MakePath (directory, name));
+                            if (Exists (candidate)) {
+                                resolved = candidate;
+                            }
+                        }
+                        for (std::size_t i = 0, count = includeDirectories.size ();
+                                resolved.empty () && i < count; ++i) {
+                            std::string candidate = Normalize (MakePath (includeDirectories[i], name));
+                            if (Exists (candidate)) {
+                                resolved = candidate;
+                            }
+                        }
+                        if (!resolved.empty ()) {
+                            if (visited.insert (resolved).second) {
+                                dependencies.insert (resolved);
+                                pending.push_back (resolved);
+                            }
+                        }
+                        else if (unresolved != 0) {
+                            unresolved->insert (*it + ((*it)[0] == '<' ? ">" : "\""));
+                        }
+                    }
+                }
+            }
+
+            bool IncludeScanner::Exists (const std::string &file) {
+                {
+                    std::lock_guard<std::mutex> guard (mutex);
+                    std::map<std::string, bool>::const_iterator it = existing.find (file);
+                    if (it != existing.end ()) {
+                        return it->second;
+                    }
+                }
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                bool exists = util::Path (ToSystemPath (file)).Exists ();
+                std::lock_guard<std::mutex> guard (mutex);
+                existing[file] = exists;
+                return exists;
+            }
+
+            void IncludeScanner::Save () {
+                std::lock_guard<std::mutex> guard (mutex);
+                if (modified) {
+                    util::Directory::Create (util::Path (path).GetDirectory ());
+                    std::fstream includeCacheFile (
+                        path.c_str (),
+                        std::fstream::out | std::fstream::trunc);
+                    if (includeCacheFile.is_open ()) {
+                        util::Attributes attributes;
+                        attributes.push_back (
+                            util::Attribute (
+                                ATTR_SCHEMA_VERSION,
+                                util::ui32Tostring (INCLUDE_CACHE_XML_SCHEMA_VERSION)));
+                        includeCacheFile << util::OpenTag (0, TAG_INCLUDE_CACHE, attributes, false, true);
+                        for (Entries::const_iterator
+                                 it = entries.begin (),
+                                 end = entries.end (); it != end; ++it) {
+                            util::Attributes attributes;
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_PATH,
+                                    util::EncodeXMLCharEntities (it->first)));
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_LAST_MODIFIED,
+                                    util::ui64Tostring ((util::ui64)it->second.lastModified)));
+                            attributes.push_back (util::Attribute (ATTR_HASH, it->second.hash));
+                            includeCacheFile << util::OpenTag (
+                                1, TAG_ENTRY, attributes, it->second.includes.empty (), true);
+                            if (!it->second.includes.empty ()) {
+                                for (std::vector<std::string>::const_iterator
+                                        jt = it->second.includes.begin (),
+                                        end = it->second.includes.end (); jt != end; ++jt) {
+                                    util::Attributes attributes;
+                                    attributes.push_back (
+                                        util::Attribute (
+                                            ATTR_NAME,
+                                            util::EncodeXMLCharEntities (*jt)));
+                                    includeCacheFile << util::OpenTag (2, TAG_INCLUDE, attributes, true, true);
+                                }
+                                includeCacheFile << util::CloseTag (1, TAG_ENTRY);
+                            }
+                        }
+                        includeCacheFile << util::CloseTag (0, TAG_INCLUDE_CACHE);
+                        modified = false;
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to open: %s.",
+                            path.c_str ());
+                    }
+                }
+            }
+
+            void IncludeScanner::Load (util::ui64 maxIncludeCacheFileSize) {
+                if (util::Path (path).Exists ()) {
+                    util::ReadOnlyFile file (util::HostEndian, path);
+                    // Protect yourself.
+                    util::ui64 fileSize = file.GetSize ();
+                    if (fileSize > maxIncludeCacheFileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "'%s' is bigger (" THEKOGANS_UTIL_UI64_FORMAT ") than expected. (" THEKOGANS_UTIL_UI64_FORMAT ")",
+                            path.c_str (),
+                            fileSize,
+                            maxIncludeCacheFileSize);
+                    }
+                    util::Buffer buffer (util::HostEndian, (util::ui32)fileSize);
+                    if (buffer.AdvanceWriteOffset (
+                            file.Read (
+                                buffer.GetWritePtr (),
+                                (util::ui32)fileSize)) != (util::ui32)fileSize) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to read " THEKOGANS_UTIL_UI64_FORMAT " bytes from '%s'.",
+                            fileSize,
+                            path.c_str ());
+                    }
+                    pugi::xml_document document;
+                    pugi::xml_parse_result result =
+                        document.load_buffer (
+                            buffer.GetReadPtr (),
+                            buffer.GetDataAvailableForReading ());
+                    if (!result) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to parse %s (%s)",
+                            path.c_str (),
+                            result.description ());
+                    }
+                    pugi::xml_node node = document.document_element ();
+                    if (std::string (node.name ()) == TAG_INCLUDE_CACHE) {
+                        ParseIncludeCache (node);
+                    }
+                }
+            }
+
+            void IncludeScanner::ParseIncludeCache (pugi::xml_node &node) {
+                for (pugi::xml_node child = node.first_child ();
+                        !child.empty (); child = child.next_sibling ()) {
+                    if (child.type () == pugi::node_element) {
+                        std::string childName = child.name ();
+                        if (childName == TAG_ENTRY) {
+                            std::string path =
+                                util::Decodestring (child.attribute (ATTR_PATH).value ());
+                            if (!path.empty ()) {
+                                Entry &entry = entries[path];
+                                entry.lastModified =
+                                    (util::i64)util::stringToui64 (child.attribute (ATTR_LAST_MODIFIED).value ());
+                                entry.hash = child.attribute (ATTR_HASH).value ();
+                                for (pugi::xml_node include = child.first_child ();
+                                        !include.empty (); include = include.next_sibling ()) {
+                                    if (include.type () == pugi::node_element &&
+                                            std::string (include.name ()) == TAG_INCLUDE) {
+                                        std::string name =
+                                            util::Decodestring (include.attribute (ATTR_NAME).value ());
+                                        if (name.size () > 1) {
+                                            entry.includes.push_back (name);
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
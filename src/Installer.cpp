@@ -29,6 +29,8 @@
 #include "thekogans/make/core/Manifest.h"
 #include "thekogans/make/core/Project.h"
 #include "thekogans/make/core/Toolchain.h"
+#include "thekogans/make/core/BuildProgress.h"
+#include "thekogans/make/core/Console.h"
 #include "thekogans/make/core/Installer.h"
 
 namespace thekogans {
@@ -246,6 +248,7 @@ namespace thekogans {
             void Installer::InstallLibrary (const std::string &project_root) {
                 if (installedProjects.find (project_root) == installedProjects.end ()) {
                     installedProjects.insert (project_root);
+                    BuildProgress::Phase phase ("Installing " + project_root);
                     std::string install_config = config;
                     if (install_config.empty ()) {
                         install_config =
@@ -470,6 +473,7 @@ namespace thekogans {
             void Installer::InstallProgram (const std::string &project_root) {
                 if (installedProjects.find (project_root) == installedProjects.end ()) {
                     installedProjects.insert (project_root);
+                    BuildProgress::Phase phase ("Installing " + project_root);
                     std::string install_config = config;
                     if (install_config.empty ()) {
                         install_config =
@@ -529,8 +533,7 @@ namespace thekogans {
                         config.project,
                         config.GetVersion (),
                         false);
-                    std::cout << "Installing " << project_root << std::endl;
-                    std::cout.flush ();
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Installing " << project_root << std::endl);
                     // install = "yes"
                     std::set<InstallPaths> installPaths;
                     GetInstallPaths (config, installPaths);
@@ -559,8 +562,7 @@ namespace thekogans {
                                 std::string (),
                                 config.GetVersion (),
                                 XML_EXT));
-                    std::cout << "Creating " << config_file << "\n";
-                    std::cout.flush ();
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Creating " << config_file << "\n");
                     std::string configFilePath = ToSystemPath (config_file);
                     util::Directory::Create (util::Path (configFilePath).GetDirectory ());
                     std::fstream configFile (
@@ -701,6 +703,7 @@ namespace thekogans {
             void Installer::InstallPlugin (const std::string &project_root) {
                 if (installedProjects.find (project_root) == installedProjects.end ()) {
                     installedProjects.insert (project_root);
+                    BuildProgress::Phase phase ("Installing " + project_root);
                     std::string install_config = config;
                     if (install_config.empty ()) {
                         install_config =
@@ -937,8 +940,7 @@ namespace thekogans {
                     DebugShared.project,
                     DebugShared.GetVersion (),
                     false);
-                std::cout << "Installing " << DebugShared.project_root << std::endl;
-                std::cout.flush ();
+                THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Installing " << DebugShared.project_root << std::endl);
                 // install = "yes"
                 std::set<InstallPaths> installPaths;
                 GetInstallPaths (DebugShared, installPaths);
@@ -995,8 +997,7 @@ namespace thekogans {
                             std::string (),
                             DebugShared.GetVersion (),
                             XML_EXT));
-                std::cout << "Creating " << config_file << "\n";
-                std::cout.flush ();
+                THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Creating " << config_file << "\n");
                 std::string configFilePath = ToSystemPath (config_file);
                 util::Directory::Create (util::Path (configFilePath).GetDirectory ());
                 std::fstream configFile (
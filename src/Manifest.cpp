@@ -22,6 +22,7 @@
 #include "thekogans/util/StringUtils.h"
 #include "thekogans/util/XMLUtils.h"
 #include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Stats.h"
 #include "thekogans/make/core/Manifest.h"
 
 namespace thekogans {
@@ -163,6 +164,7 @@ namespace thekogans {
                         }
                         manifestFile << util::CloseTag (0, TAG_MANIFEST);
                         modified = false;
+                        THEKOGANS_MAKE_CORE_STATS_INCREMENT (MANIFEST_SAVES);
                     }
                     else {
                         THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
@@ -0,0 +1,387 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/Directory.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/PrecompiledHeaderAdvisor.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const TIME_TRACE_EXTENSION = "json";
+                const char * const TIME_TRACE_SOURCE_EVENT = "Source";
+
+                bool ReadFile (
+                        const std::string &path,
+                        std::string &contents) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                    std::ifstream stream (ToSystemPath (path).c_str (), std::ios::in | std::ios::binary);
+                    if (!stream.is_open ()) {
+                        return false;
+                    }
+                    contents.assign (
+                        (std::istreambuf_iterator<char> (stream)),
+                        std::istreambuf_iterator<char> ());
+                    return true;
+                }
+
+                // Return the position just past the given key's ':'.
+                std::size_t FindField (
+                        const std::string &object,
+                        const char *key) {
+                    std::string quotedKey = std::string ("\"") + key + "\"";
+                    std::size_t position = object.find (quotedKey);
+                    if (position != std::string::npos) {
+                        position = object.find_first_not_of (" \t\r\n", position + quotedKey.size ());
+                        if (position != std::string::npos && object[position] == ':') {
+                            return object.find_first_not_of (" \t\r\n", position + 1);
+                        }
+                    }
+                    return std::string::npos;
+                }
+
+                bool GetStringField (
+                        const std::string &object,
+                        const char *key,
+                        std::string &value) {
+                    std::size_t position = FindField (object, key);
+                    if (position == std::string::npos || object[position] != '"') {
+                        return false;
+                    }
+                    value.clear ();
+                    for (std::size_t i = position + 1, count = object.size (); i < count; ++i) {
+                        if (object[i] == '"') {
+                            return true;
+                        }
+                        if (object[i] == '\\' && i + 1 < count) {
+                            ++i;
+                        }
+                        value += object[i];
+                    }
+                    return false;
+                }
+
+                bool GetNumberField (
+                        const std::string &object,
+                        const char *key,
+                        util::f64 &value) {
+                    std::size_t position = FindField (object, key);
+                    if (position == std::string::npos) {
+                        return false;
+                    }
+                    char *end = 0;
+                    value = std::strtod (object.c_str () + position, &end);
+                    return end != object.c_str () + position;
+                }
+
+                typedef std::map<std::string, std::pair<util::f64, util::ui32>> Durations;
+
+                // Time trace files are JSON ({"traceEvents":[{...},...]}).
+                // Every object whose parent is an array is an event.
+                void ParseTimeTrace (
+                        const std::string &trace,
+                        Durations &durations) {
+                    std::string containers;
+                    std::size_t eventStart = std::string::npos;
+                    bool inString = false;
+                    for (std::size_t i = 0, count = trace.size (); i < count; ++i) {
+                        char ch = trace[i];
+                        if (inString) {
+                            if (ch == '\\') {
+                                ++i;
+                            }
+                            else if (ch == '"') {
+                                inString = false;
+                            }
+                        }
+                        else if (ch == '"') {
+                            inString = true;
+                        }
+                        else if (ch == '[' || ch == '{') {
+                            if (ch == '{' && !containers.empty () && containers.back () == '[') {
+                                eventStart = i;
+                            }
+                            containers += ch;
+                        }
+                        else if (ch == ']' || ch == '}') {
+                            if (containers.empty ()) {
+                                return;
+                            }
+                            containers.erase (containers.size () - 1);
+                            if (ch == '}' && eventStart != std::string::npos &&
+                                    !containers.empty () && containers.back () == '[') {
+                                std::string event = trace.substr (eventStart, i - eventStart + 1);
+                                eventStart = std::string::npos;
+                                std::string name;
+                                std::string detail;
+                                util::f64 duration;
+                                if (GetStringField (event, "name", name) &&
+                                        name == TIME_TRACE_SOURCE_EVENT &&
+                                        GetStringField (event, "detail", detail) &&
+                                        GetNumberField (event, "dur", duration)) {
+                                    std::pair<util::f64, util::ui32> &total = durations[detail];
+                                    total.first += duration;
+                                    ++total.second;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                void FindTimeTraces (
+                        const std::string &directory,
+                        Durations &durations) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (DIRECTORY_SCANS);
+                    util::Directory directory_ (ToSystemPath (directory));
+                    util::Directory::Entry entry;
+                    for (bool gotEntry = directory_.GetFirstEntry (entry);
+                            gotEntry; gotEntry = directory_.GetNextEntry (entry)) {
+                        if (entry.type == util::Directory::Entry::Folder) {
+                            if (!util::IsDotOrDotDot (entry.name.c_str ())) {
+                                FindTimeTraces (MakePath (directory, entry.name), durations);
+                            }
+                        }
+                        else if (entry.type == util::Directory::Entry::File &&
+                                util::Path (entry.name).GetExtension () == TIME_TRACE_EXTENSION) {
+                            std::string trace;
+                            if (ReadFile (MakePath (directory, entry.name), trace)) {
+                                ParseTimeTrace (trace, durations);
+                            }
+                        }
+                    }
+                }
+
+                // Unresolved headers are matched against the traced
+                // paths by name (<vector> matches .../c++/13/vector).
+                util::f64 GetUnresolvedCost (
+                        const std::string &header,
+                        const PrecompiledHeaderAdvisor::ParseCosts &costs) {
+                    std::string suffix = std::string (1, PATH_SEPARATOR_CHAR) +
+                        header.substr (1, header.size () - 2);
+                    util::f64 cost = 0.0;
+                    for (PrecompiledHeaderAdvisor::ParseCosts::const_iterator
+                            it = costs.begin (),
+                            end = costs.end (); it != end; ++it) {
+                        if (it->first.size () >= suffix.size () &&
+                                it->first.compare (
+                                    it->first.size () - suffix.size (),
+                                    suffix.size (),
+                                    suffix) == 0 &&
+                                it->second > cost) {
+                            cost = it->second;
+                        }
+                    }
+                    return cost;
+                }
+
+                util::f64 GetSize (
+                        const std::string &header,
+                        std::map<std::string, util::f64> &sizes) {
+                    std::map<std::string, util::f64>::const_iterator it = sizes.find (header);
+                    if (it != sizes.end ()) {
+                        return it->second;
+                    }
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                    util::f64 size = util::Path (ToSystemPath (header)).Exists () ?
+                        (util::f64)util::Directory::Entry (ToSystemPath (header)).size : 0.0;
+                    sizes[header] = size;
+                    return size;
+                }
+
+                bool CompareCandidates (
+                        const PrecompiledHeaderAdvisor::Candidate &candidate1,
+                        const PrecompiledHeaderAdvisor::Candidate &candidate2) {
+                    return candidate1.score != candidate2.score ?
+                        candidate1.score > candidate2.score :
+                        candidate1.count != candidate2.count ?
+                            candidate1.count > candidate2.count :
+                            candidate1.header < candidate2.header;
+                }
+            }
+
+            void PrecompiledHeaderAdvisor::LoadTimeTraces (
+                    const std::string &directory,
+                    ParseCosts &costs) {
+                if (util::Path (ToSystemPath (directory)).Exists ()) {
+                    Durations durations;
+                    FindTimeTraces (directory, durations);
+                    for (Durations::const_iterator
+                            it = durations.begin (),
+                            end = durations.end (); it != end; ++it) {
+                        costs[it->first] = it->second.first / it->second.second;
+                    }
+                }
+            }
+
+            std::size_t PrecompiledHeaderAdvisor::GetCandidates (
+                    const std::vector<BuildGraph::File> &sources,
+                    const std::vector<std::string> &includeDirectories,
+                    IncludeScanner &includeScanner,
+                    const ParseCosts &costs,
+                    std::vector<Candidate> &candidates) {
+                // Analyze the files unity batches include, not the batches.
+                std::vector<std::string> files;
+                for (std::vector<BuildGraph::File>::const_iterator
+                        it = sources.begin (),
+                        end = sources.end (); it != end; ++it) {
+                    if (!it->hasCustomBuild) {
+                        if (!it->unity_files.empty ()) {
+                            files.insert (files.end (), it->unity_files.begin (), it->unity_files.end ());
+                        }
+                        else {
+                            files.push_back (it->path);
+                        }
+                    }
+                }
+                std::map<std::string, util::ui32> counts;
+                for (std::vector<std::string>::const_iterator
+                        it = files.begin (),
+                        end = files.end (); it != end; ++it) {
+                    std::set<std::string> dependencies;
+                    std::set<std::string> unresolved;
+                    includeScanner.GetDependencies (*it, includeDirectories, dependencies, &unresolved);
+                    for (std::set<std::string>::const_iterator
+                            jt = dependencies.begin (),
+                            end = dependencies.end (); jt != end; ++jt) {
+                        ++counts[*jt];
+                    }
+                    // Unresolved "" includes are usually generated headers.
+                    for (std::set<std::string>::const_iterator
+                            jt = unresolved.begin (),
+                            end = unresolved.end (); jt != end; ++jt) {
+                        if ((*jt)[0] == '<') {
+                            ++counts[*jt];
+                        }
+                    }
+                }
+                std::map<std::string, util::f64> sizes;
+                for (std::map<std::string, util::ui32>::const_iterator
+                        it = counts.begin (),
+                        end = counts.end (); it != end; ++it) {
+                    Candidate candidate;
+                    candidate.header = it->first;
+                    candidate.count = it->second;
+                    if (!costs.empty ()) {
+                        if (candidate.IsResolved ()) {
+                            ParseCosts::const_iterator jt = costs.find (candidate.header);
+                            if (jt != costs.end ()) {
+                                candidate.cost = jt->second;
+                            }
+                        }
+                        else {
+                            candidate.cost = GetUnresolvedCost (candidate.header, costs);
+                        }
+                    }
+                    else if (candidate.IsResolved ()) {
+                        candidate.cost = GetSize (candidate.header, sizes);
+                        std::set<std::string> dependencies;
+                        includeScanner.GetDependencies (candidate.header, includeDirectories, dependencies);
+                        for (std::set<std::string>::const_iterator
+                                jt = dependencies.begin (),
+                                end = dependencies.end (); jt != end; ++jt) {
+                            candidate.cost += GetSize (*jt, sizes);
+                        }
+                    }
+                    else {
+                        candidate.cost = UNMEASURED_HEADER_SIZE;
+                    }
+                    candidate.score = candidate.count * candidate.cost;
+                    candidates.push_back (candidate);
+                }
+                std::sort (candidates.begin (), candidates.end (), CompareCandidates);
+                return files.size ();
+            }
+
+            void PrecompiledHeaderAdvisor::GetRecommended (
+                    const std::vector<Candidate> &candidates,
+                    std::size_t sourceCount,
+                    const std::string &project_root,
+                    const std::vector<std::string> &includeDirectories,
+                    IncludeScanner &includeScanner,
+                    std::vector<std::string> &headers,
+                    util::ui32 minInclusionPercentage,
+                    util::ui32 maxHeaders) {
+                std::size_t minCount = (sourceCount * minInclusionPercentage + 99) / 100;
+                if (minCount == 0) {
+                    minCount = 1;
+                }
+                std::string projectPrefix = project_root + PATH_SEPARATOR_CHAR;
+                std::set<std::string> covered;
+                for (std::vector<Candidate>::const_iterator
+                        it = candidates.begin (),
+                        end = candidates.end (); it != end && headers.size () < maxHeaders; ++it) {
+                    if (it->count < minCount || it->score <= 0.0) {
+                        continue;
+                    }
+                    if (it->IsResolved ()) {
+                        if (it->header.compare (0, projectPrefix.size (), projectPrefix) == 0 ||
+                                covered.find (it->header) != covered.end ()) {
+                            continue;
+                        }
+                        covered.insert (it->header);
+                        includeScanner.GetDependencies (it->header, includeDirectories, covered);
+                    }
+                    headers.push_back (it->header);
+                }
+            }
+
+            bool PrecompiledHeaderAdvisor::WriteHeader (
+                    const std::string &path,
+                    const std::vector<std::string> &headers) {
+                std::ostringstream stream;
+                stream << "// Generated by thekogans_make. Do not edit." << std::endl;
+                for (std::vector<std::string>::const_iterator
+                        it = headers.begin (),
+                        end = headers.end (); it != end; ++it) {
+                    if ((*it)[0] == '<' || (*it)[0] == '"') {
+                        stream << "#include " << *it << std::endl;
+                    }
+                    else {
+                        stream << "#include \"" << *it << "\"" << std::endl;
+                    }
+                }
+                std::string contents = stream.str ();
+                std::string existing;
+                if (ReadFile (path, existing) && existing == contents) {
+                    return false;
+                }
+                std::string systemPath = ToSystemPath (path);
+                util::Directory::Create (util::Path (systemPath).GetDirectory ());
+                std::ofstream file (systemPath.c_str (), std::ofstream::out | std::ofstream::trunc);
+                if (!file.is_open ()) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to open: %s.",
+                        systemPath.c_str ());
+                }
+                file << contents;
+                return true;
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,102 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <set>
+#include <fstream>
+#include <sstream>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/Directory.h"
+#include "thekogans/util/SHA2.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/PrecompiledHeaderCache.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            std::string PrecompiledHeaderCache::GetDirectory () {
+                return MakePath (_TOOLCHAIN_ROOT, PRECOMPILED_HEADER_CACHE_DIR);
+            }
+
+            std::string PrecompiledHeaderCache::GetKey (
+                    const std::string &header,
+                    const std::string &compiler,
+                    const std::list<std::string> &arguments,
+                    const std::vector<std::string> &includeDirectories,
+                    IncludeScanner &includeScanner) {
+                std::ostringstream stream;
+                stream << "toolchain: " << _TOOLCHAIN_TRIPLET << "\n";
+                stream << "compiler: " << compiler << "\n";
+                for (std::list<std::string>::const_iterator
+                        it = arguments.begin (),
+                        end = arguments.end (); it != end; ++it) {
+                    if (it->compare (0, 2, "-I") != 0) {
+                        stream << "argument: " << *it << "\n";
+                    }
+                }
+                stream << "header: " << header << " " << includeScanner.GetHash (header) << "\n";
+                std::set<std::string> dependencies;
+                includeScanner.GetDependencies (header, includeDirectories, dependencies);
+                for (std::set<std::string>::const_iterator
+                        it = dependencies.begin (),
+                        end = dependencies.end (); it != end; ++it) {
+                    stream << "dependency: " << *it << " " << includeScanner.GetHash (*it) << "\n";
+                }
+                std::string inputs = stream.str ();
+                util::Hash::Digest digest;
+                util::SHA2 hasher;
+                hasher.FromBuffer (inputs.data (), inputs.size (), util::SHA2::DIGEST_SIZE_256, digest);
+                return util::Hash::DigestTostring (digest);
+            }
+
+            std::string PrecompiledHeaderCache::GetStubHeader (
+                    const std::string &key,
+                    const std::string &header) {
+                return MakePath (
+                    MakePath (GetDirectory (), key),
+                    util::Path (header).GetFullFileName ());
+            }
+
+            std::string PrecompiledHeaderCache::GetPrecompiledHeader (
+                    const std::string &key,
+                    const std::string &header) {
+                return GetStubHeader (key, header) + ".gch";
+            }
+
+            void PrecompiledHeaderCache::CreateStubHeader (
+                    const std::string &key,
+                    const std::string &header) {
+                std::string stubHeader = ToSystemPath (GetStubHeader (key, header));
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                if (!util::Path (stubHeader).Exists ()) {
+                    util::Directory::Create (util::Path (stubHeader).GetDirectory ());
+                    std::ofstream file (stubHeader.c_str (), std::ofstream::out | std::ofstream::trunc);
+                    if (!file.is_open ()) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to open: %s.",
+                            stubHeader.c_str ());
+                    }
+                    file << "// Generated by thekogans_make. Do not edit." << std::endl <<
+                        "#include \"" << header << "\"" << std::endl;
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
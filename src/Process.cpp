@@ -0,0 +1,453 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if !defined (TOOLCHAIN_OS_Windows)
+    #include <sys/types.h>
+    #include <sys/time.h>
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <cerrno>
+    #if defined (TOOLCHAIN_OS_Linux)
+        #include <sys/epoll.h>
+    #else // defined (TOOLCHAIN_OS_Linux)
+        #include <poll.h>
+    #endif // defined (TOOLCHAIN_OS_Linux)
+#endif // !defined (TOOLCHAIN_OS_Windows)
+#include <cstdio>
+#include <chrono>
+#include <mutex>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#if defined (TOOLCHAIN_OS_Windows)
+    #include "thekogans/util/ChildProcess.h"
+#endif // defined (TOOLCHAIN_OS_Windows)
+#include "thekogans/make/core/Console.h"
+#include "thekogans/make/core/Process.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            ResourceUsage &ResourceUsage::operator += (const ResourceUsage &usage) {
+                processCount += usage.processCount;
+                wallTime += usage.wallTime;
+                userTime += usage.userTime;
+                systemTime += usage.systemTime;
+                maxRSS = std::max (maxRSS, usage.maxRSS);
+                inputBlocks += usage.inputBlocks;
+                outputBlocks += usage.outputBlocks;
+                return *this;
+            }
+
+        #if !defined (TOOLCHAIN_OS_Windows)
+            namespace {
+                inline util::f64 ToSeconds (const timeval &tv) {
+                    return (util::f64)tv.tv_sec + (util::f64)tv.tv_usec / 1000000.0;
+                }
+
+                // Pipes are created and marked close on exec under this
+                // lock, and children are forked under it, so that a child
+                // forked by another thread never inherits (and keeps open)
+                // our pipes' write ends.
+                std::mutex &GetForkMutex () {
+                    static std::mutex forkMutex;
+                    return forkMutex;
+                }
+
+                void CreatePipe (int fds[2]) {
+                    if (pipe (fds) < 0) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                    fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+                    fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+                }
+
+                // One of the child's output pipes. Data is split in to
+                // lines, and complete lines are written (prefixed) in
+                // one go. They go through Console (stdout as Info, stderr
+                // as Error) so that they don't interleave with its
+                // messages or land on its progress line. Console::Write
+                // doesn't filter by level, the child's output is never
+                // dropped.
+                struct OutputStream {
+                    int fd;
+                    Console::Level level;
+                    const std::string &prefix;
+                    std::ofstream *log;
+                    std::string partial;
+
+                    OutputStream (
+                        int fd_,
+                        Console::Level level_,
+                        const std::string &prefix_,
+                        std::ofstream *log_) :
+                        fd (fd_),
+                        level (level_),
+                        prefix (prefix_),
+                        log (log_) {}
+
+                    // Return false on EOF (or error).
+                    bool Read () {
+                        char buffer[4096];
+                        while (1) {
+                            ssize_t count = read (fd, buffer, sizeof (buffer));
+                            if (count > 0) {
+                                Write (buffer, (std::size_t)count);
+                            }
+                            else if (count < 0 && errno == EINTR) {
+                                continue;
+                            }
+                            else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                                return true;
+                            }
+                            else {
+                                Flush ();
+                                return false;
+                            }
+                        }
+                    }
+
+                    void Write (
+                            const char *buffer,
+                            std::size_t count) {
+                        if (log != 0) {
+                            log->write (buffer, count);
+                        }
+                        std::string lines;
+                        for (std::size_t i = 0; i < count; ++i) {
+                            partial += buffer[i];
+                            if (buffer[i] == '\n') {
+                                lines += prefix;
+                                lines += partial;
+                                partial.clear ();
+                            }
+                        }
+                        if (!lines.empty ()) {
+                            Console::Instance ().Write (level, lines);
+                        }
+                    }
+
+                    void Flush () {
+                        if (!partial.empty ()) {
+                            Console::Instance ().Write (level, prefix + partial + "\n");
+                            partial.clear ();
+                        }
+                    }
+                };
+
+                // Stream both pipes until the child closes them.
+                void DrainOutput (
+                        OutputStream &output,
+                        OutputStream &error) {
+                    OutputStream *streams[] = {&output, &error};
+                    for (std::size_t i = 0; i < 2; ++i) {
+                        fcntl (streams[i]->fd, F_SETFL, fcntl (streams[i]->fd, F_GETFL) | O_NONBLOCK);
+                    }
+                    std::size_t open = 2;
+                #if defined (TOOLCHAIN_OS_Linux)
+                    int epollFd = epoll_create1 (EPOLL_CLOEXEC);
+                    if (epollFd < 0) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                    for (std::size_t i = 0; i < 2; ++i) {
+                        epoll_event event;
+                        event.events = EPOLLIN;
+                        event.data.ptr = streams[i];
+                        epoll_ctl (epollFd, EPOLL_CTL_ADD, streams[i]->fd, &event);
+                    }
+                    while (open > 0) {
+                        epoll_event events[2];
+                        int count = epoll_wait (epollFd, events, 2, -1);
+                        if (count < 0) {
+                            if (errno == EINTR) {
+                                continue;
+                            }
+                            util::i32 errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                            close (epollFd);
+                            THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                        }
+                        for (int i = 0; i < count; ++i) {
+                            OutputStream *stream = (OutputStream *)events[i].data.ptr;
+                            if (!stream->Read ()) {
+                                epoll_ctl (epollFd, EPOLL_CTL_DEL, stream->fd, 0);
+                                --open;
+                            }
+                        }
+                    }
+                    close (epollFd);
+                #else // defined (TOOLCHAIN_OS_Linux)
+                    bool closed[2] = {false, false};
+                    while (open > 0) {
+                        pollfd fds[2];
+                        nfds_t count = 0;
+                        OutputStream *polled[2];
+                        for (std::size_t i = 0; i < 2; ++i) {
+                            if (!closed[i]) {
+                                fds[count].fd = streams[i]->fd;
+                                fds[count].events = POLLIN;
+                                fds[count].revents = 0;
+                                polled[count++] = streams[i];
+                            }
+                        }
+                        if (poll (fds, count, -1) < 0) {
+                            if (errno == EINTR) {
+                                continue;
+                            }
+                            THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                                THEKOGANS_UTIL_OS_ERROR_CODE);
+                        }
+                        for (nfds_t i = 0; i < count; ++i) {
+                            if (fds[i].revents != 0 && !polled[i]->Read ()) {
+                                closed[polled[i] == streams[0] ? 0 : 1] = true;
+                                --open;
+                            }
+                        }
+                    }
+                #endif // defined (TOOLCHAIN_OS_Linux)
+                }
+            }
+        #endif // !defined (TOOLCHAIN_OS_Windows)
+
+            bool Process::Exec () {
+                returnCode = -1;
+                usage = ResourceUsage ();
+                // Whatever we told the user so far goes out before the child's output.
+                Console::Instance ().Flush ();
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+            #if defined (TOOLCHAIN_OS_Windows)
+                util::ChildProcess childProcess (path);
+                for (std::list<std::string>::const_iterator
+                        it = arguments.begin (),
+                        end = arguments.end (); it != end; ++it) {
+                    childProcess.AddArgument (*it);
+                }
+                if (childProcess.Exec () != util::ChildProcess::Failed) {
+                    returnCode = childProcess.GetReturnCode ();
+                }
+            #else // defined (TOOLCHAIN_OS_Windows)
+                std::vector<char *> argv;
+                argv.push_back (const_cast<char *> (path.c_str ()));
+                for (std::list<std::string>::const_iterator
+                        it = arguments.begin (),
+                        end = arguments.end (); it != end; ++it) {
+                    argv.push_back (const_cast<char *> (it->c_str ()));
+                }
+                argv.push_back (0);
+                // Keep parent and child output in order.
+                std::cout.flush ();
+                std::cerr.flush ();
+                fflush (0);
+                bool streamOutput = outputPath.empty () && !outputPrefix.empty ();
+                int outputPipe[2] = {-1, -1};
+                int errorPipe[2] = {-1, -1};
+                pid_t pid;
+                {
+                    std::lock_guard<std::mutex> guard (GetForkMutex ());
+                    if (streamOutput) {
+                        CreatePipe (outputPipe);
+                        try {
+                            CreatePipe (errorPipe);
+                        }
+                        catch (...) {
+                            close (outputPipe[0]);
+                            close (outputPipe[1]);
+                            throw;
+                        }
+                    }
+                    pid = fork ();
+                }
+                if (pid < 0) {
+                    util::i32 errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                    if (streamOutput) {
+                        close (outputPipe[0]);
+                        close (outputPipe[1]);
+                        close (errorPipe[0]);
+                        close (errorPipe[1]);
+                    }
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                }
+                else if (pid == 0) {
+                    // The pipes are close on exec, dup2'ed
+                    // descriptors are not.
+                    if (streamOutput &&
+                            (dup2 (outputPipe[1], STDOUT_FILENO) < 0 ||
+                                dup2 (errorPipe[1], STDERR_FILENO) < 0)) {
+                        _exit (127);
+                    }
+                    if (!outputPath.empty ()) {
+                        int fd = open (outputPath.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                        if (fd < 0 || dup2 (fd, STDOUT_FILENO) < 0 || dup2 (fd, STDERR_FILENO) < 0) {
+                            _exit (127);
+                        }
+                        close (fd);
+                    }
+                    execvp (argv[0], &argv[0]);
+                    _exit (127);
+                }
+                if (streamOutput) {
+                    close (outputPipe[1]);
+                    close (errorPipe[1]);
+                    std::ofstream log;
+                    if (!logPath.empty ()) {
+                        log.open (logPath.c_str (), std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+                    }
+                    OutputStream output (outputPipe[0], Console::Info, outputPrefix, log.is_open () ? &log : 0);
+                    OutputStream error (errorPipe[0], Console::Error, outputPrefix, log.is_open () ? &log : 0);
+                    // The child has to be reaped even if draining fails.
+                    try {
+                        DrainOutput (output, error);
+                    }
+                    catch (...) {
+                        close (outputPipe[0]);
+                        close (errorPipe[0]);
+                        int status;
+                        while (waitpid (pid, &status, 0) < 0 && errno == EINTR);
+                        throw;
+                    }
+                    close (outputPipe[0]);
+                    close (errorPipe[0]);
+                }
+                int status = 0;
+                rusage ru;
+                pid_t result;
+                do {
+                    result = wait4 (pid, &status, 0, &ru);
+                } while (result < 0 && errno == EINTR);
+                if (result < 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+                if (WIFEXITED (status)) {
+                    returnCode = WEXITSTATUS (status);
+                }
+                usage.userTime = ToSeconds (ru.ru_utime);
+                usage.systemTime = ToSeconds (ru.ru_stime);
+            #if defined (TOOLCHAIN_OS_OSX)
+                // OS X reports ru_maxrss in bytes.
+                usage.maxRSS = (util::ui64)ru.ru_maxrss / 1024;
+            #else // defined (TOOLCHAIN_OS_OSX)
+                usage.maxRSS = (util::ui64)ru.ru_maxrss;
+            #endif // defined (TOOLCHAIN_OS_OSX)
+                usage.inputBlocks = (util::ui64)ru.ru_inblock;
+                usage.outputBlocks = (util::ui64)ru.ru_oublock;
+            #endif // defined (TOOLCHAIN_OS_Windows)
+                usage.processCount = 1;
+                usage.wallTime =
+                    std::chrono::duration_cast<std::chrono::duration<util::f64>> (
+                        std::chrono::steady_clock::now () - start).count ();
+                return returnCode == 0;
+            }
+
+            std::string Process::BuildCommandLine () const {
+                std::string commandLine = path;
+                for (std::list<std::string>::const_iterator
+                        it = arguments.begin (),
+                        end = arguments.end (); it != end; ++it) {
+                    commandLine += " " + *it;
+                }
+                return commandLine;
+            }
+
+            void ProcessAccounting::Add (
+                    const std::string &project,
+                    const std::string &target,
+                    const ResourceUsage &usage) {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                map[Key (project, target)] += usage;
+            }
+
+            void ProcessAccounting::Get (Map &map_) const {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                map_ = map;
+            }
+
+            ResourceUsage ProcessAccounting::GetTotal () const {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                ResourceUsage total;
+                for (Map::const_iterator it = map.begin (), end = map.end (); it != end; ++it) {
+                    total += it->second;
+                }
+                return total;
+            }
+
+            void ProcessAccounting::Reset () {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                map.clear ();
+            }
+
+            namespace {
+                std::string FormatUsage (
+                        const std::string &project,
+                        const std::string &target,
+                        const ResourceUsage &usage) {
+                    return util::FormatString (
+                        "%-40s %-12s %5u %10.2f %10.2f %10.2f %10.1f %12s %12s",
+                        project.c_str (),
+                        target.c_str (),
+                        usage.processCount,
+                        usage.wallTime,
+                        usage.userTime,
+                        usage.systemTime,
+                        (util::f64)usage.maxRSS / 1024.0,
+                        util::ui64Tostring (usage.inputBlocks).c_str (),
+                        util::ui64Tostring (usage.outputBlocks).c_str ());
+                }
+
+                bool CompareCPU (
+                        const std::pair<ProcessAccounting::Key, ResourceUsage> &item1,
+                        const std::pair<ProcessAccounting::Key, ResourceUsage> &item2) {
+                    return item1.second.userTime + item1.second.systemTime >
+                        item2.second.userTime + item2.second.systemTime;
+                }
+            }
+
+            void ProcessAccounting::Report (std::ostream &stream) const {
+                std::vector<std::pair<Key, ResourceUsage>> items;
+                ResourceUsage total;
+                {
+                    util::LockGuard<util::SpinLock> guard (spinLock);
+                    for (Map::const_iterator it = map.begin (), end = map.end (); it != end; ++it) {
+                        items.push_back (*it);
+                        total += it->second;
+                    }
+                }
+                if (!items.empty ()) {
+                    std::stable_sort (items.begin (), items.end (), CompareCPU);
+                    stream << util::FormatString (
+                        "%-40s %-12s %5s %10s %10s %10s %10s %12s %12s",
+                        "project", "target", "procs", "wall (s)", "user (s)",
+                        "system (s)", "RSS (MB)", "in blocks", "out blocks") << std::endl;
+                    for (std::size_t i = 0, count = items.size (); i < count; ++i) {
+                        stream << FormatUsage (items[i].first.first, items[i].first.second, items[i].second) << std::endl;
+                    }
+                    stream << FormatUsage ("total", std::string (), total) << std::endl;
+                    stream.flush ();
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -25,6 +25,8 @@
 #endif // defined (THEKOGANS_MAKE_CORE_HAVE_CURL)
 #include "thekogans/make/core/thekogans_make.h"
 #include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/Tracer.h"
 #include "thekogans/make/core/Project.h"
 
 namespace thekogans {
@@ -70,6 +72,8 @@ namespace thekogans {
                     std::string &branch,
                     std::string &version,
                     const std::string &example) {
+                THEKOGANS_MAKE_CORE_TRACE_SCOPE ("find", "Project::Find");
+                THEKOGANS_MAKE_CORE_TRACE_ARG ("project", organization + "_" + project);
                 bool installed = InstallVersion (
                     organization, project, branch, version, example);
                 if (!installed) {
@@ -119,6 +123,7 @@ namespace thekogans {
                     const std::string &branch,
                     const std::string &version,
                     const std::string &example) {
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                 return util::Path (
                     ToSystemPath (
                         GetConfig (
@@ -160,7 +165,9 @@ namespace thekogans {
                     path = ToSystemPath (MakePath (components, false));
                     fileTemplate += "-%u.%u.%u";
                 }
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                 if (util::Path (path).Exists ()) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (DIRECTORY_SCANS);
                     util::Directory directory (path);
                     util::Directory::Entry entry;
                     for (bool gotEntry = directory.GetFirstEntry (entry);
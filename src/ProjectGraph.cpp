@@ -0,0 +1,250 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <list>
+#include <vector>
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/ProjectGraph.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                std::string StripTrailingSeparator (const std::string &path) {
+                    std::string stripped = path;
+                    while (stripped.size () > 1 && stripped.back () == PATH_SEPARATOR_CHAR) {
+                        stripped.pop_back ();
+                    }
+                    return stripped;
+                }
+            }
+
+            ProjectGraph::ProjectGraph (
+                    const std::string &project_root_,
+                    const std::string &config_,
+                    const std::string &type_) :
+                    project_root (project_root_),
+                    config (config_),
+                    type (type_) {
+                AddProject (
+                    thekogans_make::GetConfig (
+                        project_root,
+                        THEKOGANS_MAKE_XML,
+                        MAKE,
+                        config,
+                        type));
+            }
+
+            std::string ProjectGraph::GetOwner (const std::string &path) const {
+                std::string directory = StripTrailingSeparator (path);
+                Owners::const_iterator it = files.find (directory);
+                if (it != files.end ()) {
+                    return it->second;
+                }
+                while (!directory.empty ()) {
+                    it = directories.find (directory);
+                    if (it != directories.end ()) {
+                        return it->second;
+                    }
+                    std::size_t separator = directory.find_last_of (PATH_SEPARATOR_CHAR);
+                    if (separator == std::string::npos) {
+                        break;
+                    }
+                    directory.resize (separator);
+                }
+                return std::string ();
+            }
+
+            void ProjectGraph::GetDependents (
+                    const std::set<std::string> &roots,
+                    std::set<std::string> &closure) const {
+                std::list<std::string> queue (roots.begin (), roots.end ());
+                while (!queue.empty ()) {
+                    std::string project = queue.front ();
+                    queue.pop_front ();
+                    if (closure.insert (project).second) {
+                        Dependents::const_iterator it = dependents.find (project);
+                        if (it != dependents.end ()) {
+                            queue.insert (queue.end (), it->second.begin (), it->second.end ());
+                        }
+                    }
+                }
+            }
+
+            void ProjectGraph::GetAffectedProjects (
+                    const std::set<std::string> &paths,
+                    std::set<std::string> &affectedProjects,
+                    std::set<std::string> *unownedPaths) const {
+                std::set<std::string> owners;
+                for (std::set<std::string>::const_iterator
+                        it = paths.begin (),
+                        end = paths.end (); it != end; ++it) {
+                    std::string owner = GetOwner (*it);
+                    if (!owner.empty ()) {
+                        owners.insert (owner);
+                    }
+                    else if (unownedPaths != 0) {
+                        unownedPaths->insert (*it);
+                    }
+                }
+                GetDependents (owners, affectedProjects);
+            }
+
+            void ProjectGraph::GetImpactedProjects (
+                    const std::set<std::string> &paths,
+                    IncludeScanner &includeScanner,
+                    std::set<std::string> &impactedProjects,
+                    std::set<std::string> *unownedPaths) const {
+                std::map<std::string, std::set<std::string>> changes;
+                for (std::set<std::string>::const_iterator
+                        it = paths.begin (),
+                        end = paths.end (); it != end; ++it) {
+                    std::string owner = GetOwner (*it);
+                    if (!owner.empty ()) {
+                        changes[owner].insert (*it);
+                    }
+                    else if (unownedPaths != 0) {
+                        unownedPaths->insert (*it);
+                    }
+                }
+                std::set<std::string> owners;
+                for (std::map<std::string, std::set<std::string>>::const_iterator
+                        it = changes.begin (),
+                        end = changes.end (); it != end; ++it) {
+                    if (IsTestOnlyChange (it->first, it->second, includeScanner)) {
+                        impactedProjects.insert (it->first);
+                    }
+                    else {
+                        owners.insert (it->first);
+                    }
+                }
+                GetDependents (owners, impactedProjects);
+            }
+
+            bool ProjectGraph::IsTestOnlyChange (
+                    const std::string &owner,
+                    const std::set<std::string> &paths,
+                    IncludeScanner &includeScanner) const {
+                Files::const_iterator tests = testFiles.find (owner);
+                if (tests == testFiles.end () || tests->second.empty ()) {
+                    return false;
+                }
+                std::vector<std::string> ownerIncludeDirectories;
+                IncludeDirectories::const_iterator ownerDirectories = includeDirectories.find (owner);
+                if (ownerDirectories != includeDirectories.end ()) {
+                    ownerIncludeDirectories = ownerDirectories->second;
+                }
+                // Everything the tests see...
+                std::set<std::string> testClosure = tests->second;
+                for (std::set<std::string>::const_iterator
+                        it = tests->second.begin (),
+                        end = tests->second.end (); it != end; ++it) {
+                    includeScanner.GetDependencies (*it, ownerIncludeDirectories, testClosure);
+                }
+                // ...and everything the rest of the project sees.
+                std::set<std::string> productClosure;
+                for (Owners::const_iterator
+                        it = files.begin (),
+                        end = files.end (); it != end; ++it) {
+                    if (it->second == owner && tests->second.find (it->first) == tests->second.end ()) {
+                        productClosure.insert (it->first);
+                        includeScanner.GetDependencies (it->first, ownerIncludeDirectories, productClosure);
+                    }
+                }
+                for (std::set<std::string>::const_iterator
+                        it = paths.begin (),
+                        end = paths.end (); it != end; ++it) {
+                    if (testClosure.find (*it) == testClosure.end () ||
+                            productClosure.find (*it) != productClosure.end ()) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            void ProjectGraph::AddProject (const thekogans_make &config_) {
+                if (projects.insert (config_.project_root).second) {
+                    AddDirectory (config_.project_root, config_.project_root);
+                    files[MakePath (config_.project_root, THEKOGANS_MAKE_XML)] = config_.project_root;
+                    std::set<std::string> projectFiles;
+                    std::set<std::string> prefixes;
+                    config_.GetFiles (projectFiles, &prefixes);
+                    for (std::set<std::string>::const_iterator
+                            it = projectFiles.begin (),
+                            end = projectFiles.end (); it != end; ++it) {
+                        files[*it] = config_.project_root;
+                    }
+                    for (std::set<std::string>::const_iterator
+                            it = prefixes.begin (),
+                            end = prefixes.end (); it != end; ++it) {
+                        AddDirectory (*it, config_.project_root);
+                    }
+                    config_.GetTestFiles (testFiles[config_.project_root]);
+                    std::vector<std::string> &projectIncludeDirectories =
+                        includeDirectories[config_.project_root];
+                    for (std::list<thekogans_make::IncludeDirectories::Ptr>::const_iterator
+                            it = config_.include_directories.begin (),
+                            end = config_.include_directories.end (); it != end; ++it) {
+                        std::string prefix = MakePath (config_.project_root, (*it)->prefix);
+                        for (std::list<std::string>::const_iterator
+                                jt = (*it)->paths.begin (),
+                                end = (*it)->paths.end (); jt != end; ++jt) {
+                            AddDirectory (MakePath (prefix, *jt), config_.project_root);
+                            projectIncludeDirectories.push_back (MakePath (prefix, *jt));
+                        }
+                    }
+                    const std::list<thekogans_make::Dependency::Ptr> *dependencyLists[] = {
+                        &config_.dependencies,
+                        &config_.plugin_hosts
+                    };
+                    for (std::size_t i = 0; i < 2; ++i) {
+                        for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
+                                it = dependencyLists[i]->begin (),
+                                end = dependencyLists[i]->end (); it != end; ++it) {
+                            if ((*it)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                                dependents[(*it)->GetProjectRoot ()].insert (config_.project_root);
+                                AddProject (
+                                    thekogans_make::GetConfig (
+                                        (*it)->GetProjectRoot (),
+                                        (*it)->GetConfigFile (),
+                                        MAKE,
+                                        (*it)->GetConfig (),
+                                        (*it)->GetType ()));
+                            }
+                        }
+                    }
+                }
+            }
+
+            void ProjectGraph::AddDirectory (
+                    const std::string &directory,
+                    const std::string &owner) {
+                std::string stripped = StripTrailingSeparator (directory);
+                std::string root = StripTrailingSeparator (owner);
+                // Include directories can point outside the project
+                // (../common). Those belong to someone else.
+                if (stripped.compare (0, root.size (), root) == 0 &&
+                        (stripped.size () == root.size () ||
+                            stripped[root.size ()] == PATH_SEPARATOR_CHAR)) {
+                    directories[stripped] = owner;
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
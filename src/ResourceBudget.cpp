@@ -0,0 +1,109 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if defined (TOOLCHAIN_OS_Windows)
+    #include <windows.h>
+#else // defined (TOOLCHAIN_OS_Windows)
+    #include <unistd.h>
+#endif // defined (TOOLCHAIN_OS_Windows)
+#include <algorithm>
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/make/core/ResourceBudget.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const THEKOGANS_MAKE_CORE_COMPILE_JOBS =
+                    "THEKOGANS_MAKE_CORE_COMPILE_JOBS";
+                const char * const THEKOGANS_MAKE_CORE_LINK_JOBS =
+                    "THEKOGANS_MAKE_CORE_LINK_JOBS";
+                const char * const THEKOGANS_MAKE_CORE_MEMORY_BUDGET =
+                    "THEKOGANS_MAKE_CORE_MEMORY_BUDGET";
+            }
+
+            ResourceBudget::ResourceBudget (
+                    util::ui32 compileTokens_,
+                    util::ui32 linkTokens_,
+                    util::ui64 memory_) :
+                    compileTokens (std::max<util::ui32> (compileTokens_, 1)),
+                    linkTokens (std::max<util::ui32> (linkTokens_, 1)),
+                    memory (memory_),
+                    compileJobs (0),
+                    linkJobs (0),
+                    memoryInUse (0) {}
+
+            ResourceBudget ResourceBudget::FromEnvironment (util::ui32 workerCount) {
+                workerCount = std::max<util::ui32> (workerCount, 1);
+                std::string compileJobs =
+                    util::GetEnvironmentVariable (THEKOGANS_MAKE_CORE_COMPILE_JOBS);
+                std::string linkJobs =
+                    util::GetEnvironmentVariable (THEKOGANS_MAKE_CORE_LINK_JOBS);
+                std::string memoryBudget =
+                    util::GetEnvironmentVariable (THEKOGANS_MAKE_CORE_MEMORY_BUDGET);
+                return ResourceBudget (
+                    !compileJobs.empty () ?
+                        util::stringToui32 (compileJobs.c_str ()) : workerCount,
+                    !linkJobs.empty () ?
+                        util::stringToui32 (linkJobs.c_str ()) : workerCount / 4,
+                    !memoryBudget.empty () ?
+                        util::stringToui64 (memoryBudget.c_str ()) * 1024 :
+                        GetPhysicalMemory () / 100 * DEFAULT_MEMORY_PERCENTAGE);
+            }
+
+            util::ui64 ResourceBudget::GetPhysicalMemory () {
+            #if defined (TOOLCHAIN_OS_Windows)
+                MEMORYSTATUSEX status;
+                status.dwLength = sizeof (status);
+                return GlobalMemoryStatusEx (&status) ? (util::ui64)status.ullTotalPhys / 1024 : 0;
+            #else // defined (TOOLCHAIN_OS_Windows)
+                long pages = sysconf (_SC_PHYS_PAGES);
+                long pageSize = sysconf (_SC_PAGESIZE);
+                return pages > 0 && pageSize > 0 ?
+                    (util::ui64)pages * (util::ui64)pageSize / 1024 : 0;
+            #endif // defined (TOOLCHAIN_OS_Windows)
+            }
+
+            bool ResourceBudget::Acquire (
+                    Pool pool,
+                    util::ui64 memory_) {
+                util::ui32 &jobs = pool == Link ? linkJobs : compileJobs;
+                if (jobs < (pool == Link ? linkTokens : compileTokens) &&
+                        // An idle host runs anything. Waiting would
+                        // not make a too big job any smaller.
+                        (memory == 0 || IsIdle () || memoryInUse + memory_ <= memory)) {
+                    ++jobs;
+                    memoryInUse += memory_;
+                    return true;
+                }
+                return false;
+            }
+
+            void ResourceBudget::Release (
+                    Pool pool,
+                    util::ui64 memory_) {
+                util::ui32 &jobs = pool == Link ? linkJobs : compileJobs;
+                if (jobs > 0) {
+                    --jobs;
+                }
+                memoryInUse -= std::min (memoryInUse, memory_);
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
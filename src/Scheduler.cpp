@@ -0,0 +1,401 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Scheduler.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const util::ui32 NO_JOB = util::NIDX32;
+
+                // Compute the longest path from the start of every job to
+                // the end of the schedule, optionally pretending that job
+                // skipJob does not depend on skipDependency.
+                util::f64 GetLongestPaths (
+                        const std::vector<Scheduler::Job> &jobs,
+                        std::vector<util::f64> &remaining,
+                        util::ui32 skipJob = NO_JOB,
+                        util::ui32 skipDependency = NO_JOB) {
+                    remaining.assign (jobs.size (), 0.0);
+                    std::vector<std::size_t> outstanding (jobs.size ());
+                    std::vector<util::ui32> ready;
+                    for (std::size_t i = 0, count = jobs.size (); i < count; ++i) {
+                        outstanding[i] = jobs[i].dependents.size ();
+                        if (i == skipDependency && jobs[i].dependents.count (skipJob) == 1) {
+                            --outstanding[i];
+                        }
+                        if (outstanding[i] == 0) {
+                            ready.push_back ((util::ui32)i);
+                        }
+                    }
+                    util::f64 longest = 0.0;
+                    std::size_t visited = 0;
+                    while (!ready.empty ()) {
+                        util::ui32 job = ready.back ();
+                        ready.pop_back ();
+                        ++visited;
+                        util::f64 tail = 0.0;
+                        for (std::set<util::ui32>::const_iterator
+                                it = jobs[job].dependents.begin (),
+                                end = jobs[job].dependents.end (); it != end; ++it) {
+                            if (job != skipDependency || *it != skipJob) {
+                                tail = std::max (tail, remaining[*it]);
+                            }
+                        }
+                        remaining[job] = jobs[job].GetDuration () + tail;
+                        longest = std::max (longest, remaining[job]);
+                        for (std::set<util::ui32>::const_iterator
+                                it = jobs[job].dependencies.begin (),
+                                end = jobs[job].dependencies.end (); it != end; ++it) {
+                            if ((job != skipJob || *it != skipDependency) && --outstanding[*it] == 0) {
+                                ready.push_back (*it);
+                            }
+                        }
+                    }
+                    if (visited != jobs.size ()) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "%s", "Dependency cycle detected.");
+                    }
+                    return longest;
+                }
+
+                typedef std::set<std::pair<util::f64, util::ui32>> ReadyJobs;
+
+                inline ReadyJobs::value_type MakeReadyJob (
+                        const std::vector<Scheduler::Job> &jobs,
+                        util::ui32 job) {
+                    // Longest remaining first, then in the order added.
+                    return ReadyJobs::value_type (-jobs[job].remaining, job);
+                }
+
+                typedef std::chrono::steady_clock Clock;
+
+                inline util::f64 GetSeconds (const Clock::time_point &start) {
+                    return std::chrono::duration_cast<std::chrono::duration<util::f64>> (
+                        Clock::now () - start).count ();
+                }
+            }
+
+            util::ui32 Scheduler::AddJob (
+                    const std::string &name,
+                    util::f64 estimate,
+                    const Action &action,
+                    ResourceBudget::Pool pool,
+                    util::ui64 memory) {
+                jobs.push_back (Job (name, estimate, action, pool, memory));
+                return (util::ui32)(jobs.size () - 1);
+            }
+
+            void Scheduler::AddPostAction (
+                    util::ui32 job,
+                    const Action &postAction) {
+                if (job < jobs.size ()) {
+                    jobs[job].postActions.push_back (postAction);
+                }
+                else {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                }
+            }
+
+            void Scheduler::AddDependency (
+                    util::ui32 job,
+                    util::ui32 dependency) {
+                if (job < jobs.size () && dependency < jobs.size () && job != dependency) {
+                    jobs[job].dependencies.insert (dependency);
+                    jobs[dependency].dependents.insert (job);
+                }
+                else {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                }
+            }
+
+            namespace {
+                Scheduler::Progress GetProgress (
+                        const std::vector<Scheduler::Job> &jobs,
+                        const std::vector<Clock::time_point> &started,
+                        const std::set<util::ui32> &running,
+                        const Clock::time_point &start,
+                        util::ui32 workerCount) {
+                    Scheduler::Progress progress;
+                    Clock::time_point now = Clock::now ();
+                    progress.totalJobs = (util::ui32)jobs.size ();
+                    progress.runningJobs = (util::ui32)running.size ();
+                    progress.elapsed =
+                        std::chrono::duration_cast<std::chrono::duration<util::f64>> (now - start).count ();
+                    util::f64 remainingWork = 0.0;
+                    util::f64 remainingPath = 0.0;
+                    for (std::size_t i = 0, count = jobs.size (); i < count; ++i) {
+                        progress.totalWork += jobs[i].estimate;
+                        if (jobs[i].completed) {
+                            ++progress.completedJobs;
+                        }
+                        else {
+                            // Give running jobs credit for the time they've been
+                            // running, but no more than they are expected to take.
+                            util::f64 done = 0.0;
+                            if (running.count ((util::ui32)i) == 1) {
+                                done = std::min (jobs[i].estimate,
+                                    std::chrono::duration_cast<std::chrono::duration<util::f64>> (
+                                        now - started[i]).count ());
+                            }
+                            remainingWork += jobs[i].estimate - done;
+                            remainingPath = std::max (remainingPath, jobs[i].remaining - done);
+                        }
+                    }
+                    progress.completedWork = progress.totalWork - remainingWork;
+                    progress.eta = std::max (remainingPath,
+                        remainingWork / (util::f64)std::max<util::ui32> (workerCount, 1));
+                    return progress;
+                }
+            }
+
+            void Scheduler::Run (
+                    util::ui32 workerCount,
+                    const ProgressCallback &progressCallback,
+                    const ResourceBudget *budget) {
+                ComputeRemaining ();
+                std::vector<std::size_t> outstanding (jobs.size ());
+                ReadyJobs ready;
+                for (std::size_t i = 0, count = jobs.size (); i < count; ++i) {
+                    outstanding[i] = jobs[i].dependencies.size ();
+                    if (outstanding[i] == 0) {
+                        ready.insert (MakeReadyJob (jobs, (util::ui32)i));
+                    }
+                }
+                Clock::time_point start = Clock::now ();
+                std::vector<Clock::time_point> started (jobs.size ());
+                std::set<util::ui32> running;
+                if (workerCount <= 1 && !progressCallback) {
+                    while (!ready.empty ()) {
+                        util::ui32 job = ready.begin ()->second;
+                        ready.erase (ready.begin ());
+                        started[job] = Clock::now ();
+                        if (jobs[job].action) {
+                            jobs[job].action ();
+                        }
+                        jobs[job].duration = GetSeconds (started[job]);
+                        for (std::list<Action>::const_iterator
+                                it = jobs[job].postActions.begin (),
+                                end = jobs[job].postActions.end (); it != end; ++it) {
+                            (*it) ();
+                        }
+                        jobs[job].completed = true;
+                        for (std::set<util::ui32>::const_iterator
+                                it = jobs[job].dependents.begin (),
+                                end = jobs[job].dependents.end (); it != end; ++it) {
+                            if (--outstanding[*it] == 0) {
+                                ready.insert (MakeReadyJob (jobs, *it));
+                            }
+                        }
+                    }
+                }
+                else {
+                    workerCount = std::max<util::ui32> (workerCount, 1);
+                    // Without a budget, the worker count is the only limit.
+                    ResourceBudget budget_ = budget != 0 ?
+                        *budget : ResourceBudget (workerCount, workerCount);
+                    std::mutex mutex;
+                    std::condition_variable finished;
+                    std::list<std::pair<util::ui32, std::exception_ptr>> finishedJobs;
+                    std::vector<std::thread> threads (jobs.size ());
+                    std::exception_ptr error;
+                    while (1) {
+                        bool changed = false;
+                        while (!error && running.size () < workerCount) {
+                            // Longest remaining first, among the jobs that fit.
+                            ReadyJobs::iterator it = ready.begin ();
+                            while (it != ready.end () &&
+                                    !budget_.Acquire (jobs[it->second].pool, jobs[it->second].memory)) {
+                                ++it;
+                            }
+                            if (it == ready.end ()) {
+                                break;
+                            }
+                            util::ui32 job = it->second;
+                            ready.erase (it);
+                            running.insert (job);
+                            started[job] = Clock::now ();
+                            changed = true;
+                            threads[job] = std::thread (
+                                [this, job, &started, &mutex, &finished, &finishedJobs] () {
+                                    std::exception_ptr exception;
+                                    try {
+                                        if (jobs[job].action) {
+                                            jobs[job].action ();
+                                        }
+                                    }
+                                    catch (...) {
+                                        exception = std::current_exception ();
+                                    }
+                                    jobs[job].duration = GetSeconds (started[job]);
+                                    std::lock_guard<std::mutex> guard (mutex);
+                                    finishedJobs.push_back (std::make_pair (job, exception));
+                                    finished.notify_one ();
+                                });
+                        }
+                        if (changed && progressCallback) {
+                            progressCallback (GetProgress (jobs, started, running, start, workerCount));
+                        }
+                        if (running.empty ()) {
+                            break;
+                        }
+                        std::list<std::pair<util::ui32, std::exception_ptr>> jobs_;
+                        {
+                            std::unique_lock<std::mutex> lock (mutex);
+                            if (progressCallback) {
+                                finished.wait_for (lock, std::chrono::seconds (PROGRESS_INTERVAL),
+                                    [&finishedJobs] () {return !finishedJobs.empty ();});
+                            }
+                            else {
+                                finished.wait (lock, [&finishedJobs] () {return !finishedJobs.empty ();});
+                            }
+                            jobs_.swap (finishedJobs);
+                        }
+                        if (jobs_.empty ()) {
+                            progressCallback (GetProgress (jobs, started, running, start, workerCount));
+                            continue;
+                        }
+                        for (std::list<std::pair<util::ui32, std::exception_ptr>>::const_iterator
+                                it = jobs_.begin (),
+                                end = jobs_.end (); it != end; ++it) {
+                            util::ui32 job = it->first;
+                            threads[job].join ();
+                            running.erase (job);
+                            budget_.Release (jobs[job].pool, jobs[job].memory);
+                            if (it->second) {
+                                if (!error) {
+                                    error = it->second;
+                                }
+                                continue;
+                            }
+                            if (!error) {
+                                try {
+                                    for (std::list<Action>::const_iterator
+                                            jt = jobs[job].postActions.begin (),
+                                            end = jobs[job].postActions.end (); jt != end; ++jt) {
+                                        (*jt) ();
+                                    }
+                                    jobs[job].completed = true;
+                                }
+                                catch (...) {
+                                    error = std::current_exception ();
+                                    continue;
+                                }
+                                for (std::set<util::ui32>::const_iterator
+                                        jt = jobs[job].dependents.begin (),
+                                        end = jobs[job].dependents.end (); jt != end; ++jt) {
+                                    if (--outstanding[*jt] == 0) {
+                                        ready.insert (MakeReadyJob (jobs, *jt));
+                                    }
+                                }
+                            }
+                        }
+                        if (progressCallback) {
+                            progressCallback (GetProgress (jobs, started, running, start, workerCount));
+                        }
+                    }
+                    if (error) {
+                        std::rethrow_exception (error);
+                    }
+                }
+            }
+
+            util::f64 Scheduler::ComputeRemaining () {
+                std::vector<util::f64> remaining;
+                util::f64 longest = GetLongestPaths (jobs, remaining);
+                for (std::size_t i = 0, count = jobs.size (); i < count; ++i) {
+                    jobs[i].remaining = remaining[i];
+                }
+                return longest;
+            }
+
+            util::f64 Scheduler::GetCriticalPath (std::vector<util::ui32> &path) const {
+                std::vector<util::f64> remaining;
+                util::f64 longest = GetLongestPaths (jobs, remaining);
+                util::ui32 job = NO_JOB;
+                for (std::size_t i = 0, count = jobs.size (); i < count; ++i) {
+                    if (jobs[i].dependencies.empty () &&
+                            (job == NO_JOB || remaining[i] > remaining[job])) {
+                        job = (util::ui32)i;
+                    }
+                }
+                while (job != NO_JOB) {
+                    path.push_back (job);
+                    util::ui32 next = NO_JOB;
+                    for (std::set<util::ui32>::const_iterator
+                            it = jobs[job].dependents.begin (),
+                            end = jobs[job].dependents.end (); it != end; ++it) {
+                        if (next == NO_JOB || remaining[*it] > remaining[next]) {
+                            next = *it;
+                        }
+                    }
+                    job = next;
+                }
+                return longest;
+            }
+
+            void Scheduler::ReportCriticalPath (
+                    std::ostream &stream,
+                    util::ui32 maxEdges) const {
+                std::vector<util::ui32> path;
+                util::f64 longest = GetCriticalPath (path);
+                if (!path.empty ()) {
+                    stream << util::FormatString ("Critical path (%.2f s):", longest) << std::endl;
+                    for (std::size_t i = 0, count = path.size (); i < count; ++i) {
+                        stream << util::FormatString ("  %10.2f s  %s",
+                            jobs[path[i]].GetDuration (),
+                            jobs[path[i]].name.c_str ()) << std::endl;
+                    }
+                    // For every edge on the critical path, see how much
+                    // shorter the schedule would be without it.
+                    std::vector<std::pair<util::f64, std::size_t>> savings;
+                    for (std::size_t i = 1, count = path.size (); i < count; ++i) {
+                        std::vector<util::f64> remaining;
+                        util::f64 saving = longest - GetLongestPaths (jobs, remaining, path[i], path[i - 1]);
+                        if (saving > 0.0) {
+                            savings.push_back (std::make_pair (-saving, i));
+                        }
+                    }
+                    if (!savings.empty ()) {
+                        std::sort (savings.begin (), savings.end ());
+                        stream << "Dependency edges whose removal shortens the critical path the most:" << std::endl;
+                        for (std::size_t i = 0, count = std::min<std::size_t> (savings.size (), maxEdges); i < count; ++i) {
+                            stream << util::FormatString ("  %10.2f s  %s -> %s",
+                                -savings[i].first,
+                                jobs[path[savings[i].second]].name.c_str (),
+                                jobs[path[savings[i].second - 1]].name.c_str ()) << std::endl;
+                        }
+                    }
+                    stream.flush ();
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,527 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Console.h"
+#include "thekogans/make/core/Server.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            const char * const Server::REQUEST_BUILD = "build";
+            const char * const Server::REQUEST_GENERATE = "generate";
+            const char * const Server::REQUEST_QUERY = "query";
+            const char * const Server::QUERY_VERSION = "version";
+            const char * const Server::QUERY_FEATURES = "features";
+            const char * const Server::QUERY_DEPENDENCIES = "dependencies";
+            const char * const Server::QUERY_INCLUDE_DIRECTORIES = "include_directories";
+            const char * const Server::QUERY_LINK_LIBRARIES = "link_libraries";
+            const char * const Server::QUERY_SHARED_LIBRARIES = "shared_libraries";
+            const char * const Server::RESPONSE_OK = "ok";
+            const char * const Server::RESPONSE_ERROR = "error";
+
+            namespace {
+                void MakeAddress (
+                        const std::string &path,
+                        sockaddr_un &address) {
+                    if (path.size () >= sizeof (address.sun_path)) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Socket path is too long: %s",
+                            path.c_str ());
+                    }
+                    memset (&address, 0, sizeof (address));
+                    address.sun_family = AF_UNIX;
+                    strncpy (address.sun_path, path.c_str (), sizeof (address.sun_path) - 1);
+                }
+
+                int Connect (const std::string &path) {
+                    sockaddr_un address;
+                    MakeAddress (path, address);
+                    int handle = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                    if (handle < 0) {
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                    if (connect (handle, (const sockaddr *)&address, sizeof (address)) < 0) {
+                        close (handle);
+                        return -1;
+                    }
+                    return handle;
+                }
+
+                bool WriteAll (
+                        int handle,
+                        const char *buffer,
+                        std::size_t count) {
+                    while (count > 0) {
+                        ssize_t written = write (handle, buffer, count);
+                        if (written < 0) {
+                            if (errno == EINTR) {
+                                continue;
+                            }
+                            return false;
+                        }
+                        buffer += written;
+                        count -= written;
+                    }
+                    return true;
+                }
+
+                // Read a single line (without the terminating '\n').
+                bool ReadLine (
+                        int handle,
+                        std::string &line) {
+                    char ch;
+                    while (line.size () < Server::MAX_REQUEST_SIZE) {
+                        ssize_t count = read (handle, &ch, 1);
+                        if (count < 0) {
+                            if (errno == EINTR) {
+                                continue;
+                            }
+                            return false;
+                        }
+                        if (count == 0 || ch == '\n') {
+                            return !line.empty ();
+                        }
+                        line += ch;
+                    }
+                    return false;
+                }
+
+                // Redirect stdout and stderr to the given handle for
+                // the lifetime of the object.
+                struct StdioRedirector {
+                    int savedStdout;
+                    int savedStderr;
+
+                    explicit StdioRedirector (int handle) :
+                            savedStdout (dup (STDOUT_FILENO)),
+                            savedStderr (dup (STDERR_FILENO)) {
+                        Flush ();
+                        dup2 (handle, STDOUT_FILENO);
+                        dup2 (handle, STDERR_FILENO);
+                    }
+                    ~StdioRedirector () {
+                        Flush ();
+                        dup2 (savedStdout, STDOUT_FILENO);
+                        dup2 (savedStderr, STDERR_FILENO);
+                        close (savedStdout);
+                        close (savedStderr);
+                        // A client that hung up mid response (EPIPE) leaves
+                        // the streams in a failed state. Don't let that
+                        // silence every response (and the log) that follows.
+                        std::cout.clear ();
+                        std::cerr.clear ();
+                        clearerr (stdout);
+                        clearerr (stderr);
+                    }
+
+                    static void Flush () {
+                        // Console writes on its own thread. Whatever it has
+                        // queued belongs to the current owner of fds 1 and 2.
+                        Console::Instance ().Flush ();
+                        std::cout.flush ();
+                        std::cerr.flush ();
+                        fflush (stdout);
+                        fflush (stderr);
+                    }
+                };
+
+                std::string GetArgument (
+                        const std::vector<std::string> &arguments,
+                        std::size_t index,
+                        const std::string &defaultValue) {
+                    return index < arguments.size () ? arguments[index] : defaultValue;
+                }
+            }
+
+            Server::Server (const std::string &path_) :
+                    path (path_),
+                    listener (-1) {
+                // Refuse to steal the socket of a running server.
+                int handle = Connect (path);
+                if (handle >= 0) {
+                    close (handle);
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "A server is already listening on %s",
+                        path.c_str ());
+                }
+                unlink (path.c_str ());
+                sockaddr_un address;
+                MakeAddress (path, address);
+                listener = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (listener < 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+                if (bind (listener, (const sockaddr *)&address, sizeof (address)) < 0 ||
+                        listen (listener, SOMAXCONN) < 0 ||
+                        pipe2 (stopPipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+                    util::i32 errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                    close (listener);
+                    unlink (path.c_str ());
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                }
+            }
+
+            Server::~Server () {
+                close (listener);
+                close (stopPipe[0]);
+                close (stopPipe[1]);
+                unlink (path.c_str ());
+            }
+
+            std::string Server::GetDefaultPath () {
+                return MakePath (_TOOLCHAIN_ROOT, THEKOGANS_MAKE_SOCKET);
+            }
+
+            void Server::Run () {
+                // A client that goes away mid response should not kill the server.
+                void (*pipeHandler) (int) = signal (SIGPIPE, SIG_IGN);
+                THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Listening on " << path << std::endl);
+                bool done = false;
+                while (!done) {
+                    pollfd fds[3];
+                    fds[0].fd = stopPipe[0];
+                    fds[1].fd = watcher.GetHandle ();
+                    fds[2].fd = listener;
+                    for (std::size_t i = 0; i < 3; ++i) {
+                        fds[i].events = POLLIN;
+                        fds[i].revents = 0;
+                    }
+                    if (poll (fds, 3, -1) < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        signal (SIGPIPE, pipeHandler);
+                        THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                            THEKOGANS_UTIL_OS_ERROR_CODE);
+                    }
+                    if ((fds[0].revents & POLLIN) != 0) {
+                        char ch;
+                        while (read (stopPipe[0], &ch, 1) == 1) {}
+                        done = true;
+                    }
+                    else {
+                        if ((fds[1].revents & POLLIN) != 0) {
+                            ProcessChanges ();
+                        }
+                        if ((fds[2].revents & POLLIN) != 0) {
+                            ProcessConnection ();
+                        }
+                    }
+                }
+                signal (SIGPIPE, pipeHandler);
+            }
+
+            void Server::Stop () {
+                char ch = 0;
+                ssize_t result = write (stopPipe[1], &ch, 1);
+                (void)result;
+            }
+
+            bool Server::SendRequest (
+                    const std::string &path,
+                    const std::string &request,
+                    std::ostream &response) {
+                int handle = Connect (path);
+                if (handle < 0) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to connect to server on %s",
+                        path.c_str ());
+                }
+                std::string line = request + "\n";
+                if (!WriteAll (handle, line.c_str (), line.size ())) {
+                    util::i32 errorCode = THEKOGANS_UTIL_OS_ERROR_CODE;
+                    close (handle);
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (errorCode);
+                }
+                shutdown (handle, SHUT_WR);
+                // Stream the response while keeping track of its last line.
+                std::string lastLine;
+                std::string currLine;
+                char buffer[4096];
+                while (1) {
+                    ssize_t count = read (handle, buffer, sizeof (buffer));
+                    if (count < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        break;
+                    }
+                    if (count == 0) {
+                        break;
+                    }
+                    response.write (buffer, count);
+                    for (ssize_t i = 0; i < count; ++i) {
+                        if (buffer[i] == '\n') {
+                            lastLine.swap (currLine);
+                            currLine.clear ();
+                        }
+                        else {
+                            currLine += buffer[i];
+                        }
+                    }
+                }
+                response.flush ();
+                close (handle);
+                return lastLine == RESPONSE_OK;
+            }
+
+            void Server::ProcessConnection () {
+                int connection = accept4 (listener, 0, 0, SOCK_CLOEXEC);
+                if (connection < 0) {
+                    return;
+                }
+                timeval timeout;
+                timeout.tv_sec = REQUEST_TIMEOUT;
+                timeout.tv_usec = 0;
+                setsockopt (connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+                std::string request;
+                if (ReadLine (connection, request)) {
+                    // Pick up any config changes that happened since the
+                    // last poll before answering.
+                    ProcessChanges ();
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("> " << request << std::endl);
+                    std::string status = RESPONSE_OK;
+                    {
+                        StdioRedirector redirector (connection);
+                        THEKOGANS_UTIL_TRY {
+                            ProcessRequest (request);
+                        }
+                        THEKOGANS_UTIL_CATCH (util::Exception) {
+                            std::cerr << exception.Report () << std::endl;
+                            status = RESPONSE_ERROR;
+                        }
+                    }
+                    status += "\n";
+                    WriteAll (connection, status.c_str (), status.size ());
+                }
+                close (connection);
+            }
+
+            void Server::ProcessRequest (const std::string &request) {
+                std::vector<std::string> arguments;
+                {
+                    std::istringstream stream (request);
+                    std::string argument;
+                    while (stream >> argument) {
+                        arguments.push_back (argument);
+                    }
+                }
+                if (arguments.size () < 2) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Malformed request: %s",
+                        request.c_str ());
+                }
+                const std::string &command = arguments[0];
+                const std::string &project_root = arguments[1];
+                std::string defaultConfig =
+                    thekogans_make::GetBuildConfig (project_root, THEKOGANS_MAKE_XML);
+                if (defaultConfig.empty ()) {
+                    defaultConfig = CONFIG_DEBUG;
+                }
+                std::string defaultType =
+                    thekogans_make::GetBuildType (project_root, THEKOGANS_MAKE_XML);
+                std::set<std::string> visitedProjects;
+                if (command == REQUEST_BUILD) {
+                    std::string config = GetArgument (arguments, 2, defaultConfig);
+                    std::string type = GetArgument (arguments, 3, defaultType);
+                    std::string target = GetArgument (arguments, 4, TARGET_ALL);
+                    util::ui32 concurrency =
+                        util::stringToui32 (GetArgument (arguments, 5, "1").c_str ());
+                    BuildProject (
+                        project_root,
+                        config,
+                        type,
+                        MODE_DEVELOPMENT,
+                        false,
+                        false,
+                        target,
+                        concurrency);
+                    WatchConfig (
+                        thekogans_make::GetConfig (
+                            project_root,
+                            THEKOGANS_MAKE_XML,
+                            MAKE,
+                            config,
+                            target == TARGET_TESTS || target == TARGET_TESTS_SELF ? TYPE_STATIC : type),
+                        visitedProjects);
+                }
+                else if (command == REQUEST_GENERATE) {
+                    std::string generator = GetArgument (arguments, 2, MAKE);
+                    std::string config = GetArgument (arguments, 3, defaultConfig);
+                    std::string type = GetArgument (arguments, 4, defaultType);
+                    bool force = GetArgument (arguments, 5, VALUE_NO) == VALUE_YES;
+                    CreateBuildSystem (project_root, generator, config, type, true, force);
+                    WatchConfig (
+                        thekogans_make::GetConfig (
+                            project_root,
+                            THEKOGANS_MAKE_XML,
+                            generator,
+                            config,
+                            type),
+                        visitedProjects);
+                }
+                else if (command == REQUEST_QUERY && arguments.size () > 2) {
+                    const std::string &what = arguments[2];
+                    const thekogans_make &config = thekogans_make::GetConfig (
+                        project_root,
+                        THEKOGANS_MAKE_XML,
+                        MAKE,
+                        GetArgument (arguments, 3, defaultConfig),
+                        GetArgument (arguments, 4, defaultType));
+                    WatchConfig (config, visitedProjects);
+                    if (what == QUERY_VERSION) {
+                        std::cout << config.GetVersion () << std::endl;
+                    }
+                    else if (what == QUERY_FEATURES) {
+                        std::set<std::string> features;
+                        config.GetFeatures (features);
+                        for (std::set<std::string>::const_iterator
+                                it = features.begin (),
+                                end = features.end (); it != end; ++it) {
+                            std::cout << *it << std::endl;
+                        }
+                    }
+                    else if (what == QUERY_DEPENDENCIES) {
+                        config.ListDependencies (0);
+                    }
+                    else if (what == QUERY_INCLUDE_DIRECTORIES) {
+                        std::set<std::string> include_directories;
+                        config.GetIncludeDirectories (include_directories);
+                        for (std::set<std::string>::const_iterator
+                                it = include_directories.begin (),
+                                end = include_directories.end (); it != end; ++it) {
+                            std::cout << *it << std::endl;
+                        }
+                    }
+                    else if (what == QUERY_LINK_LIBRARIES) {
+                        std::list<std::string> link_libraries;
+                        config.GetLinkLibraries (link_libraries);
+                        for (std::list<std::string>::const_iterator
+                                it = link_libraries.begin (),
+                                end = link_libraries.end (); it != end; ++it) {
+                            std::cout << *it << std::endl;
+                        }
+                    }
+                    else if (what == QUERY_SHARED_LIBRARIES) {
+                        std::set<std::string> shared_libraries;
+                        config.GetSharedLibraries (shared_libraries);
+                        for (std::set<std::string>::const_iterator
+                                it = shared_libraries.begin (),
+                                end = shared_libraries.end (); it != end; ++it) {
+                            std::cout << *it << std::endl;
+                        }
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unknown query: %s",
+                            what.c_str ());
+                    }
+                }
+                else {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Malformed request: %s",
+                        request.c_str ());
+                }
+            }
+
+            void Server::WatchConfig (
+                    const thekogans_make &config,
+                    std::set<std::string> &visitedProjects) {
+                if (visitedProjects.insert (config.project_root).second) {
+                    watcher.AddDirectory (config.project_root);
+                    for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
+                            it = config.dependencies.begin (),
+                            end = config.dependencies.end (); it != end; ++it) {
+                        if ((*it)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                            WatchConfig (
+                                thekogans_make::GetConfig (
+                                    (*it)->GetProjectRoot (),
+                                    (*it)->GetConfigFile (),
+                                    (*it)->GetGenerator (),
+                                    (*it)->GetConfig (),
+                                    (*it)->GetType ()),
+                                visitedProjects);
+                        }
+                    }
+                    for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
+                            it = config.plugin_hosts.begin (),
+                            end = config.plugin_hosts.end (); it != end; ++it) {
+                        if ((*it)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                            WatchConfig (
+                                thekogans_make::GetConfig (
+                                    (*it)->GetProjectRoot (),
+                                    (*it)->GetConfigFile (),
+                                    (*it)->GetGenerator (),
+                                    (*it)->GetConfig (),
+                                    (*it)->GetType ()),
+                                visitedProjects);
+                        }
+                    }
+                }
+            }
+
+            void Server::ProcessChanges () {
+                std::set<std::string> paths;
+                if (!watcher.Read (paths)) {
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO (
+                        "Change notifications were lost, flushing all configs." << std::endl);
+                    thekogans_make::FlushConfigs ();
+                    return;
+                }
+                const std::string config_file = PATH_SEPARATOR THEKOGANS_MAKE_XML;
+                std::set<std::string> flushedRoots;
+                for (std::set<std::string>::const_iterator
+                        it = paths.begin (),
+                        end = paths.end (); it != end; ++it) {
+                    if (it->size () > config_file.size () &&
+                            it->compare (it->size () - config_file.size (),
+                                config_file.size (), config_file) == 0) {
+                        thekogans_make::FlushConfig (
+                            it->substr (0, it->size () - config_file.size ()),
+                            flushedRoots);
+                    }
+                }
+                for (std::set<std::string>::const_iterator
+                        it = flushedRoots.begin (),
+                        end = flushedRoots.end (); it != end; ++it) {
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Flushed " << *it << std::endl);
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
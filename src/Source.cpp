@@ -35,6 +35,7 @@
 #include "thekogans/util/SHA2.h"
 #include "thekogans/util/XMLUtils.h"
 #include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Console.h"
 #include "thekogans/make/core/Version.h"
 #include "thekogans/make/core/Source.h"
 
@@ -144,7 +145,7 @@ namespace thekogans {
                 std::string sourceDirectory = MakePath (_SOURCES_ROOT, organization);
                 std::string sourceFilePath = MakePath (sourceDirectory, SOURCE_XML);
                 if (!util::Path (sourceFilePath).Exists ()) {
-                    std::cout << "Adding " << organization << " - " << url << std::endl;
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Adding " << organization << " - " << url << std::endl);
                     if (!util::Path (sourceDirectory).Exists ()) {
                         util::Directory::Create (sourceDirectory);
                     }
@@ -182,7 +183,7 @@ namespace thekogans {
             void Source::Destroy (const std::string &organization) {
                 std::string sourcePath = MakePath (_SOURCES_ROOT, organization);
                 if (util::Path (sourcePath).Exists ()) {
-                    std::cout << "Deleting " << sourcePath << std::endl;
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Deleting " << sourcePath << std::endl);
                     util::Directory::Delete (sourcePath);
                 }
             }
@@ -294,13 +295,13 @@ namespace thekogans {
                     if ((*it)->name == name && (*it)->branch == branch) {
                         if ((*it)->version == version) {
                             (*it)->SHA2_256 = SHA2_256;
-                            std::cout << "Updating " << **it << std::endl;
+                            THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Updating " << **it << std::endl);
                             updated = true;
                             break;
                         }
                         else if (util::Version (version) > util::Version ((*it)->version)) {
                             Project::Ptr project (new Project (name, branch, version, SHA2_256));
-                            std::cout << "Adding " << *project << std::endl;
+                            THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Adding " << *project << std::endl);
                             projects.insert (it, std::move (project));
                             updated = true;
                             break;
@@ -309,7 +310,7 @@ namespace thekogans {
                 }
                 if (!updated) {
                     Project::Ptr project (new Project (name, branch, version, SHA2_256));
-                    std::cout << "Adding " << *project << std::endl;
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Adding " << *project << std::endl);
                     projects.push_back (std::move (project));
                 }
             }
@@ -324,7 +325,7 @@ namespace thekogans {
                     if ((*it)->name == name &&
                             (*it)->branch == branch &&
                             (*it)->version == version) {
-                        std::cout << "Deleting " << **it << std::endl;
+                        THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Deleting " << **it << std::endl);
                         projects.erase (it);
                         return true;
                     }
@@ -430,13 +431,13 @@ namespace thekogans {
                         if ((*it)->version == version) {
                             (*it)->file = file;
                             (*it)->SHA2_256 = SHA2_256;
-                            std::cout << "Updating " << **it << std::endl;
+                            THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Updating " << **it << std::endl);
                             updated = true;
                             break;
                         }
                         else if (util::Version (version) > util::Version ((*it)->version)) {
                             Toolchain::Ptr toolchain_ (new Toolchain (name, version, file, SHA2_256));
-                            std::cout << "Adding " << *toolchain_ << std::endl;
+                            THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Adding " << *toolchain_ << std::endl);
                             toolchain.insert (it, std::move (toolchain_));
                             updated = true;
                             break;
@@ -445,7 +446,7 @@ namespace thekogans {
                 }
                 if (!updated) {
                     Toolchain::Ptr toolchain_ (new Toolchain (name, version, file, SHA2_256));
-                    std::cout << "Adding " << *toolchain_ << std::endl;
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Adding " << *toolchain_ << std::endl);
                     toolchain.push_back (std::move (toolchain_));
                 }
             }
@@ -457,7 +458,7 @@ namespace thekogans {
                         it = toolchain.begin (),
                         end = toolchain.end (); it != end;) {
                     if ((*it)->name == name && (*it)->version == version) {
-                        std::cout << "Deleting " << **it << std::endl;
+                        THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Deleting " << **it << std::endl);
                         toolchain.erase (it);
                         return true;
                     }
@@ -31,10 +31,14 @@
 #include "thekogans/util/File.h"
 #include "thekogans/util/Directory.h"
 #include "thekogans/util/LoggerMgr.h"
-#include "thekogans/util/ChildProcess.h"
 #include "thekogans/util/SHA2.h"
+#include "thekogans/util/StringUtils.h"
 #include "thekogans/util/XMLUtils.h"
 #include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Console.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/Tracer.h"
+#include "thekogans/make/core/Process.h"
 #include "thekogans/make/core/Version.h"
 #include "thekogans/make/core/Sources.h"
 
@@ -145,8 +149,7 @@ namespace thekogans {
                     if (!organization.empty ()) {
                         Source *source = GetSource (organization);
                         if (source != 0) {
-                            std::cout << "Updating " << *source << std::endl;
-                            std::cout.flush ();
+                            THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Updating " << *source << std::endl);
                             UpdateSource (*source);
                         }
                     }
@@ -155,23 +158,20 @@ namespace thekogans {
                                 it = sources.begin (),
                                 end = sources.end (); it != end; ++it) {
                             THEKOGANS_UTIL_TRY {
-                                std::cout << "Updating " << **it << std::endl;
-                                std::cout.flush ();
+                                THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Updating " << **it << std::endl);
                                 UpdateSource (**it);
                             }
                             THEKOGANS_UTIL_CATCH (util::Exception) {
-                                std::cout << "Unable to update " << **it <<
-                                    "(" << exception.what () << "), skipping.\n";
-                                std::cout.flush ();
+                                THEKOGANS_MAKE_CORE_CONSOLE_WARNING ("Unable to update " << **it <<
+                                    "(" << exception.what () << "), skipping.\n");
                             }
                         }
                     }
                     Save ();
                 }
                 else {
-                    std::cout << "No sources found in " <<
-                        sourcesFilePath << std::endl;
-                    std::cout.flush ();
+                    THEKOGANS_MAKE_CORE_CONSOLE_WARNING ("No sources found in " <<
+                        sourcesFilePath << std::endl);
                 }
             }
 
@@ -188,15 +188,14 @@ namespace thekogans {
                     const std::string &url) {
                 Source *source = GetSource (organization);
                 if (source != 0) {
-                    std::cout << "Updating " << *source << " -> " << url << std::endl;
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Updating " << *source << " -> " << url << std::endl);
                     source->url = url;
                 }
                 else {
                     source = new Source (organization, url);
-                    std::cout << "Adding " << *source << std::endl;
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Adding " << *source << std::endl);
                     sources.push_back (Source::Ptr (source));
                 }
-                std::cout.flush ();
                 UpdateSource (*source);
                 Save ();
             }
@@ -206,14 +205,13 @@ namespace thekogans {
                         it = sources.begin (),
                         end = sources.end (); it != end; ++it) {
                     if ((*it)->organization == organization) {
-                        std::cout << "Deleting " << **it << std::endl;
+                        THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Deleting " << **it << std::endl);
                         sources.erase (it);
                         Save ();
                         return;
                     }
                 }
-                std::cout << organization << " not found.\n";
-                std::cout.flush ();
+                THEKOGANS_MAKE_CORE_CONSOLE_WARNING (organization << " not found.\n");
             }
 
             std::string Sources::GetSourceURL (
@@ -288,7 +286,10 @@ namespace thekogans {
                 if (source != 0) {
                     const Source::Project *project = source->GetProject (name, branch, version);
                     if (project != 0) {
-                        util::ChildProcess shellProcess (ToSystemPath (_TOOLCHAIN_SHELL));
+                        THEKOGANS_MAKE_CORE_TRACE_SCOPE ("download", "GetSourceProject");
+                        THEKOGANS_MAKE_CORE_TRACE_ARG ("project",
+                            GetFileName (organization, name, branch, version, TAR_GZ_EXT));
+                        Process shellProcess (ToSystemPath (_TOOLCHAIN_SHELL));
                         std::list<std::string> components;
                         components.push_back (_TOOLCHAIN_ROOT);
                         components.push_back (COMMON_DIR);
@@ -303,9 +304,13 @@ namespace thekogans {
                         }
                         shellProcess.AddArgument ("-v:" + project->version);
                         shellProcess.AddArgument ("-s:" + project->SHA2_256);
-                        util::ChildProcess::ChildStatus childStatus = shellProcess.Exec ();
-                        if (childStatus == util::ChildProcess::Failed ||
-                                shellProcess.GetReturnCode () != 0) {
+                        THEKOGANS_MAKE_CORE_STATS_INCREMENT (CHILD_PROCESSES);
+                        bool result = shellProcess.Exec ();
+                        ProcessAccounting::Instance ().Add (
+                            organization + ORGANIZATION_PROJECT_SEPARATOR + name,
+                            "download",
+                            shellProcess.GetResourceUsage ());
+                        if (!result) {
                             THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
                                 "Unable to execute: '%s'.",
                                 shellProcess.BuildCommandLine ().c_str ());
@@ -396,7 +401,7 @@ namespace thekogans {
                     }
                     ~CURLHandle () {
                         curl_easy_cleanup (curl);
-                        std::cout << std::endl;
+                        Console::Instance ().SetProgress (std::string ());
                     }
 
                     void GetURL () {
@@ -427,10 +432,12 @@ namespace thekogans {
                         const int MAX_BARWIDTH =  79;
                         int count = (int)((MAX_BARWIDTH - 7) * fraction);
                         if (count > 0) {
-                            std::cout << "\r";
-                            std::cout.width (MAX_BARWIDTH);
-                            std::cout << std::left << std::string (count, '#') << (int)(fraction * 100.0) << "%";
-                            std::cout.flush ();
+                            // Console renders (at most) every Console::PROGRESS_INTERVAL
+                            // milliseconds, no matter how often curl calls us.
+                            std::string bar (count, '#');
+                            bar.resize (MAX_BARWIDTH, ' ');
+                            Console::Instance ().SetProgress (
+                                bar + util::FormatString ("%d%%", (int)(fraction * 100.0)));
                         }
                         return 0;
                     }
@@ -461,7 +468,10 @@ namespace thekogans {
                 if (source != 0) {
                     const Source::Toolchain *toolchain = source->GetToolchain (name, version);
                     if (toolchain != 0) {
-                        util::ChildProcess shellProcess (ToSystemPath (_TOOLCHAIN_SHELL));
+                        THEKOGANS_MAKE_CORE_TRACE_SCOPE ("download", "InstallSourceToolchain");
+                        THEKOGANS_MAKE_CORE_TRACE_ARG ("toolchain",
+                            GetFileName (organization, name, std::string (), version, TAR_GZ_EXT));
+                        Process shellProcess (ToSystemPath (_TOOLCHAIN_SHELL));
                         std::list<std::string> components;
                         components.push_back (_TOOLCHAIN_ROOT);
                         components.push_back (COMMON_DIR);
@@ -477,9 +487,13 @@ namespace thekogans {
                         }
                         shellProcess.AddArgument ("-c:" + config);
                         shellProcess.AddArgument ("-t:" + type);
-                        util::ChildProcess::ChildStatus childStatus = shellProcess.Exec ();
-                        if (childStatus == util::ChildProcess::Failed ||
-                                shellProcess.GetReturnCode () != 0) {
+                        THEKOGANS_MAKE_CORE_STATS_INCREMENT (CHILD_PROCESSES);
+                        bool result = shellProcess.Exec ();
+                        ProcessAccounting::Instance ().Add (
+                            organization + ORGANIZATION_PROJECT_SEPARATOR + name,
+                            "install",
+                            shellProcess.GetResourceUsage ());
+                        if (!result) {
                             THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
                                 "Unable to execute: '%s'.",
                                 shellProcess.BuildCommandLine ().c_str ());
@@ -528,8 +542,12 @@ namespace thekogans {
                 } bufferDataSink;
                 std::string sourceUrl =
                     MakePath (MakePath (source.url, source.organization), SOURCE_XML);
-                CURLHandle curlHandle (sourceUrl, bufferDataSink);
-                curlHandle.GetURL ();
+                {
+                    THEKOGANS_MAKE_CORE_TRACE_SCOPE ("download", "UpdateSource");
+                    THEKOGANS_MAKE_CORE_TRACE_ARG ("url", sourceUrl);
+                    CURLHandle curlHandle (sourceUrl, bufferDataSink);
+                    curlHandle.GetURL ();
+                }
                 source.Clear ();
                 if (!bufferDataSink.buffer.empty ()) {
                     pugi::xml_document document;
@@ -0,0 +1,166 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Stats.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const THEKOGANS_MAKE_CORE_STATS = "THEKOGANS_MAKE_CORE_STATS";
+
+                std::string &GetStatsPath () {
+                    static std::string statsPath;
+                    return statsPath;
+                }
+
+                void DumpAtExit () {
+                    THEKOGANS_UTIL_TRY {
+                        const std::string &statsPath = GetStatsPath ();
+                        if (statsPath == VALUE_YES) {
+                            Stats::Instance ().Dump (std::cout);
+                            std::cout.flush ();
+                        }
+                        else {
+                            std::fstream statsFile (
+                                statsPath.c_str (),
+                                std::fstream::out | std::fstream::trunc);
+                            if (statsFile.is_open ()) {
+                                statsFile << Stats::Instance ().ToJSON () << std::endl;
+                            }
+                            else {
+                                THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                                    "Unable to open: %s.",
+                                    statsPath.c_str ());
+                            }
+                        }
+                    }
+                    THEKOGANS_UTIL_CATCH (util::Exception) {
+                        THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                    }
+                }
+
+                struct EnvironmentInitializer {
+                    EnvironmentInitializer () {
+                        GetStatsPath () = util::GetEnvironmentVariable (THEKOGANS_MAKE_CORE_STATS);
+                        if (!GetStatsPath ().empty ()) {
+                            // Make sure Stats outlives DumpAtExit.
+                            Stats::Instance ();
+                            atexit (DumpAtExit);
+                        }
+                    }
+                } environmentInitializer;
+            }
+
+            Stats::Stats () {
+                Reset ();
+            }
+
+            const char *Stats::GetCounterName (Counter counter) {
+                static const char * const names[COUNTER_COUNT] = {
+                    "configs_parsed",
+                    "config_cache_hits",
+                    "eval_calls",
+                    "expand_calls",
+                    "function_calls",
+                    "symbol_lookups",
+                    "environment_lookups",
+                    "environment_misses",
+                    "file_stats",
+                    "directory_scans",
+                    "files_copied",
+                    "bytes_copied",
+                    "manifest_saves",
+                    "child_processes",
+                    "build_systems_generated",
+                    "build_systems_skipped"
+                };
+                return counter < COUNTER_COUNT ? names[counter] : "unknown";
+            }
+
+            void Stats::AddFunctionCall (const std::string &name) {
+                Increment (FUNCTION_CALLS);
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                ++functionCalls[name];
+            }
+
+            void Stats::GetFunctionCalls (std::map<std::string, util::ui64> &functionCalls_) const {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                functionCalls_ = functionCalls;
+            }
+
+            void Stats::Reset () {
+                for (std::size_t i = 0; i < COUNTER_COUNT; ++i) {
+                    counters[i].store (0, std::memory_order_relaxed);
+                }
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                functionCalls.clear ();
+            }
+
+            void Stats::Dump (std::ostream &stream) const {
+                stream << "thekogans_make_core stats:" << std::endl;
+                for (std::size_t i = 0; i < COUNTER_COUNT; ++i) {
+                    stream << "  " << GetCounterName ((Counter)i) << ": " <<
+                        Get ((Counter)i) << std::endl;
+                }
+                std::map<std::string, util::ui64> functionCalls_;
+                GetFunctionCalls (functionCalls_);
+                if (!functionCalls_.empty ()) {
+                    stream << "  functions:" << std::endl;
+                    for (std::map<std::string, util::ui64>::const_iterator
+                            it = functionCalls_.begin (),
+                            end = functionCalls_.end (); it != end; ++it) {
+                        stream << "    " << it->first << ": " << it->second << std::endl;
+                    }
+                }
+            }
+
+            std::string Stats::ToJSON () const {
+                std::ostringstream stream;
+                stream << "{";
+                for (std::size_t i = 0; i < COUNTER_COUNT; ++i) {
+                    stream << EncodeJSONString (GetCounterName ((Counter)i)) << ": " <<
+                        Get ((Counter)i) << ", ";
+                }
+                stream << "\"functions\": {";
+                std::map<std::string, util::ui64> functionCalls_;
+                GetFunctionCalls (functionCalls_);
+                for (std::map<std::string, util::ui64>::const_iterator
+                        it = functionCalls_.begin (),
+                        end = functionCalls_.end (); it != end; ++it) {
+                    if (it != functionCalls_.begin ()) {
+                        stream << ", ";
+                    }
+                    stream << EncodeJSONString (it->first) << ": " << it->second;
+                }
+                stream << "}}";
+                return stream.str ();
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,339 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <map>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/Directory.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/XMLUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/BuildGraph.h"
+#include "thekogans/make/core/BuildHistory.h"
+#include "thekogans/make/core/Console.h"
+#include "thekogans/make/core/Scheduler.h"
+#include "thekogans/make/core/Process.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/TestRunner.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const TAG_TESTSUITES = "testsuites";
+                const char * const TAG_TESTSUITE = "testsuite";
+                const char * const TAG_TESTCASE = "testcase";
+                const char * const TAG_FAILURE = "failure";
+                const char * const TAG_SKIPPED = "skipped";
+                const char * const TAG_SYSTEM_OUT = "system-out";
+                const char * const ATTR_NAME = "name";
+                const char * const ATTR_CLASSNAME = "classname";
+                const char * const ATTR_TESTS = "tests";
+                const char * const ATTR_FAILURES = "failures";
+                const char * const ATTR_SKIPPED = "skipped";
+                const char * const ATTR_TIME = "time";
+                const char * const ATTR_MESSAGE = "message";
+
+                // Used as the estimate for tests that never ran.
+                const util::f64 DEFAULT_TEST_DURATION = 1.0;
+                // Only the tail of a test's output makes it in to the report.
+                const std::size_t MAX_REPORTED_OUTPUT_SIZE = 64 * 1024;
+
+                bool IsSharedLibrary (const std::string &name) {
+                    std::string extension = util::Path (name).GetExtension ();
+                    return extension == "so" || extension == "dylib" ||
+                        name.find (".so.") != std::string::npos;
+                }
+
+                // ELF or Mach-O (thin or universal). Keeps scripts
+                // and fixture data with an exec bit from being run.
+                bool IsBinary (const std::string &path) {
+                    unsigned char magic[4] = {0, 0, 0, 0};
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                    std::ifstream file (ToSystemPath (path).c_str (), std::ios::in | std::ios::binary);
+                    if (!file.is_open () || !file.read ((char *)magic, sizeof (magic))) {
+                        return false;
+                    }
+                    util::ui32 value =
+                        (util::ui32)magic[0] << 24 | (util::ui32)magic[1] << 16 |
+                        (util::ui32)magic[2] << 8 | (util::ui32)magic[3];
+                    return value == 0x7f454c46 ||
+                        value == 0xfeedface || value == 0xfeedfacf ||
+                        value == 0xcefaedfe || value == 0xcffaedfe ||
+                        value == 0xcafebabe;
+                }
+
+                // Only regular files (entry.type == File) get here.
+                bool IsTestProgram (
+                        const std::string &path,
+                        const util::Directory::Entry &entry) {
+                #if defined (TOOLCHAIN_OS_Windows)
+                    return util::Path (entry.name).GetExtension () == "exe";
+                #else // defined (TOOLCHAIN_OS_Windows)
+                    return (entry.mode & 0111) != 0 &&
+                        !IsSharedLibrary (entry.name) && IsBinary (path);
+                #endif // defined (TOOLCHAIN_OS_Windows)
+                }
+
+                void FindTestPrograms (
+                        const std::string &directory,
+                        std::vector<std::string> &programs) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (DIRECTORY_SCANS);
+                    util::Directory directory_ (ToSystemPath (directory));
+                    util::Directory::Entry entry;
+                    for (bool gotEntry = directory_.GetFirstEntry (entry);
+                            gotEntry; gotEntry = directory_.GetNextEntry (entry)) {
+                        if (entry.type == util::Directory::Entry::Folder) {
+                            if (!util::IsDotOrDotDot (entry.name.c_str ())) {
+                                FindTestPrograms (MakePath (directory, entry.name), programs);
+                            }
+                        }
+                        else if (entry.type == util::Directory::Entry::File) {
+                            std::string path = MakePath (directory, entry.name);
+                            if (IsTestProgram (path, entry)) {
+                                programs.push_back (path);
+                            }
+                        }
+                    }
+                }
+
+                bool HasTests (const BuildGraph::Project &project) {
+                    for (std::vector<BuildGraph::Language>::const_iterator
+                            it = project.languages.begin (),
+                            end = project.languages.end (); it != end; ++it) {
+                        if (!it->tests.empty ()) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                // Keep the tail of the output and drop the control
+                // characters XML 1.0 does not allow.
+                std::string GetReportedOutput (const std::string &path) {
+                    std::string output;
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                    std::ifstream stream (ToSystemPath (path).c_str (), std::ios::in | std::ios::binary);
+                    if (stream.is_open ()) {
+                        std::string contents (
+                            (std::istreambuf_iterator<char> (stream)),
+                            std::istreambuf_iterator<char> ());
+                        if (contents.size () > MAX_REPORTED_OUTPUT_SIZE) {
+                            contents.erase (0, contents.size () - MAX_REPORTED_OUTPUT_SIZE);
+                        }
+                        for (std::size_t i = 0, count = contents.size (); i < count; ++i) {
+                            unsigned char ch = (unsigned char)contents[i];
+                            if (ch >= 0x20 || ch == '\t' || ch == '\n' || ch == '\r') {
+                                output += contents[i];
+                            }
+                        }
+                    }
+                    return output;
+                }
+            }
+
+            TestRunner::TestRunner (
+                    const std::string &project_root,
+                    const std::string &config_,
+                    const std::string &type_,
+                    const std::set<std::string> &projects) :
+                    config (config_),
+                    type (type_) {
+                BuildGraph graph (project_root, "make", config, type);
+                build_root = graph.GetRoot ().build_root;
+                std::string variant = BuildHistory::GetVariant (config, type, TARGET_TESTS);
+                for (std::vector<BuildGraph::Project>::const_iterator
+                        it = graph.projects.begin (),
+                        end = graph.projects.end (); it != end; ++it) {
+                    if (HasTests (*it) &&
+                            (projects.empty () || projects.find (it->project_root) != projects.end ())) {
+                        std::string testsRoot = MakePath (it->build_root, TESTS_DIR);
+                        THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                        if (util::Path (ToSystemPath (testsRoot)).Exists ()) {
+                            std::vector<std::string> programs;
+                            FindTestPrograms (testsRoot, programs);
+                            std::sort (programs.begin (), programs.end ());
+                            for (std::vector<std::string>::const_iterator
+                                    jt = programs.begin (),
+                                    end = programs.end (); jt != end; ++jt) {
+                                Test test;
+                                test.project = it->organization + ORGANIZATION_PROJECT_SEPARATOR + it->project;
+                                test.project_root = it->project_root;
+                                test.path = *jt;
+                                test.estimate = BuildHistory::Instance ().GetDuration (
+                                    test.path, variant, DEFAULT_TEST_DURATION);
+                                tests.push_back (test);
+                            }
+                        }
+                    }
+                }
+            }
+
+            util::ui32 TestRunner::Run (util::ui32 concurrency) {
+                if (concurrency == 0) {
+                    concurrency = std::max<util::ui32> (std::thread::hardware_concurrency (), 1);
+                }
+                std::string variant = BuildHistory::GetVariant (config, type, TARGET_TESTS);
+                Scheduler scheduler;
+                for (std::size_t i = 0, count = tests.size (); i < count; ++i) {
+                    Test &test = tests[i];
+                    test.ran = false;
+                    test.passed = false;
+                    test.returnCode = -1;
+                    test.duration = 0.0;
+                    util::ui32 job = scheduler.AddJob (
+                        test.path,
+                        test.estimate,
+                        [&test] () {
+                            Process process (ToSystemPath (test.path));
+                            process.SetOutputPath (ToSystemPath (test.GetOutputPath ()));
+                            THEKOGANS_MAKE_CORE_STATS_INCREMENT (CHILD_PROCESSES);
+                            test.passed = process.Exec ();
+                            test.returnCode = process.GetReturnCode ();
+                            test.duration = process.GetResourceUsage ().wallTime;
+                            test.ran = true;
+                            ProcessAccounting::Instance ().Add (
+                                test.project, TARGET_TESTS, process.GetResourceUsage ());
+                        });
+                    scheduler.AddPostAction (job,
+                        [&test, variant] () {
+                            BuildHistory::Instance ().Add (test.path, variant, test.duration);
+                            THEKOGANS_MAKE_CORE_CONSOLE_INFO ((test.passed ? "PASSED: " : "FAILED: ") <<
+                                test.path << " (" << util::f64Tostring (test.duration, "%.2f") << "s)" <<
+                                std::endl);
+                        });
+                }
+                try {
+                    scheduler.Run (concurrency);
+                }
+                catch (...) {
+                    // Keep the durations of the tests that did run.
+                    BuildHistory::Instance ().Save ();
+                    throw;
+                }
+                BuildHistory::Instance ().Save ();
+                util::ui32 failed = 0;
+                for (std::size_t i = 0, count = tests.size (); i < count; ++i) {
+                    if (!tests[i].passed) {
+                        ++failed;
+                    }
+                }
+                return failed;
+            }
+
+            void TestRunner::WriteJUnit (const std::string &path) const {
+                typedef std::map<std::string, std::vector<const Test *>> Suites;
+                Suites suites;
+                util::ui32 failures = 0;
+                util::ui32 skipped = 0;
+                util::f64 time = 0.0;
+                for (std::size_t i = 0, count = tests.size (); i < count; ++i) {
+                    suites[tests[i].project].push_back (&tests[i]);
+                    if (!tests[i].ran) {
+                        ++skipped;
+                    }
+                    else if (!tests[i].passed) {
+                        ++failures;
+                    }
+                    time += tests[i].duration;
+                }
+                std::string systemPath = ToSystemPath (path);
+                util::Directory::Create (util::Path (systemPath).GetDirectory ());
+                std::fstream junitFile (
+                    systemPath.c_str (),
+                    std::fstream::out | std::fstream::trunc);
+                if (junitFile.is_open ()) {
+                    junitFile << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl;
+                    util::Attributes attributes;
+                    attributes.push_back (util::Attribute (ATTR_TESTS, util::ui32Tostring ((util::ui32)tests.size ())));
+                    attributes.push_back (util::Attribute (ATTR_FAILURES, util::ui32Tostring (failures)));
+                    attributes.push_back (util::Attribute (ATTR_SKIPPED, util::ui32Tostring (skipped)));
+                    attributes.push_back (util::Attribute (ATTR_TIME, util::f64Tostring (time)));
+                    junitFile << util::OpenTag (0, TAG_TESTSUITES, attributes, false, true);
+                    for (Suites::const_iterator
+                            it = suites.begin (),
+                            end = suites.end (); it != end; ++it) {
+                        util::ui32 suiteFailures = 0;
+                        util::ui32 suiteSkipped = 0;
+                        util::f64 suiteTime = 0.0;
+                        for (std::vector<const Test *>::const_iterator
+                                jt = it->second.begin (),
+                                end = it->second.end (); jt != end; ++jt) {
+                            if (!(*jt)->ran) {
+                                ++suiteSkipped;
+                            }
+                            else if (!(*jt)->passed) {
+                                ++suiteFailures;
+                            }
+                            suiteTime += (*jt)->duration;
+                        }
+                        util::Attributes attributes;
+                        attributes.push_back (util::Attribute (ATTR_NAME, util::EncodeXMLCharEntities (it->first)));
+                        attributes.push_back (util::Attribute (ATTR_TESTS, util::ui32Tostring ((util::ui32)it->second.size ())));
+                        attributes.push_back (util::Attribute (ATTR_FAILURES, util::ui32Tostring (suiteFailures)));
+                        attributes.push_back (util::Attribute (ATTR_SKIPPED, util::ui32Tostring (suiteSkipped)));
+                        attributes.push_back (util::Attribute (ATTR_TIME, util::f64Tostring (suiteTime)));
+                        junitFile << util::OpenTag (1, TAG_TESTSUITE, attributes, false, true);
+                        for (std::vector<const Test *>::const_iterator
+                                jt = it->second.begin (),
+                                end = it->second.end (); jt != end; ++jt) {
+                            const Test &test = **jt;
+                            util::Attributes attributes;
+                            attributes.push_back (util::Attribute (ATTR_CLASSNAME, util::EncodeXMLCharEntities (test.project)));
+                            attributes.push_back (
+                                util::Attribute (
+                                    ATTR_NAME,
+                                    util::EncodeXMLCharEntities (util::Path (test.path).GetFullFileName ())));
+                            attributes.push_back (util::Attribute (ATTR_TIME, util::f64Tostring (test.duration)));
+                            junitFile << util::OpenTag (2, TAG_TESTCASE, attributes, false, true);
+                            if (!test.ran) {
+                                junitFile << util::OpenTag (3, TAG_SKIPPED, util::Attributes (), true, true);
+                            }
+                            else {
+                                if (!test.passed) {
+                                    util::Attributes attributes;
+                                    attributes.push_back (
+                                        util::Attribute (
+                                            ATTR_MESSAGE,
+                                            "Exit code: " + util::i32Tostring (test.returnCode)));
+                                    junitFile << util::OpenTag (3, TAG_FAILURE, attributes, true, true);
+                                }
+                                junitFile <<
+                                    util::OpenTag (3, TAG_SYSTEM_OUT, util::Attributes (), false, false) <<
+                                    util::EncodeXMLCharEntities (GetReportedOutput (test.GetOutputPath ())) <<
+                                    util::CloseTag (0, TAG_SYSTEM_OUT);
+                            }
+                            junitFile << util::CloseTag (2, TAG_TESTCASE);
+                        }
+                        junitFile << util::CloseTag (1, TAG_TESTSUITE);
+                    }
+                    junitFile << util::CloseTag (0, TAG_TESTSUITES);
+                }
+                else {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to open: %s.",
+                        systemPath.c_str ());
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -24,6 +24,8 @@
 #endif // defined (THEKOGANS_MAKE_CORE_HAVE_CURL)
 #include "thekogans/make/core/thekogans_make.h"
 #include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/Tracer.h"
 #include "thekogans/make/core/Toolchain.h"
 
 namespace thekogans {
@@ -34,6 +36,8 @@ namespace thekogans {
                     const std::string &organization,
                     const std::string &project,
                     std::string &version) {
+                THEKOGANS_MAKE_CORE_TRACE_SCOPE ("find", "Toolchain::Find");
+                THEKOGANS_MAKE_CORE_TRACE_ARG ("toolchain", organization + "_" + project);
                 bool installed = IsInstalled (organization, project, version);
                 if (!installed) {
                     std::vector<util::Version> versions;
@@ -72,6 +76,7 @@ namespace thekogans {
                     const std::string &organization,
                     const std::string &project,
                     const std::string &version) {
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                 return util::Path (ToSystemPath (GetConfig (organization, project, version))).Exists ();
             }
 
@@ -80,7 +85,9 @@ namespace thekogans {
                     const std::string &project,
                     std::list<std::string> &versions) {
                 std::string path = ToSystemPath (MakePath (_TOOLCHAIN_DIR, CONFIG_DIR));
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                 if (util::Path (path).Exists ()) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (DIRECTORY_SCANS);
                     util::Directory directory (path);
                     util::Directory::Entry entry;
                     for (bool gotEntry = directory.GetFirstEntry (entry);
@@ -115,7 +122,9 @@ namespace thekogans {
                     const std::string &project) {
                 util::Version latestVersion (0, 0, 0);
                 std::string path = ToSystemPath (MakePath (_TOOLCHAIN_DIR, CONFIG_DIR));
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                 if (util::Path (path).Exists ()) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (DIRECTORY_SCANS);
                     util::Directory directory (path);
                     util::Directory::Entry entry;
                     for (bool gotEntry = directory.GetFirstEntry (entry);
@@ -0,0 +1,192 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#if defined (TOOLCHAIN_OS_Windows)
+    #include <windows.h>
+#else // defined (TOOLCHAIN_OS_Windows)
+    #include <unistd.h>
+#endif // defined (TOOLCHAIN_OS_Windows)
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LockGuard.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Tracer.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                const char * const THEKOGANS_MAKE_CORE_TRACE = "THEKOGANS_MAKE_CORE_TRACE";
+                const char * const THEKOGANS_MAKE_CORE_TRACE_THRESHOLD =
+                    "THEKOGANS_MAKE_CORE_TRACE_THRESHOLD";
+
+                // All timestamps are relative to library load.
+                const std::chrono::steady_clock::time_point epoch =
+                    std::chrono::steady_clock::now ();
+
+                util::ui32 GetProcessId () {
+                #if defined (TOOLCHAIN_OS_Windows)
+                    return (util::ui32)GetCurrentProcessId ();
+                #else // defined (TOOLCHAIN_OS_Windows)
+                    return (util::ui32)getpid ();
+                #endif // defined (TOOLCHAIN_OS_Windows)
+                }
+
+                void FlushAtExit () {
+                    THEKOGANS_UTIL_TRY {
+                        Tracer::Instance ().Flush ();
+                    }
+                    THEKOGANS_UTIL_CATCH (util::Exception) {
+                        THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                    }
+                }
+
+                struct EnvironmentInitializer {
+                    EnvironmentInitializer () {
+                        std::string path = util::GetEnvironmentVariable (THEKOGANS_MAKE_CORE_TRACE);
+                        if (!path.empty ()) {
+                            std::string threshold =
+                                util::GetEnvironmentVariable (THEKOGANS_MAKE_CORE_TRACE_THRESHOLD);
+                            Tracer::Instance ().Enable (path,
+                                !threshold.empty () ?
+                                    util::stringToui32 (threshold.c_str ()) :
+                                    (util::ui64)Tracer::DEFAULT_THRESHOLD);
+                        }
+                    }
+                } environmentInitializer;
+            }
+
+            void Tracer::Scope::AddArg (
+                    const char *key,
+                    const std::string &value) {
+                if (!args.empty ()) {
+                    args += ", ";
+                }
+                args += EncodeJSONString (key) + ": " + EncodeJSONString (value);
+            }
+
+            void Tracer::Scope::End () {
+                Tracer::Instance ().AddEvent (category, name, start, threshold, args);
+            }
+
+            volatile bool Tracer::enabled = false;
+
+            Tracer::Tracer () :
+                thresholdDuration (DEFAULT_THRESHOLD) {}
+
+            util::ui64 Tracer::Now () {
+                return (util::ui64)std::chrono::duration_cast<std::chrono::microseconds> (
+                    std::chrono::steady_clock::now () - epoch).count ();
+            }
+
+            void Tracer::Enable (
+                    const std::string &path_,
+                    util::ui64 thresholdDuration_) {
+                if (!path_.empty ()) {
+                    util::LockGuard<util::SpinLock> guard (spinLock);
+                    if (path.empty ()) {
+                        atexit (FlushAtExit);
+                    }
+                    path = path_;
+                    thresholdDuration = thresholdDuration_;
+                    enabled = true;
+                }
+                else {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE_EINVAL);
+                }
+            }
+
+            void Tracer::Disable () {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                enabled = false;
+            }
+
+            void Tracer::Flush () {
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                if (!path.empty () && !events.empty ()) {
+                    std::fstream traceFile (
+                        path.c_str (),
+                        std::fstream::out | std::fstream::trunc);
+                    if (traceFile.is_open ()) {
+                        util::ui32 processId = GetProcessId ();
+                        traceFile << "{\"traceEvents\": [\n";
+                        for (std::map<std::thread::id, util::ui32>::const_iterator
+                                it = threadIds.begin (),
+                                end = threadIds.end (); it != end; ++it) {
+                            traceFile << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " <<
+                                processId << ", \"tid\": " << it->second <<
+                                ", \"args\": {\"name\": \"thread " << it->second << "\"}},\n";
+                        }
+                        for (std::size_t i = 0, count = events.size (); i < count; ++i) {
+                            const Event &event = events[i];
+                            traceFile << "{\"name\": " << EncodeJSONString (event.name) <<
+                                ", \"cat\": " << EncodeJSONString (event.category) <<
+                                ", \"ph\": \"X\", \"ts\": " << event.start <<
+                                ", \"dur\": " << event.duration <<
+                                ", \"pid\": " << processId <<
+                                ", \"tid\": " << event.threadId;
+                            if (!event.args.empty ()) {
+                                traceFile << ", \"args\": {" << event.args << "}";
+                            }
+                            traceFile << (i + 1 < count ? "},\n" : "}\n");
+                        }
+                        traceFile << "], \"displayTimeUnit\": \"ms\"}\n";
+                    }
+                    else {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Unable to open: %s.",
+                            path.c_str ());
+                    }
+                }
+            }
+
+            void Tracer::AddEvent (
+                    const char *category,
+                    const char *name,
+                    util::ui64 start,
+                    bool threshold,
+                    const std::string &args) {
+                util::ui64 duration = Now () - start;
+                util::LockGuard<util::SpinLock> guard (spinLock);
+                if (!threshold || duration >= thresholdDuration) {
+                    std::thread::id id = std::this_thread::get_id ();
+                    std::map<std::thread::id, util::ui32>::const_iterator it = threadIds.find (id);
+                    if (it == threadIds.end ()) {
+                        it = threadIds.insert (
+                            std::map<std::thread::id, util::ui32>::value_type (
+                                id, (util::ui32)threadIds.size () + 1)).first;
+                    }
+                    Event event;
+                    event.category = category;
+                    event.name = name;
+                    event.start = start;
+                    event.duration = duration;
+                    event.threadId = it->second;
+                    event.args = args;
+                    events.push_back (event);
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -0,0 +1,109 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/Directory.h"
+#include "thekogans/util/StringUtils.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/Unity.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            namespace {
+                // FNV-1a. Stable across runs and platforms.
+                util::ui32 HashName (const std::string &name) {
+                    util::ui32 hash = 2166136261u;
+                    for (std::size_t i = 0, count = name.size (); i < count; ++i) {
+                        hash ^= (util::ui8)name[i];
+                        hash *= 16777619u;
+                    }
+                    return hash;
+                }
+            }
+
+            void Unity::GetBatches (
+                    const std::vector<std::string> &files,
+                    util::ui32 batchSize,
+                    const std::string &extension,
+                    std::vector<Batch> &batches) {
+                std::vector<std::string> sorted = files;
+                std::sort (sorted.begin (), sorted.end ());
+                batchSize = std::max<util::ui32> (batchSize, 1);
+                Batch batch;
+                for (std::size_t i = 0, count = sorted.size (); i < count; ++i) {
+                    batch.files.push_back (sorted[i]);
+                    // A file ends its batch if its name hash says so
+                    // (on average every batchSize files), or if the
+                    // batch got too big.
+                    if (HashName (util::Path (sorted[i]).GetFullFileName ()) % batchSize == 0 ||
+                            batch.files.size () >= 2 * batchSize ||
+                            i + 1 == count) {
+                        // Named after its first file, which only
+                        // changes if a file is added before it.
+                        batch.name = "unity_" +
+                            util::ui32Tostring (HashName (batch.files[0]), "%08x") + extension;
+                        batches.push_back (batch);
+                        batch = Batch ();
+                    }
+                }
+            }
+
+            bool Unity::WriteBatch (
+                    const std::string &directory,
+                    const Batch &batch) {
+                std::ostringstream contents;
+                contents << "// Generated by thekogans_make. Do not edit." << std::endl;
+                for (std::vector<std::string>::const_iterator
+                        it = batch.files.begin (),
+                        end = batch.files.end (); it != end; ++it) {
+                    contents << "#include \"" << *it << "\"" << std::endl;
+                }
+                std::string path = ToSystemPath (MakePath (directory, batch.name));
+                {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
+                    std::ifstream existing (path.c_str ());
+                    if (existing.is_open ()) {
+                        std::string existingContents (
+                            (std::istreambuf_iterator<char> (existing)),
+                            std::istreambuf_iterator<char> ());
+                        // Leave the timestamp alone. Its object is up to date.
+                        if (existingContents == contents.str ()) {
+                            return false;
+                        }
+                    }
+                }
+                util::Directory::Create (util::Path (path).GetDirectory ());
+                std::ofstream file (path.c_str (), std::ofstream::out | std::ofstream::trunc);
+                if (!file.is_open ()) {
+                    THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                        "Unable to open: %s.",
+                        path.c_str ());
+                }
+                file << contents.str ();
+                return true;
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
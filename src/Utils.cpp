@@ -23,7 +23,13 @@
 #include <set>
 #include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <fstream>
+#include <vector>
+#include <map>
+#include <memory>
+#include <exception>
+#include <thread>
 #include "thekogans/util/FixedArray.h"
 #include "thekogans/util/Array.h"
 #include "thekogans/util/Path.h"
@@ -33,7 +39,6 @@
 #include "thekogans/util/Version.h"
 #include "thekogans/util/Plugins.h"
 #include "thekogans/util/SHA2.h"
-#include "thekogans/util/ChildProcess.h"
 #if defined (TOOLCHAIN_OS_Windows)
     #include "thekogans/util/WindowsUtils.h"
 #endif // defined (TOOLCHAIN_OS_Windows)
@@ -46,7 +51,19 @@
 #include "thekogans/make/core/Generator.h"
 #include "thekogans/make/core/Project.h"
 #include "thekogans/make/core/Toolchain.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/Tracer.h"
+#include "thekogans/make/core/Process.h"
+#include "thekogans/make/core/BuildHistory.h"
+#include "thekogans/make/core/ResourceBudget.h"
+#include "thekogans/make/core/Scheduler.h"
+#include "thekogans/make/core/BuildProgress.h"
+#include "thekogans/make/core/ProjectGraph.h"
+#include "thekogans/make/core/Fingerprint.h"
+#include "thekogans/make/core/BuildGraph.h"
+#include "thekogans/make/core/Executor.h"
 #include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Console.h"
 
 namespace thekogans {
     namespace make {
@@ -349,6 +366,7 @@ namespace thekogans {
                     const std::string &generator,
                     const std::string &config,
                     const std::string &type) {
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                 return util::Path (
                     ToSystemPath (
                         GetBuildRoot (project_root, generator, config, type))).Exists ();
@@ -361,6 +379,7 @@ namespace thekogans {
                     const std::string &type) {
                 std::string buildRoot =
                     ToSystemPath (GetBuildRoot (project_root, generator, config, type));
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                 if (!util::Path (buildRoot).Exists ()) {
                     util::Directory::Create (buildRoot);
                 }
@@ -489,16 +508,55 @@ namespace thekogans {
                 return util::Hash::DigestTostring (digest);
             }
 
+            _LIB_THEKOGANS_MAKE_CORE_DECL std::string _LIB_THEKOGANS_MAKE_CORE_API EncodeJSONString (
+                    const std::string &value) {
+                std::string encoded;
+                encoded.reserve (value.size () + 2);
+                encoded += '"';
+                for (std::size_t i = 0, count = value.size (); i < count; ++i) {
+                    char ch = value[i];
+                    switch (ch) {
+                        case '"':
+                            encoded += "\\\"";
+                            break;
+                        case '\\':
+                            encoded += "\\\\";
+                            break;
+                        case '\n':
+                            encoded += "\\n";
+                            break;
+                        case '\r':
+                            encoded += "\\r";
+                            break;
+                        case '\t':
+                            encoded += "\\t";
+                            break;
+                        default:
+                            if ((util::ui8)ch < 0x20) {
+                                encoded += util::FormatString ("\\u%04x", (util::ui8)ch);
+                            }
+                            else {
+                                encoded += ch;
+                            }
+                            break;
+                    }
+                }
+                encoded += '"';
+                return encoded;
+            }
+
             _LIB_THEKOGANS_MAKE_CORE_DECL bool _LIB_THEKOGANS_MAKE_CORE_API CopyFile (
                     const std::string &from,
                     const std::string &to) {
                 std::string fromPath = ToSystemPath (from);
                 std::string toPath = ToSystemPath (to);
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                 if (!util::Path (toPath).Exists () ||
                         util::Directory::Entry (toPath).lastModifiedDate <
                         util::Directory::Entry (fromPath).lastModifiedDate) {
-                    std::cout << "Copying " << from << " -> " << to << std::endl;
-                    std::cout.flush ();
+                    THEKOGANS_MAKE_CORE_TRACE_SCOPE ("install", "CopyFile");
+                    THEKOGANS_MAKE_CORE_TRACE_ARG ("from", from);
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Copying " << from << " -> " << to << std::endl);
                     util::Directory::Create (util::Path (toPath).GetDirectory ());
                     util::ReadOnlyFile fromFile (util::HostEndian, fromPath);
                 #if defined (TOOLCHAIN_OS_Windows)
@@ -520,7 +578,9 @@ namespace thekogans {
                             count != 0;
                             count = fromFile.Read (buffer.array, 4096)) {
                         toFile.Write (buffer.array, count);
+                        THEKOGANS_MAKE_CORE_STATS_ADD (BYTES_COPIED, count);
                     }
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILES_COPIED);
                     return true;
                 }
                 return false;
@@ -528,9 +588,9 @@ namespace thekogans {
 
             _LIB_THEKOGANS_MAKE_CORE_DECL bool _LIB_THEKOGANS_MAKE_CORE_API DeleteFile (const std::string &file) {
                 util::Path path (ToSystemPath (file));
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                 if (path.Exists ()) {
-                    std::cout << "Deleting " << file << std::endl;
-                    std::cout.flush ();
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Deleting " << file << std::endl);
                     path.Delete ();
                     return true;
                 }
@@ -543,14 +603,14 @@ namespace thekogans {
                         const std::string &folderName) {
                     util::Directory directory (ToSystemPath (path));
                     util::Directory::Entry entry;
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (DIRECTORY_SCANS);
                     for (bool gotEntry = directory.GetFirstEntry (entry);
                             gotEntry; gotEntry = directory.GetNextEntry (entry)) {
                         if (entry.type == util::Directory::Entry::Folder &&
                                 !util::IsDotOrDotDot (entry.name.c_str ())) {
                             if (entry.name == folderName) {
                                 std::string folder = MakePath (path, entry.name);
-                                std::cout << "Deleting " << folder << std::endl;
-                                std::cout.flush ();
+                                THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Deleting " << folder << std::endl);
                                 util::Path (ToSystemPath (folder)).Delete ();
                             }
                             else {
@@ -675,8 +735,7 @@ namespace thekogans {
                         }
                     }
                     std::string configFilePath = MakePath (project_root, config_file);
-                    std::cout << "Uninstalling " << configFilePath << std::endl;
-                    std::cout.flush ();
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Uninstalling " << configFilePath << std::endl);
                     DeleteFolders (
                         project_root,
                         GetFileName (organization, project, std::string (), version, std::string ()));
@@ -793,6 +852,8 @@ namespace thekogans {
                     const std::string &config_,
                     const std::string &type,
                     const std::string &destination) {
+                THEKOGANS_MAKE_CORE_TRACE_SCOPE ("install", "CopyDependencies");
+                THEKOGANS_MAKE_CORE_TRACE_ARG ("project_root", project_root);
                 const thekogans_make &config = thekogans_make::GetConfig (
                     project_root,
                     THEKOGANS_MAKE_XML,
@@ -820,9 +881,8 @@ namespace thekogans {
                     if (util::Path (fromPluginsPath).Exists ()) {
                         if (util::Path (toPluginsPath).Exists ()) {
                             // Merge fromPluginsPath and toPluginsPath.
-                            std::cout << "Merging " << *it + EXT_SEPARATOR + PLUGINS_EXT << " and " <<
-                                sharedLibrary + EXT_SEPARATOR + PLUGINS_EXT << std::endl;
-                            std::cout.flush ();
+                            THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Merging " << *it + EXT_SEPARATOR + PLUGINS_EXT << " and " <<
+                                sharedLibrary + EXT_SEPARATOR + PLUGINS_EXT << std::endl);
                             if (util::Directory::Entry (toPluginsPath).lastModifiedDate <
                                     util::Directory::Entry (fromPluginsPath).lastModifiedDate) {
                                 util::Plugins fromPlugins (fromPluginsPath);
@@ -1043,18 +1103,209 @@ namespace thekogans {
                 return generatorList;
             }
 
+            namespace {
+                util::ui32 AddGenerateJob (
+                        const thekogans_make &config,
+                        const std::string &generator,
+                        bool rootProject,
+                        bool force,
+                        const Fingerprint::Map &fingerprints,
+                        Scheduler &scheduler,
+                        std::vector<std::exception_ptr> &errors,
+                        std::map<std::string, util::ui32> &generatedProjects) {
+                    std::string configKey = GetConfigKey (
+                        config.project_root,
+                        config.config_file,
+                        generator,
+                        config.config,
+                        config.type);
+                    std::map<std::string, util::ui32>::const_iterator it =
+                        generatedProjects.find (configKey);
+                    if (it != generatedProjects.end ()) {
+                        return it->second;
+                    }
+                    // Dependencies are added first so that job order
+                    // matches the order of sequential generation.
+                    std::set<util::ui32> dependencies;
+                    const std::list<thekogans_make::Dependency::Ptr> *dependencyLists[] = {
+                        &config.dependencies,
+                        &config.plugin_hosts
+                    };
+                    for (std::size_t i = 0; i < 2; ++i) {
+                        for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
+                                jt = dependencyLists[i]->begin (),
+                                end = dependencyLists[i]->end (); jt != end; ++jt) {
+                            if ((*jt)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                                dependencies.insert (
+                                    AddGenerateJob (
+                                        thekogans_make::GetConfig (
+                                            (*jt)->GetProjectRoot (),
+                                            (*jt)->GetConfigFile (),
+                                            generator,
+                                            (*jt)->GetConfig (),
+                                            (*jt)->GetType ()),
+                                        generator,
+                                        false,
+                                        force,
+                                        fingerprints,
+                                        scheduler,
+                                        errors,
+                                        generatedProjects));
+                            }
+                        }
+                    }
+                    Scheduler::Action action;
+                    Fingerprint::Map::const_iterator fingerprint = fingerprints.find (
+                        Fingerprint::GetPath (
+                            config.project_root,
+                            generator,
+                            config.config,
+                            config.type));
+                    // Generators are created here, on the calling
+                    // thread, one per project so that no two jobs
+                    // share an instance.
+                    Generator::SharedPtr generator_ = Generator::Get (generator, rootProject);
+                    if (force || fingerprint == fingerprints.end () ||
+                            !Fingerprint::IsUpToDate (
+                                fingerprint->first,
+                                fingerprint->second,
+                                generator_->GetOutputFile ())) {
+                        std::size_t error = errors.size ();
+                        errors.push_back (std::exception_ptr ());
+                        std::string project_root = config.project_root;
+                        std::string config_ = config.config;
+                        std::string type = config.type;
+                        action = [generator_, project_root, config_, type, force, error, &errors] () {
+                            try {
+                                generator_->Generate (project_root, config_, type, false, force);
+                                THEKOGANS_MAKE_CORE_STATS_INCREMENT (BUILD_SYSTEMS_GENERATED);
+                            }
+                            catch (...) {
+                                errors[error] = std::current_exception ();
+                            }
+                        };
+                    }
+                    else {
+                        THEKOGANS_MAKE_CORE_STATS_INCREMENT (BUILD_SYSTEMS_SKIPPED);
+                    }
+                    util::ui32 job = scheduler.AddJob (config.project_root, 1.0, action);
+                    for (std::set<util::ui32>::const_iterator
+                            jt = dependencies.begin (),
+                            end = dependencies.end (); jt != end; ++jt) {
+                        scheduler.AddDependency (job, *jt);
+                    }
+                    generatedProjects[configKey] = job;
+                    return job;
+                }
+
+                void GenerateParallel (
+                        const std::string &project_root,
+                        const std::string &generator,
+                        const std::string &config,
+                        const std::string &type,
+                        bool force,
+                        const Fingerprint::Map &fingerprints,
+                        util::ui32 concurrency) {
+                    // Building the DAG parses every config in the graph
+                    // on this thread, so the jobs mostly hit the cache.
+                    // Anything else a generator asks for (a toolchain
+                    // dependency of a different variant, ...) is parsed
+                    // under GetConfig's lock.
+                    Scheduler scheduler;
+                    std::vector<std::exception_ptr> errors;
+                    std::map<std::string, util::ui32> generatedProjects;
+                    AddGenerateJob (
+                        thekogans_make::GetConfig (
+                            project_root,
+                            THEKOGANS_MAKE_XML,
+                            generator,
+                            config,
+                            type),
+                        generator,
+                        true,
+                        force,
+                        fingerprints,
+                        scheduler,
+                        errors,
+                        generatedProjects);
+                    if (concurrency == 0) {
+                        concurrency = std::max (1u, std::thread::hardware_concurrency ());
+                    }
+                    // Every project is generated even if some fail. Errors
+                    // are reported in sequential generation order; the
+                    // first one is rethrown, the rest are logged.
+                    scheduler.Run (concurrency);
+                    std::exception_ptr error;
+                    for (std::size_t i = 0, count = errors.size (); i < count; ++i) {
+                        if (errors[i]) {
+                            if (!error) {
+                                error = errors[i];
+                            }
+                            else {
+                                try {
+                                    std::rethrow_exception (errors[i]);
+                                }
+                                catch (const util::Exception &exception) {
+                                    THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                                }
+                                catch (...) {
+                                }
+                            }
+                        }
+                    }
+                    if (error) {
+                        std::rethrow_exception (error);
+                    }
+                }
+            }
+
             _LIB_THEKOGANS_MAKE_CORE_DECL void _LIB_THEKOGANS_MAKE_CORE_API CreateBuildSystem (
                     const std::string &project_root,
                     const std::string &generator_,
                     const std::string &config,
                     const std::string &type,
                     bool generateDependencies,
-                    bool force) {
+                    bool force,
+                    util::ui32 concurrency) {
                 Generator::SharedPtr generator = Generator::Get (generator_, true);
                 if (generator.Get () != 0) {
                     if (config == CONFIG_DEBUG || config == CONFIG_RELEASE) {
                         if (type == TYPE_SHARED || type == TYPE_STATIC) {
-                            generator->Generate (project_root, config, type, generateDependencies, force);
+                            Fingerprint::Map fingerprints;
+                            Fingerprint::Compute (
+                                project_root,
+                                generator_,
+                                generator->GetVersion (),
+                                config,
+                                type,
+                                generateDependencies,
+                                fingerprints);
+                            if (!force && Fingerprint::IsUpToDate (fingerprints, generator->GetOutputFile ())) {
+                                THEKOGANS_MAKE_CORE_STATS_INCREMENT (BUILD_SYSTEMS_SKIPPED);
+                            }
+                            else {
+                                if (generator->UsesBuildGraph ()) {
+                                    BuildGraph graph (project_root, generator_, config, type);
+                                    graph.WriteUnityBatches ();
+                                    generator->GenerateFromGraph (graph, generateDependencies, force);
+                                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (BUILD_SYSTEMS_GENERATED);
+                                }
+                                else if (generateDependencies && concurrency != 1 && generator->IsThreadSafe ()) {
+                                    GenerateParallel (
+                                        project_root,
+                                        generator_,
+                                        config,
+                                        type,
+                                        force,
+                                        fingerprints,
+                                        concurrency);
+                                }
+                                else {
+                                    generator->Generate (project_root, config, type, generateDependencies, force);
+                                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (BUILD_SYSTEMS_GENERATED);
+                                }
+                                Fingerprint::Save (fingerprints);
+                            }
                         }
                         else {
                             THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
@@ -1086,6 +1337,22 @@ namespace thekogans {
                 if (generator.Get () != 0) {
                     if (config == CONFIG_DEBUG || config == CONFIG_RELEASE) {
                         if (type == TYPE_SHARED || type == TYPE_STATIC) {
+                            // Without the build system, the fingerprints
+                            // would only lie to the next CreateBuildSystem.
+                            Fingerprint::Map fingerprints;
+                            Fingerprint::Compute (
+                                project_root,
+                                generator_,
+                                generator->GetVersion (),
+                                config,
+                                type,
+                                deleteDependencies,
+                                fingerprints);
+                            for (Fingerprint::Map::const_iterator
+                                    it = fingerprints.begin (),
+                                    end = fingerprints.end (); it != end; ++it) {
+                                Fingerprint::Delete (it->first);
+                            }
                             generator->Delete (project_root, config, type, deleteDependencies);
                         }
                         else {
@@ -1109,12 +1376,26 @@ namespace thekogans {
             }
 
             namespace {
-                void Execgnu_make (
+                // Concurrent make runs stream their output line by
+                // line, each line prefixed with its project and variant.
+                inline std::string GetOutputPrefix (
+                        bool streamOutput,
+                        const std::string &project,
+                        const std::string &variant) {
+                    return streamOutput ? "[" + project + ":" + variant + "] " : std::string ();
+                }
+
+                ResourceUsage Execgnu_make (
+                        const std::string &project,
                         const std::string &build_root,
                         const std::string &gnu_make,
                         const std::list<std::string> &arguments,
-                        const std::string &target) {
-                    util::ChildProcess gnu_makeProcess (gnu_make);
+                        const std::string &target,
+                        const std::string &outputPrefix) {
+                    THEKOGANS_MAKE_CORE_TRACE_SCOPE ("build", "gnu_make");
+                    THEKOGANS_MAKE_CORE_TRACE_ARG ("build_root", build_root);
+                    THEKOGANS_MAKE_CORE_TRACE_ARG ("target", target);
+                    Process gnu_makeProcess (gnu_make);
                     gnu_makeProcess.AddArgument ("-f");
                     gnu_makeProcess.AddArgument (MakePath (build_root, MAKEFILE));
                     for (std::list<std::string>::const_iterator
@@ -1123,87 +1404,224 @@ namespace thekogans {
                         gnu_makeProcess.AddArgument (*it);
                     }
                     gnu_makeProcess.AddArgument (target);
-                    util::ChildProcess::ChildStatus childStatus = gnu_makeProcess.Exec ();
-                    if (childStatus == util::ChildProcess::Failed ||
-                            gnu_makeProcess.GetReturnCode () != 0) {
+                    if (!outputPrefix.empty ()) {
+                        gnu_makeProcess.SetOutputPrefix (
+                            outputPrefix,
+                            ToSystemPath (MakePath (build_root, BUILD_LOG)));
+                    }
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (CHILD_PROCESSES);
+                    bool result = gnu_makeProcess.Exec ();
+                    ProcessAccounting::Instance ().Add (
+                        project, target, gnu_makeProcess.GetResourceUsage ());
+                    if (!result) {
                         THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
                             "Unable to execute '%s'.",
                             gnu_makeProcess.BuildCommandLine ().c_str ());
                     }
+                    return gnu_makeProcess.GetResourceUsage ();
+                }
+
+                // Projects whose make links a program, a plugin or a shared
+                // library take a link token. The rest only compile (and archive).
+                ResourceBudget::Pool GetPool (
+                        const thekogans_make &config,
+                        const std::string &type,
+                        const std::string &target) {
+                    return target != TARGET_CLEAN &&
+                        (config.project_type == PROJECT_TYPE_PROGRAM ||
+                            config.project_type == PROJECT_TYPE_PLUGIN ||
+                            (config.project_type == PROJECT_TYPE_LIBRARY && type == TYPE_SHARED)) ?
+                        ResourceBudget::Link : ResourceBudget::Compile;
                 }
 
-                void BuildProjectHelper (
+                void BuildProjectDependencies (
+                    const thekogans_make &config,
+                    util::ui32 job,
+                    const std::string &gnu_make,
+                    const std::list<std::string> &arguments,
+                    bool streamOutput,
+                    const std::string &target,
+                    util::f64 defaultDuration,
+                    const std::set<std::string> &projects,
+                    Scheduler &scheduler,
+                    std::map<std::string, util::ui32> &builtProjects);
+
+                // Every project is a Scheduler job. Configs are loaded (and
+                // post actions are run) on the calling thread. Only gnu make
+                // runs on the workers.
+                util::ui32 BuildProjectHelper (
                         const std::string &project_root,
                         const std::string &config_,
                         const std::string &type,
                         const std::string &gnu_make,
                         const std::list<std::string> &arguments,
+                        bool streamOutput,
                         const std::string &target,
-                        std::set<std::string> &builtProjects) {
-                    if (builtProjects.find (project_root) == builtProjects.end ()) {
-                        builtProjects.insert (project_root);
-                        const thekogans_make &config = thekogans_make::GetConfig (
-                            project_root,
-                            THEKOGANS_MAKE_XML,
-                            MAKE,
-                            config_,
-                            type);
-                        if (config.project_type == PROJECT_TYPE_PLUGIN) {
-                            for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
-                                    it = config.plugin_hosts.begin (),
-                                    end = config.plugin_hosts.end (); it != end; ++it) {
-                                if ((*it)->GetConfigFile () == THEKOGANS_MAKE_XML) {
-                                    BuildProjectHelper (
+                        util::f64 defaultDuration,
+                        const std::set<std::string> &projects,
+                        Scheduler &scheduler,
+                        std::map<std::string, util::ui32> &builtProjects) {
+                    std::map<std::string, util::ui32>::const_iterator builtProject =
+                        builtProjects.find (project_root);
+                    if (builtProject != builtProjects.end ()) {
+                        return builtProject->second;
+                    }
+                    const thekogans_make &config = thekogans_make::GetConfig (
+                        project_root,
+                        THEKOGANS_MAKE_XML,
+                        MAKE,
+                        config_,
+                        type);
+                    std::string project = config.organization + ORGANIZATION_PROJECT_SEPARATOR + config.project;
+                    std::string build_root = GetBuildRoot (project_root, "make", config_, type);
+                    std::string variant = BuildHistory::GetVariant (config_, type, target);
+                    // Projects outside the slice still get a (no-op) job
+                    // so that the dependencies between the ones inside
+                    // it stay intact.
+                    if (!projects.empty () && projects.find (project_root) == projects.end ()) {
+                        util::ui32 job = scheduler.AddJob (project, 0.0, Scheduler::Action ());
+                        builtProjects.insert (std::map<std::string, util::ui32>::value_type (project_root, job));
+                        BuildProjectDependencies (
+                            config,
+                            job,
+                            gnu_make,
+                            arguments,
+                            streamOutput,
+                            target,
+                            defaultDuration,
+                            projects,
+                            scheduler,
+                            builtProjects);
+                        return job;
+                    }
+                    std::string outputPrefix = GetOutputPrefix (streamOutput, project, variant);
+                    ResourceBudget::Pool pool = GetPool (config, type, target);
+                    // Written by the worker, read by the post action.
+                    std::shared_ptr<util::ui64> maxRSS (new util::ui64 (0));
+                    util::ui32 job = scheduler.AddJob (
+                        project,
+                        BuildHistory::Instance ().GetDuration (project_root, variant, defaultDuration),
+                        [project, build_root, gnu_make, arguments, target, outputPrefix, maxRSS] () {
+                            *maxRSS = Execgnu_make (
+                                project, build_root, gnu_make, arguments, target, outputPrefix).maxRSS;
+                        },
+                        pool,
+                        target == TARGET_CLEAN ? 0 :
+                            BuildHistory::Instance ().GetMaxRSS (project_root, variant,
+                                pool == ResourceBudget::Link ?
+                                    ResourceBudget::DEFAULT_LINK_MEMORY :
+                                    ResourceBudget::DEFAULT_COMPILE_MEMORY));
+                    builtProjects.insert (std::map<std::string, util::ui32>::value_type (project_root, job));
+                    scheduler.AddPostAction (job,
+                        [&scheduler, job, project_root, variant, maxRSS] () {
+                            BuildHistory::Instance ().Add (
+                                project_root, variant, scheduler.jobs[job].duration);
+                            BuildHistory::Instance ().AddMaxRSS (project_root, variant, *maxRSS);
+                        });
+                    BuildProjectDependencies (
+                        config,
+                        job,
+                        gnu_make,
+                        arguments,
+                        streamOutput,
+                        target,
+                        defaultDuration,
+                        projects,
+                        scheduler,
+                        builtProjects);
+                    if (target == TARGET_CLEAN) {
+                        scheduler.AddPostAction (job,
+                            [build_root] () {
+                                DeleteFile (MakePath (build_root, MAKEFILE));
+                                Fingerprint::Delete (MakePath (build_root, FINGERPRINT_FILE));
+                            });
+                    }
+                    return job;
+                }
+
+                void BuildProjectDependencies (
+                        const thekogans_make &config,
+                        util::ui32 job,
+                        const std::string &gnu_make,
+                        const std::list<std::string> &arguments,
+                        bool streamOutput,
+                        const std::string &target,
+                        util::f64 defaultDuration,
+                        const std::set<std::string> &projects,
+                        Scheduler &scheduler,
+                        std::map<std::string, util::ui32> &builtProjects) {
+                    if (config.project_type == PROJECT_TYPE_PLUGIN) {
+                        for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
+                                it = config.plugin_hosts.begin (),
+                                end = config.plugin_hosts.end (); it != end; ++it) {
+                            if ((*it)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                                util::ui32 plugin_hostJob = BuildProjectHelper (
+                                    (*it)->GetProjectRoot (),
+                                    (*it)->GetConfig (),
+                                    (*it)->GetType (),
+                                    gnu_make,
+                                    arguments,
+                                    streamOutput,
+                                    target == TARGET_TESTS_SELF ? TARGET_ALL : target,
+                                    defaultDuration,
+                                    projects,
+                                    scheduler,
+                                    builtProjects);
+                                scheduler.AddDependency (job, plugin_hostJob);
+                                if (target == TARGET_ALL || target == TARGET_TESTS) {
+                                    const core::thekogans_make &plugin_host = thekogans_make::GetConfig (
                                         (*it)->GetProjectRoot (),
+                                        (*it)->GetConfigFile (),
+                                        (*it)->GetGenerator (),
                                         (*it)->GetConfig (),
-                                        (*it)->GetType (),
-                                        gnu_make,
-                                        arguments,
-                                        target == TARGET_TESTS_SELF ? TARGET_ALL : target,
-                                        builtProjects);
-                                    if (target == TARGET_ALL || target == TARGET_TESTS) {
-                                        const core::thekogans_make &plugin_host = thekogans_make::GetConfig (
-                                            (*it)->GetProjectRoot (),
-                                            (*it)->GetConfigFile (),
-                                            (*it)->GetGenerator (),
-                                            (*it)->GetConfig (),
-                                            (*it)->GetType ());
-                                        if (plugin_host.project_type == PROJECT_TYPE_PROGRAM) {
-                                            CopyDependencies (
-                                                (*it)->GetProjectRoot (),
-                                                (*it)->GetConfig (),
-                                                (*it)->GetType ());
-                                        }
-                                        else if (plugin_host.project_type == PROJECT_TYPE_PLUGIN) {
-                                            CopyPlugin (
-                                                (*it)->GetProjectRoot (),
-                                                (*it)->GetConfig ());
-                                        }
+                                        (*it)->GetType ());
+                                    std::string plugin_hostRoot = (*it)->GetProjectRoot ();
+                                    std::string plugin_hostConfig = (*it)->GetConfig ();
+                                    std::string plugin_hostType = (*it)->GetType ();
+                                    if (plugin_host.project_type == PROJECT_TYPE_PROGRAM) {
+                                        scheduler.AddPostAction (plugin_hostJob,
+                                            [plugin_hostRoot, plugin_hostConfig, plugin_hostType] () {
+                                                CopyDependencies (
+                                                    plugin_hostRoot,
+                                                    plugin_hostConfig,
+                                                    plugin_hostType);
+                                            });
+                                    }
+                                    else if (plugin_host.project_type == PROJECT_TYPE_PLUGIN) {
+                                        scheduler.AddPostAction (plugin_hostJob,
+                                            [plugin_hostRoot, plugin_hostConfig] () {
+                                                CopyPlugin (
+                                                    plugin_hostRoot,
+                                                    plugin_hostConfig);
+                                            });
                                     }
                                 }
                             }
                         }
-                        for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
-                                it = config.dependencies.begin (),
-                                end = config.dependencies.end (); it != end; ++it) {
-                            if ((*it)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                    }
+                    for (std::list<thekogans_make::Dependency::Ptr>::const_iterator
+                            it = config.dependencies.begin (),
+                            end = config.dependencies.end (); it != end; ++it) {
+                        if ((*it)->GetConfigFile () == THEKOGANS_MAKE_XML) {
+                            scheduler.AddDependency (job,
                                 BuildProjectHelper (
                                     (*it)->GetProjectRoot (),
                                     (*it)->GetConfig (),
                                     (*it)->GetType (),
                                     gnu_make,
                                     arguments,
+                                    streamOutput,
                                     target == TARGET_TESTS_SELF ? TARGET_ALL : target,
-                                    builtProjects);
-                            }
-                        }
-                        std::string build_root = GetBuildRoot (project_root, "make", config_, type);
-                        Execgnu_make (build_root, gnu_make, arguments, target);
-                        if (target == TARGET_CLEAN) {
-                            DeleteFile (MakePath (build_root, MAKEFILE));
+                                    defaultDuration,
+                                    projects,
+                                    scheduler,
+                                    builtProjects));
                         }
                     }
                 }
+
+                // Used as the estimate for projects that were never built.
+                const util::f64 DEFAULT_BUILD_DURATION = 1.0;
             }
 
             _LIB_THEKOGANS_MAKE_CORE_DECL void _LIB_THEKOGANS_MAKE_CORE_API BuildProject (
@@ -1213,14 +1631,17 @@ namespace thekogans {
                     const std::string &mode,
                     bool hide_commands,
                     bool parallel_build,
-                    const std::string &target) {
+                    const std::string &target,
+                    util::ui32 concurrency,
+                    const std::set<std::string> &projects) {
                 CreateBuildSystem (
                     project_root,
                     "make",
                     config_,
                     target == TARGET_TESTS || target == TARGET_TESTS_SELF ? TYPE_STATIC : type,
                     true,
-                    false);
+                    false,
+                    concurrency);
                 std::string gnu_make =
                     ToSystemPath (
                         Toolchain::GetProgram ("gnu", "make",
@@ -1229,21 +1650,42 @@ namespace thekogans {
                 if (hide_commands) {
                     arguments.push_back ("--quiet");
                 }
+                // Instead of having make hold back whole recipe outputs
+                // (--output-sync), stream prefixed lines whenever more
+                // than one job can be writing at once.
+                bool streamOutput = parallel_build || concurrency > 1;
+                // Keep concurrent links (and the host's memory) in check.
+                ResourceBudget budget = ResourceBudget::FromEnvironment (concurrency);
                 if (parallel_build) {
-                    arguments.push_back ("--output-sync");
-                    arguments.push_back ("-j");
+                    // Every running make holds a single token. Split the
+                    // host's CPUs between the makes that can run at once
+                    // instead of letting each run an unbounded number of
+                    // jobs.
+                    util::ui32 makeCount = std::max<util::ui32> (1,
+                        std::min (concurrency, budget.compileTokens));
+                    util::ui32 makeJobs = std::max<util::ui32> (1,
+                        std::max (1u, std::thread::hardware_concurrency ()) / makeCount);
+                    arguments.push_back ("-j" + util::ui32Tostring (makeJobs));
                 }
                 arguments.push_back ("mode=" + mode);
                 arguments.push_back ("hide_commands=" + std::string (hide_commands ? VALUE_YES : VALUE_NO));
+                ProcessAccounting::Instance ().Reset ();
+                util::f64 defaultDuration =
+                    BuildHistory::Instance ().GetAverageDuration (DEFAULT_BUILD_DURATION);
+                Scheduler scheduler;
                 if (target != TARGET_CLEAN_SELF) {
-                    std::set<std::string> builtProjects;
-                    BuildProjectHelper (
+                    std::map<std::string, util::ui32> builtProjects;
+                    util::ui32 job = BuildProjectHelper (
                         project_root,
                         config_,
                         target == TARGET_TESTS || target == TARGET_TESTS_SELF ? TYPE_STATIC : type,
                         gnu_make,
                         arguments,
+                        streamOutput,
                         target,
+                        defaultDuration,
+                        projects,
+                        scheduler,
                         builtProjects);
                     if (target == TARGET_ALL || target == TARGET_TESTS || target == TARGET_TESTS_SELF) {
                         const thekogans_make &config = thekogans_make::GetConfig (
@@ -1253,18 +1695,131 @@ namespace thekogans {
                             config_,
                             target == TARGET_TESTS || target == TARGET_TESTS_SELF ? TYPE_STATIC : type);
                         if (config.project_type == PROJECT_TYPE_PROGRAM) {
-                            CopyDependencies (project_root, config_, type);
+                            scheduler.AddPostAction (job,
+                                [project_root, config_, type] () {
+                                    CopyDependencies (project_root, config_, type);
+                                });
                         }
                         else if (config.project_type == PROJECT_TYPE_PLUGIN) {
-                            CopyPlugin (project_root, config_);
+                            scheduler.AddPostAction (job,
+                                [project_root, config_] () {
+                                    CopyPlugin (project_root, config_);
+                                });
                         }
                     }
                 }
                 else {
+                    const thekogans_make &config = thekogans_make::GetConfig (
+                        project_root,
+                        THEKOGANS_MAKE_XML,
+                        MAKE,
+                        config_,
+                        type);
+                    std::string project = config.organization + ORGANIZATION_PROJECT_SEPARATOR + config.project;
                     std::string build_root = GetBuildRoot (project_root, "make", config_, type);
-                    Execgnu_make (build_root, gnu_make, arguments, target);
-                    DeleteFile (MakePath (build_root, MAKEFILE));
+                    std::string variant = BuildHistory::GetVariant (config_, type, target);
+                    std::string outputPrefix = GetOutputPrefix (streamOutput, project, variant);
+                    util::ui32 job = scheduler.AddJob (
+                        project,
+                        BuildHistory::Instance ().GetDuration (project_root, variant, defaultDuration),
+                        [project, build_root, gnu_make, arguments, target, outputPrefix] () {
+                            Execgnu_make (project, build_root, gnu_make, arguments, target, outputPrefix);
+                        });
+                    scheduler.AddPostAction (job,
+                        [&scheduler, job, project_root, variant] () {
+                            BuildHistory::Instance ().Add (
+                                project_root, variant, scheduler.jobs[job].duration);
+                        });
+                    scheduler.AddPostAction (job,
+                        [build_root] () {
+                            DeleteFile (MakePath (build_root, MAKEFILE));
+                            Fingerprint::Delete (MakePath (build_root, FINGERPRINT_FILE));
+                        });
+                }
+                try {
+                    scheduler.Run (concurrency,
+                        BuildProgress::Instance ().IsEnabled () ?
+                            [] (const Scheduler::Progress &progress) {
+                                BuildProgress::Instance ().Report (progress);
+                            } :
+                            Scheduler::ProgressCallback (),
+                        &budget);
+                }
+                catch (...) {
+                    // Keep the durations of the projects that did build.
+                    BuildHistory::Instance ().Save ();
+                    throw;
+                }
+                BuildHistory::Instance ().Save ();
+                // Through Console, so that it comes after the queued
+                // post action output (Copying...), not before it.
+                std::ostringstream report;
+                report << "Child process resource usage:" << std::endl;
+                ProcessAccounting::Instance ().Report (report);
+                scheduler.ReportCriticalPath (report);
+                THEKOGANS_MAKE_CORE_CONSOLE_INFO (report.str ());
+            }
+
+            _LIB_THEKOGANS_MAKE_CORE_DECL void _LIB_THEKOGANS_MAKE_CORE_API BuildAffectedProjects (
+                    const std::string &project_root,
+                    const std::string &config,
+                    const std::string &type,
+                    const std::string &mode,
+                    bool hide_commands,
+                    bool parallel_build,
+                    const std::string &target,
+                    util::ui32 concurrency,
+                    const std::set<std::string> &changedPaths) {
+                ProjectGraph graph (
+                    project_root,
+                    config,
+                    target == TARGET_TESTS || target == TARGET_TESTS_SELF ? TYPE_STATIC : type);
+                std::set<std::string> affectedProjects;
+                if (target == TARGET_TESTS || target == TARGET_TESTS_SELF) {
+                    // Changes confined to a project's tests don't
+                    // retest (or rebuild) its dependents.
+                    IncludeScanner includeScanner;
+                    graph.GetImpactedProjects (changedPaths, includeScanner, affectedProjects);
+                    includeScanner.Save ();
+                }
+                else {
+                    graph.GetAffectedProjects (changedPaths, affectedProjects);
                 }
+                if (affectedProjects.empty ()) {
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("No project in " << project_root <<
+                        " is affected by the changes." << std::endl);
+                    return;
+                }
+                THEKOGANS_MAKE_CORE_CONSOLE_INFO (affectedProjects.size () << " of " <<
+                    graph.projects.size () << " project(s) affected:" << std::endl);
+                for (std::set<std::string>::const_iterator
+                        it = affectedProjects.begin (),
+                        end = affectedProjects.end (); it != end; ++it) {
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("  " << *it << std::endl);
+                }
+                BuildProject (
+                    project_root,
+                    config,
+                    type,
+                    mode,
+                    hide_commands,
+                    parallel_build,
+                    target,
+                    concurrency,
+                    affectedProjects);
+            }
+
+            _LIB_THEKOGANS_MAKE_CORE_DECL util::ui32 _LIB_THEKOGANS_MAKE_CORE_API BuildProjectNative (
+                    const std::string &project_root,
+                    const std::string &config,
+                    const std::string &type,
+                    util::ui32 concurrency) {
+                // Configs are evaluated as they are for the make
+                // generator so that custom build outputs land in
+                // the same place.
+                BuildGraph graph (project_root, "make", config, type);
+                Executor executor (graph);
+                return executor.Run (concurrency);
             }
 
         } // namespace core
@@ -0,0 +1,225 @@
+// Copyright 2011 Boris Kogan (boris@thekogans.net)
+//
+// This file is part of thekogans_make_core.
+//
+// thekogans_make_core is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// thekogans_make_core is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with thekogans_make_core. If not, see <http://www.gnu.org/licenses/>.
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include "thekogans/util/Path.h"
+#include "thekogans/util/Exception.h"
+#include "thekogans/util/LoggerMgr.h"
+#include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Console.h"
+#include "thekogans/make/core/Watch.h"
+
+namespace thekogans {
+    namespace make {
+        namespace core {
+
+            Watch::Watch (
+                    const std::string &project_root_,
+                    const std::string &config_,
+                    const std::string &type_,
+                    const std::string &target_,
+                    util::ui32 concurrency_,
+                    util::ui32 debounce_) :
+                    project_root (project_root_),
+                    config (config_),
+                    type (target_ == TARGET_TESTS || target_ == TARGET_TESTS_SELF ? TYPE_STATIC : type_),
+                    target (target_),
+                    concurrency (concurrency_),
+                    debounce (debounce_) {
+                if (pipe2 (stopPipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+            }
+
+            Watch::~Watch () {
+                close (stopPipe[0]);
+                close (stopPipe[1]);
+            }
+
+            void Watch::Run () {
+                Scan ();
+                Build (std::set<std::string> ());
+                while (1) {
+                    bool stop = false;
+                    if (!Wait (-1, stop)) {
+                        if (stop) {
+                            break;
+                        }
+                        continue;
+                    }
+                    // Editors (and git checkouts) touch many files in quick
+                    // succession. Keep collecting until things quiet down.
+                    std::set<std::string> paths;
+                    bool complete = watcher.Read (paths);
+                    while (Wait (debounce, stop)) {
+                        complete = watcher.Read (paths) && complete;
+                    }
+                    if (stop) {
+                        break;
+                    }
+                    std::set<std::string> changedProjects;
+                    if (complete) {
+                        bool configChanged = false;
+                        for (std::set<std::string>::const_iterator
+                                it = paths.begin (),
+                                end = paths.end (); it != end; ++it) {
+                            // Only listed files count. Anything else under the
+                            // project roots (build output) would trigger endless
+                            // rebuilds.
+                            ProjectGraph::Owners::const_iterator owner = graph->files.find (*it);
+                            if (owner != graph->files.end ()) {
+                                changedProjects.insert (owner->second);
+                                if (util::Path (*it).GetFullFileName () == THEKOGANS_MAKE_XML) {
+                                    std::set<std::string> flushedRoots;
+                                    thekogans_make::FlushConfig (owner->second, flushedRoots);
+                                    configChanged = true;
+                                }
+                            }
+                        }
+                        if (configChanged) {
+                            THEKOGANS_UTIL_TRY {
+                                Scan ();
+                            }
+                            THEKOGANS_UTIL_CATCH (util::Exception) {
+                                // Keep the old maps and wait for the config to be fixed.
+                                THEKOGANS_MAKE_CORE_CONSOLE_ERROR (exception.Report () << std::endl);
+                                continue;
+                            }
+                        }
+                    }
+                    else {
+                        // Change notifications were lost. Start over.
+                        thekogans_make::FlushConfigs ();
+                        THEKOGANS_UTIL_TRY {
+                            Scan ();
+                        }
+                        THEKOGANS_UTIL_CATCH (util::Exception) {
+                            THEKOGANS_MAKE_CORE_CONSOLE_ERROR (exception.Report () << std::endl);
+                            continue;
+                        }
+                        Build (std::set<std::string> ());
+                        continue;
+                    }
+                    if (!changedProjects.empty ()) {
+                        std::set<std::string> projects;
+                        graph->GetDependents (changedProjects, projects);
+                        Build (projects);
+                    }
+                }
+            }
+
+            void Watch::Stop () {
+                char ch = 0;
+                ssize_t result = write (stopPipe[1], &ch, 1);
+                (void)result;
+            }
+
+            void Watch::Scan () {
+                // Load the new graph on the side so that a broken config
+                // leaves the old one (and the watches) in place.
+                ProjectGraph::Ptr newGraph (new ProjectGraph (project_root, config, type));
+                for (ProjectGraph::Owners::const_iterator
+                        it = newGraph->files.begin (),
+                        end = newGraph->files.end (); it != end; ++it) {
+                    std::string directory = util::Path (it->first).GetDirectory ();
+                    if (!watcher.IsWatched (directory)) {
+                        THEKOGANS_UTIL_TRY {
+                            watcher.AddDirectory (directory);
+                        }
+                        THEKOGANS_UTIL_CATCH (util::Exception) {
+                            THEKOGANS_UTIL_LOG_WARNING ("%s\n", exception.Report ().c_str ());
+                        }
+                    }
+                }
+                graph.swap (newGraph);
+                THEKOGANS_MAKE_CORE_CONSOLE_INFO (
+                    "Watching " << graph->files.size () << " files in " <<
+                    graph->projects.size () << " project(s)." << std::endl);
+            }
+
+            bool Watch::Wait (
+                    util::i32 timeout,
+                    bool &stop) {
+                pollfd fds[2];
+                fds[0].fd = stopPipe[0];
+                fds[1].fd = watcher.GetHandle ();
+                for (std::size_t i = 0; i < 2; ++i) {
+                    fds[i].events = POLLIN;
+                    fds[i].revents = 0;
+                }
+                int result;
+                do {
+                    result = poll (fds, 2, timeout);
+                } while (result < 0 && errno == EINTR);
+                if (result < 0) {
+                    THEKOGANS_UTIL_THROW_ERROR_CODE_EXCEPTION (
+                        THEKOGANS_UTIL_OS_ERROR_CODE);
+                }
+                if ((fds[0].revents & POLLIN) != 0) {
+                    stop = true;
+                    return false;
+                }
+                return (fds[1].revents & POLLIN) != 0;
+            }
+
+            void Watch::Build (const std::set<std::string> &projects) {
+                if (projects.empty ()) {
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Building " << project_root << std::endl);
+                }
+                else {
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO (
+                        "Rebuilding " << projects.size () << " project(s):" << std::endl);
+                    for (std::set<std::string>::const_iterator
+                            it = projects.begin (),
+                            end = projects.end (); it != end; ++it) {
+                        THEKOGANS_MAKE_CORE_CONSOLE_INFO ("  " << *it << std::endl);
+                    }
+                }
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+                THEKOGANS_UTIL_TRY {
+                    BuildProject (
+                        project_root,
+                        config,
+                        type,
+                        MODE_DEVELOPMENT,
+                        false,
+                        false,
+                        target,
+                        concurrency,
+                        projects);
+                    // Through Console, so that it comes after the
+                    // build output it summarizes.
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO (
+                        "Build succeeded in " <<
+                        std::chrono::duration<util::f64> (
+                            std::chrono::steady_clock::now () - start).count () <<
+                        " seconds. Watching for changes..." << std::endl);
+                }
+                THEKOGANS_UTIL_CATCH (util::Exception) {
+                    THEKOGANS_MAKE_CORE_CONSOLE_ERROR (exception.Report () << std::endl);
+                    THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Build failed. Watching for changes..." << std::endl);
+                }
+            }
+
+        } // namespace core
+    } // namespace make
+} // namespace thekogans
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <regex>
 #include <sstream>
+#include <mutex>
 #include "thekogans/util/Types.h"
 #include "thekogans/util/Version.h"
 #include "thekogans/util/Path.h"
@@ -31,7 +32,10 @@
 #include "thekogans/make/core/Function.h"
 #include "thekogans/make/core/Project.h"
 #include "thekogans/make/core/Toolchain.h"
+#include "thekogans/make/core/Stats.h"
+#include "thekogans/make/core/Tracer.h"
 #include "thekogans/make/core/Utils.h"
+#include "thekogans/make/core/Console.h"
 #include "thekogans/make/core/Version.h"
 #include "thekogans/make/core/thekogans_make.h"
 
@@ -62,6 +66,9 @@ namespace thekogans {
             const char * const thekogans_make::ATTR_CONFIG = "config";
             const char * const thekogans_make::ATTR_TYPE = "type";
             const char * const thekogans_make::ATTR_FLAGS = "flags";
+            const char * const thekogans_make::ATTR_UNITY = "unity";
+            const char * const thekogans_make::ATTR_UNITY_BATCH_SIZE = "unity_batch_size";
+            const char * const thekogans_make::ATTR_AUTO = "auto";
 
             const char * const thekogans_make::TAG_THEKOGANS_MAKE = "thekogans_make";
             const char * const thekogans_make::TAG_CONSTANTS = "constants";
@@ -387,12 +394,11 @@ namespace thekogans {
                                             (!it->second.empty () ? it->second + DECORATIONS_SEPARATOR + it->first : it->first);
 
                                     }
-                                    std::cout << "WARNING: Found multiple versions for " <<
+                                    THEKOGANS_MAKE_CORE_CONSOLE_WARNING ("WARNING: Found multiple versions for " <<
                                         projectName << ": " << dependencyVersions << " (using " <<
                                         (!versionSet.begin ()->second.empty () ?
                                             versionSet.begin ()->second + DECORATIONS_SEPARATOR + versionSet.begin ()->first :
-                                            versionSet.begin ()->first) << ")" << std::endl;
-                                    std::cout.flush ();
+                                            versionSet.begin ()->first) << ")" << std::endl);
                                 }
                                 if (version.empty ()) {
                                     std::string floatingVersion = config.GetVersion ();
@@ -758,10 +764,9 @@ namespace thekogans {
                                     while (++it != end) {
                                         dependencyVersions += ", " + it->first;
                                     }
-                                    std::cout << "WARNING: Found multiple versions for " <<
+                                    THEKOGANS_MAKE_CORE_CONSOLE_WARNING ("WARNING: Found multiple versions for " <<
                                         projectName << ": " << dependencyVersions << " (using " <<
-                                        versionSet.begin ()->first << ")" << std::endl;
-                                    std::cout.flush ();
+                                        versionSet.begin ()->first << ")" << std::endl);
                                 }
                                 version = versionSet.begin ()->first;
                             }
@@ -856,6 +861,7 @@ namespace thekogans {
                             }
                             else {
                                 std::string include_directory = config.GetToolchainIncludeDirectory ();
+                                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                                 if (util::Path (ToSystemPath (include_directory)).Exists ()) {
                                     include_directories.insert (include_directory);
                                 }
@@ -893,6 +899,7 @@ namespace thekogans {
                             }
                             else {
                                 std::string link_library = config.GetToolchainLinkLibrary ();
+                                THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                                 if (util::Path (ToSystemPath (link_library)).Exists ()) {
                                     link_libraries.push_back (link_library);
                                 }
@@ -941,6 +948,7 @@ namespace thekogans {
                                 }
                                 else {
                                     std::string shared_library = config.GetToolchainGoal ();
+                                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (FILE_STATS);
                                     if (util::Path (ToSystemPath (shared_library)).Exists ()) {
                                         shared_libraries.insert (shared_library);
                                     }
@@ -1423,6 +1431,15 @@ namespace thekogans {
                     static ConfigMap configMap;
                     return configMap;
                 }
+
+                // Generators run on pool threads (see GenerateParallel)
+                // and can ask for configs that were never cached. Recursive
+                // because parsing a config gets the configs of its
+                // dependencies.
+                std::recursive_mutex &GetConfigMapMutex () {
+                    static std::recursive_mutex configMapMutex;
+                    return configMapMutex;
+                }
             }
 
             const thekogans_make &thekogans_make::GetConfig (
@@ -1431,6 +1448,7 @@ namespace thekogans {
                     const std::string &generator,
                     const std::string &config,
                     const std::string &type) {
+                std::lock_guard<std::recursive_mutex> guard (GetConfigMapMutex ());
                 ConfigMap &configMap = GetConfigMap ();
                 std::string configKey =
                     GetConfigKey (project_root, config_file, generator, config, type);
@@ -1454,6 +1472,7 @@ namespace thekogans {
                                         type))));
                     if (result.second) {
                         it = result.first;
+                        THEKOGANS_MAKE_CORE_STATS_INCREMENT (CONFIGS_PARSED);
                     }
                     else {
                         THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
@@ -1461,13 +1480,63 @@ namespace thekogans {
                             configKey.c_str ());
                     }
                 }
+                else {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (CONFIG_CACHE_HITS);
+                }
                 return *it->second;
             }
 
+            void thekogans_make::FlushConfigs () {
+                std::lock_guard<std::recursive_mutex> guard (GetConfigMapMutex ());
+                GetConfigMap ().clear ();
+            }
+
+            void thekogans_make::FlushConfig (
+                    const std::string &project_root,
+                    std::set<std::string> &flushedRoots) {
+                std::lock_guard<std::recursive_mutex> guard (GetConfigMapMutex ());
+                ConfigMap &configMap = GetConfigMap ();
+                std::set<std::string> roots;
+                roots.insert (project_root);
+                // Every variant of project_root goes first. Then keep
+                // sweeping the map for configs that depend (directly or
+                // through a plugin host) on a flushed root until nothing
+                // else is removed.
+                while (!roots.empty ()) {
+                    flushedRoots.insert (roots.begin (), roots.end ());
+                    std::set<std::string> dependents;
+                    for (ConfigMap::iterator it = configMap.begin (); it != configMap.end ();) {
+                        const thekogans_make &config = *it->second;
+                        bool flush = roots.find (config.project_root) != roots.end ();
+                        for (std::list<Dependency::Ptr>::const_iterator
+                                jt = config.dependencies.begin (),
+                                end = config.dependencies.end (); !flush && jt != end; ++jt) {
+                            flush = (*jt)->GetConfigFile () == THEKOGANS_MAKE_XML &&
+                                roots.find ((*jt)->GetProjectRoot ()) != roots.end ();
+                        }
+                        for (std::list<Dependency::Ptr>::const_iterator
+                                jt = config.plugin_hosts.begin (),
+                                end = config.plugin_hosts.end (); !flush && jt != end; ++jt) {
+                            flush = (*jt)->GetConfigFile () == THEKOGANS_MAKE_XML &&
+                                roots.find ((*jt)->GetProjectRoot ()) != roots.end ();
+                        }
+                        if (flush) {
+                            if (flushedRoots.find (config.project_root) == flushedRoots.end ()) {
+                                dependents.insert (config.project_root);
+                            }
+                            configMap.erase (it++);
+                        }
+                        else {
+                            ++it;
+                        }
+                    }
+                    roots.swap (dependents);
+                }
+            }
+
             void thekogans_make::CheckDependencies () const {
-                std::cout << "Checking dependencies for " <<
-                    MakePath (project_root, config_file) << std::endl;
-                std::cout.flush ();
+                THEKOGANS_MAKE_CORE_CONSOLE_INFO ("Checking dependencies for " <<
+                    MakePath (project_root, config_file) << std::endl);
                 Dependency::Versions versions;
                 for (std::list<Dependency::Ptr>::const_iterator
                         it = dependencies.begin (),
@@ -1562,8 +1631,64 @@ namespace thekogans {
                 }
             }
 
+            void thekogans_make::GetFiles (
+                    std::set<std::string> &files,
+                    std::set<std::string> *prefixes) const {
+                const std::list<FileList::Ptr> *fileLists[] = {
+                    &masm_headers, &masm_sources, &masm_tests,
+                    &nasm_headers, &nasm_sources, &nasm_tests,
+                    &c_headers, &c_sources, &c_tests,
+                    &cpp_headers, &cpp_sources, &cpp_tests,
+                    &objective_c_headers, &objective_c_sources, &objective_c_tests,
+                    &objective_cpp_headers, &objective_cpp_sources, &objective_cpp_tests,
+                    &resources,
+                    &rc_sources
+                };
+                for (std::size_t i = 0, count = sizeof (fileLists) / sizeof (fileLists[0]); i < count; ++i) {
+                    for (std::list<FileList::Ptr>::const_iterator
+                            it = fileLists[i]->begin (),
+                            end = fileLists[i]->end (); it != end; ++it) {
+                        std::string prefix = MakePath (project_root, (*it)->prefix);
+                        if (prefixes != 0) {
+                            prefixes->insert (prefix);
+                        }
+                        for (std::list<FileList::File::Ptr>::const_iterator
+                                jt = (*it)->files.begin (),
+                                end = (*it)->files.end (); jt != end; ++jt) {
+                            files.insert (MakePath (prefix, (*jt)->name));
+                        }
+                    }
+                }
+            }
+
+            void thekogans_make::GetTestFiles (std::set<std::string> &files) const {
+                const std::list<FileList::Ptr> *fileLists[] = {
+                    &masm_tests,
+                    &nasm_tests,
+                    &c_tests,
+                    &cpp_tests,
+                    &objective_c_tests,
+                    &objective_cpp_tests
+                };
+                for (std::size_t i = 0, count = sizeof (fileLists) / sizeof (fileLists[0]); i < count; ++i) {
+                    for (std::list<FileList::Ptr>::const_iterator
+                            it = fileLists[i]->begin (),
+                            end = fileLists[i]->end (); it != end; ++it) {
+                        std::string prefix = MakePath (project_root, (*it)->prefix);
+                        for (std::list<FileList::File::Ptr>::const_iterator
+                                jt = (*it)->files.begin (),
+                                end = (*it)->files.end (); jt != end; ++jt) {
+                            files.insert (MakePath (prefix, (*jt)->name));
+                        }
+                    }
+                }
+            }
+
             bool thekogans_make::Eval (const char *expression) const {
                 if (expression != 0) {
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (EVAL_CALLS);
+                    THEKOGANS_MAKE_CORE_TRACE_THRESHOLD_SCOPE ("expression", "Eval");
+                    THEKOGANS_MAKE_CORE_TRACE_ARG ("expression", expression);
                     THEKOGANS_UTIL_TRY {
                         Tokenizer tokenizer (expression, *this);
                         Parser parser (tokenizer);
@@ -1595,15 +1720,20 @@ namespace thekogans {
                 if (it != EnvironmentSymbolTable::Instance ().end ()) {
                     return it->second;
                 }
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (ENVIRONMENT_LOOKUPS);
                 std::string environmentVariable =
                     util::GetEnvironmentVariable (symbol.c_str ());
                 if (!environmentVariable.empty ()) {
                     return Value (environmentVariable);
                 }
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (ENVIRONMENT_MISSES);
                 return Value ();
             }
 
             std::string thekogans_make::Expand (const char *format) const {
+                THEKOGANS_MAKE_CORE_STATS_INCREMENT (EXPAND_CALLS);
+                THEKOGANS_MAKE_CORE_TRACE_THRESHOLD_SCOPE ("expression", "Expand");
+                THEKOGANS_MAKE_CORE_TRACE_ARG ("format", format);
                 std::string expanded;
                 std::size_t formatLength = strlen (format);
                 util::TenantReadBuffer buffer (util::HostEndian, format, formatLength);
@@ -1921,6 +2051,9 @@ namespace thekogans {
                     config (config_),
                     type (type_),
                     guid (util::GUID::Empty) {
+                THEKOGANS_MAKE_CORE_TRACE_SCOPE ("config", "thekogans_make");
+                THEKOGANS_MAKE_CORE_TRACE_ARG ("project_root", project_root);
+                THEKOGANS_MAKE_CORE_TRACE_ARG ("config", config + "/" + type);
                 if (generator.empty ()) {
                     generator = MAKE;
                 }
@@ -2625,6 +2758,7 @@ namespace thekogans {
                         std::list<std::string> &results) {
                     util::Directory directory (ToSystemPath (MakePath (prefix, branch)));
                     util::Directory::Entry entry;
+                    THEKOGANS_MAKE_CORE_STATS_INCREMENT (DIRECTORY_SCANS);
                     try {
                         std::regex regex (pattern, flags);
                         for (bool gotEntry = directory.GetFirstEntry (entry);
@@ -2651,6 +2785,17 @@ namespace thekogans {
                 if (!destinationPrefix.empty ()) {
                     fileList.destinationPrefix = destinationPrefix;
                 }
+                fileList.unity = Expand (node.attribute (ATTR_UNITY).value ()) == VALUE_YES;
+                std::string unityBatchSize = Expand (node.attribute (ATTR_UNITY_BATCH_SIZE).value ());
+                if (!unityBatchSize.empty ()) {
+                    fileList.unityBatchSize = util::stringToui32 (unityBatchSize.c_str ());
+                    if (fileList.unityBatchSize == 0) {
+                        THEKOGANS_UTIL_THROW_STRING_EXCEPTION (
+                            "Invalid %s: %s",
+                            ATTR_UNITY_BATCH_SIZE,
+                            unityBatchSize.c_str ());
+                    }
+                }
                 SymbolTableMgr symbolTableMgr (localSymbolTable);
                 localSymbolTable[ATTR_PREFIX] = Value (fileList.prefix);
                 localSymbolTable[ATTR_INSTALL] = Value (fileList.install);
@@ -2711,6 +2856,7 @@ namespace thekogans {
             void thekogans_make::ParseFile (
                     pugi::xml_node &node,
                     FileList::File &file) {
+                file.unity = Expand (node.attribute (ATTR_UNITY).value ()) != VALUE_NO;
                 for (pugi::xml_node child = node.first_child ();
                         !child.empty (); child = child.next_sibling ()) {
                     if (child.type () == pugi::node_element) {
@@ -2800,6 +2946,8 @@ namespace thekogans {
                     PrecompiledHeader &precompiledHeader) {
                 precompiledHeader.type = PrecompiledHeader::stringToType (
                     Expand (node.attribute (ATTR_TYPE).value ()));
+                precompiledHeader.automatic =
+                    Expand (node.attribute (ATTR_AUTO).value ()) == VALUE_YES;
                 for (pugi::xml_node child = node.first_child ();
                         !child.empty (); child = child.next_sibling ()) {
                     if (child.type () == pugi::node_element) {
@@ -3011,6 +3159,8 @@ namespace thekogans {
                     pugi::xml_node &root) {
                 std::string configFilePath =
                     ToSystemPath (MakePath (project_root, config_file));
+                THEKOGANS_MAKE_CORE_TRACE_SCOPE ("config", "CreateDOM");
+                THEKOGANS_MAKE_CORE_TRACE_ARG ("path", configFilePath);
                 util::ReadOnlyFile configFile (util::HostEndian, configFilePath);
                 // Protect yourself.
                 const util::ui32 MAX_CONFIG_FILE_SIZE = 1024 * 1024;